@@ -34,6 +34,9 @@
 
 #include "sensors/sensors.h"
 #include "sensors/gyro.h"
+#include "sensors/gyro_redundancy.h"
+#include "sensors/vibration.h"
+
 
 #include "io/statusindicator.h"
 #include "sensors/acceleration.h"
@@ -43,6 +46,8 @@
 #include "telemetry/telemetry.h"
 
 #include "flight/mixer.h"
+#include "flight/thrust_linear.h"
+#include "flight/servo_output.h"
 #include "sensors/boardalignment.h"
 #include "sensors/battery.h"
 #include "io/gimbal.h"
@@ -51,8 +56,10 @@
 #include "io/rc_controls.h"
 #include "io/rc_curves.h"
 #include "io/gps.h"
+#include "io/flight_log.h"
 #include "flight/failsafe.h"
 #include "flight/imu.h"
+#include "flight/altitude_controller.h"
 #include "flight/navigation.h"
 
 #include "config/runtime_config.h"
@@ -86,7 +93,7 @@ static uint32_t flashWriteAddress = (0x08000000 + (uint32_t)((FLASH_PAGE_SIZE *
 master_t masterConfig;      // master config struct with data independent from profiles
 profile_t currentProfile;   // profile config struct
 
-static const uint8_t EEPROM_CONF_VERSION = 75;
+static const uint8_t EEPROM_CONF_VERSION = 86;
 
 static void resetAccelerometerTrims(flightDynamicsTrims_t *accelerometerTrims)
 {
@@ -165,6 +172,7 @@ void resetSensorAlignment(sensorAlignmentConfig_t *sensorAlignmentConfig)
     sensorAlignmentConfig->gyro_align = ALIGN_DEFAULT;
     sensorAlignmentConfig->acc_align = ALIGN_DEFAULT;
     sensorAlignmentConfig->mag_align = ALIGN_DEFAULT;
+    sensorAlignmentConfig->gyro_secondary_align = ALIGN_DEFAULT;
 }
 
 void resetEscAndServoConfig(escAndServoConfig_t *escAndServoConfig)
@@ -203,6 +211,7 @@ void resetSerialConfig(serialConfig_t *serialConfig)
 #endif
 
     serialConfig->msp_baudrate = 115200;
+    serialConfig->msp_time_budget = 300;
     serialConfig->cli_baudrate = 115200;
     serialConfig->gps_baudrate = 115200;
     serialConfig->gps_passthrough_baudrate = 115200;
@@ -245,6 +254,11 @@ static void resetConf(void)
     masterConfig.max_angle_inclination = 500;    // 50 degrees
     masterConfig.yaw_control_direction = 1;
     masterConfig.gyroConfig.gyroMovementCalibrationThreshold = 32;
+    masterConfig.gyroRedundancyConfig.gyro_redundancy = 0;
+    masterConfig.gyroRedundancyConfig.gyro_vote_threshold = 500;
+    masterConfig.gyroRedundancyConfig.gyro_fault_cycles = 20;
+    masterConfig.vibrationConfig.acc_vibration_warning = 0;
+    masterConfig.flightLogConfig.flight_log_rate = 1;
 
     masterConfig.batteryConfig.vbatscale = 110;
     masterConfig.batteryConfig.vbatmaxcellvoltage = 43;
@@ -263,6 +277,8 @@ static void resetConf(void)
     masterConfig.inputFilteringMode = INPUT_FILTERING_DISABLED;
 
     masterConfig.retarded_arm = 0;              // disable arm/disarm on roll left/right
+    masterConfig.stickCommandConfig.arm_hold_time = 400;
+    masterConfig.stickCommandConfig.command_hold_time = 400;
     masterConfig.small_angle = 25;
 
     masterConfig.airplaneConfig.flaps_speed = 0;
@@ -271,12 +287,14 @@ static void resetConf(void)
     // Motor/ESC/Servo
     resetEscAndServoConfig(&masterConfig.escAndServoConfig);
     resetFlight3DConfig(&masterConfig.flight3DConfig);
+    masterConfig.thrustLinearConfig.thrust_linear = 0;
 
 #ifdef BRUSHED_MOTORS
     masterConfig.motor_pwm_rate = BRUSHED_MOTORS_PWM_RATE;
 #else
     masterConfig.motor_pwm_rate = BRUSHLESS_MOTORS_PWM_RATE;
 #endif
+    masterConfig.motor_pwm_dither = 1;
     masterConfig.servo_pwm_rate = 50;
 
 #ifdef GPS
@@ -323,6 +341,8 @@ static void resetConf(void)
     currentProfile.yaw_deadband = 0;
     currentProfile.alt_hold_deadband = 40;
     currentProfile.alt_hold_fast_change = 1;
+    currentProfile.alt_hold_hover_learn = 10;
+    currentProfile.alt_hold_accel_gain = 100;
     currentProfile.throttle_correction_value = 0;      // could 10 with althold or 40 for fpv
     currentProfile.throttle_correction_angle = 800;    // could be 80.0 deg with atlhold or 45.0 for fpv
 
@@ -344,6 +364,7 @@ static void resetConf(void)
 
     currentProfile.mixerConfig.yaw_direction = 1;
     currentProfile.mixerConfig.tri_unarmed_servo = 1;
+    currentProfile.mixerConfig.vbat_pid_compensation = 0;
 
     // gimbal
     currentProfile.gimbalConfig.gimbal_flags = GIMBAL_NORMAL;
@@ -401,6 +422,14 @@ void activateConfig(void)
     generateThrottleCurve(&currentProfile.controlRateConfig, &masterConfig.escAndServoConfig);
 
     useGyroConfig(&masterConfig.gyroConfig);
+    useGyroRedundancyConfig(&masterConfig.gyroRedundancyConfig);
+    useVibrationConfig(&masterConfig.vibrationConfig);
+#ifdef FLASH_LOG
+    useFlightLogConfig(&masterConfig.flightLogConfig);
+#endif
+    thrustLinearInit(&masterConfig.thrustLinearConfig);
+    servoOutputInit(masterConfig.servoOutputConf);
+
 #ifdef TELEMETRY
     useTelemetryConfig(&masterConfig.telemetryConfig);
 #endif
@@ -427,13 +456,20 @@ void activateConfig(void)
     imuRuntimeConfig.acc_unarmedcal = currentProfile.acc_unarmedcal;;
     imuRuntimeConfig.small_angle = masterConfig.small_angle;
 
-    configureImu(&imuRuntimeConfig, &currentProfile.pidProfile, &currentProfile.barometerConfig, &currentProfile.accDeadband);
+    configureImu(&imuRuntimeConfig, &currentProfile.barometerConfig, &currentProfile.accDeadband);
 
     calculateThrottleAngleScale(currentProfile.throttle_correction_angle);
     calculateAccZLowPassFilterRCTimeConstant(currentProfile.accz_lpf_cutoff);
 
 #ifdef BARO
     useBarometerConfig(&currentProfile.barometerConfig);
+    configureAltitudeController(
+            &currentProfile.pidProfile,
+            currentProfile.alt_hold_hover_learn,
+            currentProfile.alt_hold_accel_gain,
+            masterConfig.escAndServoConfig.minthrottle,
+            masterConfig.escAndServoConfig.maxthrottle
+            );
 #endif
 }
 
@@ -33,9 +33,12 @@ typedef struct master_t {
     // motor/esc/servo related stuff
     escAndServoConfig_t escAndServoConfig;
     flight3DConfig_t flight3DConfig;
+    thrustLinearConfig_t thrustLinearConfig;
 
     uint16_t motor_pwm_rate;                // The update rate of motor outputs (50-498Hz)
+    uint8_t motor_pwm_dither;               // Dither brushed motor outputs to recover the resolution a high motor_pwm_rate leaves
     uint16_t servo_pwm_rate;                // The update rate of servo outputs (50-498Hz)
+    servoOutputConfig_t servoOutputConf[MAX_SUPPORTED_SERVOS]; // per servo output rate and conditioning
 
     // global sensor-related stuff
 
@@ -49,6 +52,10 @@ typedef struct master_t {
     uint16_t gyro_cmpfm_factor;             // Set the Gyro Weight for Gyro/Magnetometer complementary filter. Increasing this value would reduce and delay Magnetometer influence on the output of the filter
 
     gyroConfig_t gyroConfig;
+    gyroRedundancyConfig_t gyroRedundancyConfig;
+    vibrationConfig_t vibrationConfig;
+    flightLogConfig_t flightLogConfig;
+
 
     uint16_t max_angle_inclination;         // max inclination allowed in angle (level) mode. default 500 (50 degrees).
     flightDynamicsTrims_t accZero;
@@ -60,6 +67,7 @@ typedef struct master_t {
     inputFilteringMode_e inputFilteringMode;  // Use hardware input filtering, e.g. for OrangeRX PPM/PWM receivers.
 
     uint8_t retarded_arm;                   // allow disarsm/arm on throttle down + roll left/right
+    stickCommandConfig_t stickCommandConfig;
     uint8_t small_angle;
 
     airplaneConfig_t airplaneConfig;
@@ -49,6 +49,8 @@ typedef struct profile_s {
     uint8_t yaw_deadband;                   // introduce a deadband around the stick center for yaw axis. Must be greater than zero.
     uint8_t alt_hold_deadband;              // defines the neutral zone of throttle stick during altitude hold, default setting is +/-40
     uint8_t alt_hold_fast_change;           // when disabled, turn off the althold when throttle stick is out of deadband defined with alt_hold_deadband; when enabled, altitude changes slowly proportional to stick movement
+    uint8_t alt_hold_hover_learn;           // seconds for the hover throttle to follow the throttle in steady alt hold, 0 takes the throttle when alt hold engages every time
+    uint8_t alt_hold_accel_gain;            // percent of the measured acceleration error alt hold feeds back into the throttle
 
     uint16_t throttle_correction_angle;     // the angle when the throttle correction is maximal. in 0.1 degres, ex 225 = 22.5 ,30.0, 450 = 45.0 deg
     uint8_t throttle_correction_value;      // the correction that will be applied at throttle_correction_angle.
@@ -33,4 +33,5 @@ typedef struct acc_s {
     sensorInitFuncPtr init;                                 // initialize function
     sensorReadFuncPtr read;                                 // read 3 axis data function
     char revisionCode;                                      // a revision code for the sensor, if known
+    uint8_t fullScaleG;                                     // the +/- range the sensor is configured for
 } acc_t;
@@ -78,6 +78,7 @@ bool adxl345Detect(drv_adxl345_config_t *init, acc_t *acc)
 
     acc->init = adxl345Init;
     acc->read = adxl345Read;
+    acc->fullScaleG = 8;
     return true;
 }
 
@@ -45,6 +45,7 @@ bool bma280Detect(acc_t *acc)
 
     acc->init = bma280Init;
     acc->read = bma280Read;
+    acc->fullScaleG = 8;
     return true;
 }
 
@@ -137,6 +137,7 @@ bool lsm303dlhcAccDetect(acc_t *acc)
 
     acc->init = lsm303dlhcAccInit;
     acc->read = lsm303dlhcAccRead;
+    acc->fullScaleG = 4;
     return true;
 }
 
@@ -94,6 +94,8 @@ bool mma8452Detect(acc_t *acc)
 
     acc->init = mma8452Init;
     acc->read = mma8452Read;
+    // low noise mode limits the range to +/-4G
+    acc->fullScaleG = 4;
     device_id = sig;
     return true;
 }
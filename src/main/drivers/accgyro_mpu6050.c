@@ -210,6 +210,7 @@ bool mpu6050AccDetect(acc_t *acc)
 
     acc->init = mpu6050AccInit;
     acc->read = mpu6050AccRead;
+    acc->fullScaleG = 8;
     acc->revisionCode = (mpuAccelTrim == MPU_6050_HALF_RESOLUTION ? 'o' : 'n'); // es/non-es variance between MPU6050 sensors, half of the naze boards are mpu6000ES.
 
     return true;
@@ -261,6 +261,7 @@ bool mpu6000SpiAccDetect(acc_t *acc)
 
     acc->init = mpu6000SpiAccInit;
     acc->read = mpu6000SpiAccRead;
+    acc->fullScaleG = 8;
 
     delay(100);
     return true;
@@ -23,244 +23,409 @@
 #include "build_config.h"
 
 #include "gpio.h"
+#include "bus_i2c.h"
+#include "bus_i2c_soft.h"
 
 // Software I2C driver, using same pins as hardware I2C, with hw i2c module disabled.
-// Can be configured for I2C2 pinout (SCL: PB10, SDA: PB11) or I2C1 pinout (SCL: PB6, SDA: PB7)
+// I2C_DEVICE picks the pins, I2C1 (SCL: PB6, SDA: PB7) or I2C2 (SCL: PB10, SDA: PB11).
+//
+// A transfer is a state machine moved on one half bit at a time by i2cSoftStep().  SCL is low for 1.3us and
+// high for the rest of the 2.5us of 400kHz, 1.2us, and the half bits are timed on the core cycle counter from
+// when the last one was due rather than from when the code got round to it, so the time the driver itself
+// takes does not slow the bus.  An edge that was late still leaves the next phase at least the fast mode
+// minimum, 1.3us low or 0.6us high, from when it was driven; the high phases make up the time.  The blocking
+// calls run the steps back to back; i2cSoftService() runs at most one and returns at once, for a timer
+// interrupt to drive a transfer.
 
 #ifdef SOFT_I2C
 
-#ifdef SOFT_I2C_PB1011
-#define SCL_H         GPIOB->BSRR = Pin_10
-#define SCL_L         GPIOB->BRR  = Pin_10
+#define I2C_SOFT_PERIOD_NS 2500            // 400kHz
+#define I2C_SOFT_LOW_MIN_NS 1300
+#define I2C_SOFT_HIGH_MIN_NS 600
+#define I2C_SOFT_STRETCH_TIMEOUT_US 1000    // longest a slave may hold SCL low
 
-#define SDA_H         GPIOB->BSRR = Pin_11
-#define SDA_L         GPIOB->BRR  = Pin_11
+#define I2C_SOFT_BYTE_HALF_BITS 18          // 8 data bits and the ack
 
-#define SCL_read      (GPIOB->IDR & Pin_10)
-#define SDA_read      (GPIOB->IDR & Pin_11)
-#define I2C_PINS      (Pin_10 | Pin_11)
-#define I2C_GPIO      GPIOB
+#ifndef DWT
+// the cycle counter, which the CMSIS headers of the F1 library do not describe
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+#define DWT ((DWT_Type *)0xE0001000)
+#define DWT_CTRL_CYCCNTENA_Msk 0x00000001
 #endif
 
-#ifdef SOFT_I2C_PB67
-#define SCL_H         GPIOB->BSRR = Pin_6
-#define SCL_L         GPIOB->BRR  = Pin_6
+typedef struct i2cSoftPins_s {
+    GPIO_TypeDef *gpio;
+    uint16_t scl;
+    uint16_t sda;
+} i2cSoftPins_t;
 
-#define SDA_H         GPIOB->BSRR = Pin_7
-#define SDA_L         GPIOB->BRR  = Pin_7
+static const i2cSoftPins_t i2cSoftPinMap[] = {
+    { GPIOB, Pin_6, Pin_7 },
+    { GPIOB, Pin_10, Pin_11 },
+};
 
-#define SCL_read      (GPIOB->IDR & Pin_6)
-#define SDA_read      (GPIOB->IDR & Pin_7)
-#define I2C_PINS      (Pin_6 | Pin_7)
-#define I2C_GPIO      GPIOB
-#endif
+typedef enum {
+    I2C_SOFT_IDLE = 0,
+    I2C_SOFT_START,
+    I2C_SOFT_ADDRESS,
+    I2C_SOFT_REGISTER,
+    I2C_SOFT_RESTART,
+    I2C_SOFT_READ_ADDRESS,
+    I2C_SOFT_WRITE_DATA,
+    I2C_SOFT_READ_DATA,
+    I2C_SOFT_STOP
+} i2cSoftPhase_e;
 
-#ifndef SCL_H
-#error Need to define SOFT_I2C_PB1011 or SOFT_I2C_PB67 (see board.h)
-#endif
+// what the next step reads from the bus before it drives it
+typedef enum {
+    I2C_SOFT_SAMPLE_NONE = 0,
+    I2C_SOFT_SAMPLE_BUS_FREE,
+    I2C_SOFT_SAMPLE_ACK,
+    I2C_SOFT_SAMPLE_BIT
+} i2cSoftSample_e;
+
+static const i2cSoftPins_t *pins = &i2cSoftPinMap[0];
+static uint32_t lowCycles;
+static uint32_t highCycles;
+static uint32_t lowMinCycles;
+static uint32_t highMinCycles;
+static uint32_t stretchTimeoutCycles;
+
+static uint32_t edgeCycles;                 // when the last half bit was due
+static uint32_t drivenAt;                   // and when it was driven
+static uint32_t stretchStartedAt;
+static bool stretching;
+static bool sclHigh;                        // as last driven
 
-static void I2C_delay(void)
+static volatile i2cSoftPhase_e phase = I2C_SOFT_IDLE;
+static i2cSoftSample_e sample;
+static uint8_t halfBit;                     // within the phase
+static uint8_t address;
+static uint8_t reg;
+static uint8_t *buffer;
+static uint8_t length;
+static uint8_t bufferIndex;
+static bool reading;
+static uint8_t shift;                       // the byte being sent or received
+static bool failed;
+
+static uint16_t i2cErrorCount = 0;
+
+#define SCL_read      (pins->gpio->IDR & pins->scl)
+#define SDA_read      (pins->gpio->IDR & pins->sda)
+
+// Both lines in one write.  SDA only changes along with SCL going low, or on its own with SCL high for a
+// start or a stop.
+static void i2cSoftDrive(bool scl, bool sda)
 {
-    volatile int i = 7;
-    while (i) {
-    	i--;
+    pins->gpio->BSRR = (scl ? pins->scl : (uint32_t)pins->scl << 16) | (sda ? pins->sda : (uint32_t)pins->sda << 16);
+    drivenAt = DWT->CYCCNT;
+    sclHigh = scl;
+}
+
+static void i2cSoftAbort(void)
+{
+    i2cErrorCount++;
+    failed = true;
+    i2cSoftDrive(true, true);
+    phase = I2C_SOFT_IDLE;
+}
+
+static void i2cSoftEnterPhase(i2cSoftPhase_e next)
+{
+    phase = next;
+    halfBit = 0;
+
+    switch (next) {
+        case I2C_SOFT_ADDRESS:
+            shift = address << 1 | I2C_Direction_Transmitter;
+            break;
+        case I2C_SOFT_REGISTER:
+            shift = reg;
+            break;
+        case I2C_SOFT_READ_ADDRESS:
+            shift = address << 1 | I2C_Direction_Receiver;
+            break;
+        case I2C_SOFT_WRITE_DATA:
+            shift = buffer[bufferIndex++];
+            break;
+        case I2C_SOFT_READ_DATA:
+            shift = 0;
+            break;
+        default:
+            break;
     }
 }
 
-static bool I2C_Start(void)
+static void i2cSoftNextPhase(void)
 {
-    SDA_H;
-    SCL_H;
-    I2C_delay();
-    if (!SDA_read) {
-    	return false;
+    switch (phase) {
+        case I2C_SOFT_START:
+            i2cSoftEnterPhase(I2C_SOFT_ADDRESS);
+            break;
+        case I2C_SOFT_ADDRESS:
+            i2cSoftEnterPhase(I2C_SOFT_REGISTER);
+            break;
+        case I2C_SOFT_RESTART:
+            i2cSoftEnterPhase(I2C_SOFT_READ_ADDRESS);
+            break;
+        case I2C_SOFT_REGISTER:
+            if (reading) {
+                i2cSoftEnterPhase(I2C_SOFT_RESTART);
+                break;
+            }
+            // fall through
+        case I2C_SOFT_WRITE_DATA:
+            i2cSoftEnterPhase(bufferIndex < length ? I2C_SOFT_WRITE_DATA : I2C_SOFT_STOP);
+            break;
+        case I2C_SOFT_READ_ADDRESS:
+        case I2C_SOFT_READ_DATA:
+            i2cSoftEnterPhase(bufferIndex < length ? I2C_SOFT_READ_DATA : I2C_SOFT_STOP);
+            break;
+        default:
+            phase = I2C_SOFT_IDLE;
+            break;
     }
-    SDA_L;
-    I2C_delay();
-    if (SDA_read) {
-	    return false;
-	}
-    SDA_L;
-    I2C_delay();
-    return true;
 }
 
-static void I2C_Stop(void)
+// A slave holds SCL low after the master lets it go to stretch the clock.  Once it lets go as well the high
+// half bit is timed from then.
+static bool i2cSoftClockReleased(void)
 {
-    SCL_L;
-    I2C_delay();
-    SDA_L;
-    I2C_delay();
-    SCL_H;
-    I2C_delay();
-    SDA_H;
-    I2C_delay();
+    if (sclHigh && !SCL_read) {
+        uint32_t now = DWT->CYCCNT;
+
+        if (!stretching) {
+            stretching = true;
+            stretchStartedAt = now;
+        } else if (now - stretchStartedAt > stretchTimeoutCycles) {
+            stretching = false;
+            i2cSoftAbort();
+        }
+        return false;
+    }
+    if (stretching) {
+        stretching = false;
+        edgeCycles = drivenAt = DWT->CYCCNT;
+        return false;
+    }
+    return true;
 }
 
-static void I2C_Ack(void)
+static void i2cSoftTakeSample(void)
 {
-    SCL_L;
-    I2C_delay();
-    SDA_L;
-    I2C_delay();
-    SCL_H;
-    I2C_delay();
-    SCL_L;
-    I2C_delay();
+    switch (sample) {
+        case I2C_SOFT_SAMPLE_BUS_FREE:
+            if (!SDA_read) {
+                i2cSoftAbort();
+            }
+            break;
+        case I2C_SOFT_SAMPLE_ACK:
+            if (SDA_read) {
+                i2cErrorCount++;
+                failed = true;
+                i2cSoftEnterPhase(I2C_SOFT_STOP);
+            }
+            break;
+        case I2C_SOFT_SAMPLE_BIT:
+            shift = shift << 1 | (SDA_read ? 1 : 0);
+            break;
+        default:
+            break;
+    }
+    sample = I2C_SOFT_SAMPLE_NONE;
 }
 
-static void I2C_NoAck(void)
+// one half bit of the transfer
+static void i2cSoftStep(void)
 {
-    SCL_L;
-    I2C_delay();
-    SDA_H;
-    I2C_delay();
-    SCL_H;
-    I2C_delay();
-    SCL_L;
-    I2C_delay();
+    uint8_t bit;
+
+    if (!i2cSoftClockReleased()) {
+        return;
+    }
+    i2cSoftTakeSample();
+
+    switch (phase) {
+        case I2C_SOFT_IDLE:
+            return;
+
+        case I2C_SOFT_START:
+        case I2C_SOFT_RESTART:
+            // a start from idle finds both lines high, a repeated start lets SDA go with SCL low and then SCL
+            if (halfBit == 0 && phase == I2C_SOFT_START) {
+                halfBit = 1;
+            }
+            if (halfBit == 0) {
+                i2cSoftDrive(false, true);
+            } else if (halfBit == 1) {
+                i2cSoftDrive(true, true);
+                sample = I2C_SOFT_SAMPLE_BUS_FREE;
+            } else {
+                i2cSoftDrive(true, false);
+                i2cSoftNextPhase();
+                return;
+            }
+            break;
+
+        case I2C_SOFT_STOP:
+            i2cSoftDrive(halfBit > 0, halfBit > 1);
+            if (halfBit == 2) {
+                phase = I2C_SOFT_IDLE;
+                return;
+            }
+            break;
+
+        case I2C_SOFT_READ_DATA:
+            bit = halfBit >> 1;
+            if (halfBit == 16) {
+                buffer[bufferIndex++] = shift;
+            }
+            // ack every byte but the last
+            i2cSoftDrive(halfBit & 1, bit < 8 || bufferIndex == length);
+            if (bit < 8 && (halfBit & 1)) {
+                sample = I2C_SOFT_SAMPLE_BIT;
+            }
+            break;
+
+        default:
+            bit = halfBit >> 1;
+            i2cSoftDrive(halfBit & 1, bit == 8 || (shift & (0x80 >> bit)));
+            if (halfBit == I2C_SOFT_BYTE_HALF_BITS - 1) {
+                sample = I2C_SOFT_SAMPLE_ACK;
+            }
+            break;
+    }
+
+    if (++halfBit == I2C_SOFT_BYTE_HALF_BITS) {
+        i2cSoftNextPhase();
+    }
 }
 
-static bool I2C_WaitAck(void)
+// True once the low or high phase of SCL is over.  Held up by more than a little, by an interrupt say, the
+// next phase is timed from now rather than cut short.
+static bool i2cSoftEdgeDue(void)
 {
-    SCL_L;
-    I2C_delay();
-    SDA_H;
-    I2C_delay();
-    SCL_H;
-    I2C_delay();
-    if (SDA_read) {
-        SCL_L;
+    uint32_t now = DWT->CYCCNT;
+    uint32_t phaseCycles = sclHigh ? highCycles : lowCycles;
+    int32_t late = (int32_t)(now - edgeCycles - phaseCycles);
+
+    if (late < 0 || now - drivenAt < (sclHigh ? highMinCycles : lowMinCycles)) {
         return false;
     }
-    SCL_L;
+    edgeCycles += phaseCycles;
+    if (late > (int32_t)(phaseCycles / 4)) {
+        edgeCycles += late;
+    }
     return true;
 }
 
-static void I2C_SendByte(uint8_t byte)
+static void i2cSoftBegin(uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *buf, bool read)
 {
-    uint8_t i = 8;
-    while (i--) {
-        SCL_L;
-        I2C_delay();
-        if (byte & 0x80) {
-    	    SDA_H;
-        } else {
-	        SDA_L;
-	    }
-        byte <<= 1;
-        I2C_delay();
-        SCL_H;
-        I2C_delay();
-    }
-    SCL_L;
+    address = addr_;
+    reg = reg_;
+    buffer = buf;
+    length = len_;
+    bufferIndex = 0;
+    reading = read;
+    failed = false;
+    stretching = false;
+    sample = I2C_SOFT_SAMPLE_NONE;
+    edgeCycles = drivenAt = DWT->CYCCNT - highCycles;
+    i2cSoftEnterPhase(I2C_SOFT_START);
 }
 
-static uint8_t I2C_ReceiveByte(void)
+static bool i2cSoftTransfer(uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *buf, bool read)
 {
-    uint8_t i = 8;
-    uint8_t byte = 0;
-
-    SDA_H;
-    while (i--) {
-        byte <<= 1;
-        SCL_L;
-        I2C_delay();
-        SCL_H;
-        I2C_delay();
-        if (SDA_read) {
-            byte |= 0x01;
+    if (phase != I2C_SOFT_IDLE) {
+        return false;
+    }
+    i2cSoftBegin(addr_, reg_, len_, buf, read);
+    while (phase != I2C_SOFT_IDLE) {
+        if (i2cSoftEdgeDue()) {
+            i2cSoftStep();
         }
     }
-    SCL_L;
-    return byte;
+    return !failed;
+}
+
+// rounded up, the times are minimums
+static uint32_t i2cSoftNsToCycles(uint32_t ns)
+{
+    return (SystemCoreClock / 1000000 * ns + 999) / 1000;
 }
 
-void i2cInit(I2C_TypeDef * I2C)
+void i2cInit(I2CDevice index)
 {
     gpio_config_t gpio;
 
-    gpio.pin = I2C_PINS;
+    if (index > I2CDEV_MAX)
+        index = I2CDEV_MAX;
+    pins = &i2cSoftPinMap[index];
+
+    gpio.pin = pins->scl | pins->sda;
     gpio.speed = Speed_2MHz;
     gpio.mode = Mode_Out_OD;
-    gpioInit(I2C_GPIO, &gpio);
+    gpioInit(pins->gpio, &gpio);
+    i2cSoftDrive(true, true);
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    lowMinCycles = i2cSoftNsToCycles(I2C_SOFT_LOW_MIN_NS);
+    highMinCycles = i2cSoftNsToCycles(I2C_SOFT_HIGH_MIN_NS);
+    lowCycles = lowMinCycles;
+    highCycles = i2cSoftNsToCycles(I2C_SOFT_PERIOD_NS) - lowCycles;
+    stretchTimeoutCycles = SystemCoreClock / 1000000 * I2C_SOFT_STRETCH_TIMEOUT_US;
 }
 
-bool i2cWriteBuffer(uint8_t addr, uint8_t reg, uint8_t len, uint8_t * data)
+bool i2cWriteBuffer(uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *data)
 {
-    int i;
-    if (!I2C_Start()) {
-	    return false;
-	}
-    I2C_SendByte(addr << 1 | I2C_Direction_Transmitter);
-    if (!I2C_WaitAck()) {
-        I2C_Stop();
-        return false;
-    }
-    I2C_SendByte(reg);
-    I2C_WaitAck();
-    for (i = 0; i < len; i++) {
-        I2C_SendByte(data[i]);
-        if (!I2C_WaitAck()) {
-            I2C_Stop();
-            return false;
-        }
-    }
-    I2C_Stop();
-    return true;
+    return i2cSoftTransfer(addr_, reg_, len_, data, false);
 }
 
-bool i2cWrite(uint8_t addr, uint8_t reg, uint8_t data)
+bool i2cWrite(uint8_t addr_, uint8_t reg_, uint8_t data)
 {
-    if (!I2C_Start()) {
-	    return false;
-	}
-    I2C_SendByte(addr << 1 | I2C_Direction_Transmitter);
-    if (!I2C_WaitAck()) {
-        I2C_Stop();
+    return i2cSoftTransfer(addr_, reg_, 1, &data, false);
+}
+
+bool i2cRead(uint8_t addr_, uint8_t reg_, uint8_t len, uint8_t *buf)
+{
+    return i2cSoftTransfer(addr_, reg_, len, buf, true);
+}
+
+uint16_t i2cGetErrorCounter(void)
+{
+    return i2cErrorCount;
+}
+
+bool i2cSoftReadStart(uint8_t addr_, uint8_t reg_, uint8_t len, uint8_t *buf)
+{
+    if (phase != I2C_SOFT_IDLE) {
         return false;
     }
-    I2C_SendByte(reg);
-    I2C_WaitAck();
-    I2C_SendByte(data);
-    I2C_WaitAck();
-    I2C_Stop();
+    i2cSoftBegin(addr_, reg_, len, buf, true);
     return true;
 }
 
-bool i2cRead(uint8_t addr, uint8_t reg, uint8_t len, uint8_t *buf)
+void i2cSoftService(void)
 {
-    if (!I2C_Start()) {
-	    return false;
-	}
-    I2C_SendByte(addr << 1 | I2C_Direction_Transmitter);
-    if (!I2C_WaitAck()) {
-        I2C_Stop();
-        return false;
+    if (phase != I2C_SOFT_IDLE && i2cSoftEdgeDue()) {
+        i2cSoftStep();
     }
-    I2C_SendByte(reg);
-    I2C_WaitAck();
-    I2C_Start();
-    I2C_SendByte(addr << 1 | I2C_Direction_Receiver);
-    I2C_WaitAck();
-    while (len) {
-        *buf = I2C_ReceiveByte();
-        if (len == 1) {
-	        I2C_NoAck();
-        } else {
-	        I2C_Ack();
-	    }
-        buf++;
-        len--;
-    }
-    I2C_Stop();
-    return true;
 }
 
-uint16_t i2cGetErrorCounter(void)
+bool i2cSoftBusy(void)
+{
+    return phase != I2C_SOFT_IDLE;
+}
+
+bool i2cSoftFailed(void)
 {
-    // TODO maybe fix this, but since this is test code, doesn't matter.
-    return 0;
+    return failed;
 }
 
 #endif
@@ -0,0 +1,26 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Non-blocking reads on the software I2C bus.  i2cSoftReadStart() returns at once and i2cSoftService(), called
+// from a timer interrupt at twice the bus clock or faster, moves the read on by at most a half bit per call.
+// The blocking calls in bus_i2c.h return false while such a read is under way.
+bool i2cSoftReadStart(uint8_t addr_, uint8_t reg, uint8_t len, uint8_t *buf);
+void i2cSoftService(void);
+bool i2cSoftBusy(void);
+bool i2cSoftFailed(void);
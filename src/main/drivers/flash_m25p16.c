@@ -0,0 +1,236 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "platform.h"
+
+#include "system.h"
+#include "bus_spi.h"
+
+#include "flash_m25p16.h"
+
+// M25P16 and the Winbond W25Q parts share these commands, 64KB sectors and 256 byte pages
+#define M25P16_INSTRUCTION_RDID             0x9F
+#define M25P16_INSTRUCTION_READ_BYTES       0x03
+#define M25P16_INSTRUCTION_READ_STATUS_REG  0x05
+#define M25P16_INSTRUCTION_WRITE_ENABLE     0x06
+#define M25P16_INSTRUCTION_PAGE_PROGRAM     0x02
+#define M25P16_INSTRUCTION_SECTOR_ERASE     0xD8
+#define M25P16_INSTRUCTION_BULK_ERASE       0xC7
+
+#define M25P16_STATUS_FLAG_WRITE_IN_PROGRESS 0x01
+
+#define M25P16_SECTOR_SIZE                  65536
+
+// Typical operation times from the datasheets.  The status register is not read before the operation is
+// due to have finished, after that every poll interval until it has.
+#define M25P16_PAGE_PROGRAM_US              640
+#define M25P16_PAGE_PROGRAM_POLL_US         100
+#define M25P16_SECTOR_ERASE_US              600000
+#define M25P16_SECTOR_ERASE_POLL_US         10000
+#define M25P16_BULK_ERASE_US                13000000
+#define M25P16_BULK_ERASE_POLL_US           100000
+
+#define DISABLE_M25P16                      GPIO_SetBits(M25P16_CS_GPIO, M25P16_CS_PIN)
+#define ENABLE_M25P16                       GPIO_ResetBits(M25P16_CS_GPIO, M25P16_CS_PIN)
+
+typedef struct m25p16Chip_s {
+    uint32_t jedecId;
+    uint16_t sectors;
+} m25p16Chip_t;
+
+static const m25p16Chip_t m25p16Chips[] = {
+    { 0x202015, 32 },       // M25P16
+    { 0x202016, 64 },       // M25P32
+    { 0x202017, 128 },      // M25P64
+    { 0xEF4015, 32 },       // W25Q16
+    { 0xEF4016, 64 },       // W25Q32
+    { 0xEF4017, 128 },      // W25Q64
+};
+
+#define M25P16_CHIP_COUNT (sizeof(m25p16Chips) / sizeof(m25p16Chips[0]))
+
+static flashGeometry_t geometry;
+
+static bool couldBeBusy;
+static uint32_t nextStatusReadAt;
+static uint32_t statusPollInterval;
+
+static void m25p16PerformOneByteCommand(uint8_t command)
+{
+    ENABLE_M25P16;
+    spiTransferByte(M25P16_SPI_INSTANCE, command);
+    DISABLE_M25P16;
+}
+
+static void m25p16SendCommandAndAddress(uint8_t command, uint32_t address)
+{
+    spiTransferByte(M25P16_SPI_INSTANCE, command);
+    spiTransferByte(M25P16_SPI_INSTANCE, (address >> 16) & 0xFF);
+    spiTransferByte(M25P16_SPI_INSTANCE, (address >> 8) & 0xFF);
+    spiTransferByte(M25P16_SPI_INSTANCE, address & 0xFF);
+}
+
+static uint8_t m25p16ReadStatus(void)
+{
+    uint8_t status;
+
+    ENABLE_M25P16;
+    spiTransferByte(M25P16_SPI_INSTANCE, M25P16_INSTRUCTION_READ_STATUS_REG);
+    status = spiTransferByte(M25P16_SPI_INSTANCE, 0);
+    DISABLE_M25P16;
+
+    return status;
+}
+
+static void m25p16SetBusy(uint32_t duration, uint32_t pollInterval)
+{
+    couldBeBusy = true;
+    nextStatusReadAt = micros() + duration;
+    statusPollInterval = pollInterval;
+}
+
+bool m25p16IsReady(void)
+{
+    if (!couldBeBusy) {
+        return true;
+    }
+
+    uint32_t now = micros();
+    if ((int32_t)(now - nextStatusReadAt) < 0) {
+        return false;
+    }
+
+    couldBeBusy = (m25p16ReadStatus() & M25P16_STATUS_FLAG_WRITE_IN_PROGRESS) != 0;
+    if (couldBeBusy) {
+        nextStatusReadAt = now + statusPollInterval;
+    }
+
+    return !couldBeBusy;
+}
+
+static uint32_t m25p16ReadJedecId(void)
+{
+    uint8_t id[3];
+
+    ENABLE_M25P16;
+    spiTransferByte(M25P16_SPI_INSTANCE, M25P16_INSTRUCTION_RDID);
+    spiTransfer(M25P16_SPI_INSTANCE, id, NULL, sizeof(id));
+    DISABLE_M25P16;
+
+    return (id[0] << 16) | (id[1] << 8) | id[2];
+}
+
+bool m25p16Init(void)
+{
+    uint8_t i;
+
+    DISABLE_M25P16;
+    spiSetDivisor(M25P16_SPI_INSTANCE, SPI_18MHZ_CLOCK_DIVIDER);
+
+    geometry.sectors = 0;
+    geometry.totalSize = 0;
+
+    uint32_t jedecId = m25p16ReadJedecId();
+    for (i = 0; i < M25P16_CHIP_COUNT; i++) {
+        if (m25p16Chips[i].jedecId == jedecId) {
+            geometry.sectors = m25p16Chips[i].sectors;
+            break;
+        }
+    }
+    if (!geometry.sectors) {
+        return false;
+    }
+
+    geometry.pageSize = M25P16_PAGE_SIZE;
+    geometry.sectorSize = M25P16_SECTOR_SIZE;
+    geometry.pagesPerSector = M25P16_SECTOR_SIZE / M25P16_PAGE_SIZE;
+    geometry.totalSize = geometry.sectorSize * geometry.sectors;
+
+    // a reset in the middle of an erase leaves the chip busy, check once before the first command
+    m25p16SetBusy(0, M25P16_SECTOR_ERASE_POLL_US);
+
+    return true;
+}
+
+const flashGeometry_t *m25p16GetGeometry(void)
+{
+    return &geometry;
+}
+
+bool m25p16EraseSector(uint32_t address)
+{
+    if (!m25p16IsReady()) {
+        return false;
+    }
+
+    m25p16PerformOneByteCommand(M25P16_INSTRUCTION_WRITE_ENABLE);
+
+    ENABLE_M25P16;
+    m25p16SendCommandAndAddress(M25P16_INSTRUCTION_SECTOR_ERASE, address);
+    DISABLE_M25P16;
+
+    m25p16SetBusy(M25P16_SECTOR_ERASE_US, M25P16_SECTOR_ERASE_POLL_US);
+    return true;
+}
+
+bool m25p16EraseCompletely(void)
+{
+    if (!m25p16IsReady()) {
+        return false;
+    }
+
+    m25p16PerformOneByteCommand(M25P16_INSTRUCTION_WRITE_ENABLE);
+    m25p16PerformOneByteCommand(M25P16_INSTRUCTION_BULK_ERASE);
+
+    m25p16SetBusy(M25P16_BULK_ERASE_US, M25P16_BULK_ERASE_POLL_US);
+    return true;
+}
+
+bool m25p16PageProgram(uint32_t address, const uint8_t *data, uint16_t length)
+{
+    if (!m25p16IsReady()) {
+        return false;
+    }
+
+    m25p16PerformOneByteCommand(M25P16_INSTRUCTION_WRITE_ENABLE);
+
+    ENABLE_M25P16;
+    m25p16SendCommandAndAddress(M25P16_INSTRUCTION_PAGE_PROGRAM, address);
+    spiTransfer(M25P16_SPI_INSTANCE, NULL, (uint8_t *)data, length);
+    DISABLE_M25P16;
+
+    m25p16SetBusy(M25P16_PAGE_PROGRAM_US, M25P16_PAGE_PROGRAM_POLL_US);
+    return true;
+}
+
+bool m25p16ReadBytes(uint32_t address, uint8_t *buffer, uint16_t length)
+{
+    if (!m25p16IsReady()) {
+        return false;
+    }
+
+    ENABLE_M25P16;
+    m25p16SendCommandAndAddress(M25P16_INSTRUCTION_READ_BYTES, address);
+    spiTransfer(M25P16_SPI_INSTANCE, buffer, NULL, length);
+    DISABLE_M25P16;
+
+    return true;
+}
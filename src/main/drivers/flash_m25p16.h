@@ -0,0 +1,42 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define M25P16_PAGE_SIZE 256
+
+typedef struct flashGeometry_s {
+    uint16_t sectors;
+    uint16_t pagesPerSector;
+    uint16_t pageSize;
+    uint32_t sectorSize;
+    uint32_t totalSize;
+} flashGeometry_t;
+
+bool m25p16Init(void);
+const flashGeometry_t *m25p16GetGeometry(void);
+
+// Never waits for the chip.  The calls below return false without touching the bus while the previous
+// program or erase is still running; m25p16IsReady only reads the status register once the operation is
+// due to have finished.
+bool m25p16IsReady(void);
+
+bool m25p16EraseSector(uint32_t address);
+bool m25p16EraseCompletely(void);
+// the data must not cross a page boundary, the chip would wrap to the start of the page
+bool m25p16PageProgram(uint32_t address, const uint8_t *data, uint16_t length);
+bool m25p16ReadBytes(uint32_t address, uint8_t *buffer, uint16_t length);
@@ -238,6 +238,69 @@ static const uint16_t * const hardwareMaps[] = {
     airPPM,
 };
 
+static pwmOutputConfiguration_t pwmOutputConfiguration;
+
+static pwmOutputAllocation_t *pwmAllocateOutput(uint8_t timerIndex, uint8_t type, uint16_t rate)
+{
+    pwmOutputAllocation_t *output = &pwmOutputConfiguration.outputs[pwmOutputConfiguration.outputCount++];
+
+    output->timerIndex = timerIndex;
+    output->type = type;
+    output->rate = rate;
+    return output;
+}
+
+static bool pwmSharesTimer(const pwmOutputAllocation_t *a, const pwmOutputAllocation_t *b)
+{
+    return timerHardware[a->timerIndex].tim == timerHardware[b->timerIndex].tim;
+}
+
+/*
+ * All channels of a timer share its time base, so servos on one timer can only run at one rate.  Each group of
+ * servos on a timer runs at the lowest rate asked of any of them, as analog servos are damaged by a rate that
+ * is too high but digital ones only lose some latency to one that is too low.
+ */
+static void pwmGroupServoRates(void)
+{
+    uint8_t i, j;
+
+    for (i = 0; i < pwmOutputConfiguration.outputCount; i++) {
+        pwmOutputAllocation_t *output = &pwmOutputConfiguration.outputs[i];
+        if (output->type != PWM_OUTPUT_SERVO)
+            continue;
+
+        for (j = 0; j < pwmOutputConfiguration.outputCount; j++) {
+            pwmOutputAllocation_t *other = &pwmOutputConfiguration.outputs[j];
+            if (other->type == PWM_OUTPUT_SERVO && pwmSharesTimer(output, other) && other->rate < output->rate)
+                output->rate = other->rate;
+        }
+    }
+}
+
+// Counts the outputs that ask for a different rate than an earlier output on the same timer, a motor and a servo
+// on one timer for instance.  Whichever is configured last sets the rate of both.
+uint8_t pwmCountTimerConflicts(const pwmOutputConfiguration_t *configuration)
+{
+    uint8_t conflicts = 0;
+    uint8_t i, j;
+
+    for (i = 1; i < configuration->outputCount; i++) {
+        for (j = 0; j < i; j++) {
+            if (pwmSharesTimer(&configuration->outputs[i], &configuration->outputs[j]) &&
+                    configuration->outputs[i].rate != configuration->outputs[j].rate) {
+                conflicts++;
+                break;
+            }
+        }
+    }
+    return conflicts;
+}
+
+const pwmOutputConfiguration_t *pwmGetOutputConfiguration(void)
+{
+    return &pwmOutputConfiguration;
+}
+
 pwmOutputConfiguration_t *pwmInit(drv_pwm_config_t *init)
 {
     int i = 0;
@@ -245,8 +308,6 @@ pwmOutputConfiguration_t *pwmInit(drv_pwm_config_t *init)
 
     int channelIndex = 0;
 
-    static pwmOutputConfiguration_t pwmOutputConfiguration;
-
     memset(&pwmOutputConfiguration, 0, sizeof(pwmOutputConfiguration));
 
     // this is pretty hacky shit, but it will do for now. array of 4 config maps, [ multiPWM multiPPM airPWM airPPM ]
@@ -360,16 +421,32 @@ pwmOutputConfiguration_t *pwmInit(drv_pwm_config_t *init)
             channelIndex++;
         } else if (type == TYPE_M) {
             if (init->motorPwmRate > 500) {
-                pwmBrushedMotorConfig(timerHardwarePtr, pwmOutputConfiguration.motorCount, init->motorPwmRate, init->idlePulse);
+                pwmBrushedMotorConfig(timerHardwarePtr, pwmOutputConfiguration.motorCount, init->motorPwmRate, init->idlePulse, init->brushedMotorDithering);
             } else {
                 pwmBrushlessMotorConfig(timerHardwarePtr, pwmOutputConfiguration.motorCount, init->motorPwmRate, init->idlePulse);
             }
+            pwmAllocateOutput(timerIndex, PWM_OUTPUT_MOTOR, init->motorPwmRate);
             pwmOutputConfiguration.motorCount++;
         } else if (type == TYPE_S) {
-            pwmServoConfig(timerHardwarePtr, pwmOutputConfiguration.servoCount, init->servoPwmRate, init->servoCenterPulse);
+            if (pwmOutputConfiguration.servoCount >= MAX_PWM_SERVOS)
+                continue;
+            uint16_t servoPwmRate = init->servoPwmRates[pwmOutputConfiguration.servoCount];
+            pwmAllocateOutput(timerIndex, PWM_OUTPUT_SERVO, servoPwmRate ? servoPwmRate : init->servoPwmRate);
             pwmOutputConfiguration.servoCount++;
         }
     }
 
+    // servos are configured once every servo on their timer is known
+    pwmGroupServoRates();
+
+    uint8_t servoIndex = 0;
+    for (i = 0; i < pwmOutputConfiguration.outputCount; i++) {
+        pwmOutputAllocation_t *output = &pwmOutputConfiguration.outputs[i];
+        if (output->type == PWM_OUTPUT_SERVO) {
+            pwmServoConfig(&timerHardware[output->timerIndex], servoIndex, output->rate, init->servoCenterPulse);
+            servoIndex++;
+        }
+    }
+
     return &pwmOutputConfiguration;
 }
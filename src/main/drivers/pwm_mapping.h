@@ -48,16 +48,31 @@ typedef struct drv_pwm_config_t {
     bool extraServos;    // configure additional 4 channels in PPM mode as servos, not motors
     bool airplane;       // fixed wing hardware config, lots of servos etc
     uint16_t motorPwmRate;
+    bool brushedMotorDithering;             // carry the fraction of a timer count each brushed motor write drops into the next
     uint16_t servoPwmRate;
+    uint16_t servoPwmRates[MAX_PWM_SERVOS]; // per servo output, 0 uses servoPwmRate
     uint16_t idlePulse;  // PWM value to use when initializing the driver. set this to either PULSE_1MS (regular pwm), 
                          // some higher value (used by 3d mode), or 0, for brushed pwm drivers.
     uint16_t servoCenterPulse;
 } drv_pwm_config_t;
 
 
+typedef enum {
+    PWM_OUTPUT_MOTOR = 0,
+    PWM_OUTPUT_SERVO
+} pwmOutputType_e;
+
+typedef struct pwmOutputAllocation_s {
+    uint8_t timerIndex;                     // PWM1..PWM14
+    uint8_t type;                           // see pwmOutputType_e
+    uint16_t rate;                          // Hz the output runs at
+} pwmOutputAllocation_t;
+
 typedef struct pwmOutputConfiguration_s {
     uint8_t servoCount;
     uint8_t motorCount;
+    uint8_t outputCount;
+    pwmOutputAllocation_t outputs[MAX_PWM_MOTORS + MAX_PWM_SERVOS];
 } pwmOutputConfiguration_t;
 
 // This indexes into the read-only hardware definition structure, timerHardware_t, as well as into pwmPorts structure with dynamic data.
@@ -77,3 +92,6 @@ enum {
     PWM13,
     PWM14
 };
+
+const pwmOutputConfiguration_t *pwmGetOutputConfiguration(void);
+uint8_t pwmCountTimerConflicts(const pwmOutputConfiguration_t *configuration);
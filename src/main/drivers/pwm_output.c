@@ -43,6 +43,8 @@ typedef struct {
 #endif
     uint16_t period;
     pwmWriteFuncPtr pwmWritePtr;
+    uint32_t scale;                         // brushed, timer counts per us of motor command, 16.16 fixed point
+    uint16_t ditherError;                   // brushed, fraction of a count carried into the next write
 } pwmOutputPort_t;
 
 static pwmOutputPort_t pwmOutputPorts[MAX_PWM_OUTPUT_PORTS];
@@ -126,9 +128,32 @@ static pwmOutputPort_t *pwmOutConfig(const timerHardware_t *timerHardware, uint8
     return p;
 }
 
+static uint32_t pwmBrushedDuty(pwmOutputPort_t *motor, uint16_t value)
+{
+    if (value <= PULSE_1MS)
+        return 0;
+    if (value >= 2 * PULSE_1MS)
+        return (uint32_t)motor->period << 16;
+    return (value - PULSE_1MS) * motor->scale;
+}
+
 static void pwmWriteBrushed(uint8_t index, uint16_t value)
 {
-    *motors[index]->ccr = (value - 1000) * motors[index]->period / 1000;
+    *motors[index]->ccr = pwmBrushedDuty(motors[index], value) >> 16;
+}
+
+/*
+ * At high motor_pwm_rate the period leaves fewer timer counts than there are steps in the motor command, 250 at
+ * 32kHz.  The fraction of a count each write drops is carried into the next one, a first order sigma-delta, so
+ * the duty averaged over a few writes matches the command to well under a count.
+ */
+static void pwmWriteBrushedDithered(uint8_t index, uint16_t value)
+{
+    pwmOutputPort_t *motor = motors[index];
+    uint32_t duty = pwmBrushedDuty(motor, value) + motor->ditherError;
+
+    motor->ditherError = duty & 0xFFFF;
+    *motor->ccr = duty >> 16;
 }
 
 static void pwmWriteStandard(uint8_t index, uint16_t value)
@@ -149,12 +174,13 @@ void pwmWriteServo(uint8_t index, uint16_t value)
 }
 
 
-void pwmBrushedMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, uint16_t motorPwmRate, uint16_t idlePulse)
+void pwmBrushedMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, uint16_t motorPwmRate, uint16_t idlePulse, bool dithering)
 {
 	uint32_t hz = PWM_BRUSHED_TIMER_MHZ * 1000000;
 	motors[motorIndex] = pwmOutConfig(timerHardware, PWM_BRUSHED_TIMER_MHZ, hz / motorPwmRate, idlePulse);
-	motors[motorIndex]->pwmWritePtr = pwmWriteBrushed;
-
+	motors[motorIndex]->scale = (((uint32_t)motors[motorIndex]->period << 16) + PULSE_1MS / 2) / PULSE_1MS;
+	motors[motorIndex]->ditherError = 0;
+	motors[motorIndex]->pwmWritePtr = dithering ? pwmWriteBrushedDithered : pwmWriteBrushed;
 }
 
 void pwmBrushlessMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, uint16_t motorPwmRate, uint16_t idlePulse)
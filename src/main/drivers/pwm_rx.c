@@ -69,8 +69,11 @@ static uint16_t captures[PWM_PORTS_OR_PPM_CAPTURE_COUNT];
 #define PPM_TIMER_PERIOD 0xFFFF
 #define PWM_TIMER_PERIOD 0xFFFF
 
-static uint8_t ppmFrameCount = 0;
-static uint8_t lastPPMFrameCount = 0;
+// a PPM frame, or a pulse on every parallel PWM input that has had one
+static uint8_t frameCount = 0;
+static uint8_t lastFrameCount = 0;
+static uint8_t pwmConnectedPorts;
+static uint8_t pwmCapturedPorts;
 
 typedef struct ppmDevice {
     uint8_t  pulseIndex;
@@ -98,14 +101,14 @@ ppmDevice_t ppmDev;
 #define PPM_RCVR_TIMEOUT            0
 
 
-bool isPPMDataBeingReceived(void)
+bool isPWMDataBeingReceived(void)
 {
-    return (ppmFrameCount != lastPPMFrameCount);
+    return (frameCount != lastFrameCount);
 }
 
-void resetPPMDataReceivedState(void)
+void resetPWMDataReceivedState(void)
 {
-    lastPPMFrameCount = ppmFrameCount;
+    lastFrameCount = frameCount;
 }
 
 #define MIN_CHANNELS_BEFORE_PPM_FRAME_CONSIDERED_VALID 4
@@ -186,7 +189,7 @@ static void ppmEdgeCallback(uint8_t port, captureCompare_t capture)
             for (i = ppmDev.numChannels; i < PPM_IN_MAX_NUM_CHANNELS; i++) {
                 captures[i] = PPM_RCVR_TIMEOUT;
             }
-            ppmFrameCount++;
+            frameCount++;
         }
 
         ppmDev.tracking   = true;
@@ -228,6 +231,14 @@ static void pwmEdgeCallback(uint8_t port, captureCompare_t capture)
         pwmInputPort->capture = pwmInputPort->fall - pwmInputPort->rise;
         captures[pwmInputPort->channel] = pwmInputPort->capture;
 
+        // an input that stops while the others carry on holds back the frame, so a loose lead is a lost signal
+        pwmConnectedPorts |= 1 << port;
+        pwmCapturedPorts |= 1 << port;
+        if (pwmCapturedPorts == pwmConnectedPorts) {
+            pwmCapturedPorts = 0;
+            frameCount++;
+        }
+
         // switch state
         pwmInputPort->state = 0;
         pwmICConfig(timerHardwarePtr->tim, timerHardwarePtr->channel, TIM_ICPolarity_Rising);
@@ -27,7 +27,7 @@ void pwmInConfig(const timerHardware_t *timerHardwarePtr, uint8_t channel);
 
 uint16_t pwmRead(uint8_t channel);
 
-bool isPPMDataBeingReceived(void);
-void resetPPMDataReceivedState(void);
+bool isPWMDataBeingReceived(void);
+void resetPWMDataReceivedState(void);
 
 void pwmRxInit(inputFilteringMode_e initialInputFilteringMode);
@@ -22,6 +22,32 @@
 
 #include "serial.h"
 
+static volatile uint8_t serialBufferPool[SERIAL_BUFFER_POOL_SIZE];
+static uint16_t serialBufferPoolIndex;
+
+// buffers are never freed, ports keep theirs until reboot
+bool serialAllocateBuffers(serialBuffers_t *buffers, uint16_t rxBufferSize, uint16_t txBufferSize)
+{
+    if (serialBufferPoolIndex + rxBufferSize + txBufferSize > SERIAL_BUFFER_POOL_SIZE) {
+        return false;
+    }
+
+    buffers->rxBuffer = &serialBufferPool[serialBufferPoolIndex];
+    buffers->rxBufferSize = rxBufferSize;
+    serialBufferPoolIndex += rxBufferSize;
+
+    buffers->txBuffer = &serialBufferPool[serialBufferPoolIndex];
+    buffers->txBufferSize = txBufferSize;
+    serialBufferPoolIndex += txBufferSize;
+
+    return true;
+}
+
+uint16_t serialBufferPoolUsed(void)
+{
+    return serialBufferPoolIndex;
+}
+
 void serialPrint(serialPort_t *instance, const char *str)
 {
     uint8_t ch;
@@ -45,6 +71,23 @@ uint8_t serialTotalBytesWaiting(serialPort_t *instance)
     return instance->vTable->serialTotalBytesWaiting(instance);
 }
 
+uint8_t serialTotalTxFree(serialPort_t *instance)
+{
+    return instance->vTable->serialTotalTxFree(instance);
+}
+
+void serialWriteBuf(serialPort_t *instance, const uint8_t *data, uint8_t count)
+{
+    if (instance->vTable->writeBuf) {
+        instance->vTable->writeBuf(instance, data, count);
+        return;
+    }
+
+    while (count--) {
+        serialWrite(instance, *(data++));
+    }
+}
+
 uint8_t serialRead(serialPort_t *instance)
 {
     return instance->vTable->serialRead(instance);
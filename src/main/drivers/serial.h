@@ -31,6 +31,24 @@ typedef enum portMode_t {
 
 typedef void (*serialReceiveCallbackPtr)(uint16_t data);   // used by serial drivers to return frames to app
 
+// Port ring buffers come from one pool, sized for the functions assigned to each port when the serial
+// config is applied, so unused ports take no RAM.  The drivers wrap indexes with a mask so sizes must be
+// powers of two.
+#ifndef SERIAL_BUFFER_POOL_SIZE
+#if (SERIAL_PORT_COUNT > 2)
+#define SERIAL_BUFFER_POOL_SIZE 1024    // an MSP/CLI port and a GPS port, plus serial rx or telemetry on the others
+#else
+#define SERIAL_BUFFER_POOL_SIZE 704     // an MSP/CLI port and a GPS port
+#endif
+#endif
+
+typedef struct serialBuffers_s {
+    volatile uint8_t *rxBuffer;
+    volatile uint8_t *txBuffer;
+    uint16_t rxBufferSize;
+    uint16_t txBufferSize;
+} serialBuffers_t;
+
 typedef struct serialPort {
 
     const struct serialPortVTable *vTable;
@@ -58,6 +76,9 @@ struct serialPortVTable {
 
     uint8_t (*serialTotalBytesWaiting)(serialPort_t *instance);
 
+    // bytes serialWrite can queue without overwriting ones not yet sent
+    uint8_t (*serialTotalTxFree)(serialPort_t *instance);
+
     uint8_t (*serialRead)(serialPort_t *instance);
 
     // Specified baud rate may not be allowed by an implementation, use serialGetBaudRate to determine actual baud rate in use.
@@ -66,13 +87,21 @@ struct serialPortVTable {
     bool (*isSerialTransmitBufferEmpty)(serialPort_t *instance);
 
     void (*setMode)(serialPort_t *instance, portMode_t mode);
+
+    // optional, queues a block and starts the transmitter once, NULL falls back to serialWrite per byte
+    void (*writeBuf)(serialPort_t *instance, const uint8_t *data, uint8_t count);
 };
 
 void serialWrite(serialPort_t *instance, uint8_t ch);
 uint8_t serialTotalBytesWaiting(serialPort_t *instance);
+uint8_t serialTotalTxFree(serialPort_t *instance);
+void serialWriteBuf(serialPort_t *instance, const uint8_t *data, uint8_t count);
 uint8_t serialRead(serialPort_t *instance);
 void serialSetBaudRate(serialPort_t *instance, uint32_t baudRate);
 void serialSetMode(serialPort_t *instance, portMode_t mode);
 bool isSerialTransmitBufferEmpty(serialPort_t *instance);
 void serialPrint(serialPort_t *instance, const char *str);
 uint32_t serialGetBaudRate(serialPort_t *instance);
+
+bool serialAllocateBuffers(serialBuffers_t *buffers, uint16_t rxBufferSize, uint16_t txBufferSize);
+uint16_t serialBufferPoolUsed(void);
@@ -136,20 +136,23 @@ static void serialOutputPortConfig(const timerHardware_t *timerHardwarePtr)
     softSerialGPIOConfig(timerHardwarePtr->gpio, timerHardwarePtr->pin, Mode_Out_PP);
 }
 
-static void resetBuffers(softSerial_t *softSerial)
+static void resetBuffers(softSerial_t *softSerial, const serialBuffers_t *buffers)
 {
-    softSerial->port.rxBufferSize = SOFT_SERIAL_BUFFER_SIZE;
-    softSerial->port.rxBuffer = softSerial->rxBuffer;
+    if (buffers) {
+        softSerial->port.rxBuffer = buffers->rxBuffer;
+        softSerial->port.rxBufferSize = buffers->rxBufferSize;
+        softSerial->port.txBuffer = buffers->txBuffer;
+        softSerial->port.txBufferSize = buffers->txBufferSize;
+    }
+
     softSerial->port.rxBufferTail = 0;
     softSerial->port.rxBufferHead = 0;
 
-    softSerial->port.txBuffer = softSerial->txBuffer;
-    softSerial->port.txBufferSize = SOFT_SERIAL_BUFFER_SIZE;
     softSerial->port.txBufferTail = 0;
     softSerial->port.txBufferHead = 0;
 }
 
-serialPort_t *openSoftSerial(softSerialPortIndex_e portIndex, serialReceiveCallbackPtr callback, uint32_t baud, serialInversion_e inversion)
+serialPort_t *openSoftSerial(softSerialPortIndex_e portIndex, serialReceiveCallbackPtr callback, uint32_t baud, serialInversion_e inversion, const serialBuffers_t *buffers)
 {
     softSerial_t *softSerial = &(softSerialPorts[portIndex]);
 
@@ -169,7 +172,7 @@ serialPort_t *openSoftSerial(softSerialPortIndex_e portIndex, serialReceiveCallb
     softSerial->port.inversion = inversion;
     softSerial->port.callback = callback;
 
-    resetBuffers(softSerial);
+    resetBuffers(softSerial, buffers);
 
     softSerial->isTransmittingData = false;
 
@@ -375,7 +378,16 @@ uint8_t softSerialTotalBytesWaiting(serialPort_t *instance)
 
     softSerial_t *s = (softSerial_t *)instance;
 
-    return (s->port.rxBufferHead - s->port.rxBufferTail) & (s->port.txBufferSize - 1);
+    return (s->port.rxBufferHead - s->port.rxBufferTail) & (s->port.rxBufferSize - 1);
+}
+
+uint8_t softSerialTotalTxFree(serialPort_t *instance)
+{
+    if ((instance->mode & MODE_TX) == 0) {
+        return 0;
+    }
+
+    return (instance->txBufferTail - instance->txBufferHead - 1) & (instance->txBufferSize - 1);
 }
 
 uint8_t softSerialReadByte(serialPort_t *instance)
@@ -408,7 +420,7 @@ void softSerialWriteByte(serialPort_t *s, uint8_t ch)
 void softSerialSetBaudRate(serialPort_t *s, uint32_t baudRate)
 {
     softSerial_t *softSerial = (softSerial_t *)s;
-    openSoftSerial(softSerial->softSerialPortIndex, s->callback, baudRate, softSerial->port.inversion);
+    openSoftSerial((softSerialPortIndex_e)softSerial->softSerialPortIndex, s->callback, baudRate, softSerial->port.inversion, NULL);
 }
 
 void softSerialSetMode(serialPort_t *instance, portMode_t mode)
@@ -425,10 +437,12 @@ const struct serialPortVTable softSerialVTable[] = {
     {
         softSerialWriteByte,
         softSerialTotalBytesWaiting,
+        softSerialTotalTxFree,
         softSerialReadByte,
         softSerialSetBaudRate,
         isSoftSerialTransmitBufferEmpty,
         softSerialSetMode,
+        NULL,
     }
 };
 
@@ -17,8 +17,6 @@
 
 #pragma once
 
-#define SOFT_SERIAL_BUFFER_SIZE 256
-
 typedef enum {
     SOFTSERIAL1 = 0,
     SOFTSERIAL2
@@ -28,11 +26,8 @@ typedef struct softSerial_s {
     serialPort_t     port;
 
     const timerHardware_t *rxTimerHardware;
-    volatile uint8_t rxBuffer[SOFT_SERIAL_BUFFER_SIZE];
-
     const timerHardware_t *txTimerHardware;
-    volatile uint8_t txBuffer[SOFT_SERIAL_BUFFER_SIZE];
-    
+
     uint8_t          isSearchingForStartBit;
     uint8_t          rxBitIndex;
     uint8_t          rxLastLeadingEdgeAtBitIndex;
@@ -55,11 +50,13 @@ extern softSerial_t softSerialPorts[];
 
 extern const struct serialPortVTable softSerialVTable[];
 
-serialPort_t *openSoftSerial(softSerialPortIndex_e portIndex, serialReceiveCallbackPtr callback, uint32_t baud, serialInversion_e inversion);
+// buffers may be NULL when re-opening a port, which then keeps the ones it has
+serialPort_t *openSoftSerial(softSerialPortIndex_e portIndex, serialReceiveCallbackPtr callback, uint32_t baud, serialInversion_e inversion, const serialBuffers_t *buffers);
 
 // serialPort API
 void softSerialWriteByte(serialPort_t *instance, uint8_t ch);
 uint8_t softSerialTotalBytesWaiting(serialPort_t *instance);
+uint8_t softSerialTotalTxFree(serialPort_t *instance);
 uint8_t softSerialReadByte(serialPort_t *instance);
 void softSerialSetBaudRate(serialPort_t *s, uint32_t baudRate);
 bool isSoftSerialTransmitBufferEmpty(serialPort_t *s);
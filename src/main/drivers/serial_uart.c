@@ -61,7 +61,7 @@ static void uartReconfigure(uartPort_t *uartPort)
     USART_Init(uartPort->USARTx, &USART_InitStructure);
 }
 
-serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, serialInversion_e inversion)
+serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, serialInversion_e inversion, const serialBuffers_t *buffers)
 {
     UNUSED(inversion);
     DMA_InitTypeDef DMA_InitStructure;
@@ -90,6 +90,13 @@ serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr callback,
     }
     s->txDMAEmpty = true;
 
+    if (buffers) {
+        s->port.rxBuffer = buffers->rxBuffer;
+        s->port.txBuffer = buffers->txBuffer;
+        s->port.rxBufferSize = buffers->rxBufferSize;
+        s->port.txBufferSize = buffers->txBufferSize;
+    }
+
     // common serial initialisation code should move to serialPort::init()
     s->port.rxBufferHead = s->port.rxBufferTail = 0;
     s->port.txBufferHead = s->port.txBufferTail = 0;
@@ -121,7 +128,7 @@ serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr callback,
             DMA_InitStructure.DMA_BufferSize = s->port.rxBufferSize;
             DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
             DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
-            DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)s->port.rxBuffer;
+            DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)(uintptr_t)s->port.rxBuffer;
             DMA_DeInit(s->rxDMAChannel);
             DMA_Init(s->rxDMAChannel, &DMA_InitStructure);
             DMA_Cmd(s->rxDMAChannel, ENABLE);
@@ -171,7 +178,7 @@ void uartSetBaudRate(serialPort_t *instance, uint32_t baudRate)
 #ifndef STM32F303xC // FIXME this doesnt seem to work, for now re-open the port from scratch, perhaps clearing some uart flags may help?
     uartReconfigure(uartPort);
 #else
-    uartOpen(uartPort->USARTx, uartPort->port.callback, uartPort->port.baudRate, uartPort->port.mode, uartPort->port.inversion);
+    uartOpen(uartPort->USARTx, uartPort->port.callback, uartPort->port.baudRate, uartPort->port.mode, uartPort->port.inversion, NULL);
 #endif
 }
 
@@ -182,13 +189,13 @@ void uartSetMode(serialPort_t *instance, portMode_t mode)
 #ifndef STM32F303xC // FIXME this doesnt seem to work, for now re-open the port from scratch, perhaps clearing some uart flags may help?
     uartReconfigure(uartPort);
 #else
-    uartOpen(uartPort->USARTx, uartPort->port.callback, uartPort->port.baudRate, uartPort->port.mode, uartPort->port.inversion);
+    uartOpen(uartPort->USARTx, uartPort->port.callback, uartPort->port.baudRate, uartPort->port.mode, uartPort->port.inversion, NULL);
 #endif
 }
 
 void uartStartTxDMA(uartPort_t *s)
 {
-    s->txDMAChannel->CMAR = (uint32_t)&s->port.txBuffer[s->port.txBufferTail];
+    s->txDMAChannel->CMAR = (uint32_t)(uintptr_t)&s->port.txBuffer[s->port.txBufferTail];
     if (s->port.txBufferHead > s->port.txBufferTail) {
         s->txDMAChannel->CNDTR = s->port.txBufferHead - s->port.txBufferTail;
         s->port.txBufferTail = s->port.txBufferHead;
@@ -204,10 +211,26 @@ uint8_t uartTotalBytesWaiting(serialPort_t *instance)
 {
     uartPort_t *s = (uartPort_t*)instance;
     if (s->rxDMAChannel)
-        return (s->rxDMAChannel->CNDTR - s->rxDMAPos) & (s->port.txBufferSize - 1);
+        return (s->rxDMAChannel->CNDTR - s->rxDMAPos) & (s->port.rxBufferSize - 1);
     else {
-        return (s->port.rxBufferHead - s->port.rxBufferTail) & (s->port.txBufferSize - 1);
+        return (s->port.rxBufferHead - s->port.rxBufferTail) & (s->port.rxBufferSize - 1);
+    }
+}
+
+uint8_t uartTotalTxFree(serialPort_t *instance)
+{
+    uartPort_t *s = (uartPort_t*)instance;
+    uint32_t bytesUsed = (s->port.txBufferHead - s->port.txBufferTail) & (s->port.txBufferSize - 1);
+
+    if (s->txDMAChannel) {
+        // the tail moves past a block when its DMA starts, the bytes still to go are not free yet
+        bytesUsed += s->txDMAChannel->CNDTR;
+    }
+
+    if (bytesUsed >= s->port.txBufferSize - 1) {
+        return 0;
     }
+    return (s->port.txBufferSize - 1) - bytesUsed;
 }
 
 bool isUartTransmitBufferEmpty(serialPort_t *instance)
@@ -236,12 +259,8 @@ uint8_t uartRead(serialPort_t *instance)
     return ch;
 }
 
-void uartWrite(serialPort_t *instance, uint8_t ch)
+static void uartStartTx(uartPort_t *s)
 {
-    uartPort_t *s = (uartPort_t *)instance;
-    s->port.txBuffer[s->port.txBufferHead] = ch;
-    s->port.txBufferHead = (s->port.txBufferHead + 1) % s->port.txBufferSize;
-
     if (s->txDMAChannel) {
         if (!(s->txDMAChannel->CCR & 1))
             uartStartTxDMA(s);
@@ -250,13 +269,37 @@ void uartWrite(serialPort_t *instance, uint8_t ch)
     }
 }
 
+void uartWrite(serialPort_t *instance, uint8_t ch)
+{
+    uartPort_t *s = (uartPort_t *)instance;
+    s->port.txBuffer[s->port.txBufferHead] = ch;
+    s->port.txBufferHead = (s->port.txBufferHead + 1) % s->port.txBufferSize;
+
+    uartStartTx(s);
+}
+
+// one DMA transfer for the block rather than one for the first byte and another for the rest
+void uartWriteBuf(serialPort_t *instance, const uint8_t *data, uint8_t count)
+{
+    uartPort_t *s = (uartPort_t *)instance;
+
+    while (count--) {
+        s->port.txBuffer[s->port.txBufferHead] = *(data++);
+        s->port.txBufferHead = (s->port.txBufferHead + 1) % s->port.txBufferSize;
+    }
+
+    uartStartTx(s);
+}
+
 const struct serialPortVTable uartVTable[] = {
     {
         uartWrite,
         uartTotalBytesWaiting,
+        uartTotalTxFree,
         uartRead,
         uartSetBaudRate,
         isUartTransmitBufferEmpty,
         uartSetMode,
+        uartWriteBuf,
     }
 };
@@ -17,15 +17,6 @@
 
 #pragma once
 
-// FIXME since serial ports can be used for any function these buffer sizes probably need normalising.
-// Code is optimal when buffer sizes are powers of 2 due to use of % and / operators.
-#define UART1_RX_BUFFER_SIZE    256
-#define UART1_TX_BUFFER_SIZE    256
-#define UART2_RX_BUFFER_SIZE    128
-#define UART2_TX_BUFFER_SIZE    64
-#define UART3_RX_BUFFER_SIZE    128
-#define UART3_TX_BUFFER_SIZE    64
-
 typedef struct {
     serialPort_t port;
 
@@ -46,11 +37,14 @@ typedef struct {
 
 extern const struct serialPortVTable uartVTable[];
 
-serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, serialInversion_e inversion);
+// buffers may be NULL when re-opening a port, which then keeps the ones it has
+serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, serialInversion_e inversion, const serialBuffers_t *buffers);
 
 // serialPort API
 void uartWrite(serialPort_t *instance, uint8_t ch);
 uint8_t uartTotalBytesWaiting(serialPort_t *instance);
+uint8_t uartTotalTxFree(serialPort_t *instance);
+void uartWriteBuf(serialPort_t *instance, const uint8_t *data, uint8_t count);
 uint8_t uartRead(serialPort_t *instance);
 void uartSetBaudRate(serialPort_t *s, uint32_t baudRate);
 bool isUartTransmitBufferEmpty(serialPort_t *s);
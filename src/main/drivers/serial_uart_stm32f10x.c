@@ -76,8 +76,6 @@ void usartIrqCallback(uartPort_t *s)
 uartPort_t *serialUSART1(uint32_t baudRate, portMode_t mode)
 {
     uartPort_t *s;
-    static volatile uint8_t rx1Buffer[UART1_RX_BUFFER_SIZE];
-    static volatile uint8_t tx1Buffer[UART1_TX_BUFFER_SIZE];
     gpio_config_t gpio;
     NVIC_InitTypeDef NVIC_InitStructure;
 
@@ -86,11 +84,6 @@ uartPort_t *serialUSART1(uint32_t baudRate, portMode_t mode)
     
     s->port.baudRate = baudRate;
     
-    s->port.rxBuffer = rx1Buffer;
-    s->port.txBuffer = tx1Buffer;
-    s->port.rxBufferSize = UART1_RX_BUFFER_SIZE;
-    s->port.txBufferSize = UART1_TX_BUFFER_SIZE;
-    
     s->USARTx = USART1;
 
     s->txDMAPeripheralBaseAddr = (uint32_t)&s->USARTx->DR;
@@ -161,8 +154,6 @@ void USART1_IRQHandler(void)
 uartPort_t *serialUSART2(uint32_t baudRate, portMode_t mode)
 {
     uartPort_t *s;
-    static volatile uint8_t rx2Buffer[UART2_RX_BUFFER_SIZE];
-    static volatile uint8_t tx2Buffer[UART2_TX_BUFFER_SIZE];
     gpio_config_t gpio;
     NVIC_InitTypeDef NVIC_InitStructure;
 
@@ -171,11 +162,6 @@ uartPort_t *serialUSART2(uint32_t baudRate, portMode_t mode)
     
     s->port.baudRate = baudRate;
     
-    s->port.rxBufferSize = UART2_RX_BUFFER_SIZE;
-    s->port.txBufferSize = UART2_TX_BUFFER_SIZE;
-    s->port.rxBuffer = rx2Buffer;
-    s->port.txBuffer = tx2Buffer;
-    
     s->USARTx = USART2;
 
     s->txDMAPeripheralBaseAddr = (uint32_t)&s->USARTx->DR;
@@ -221,8 +207,6 @@ void USART2_IRQHandler(void)
 uartPort_t *serialUSART3(uint32_t baudRate, portMode_t mode)
 {
     uartPort_t *s;
-    static volatile uint8_t rx3Buffer[UART3_RX_BUFFER_SIZE];
-    static volatile uint8_t tx3Buffer[UART3_TX_BUFFER_SIZE];
     gpio_config_t gpio;
     NVIC_InitTypeDef NVIC_InitStructure;
 
@@ -231,11 +215,6 @@ uartPort_t *serialUSART3(uint32_t baudRate, portMode_t mode)
 
     s->port.baudRate = baudRate;
 
-    s->port.rxBuffer = rx3Buffer;
-    s->port.txBuffer = tx3Buffer;
-    s->port.rxBufferSize = UART3_RX_BUFFER_SIZE;
-    s->port.txBufferSize = UART3_TX_BUFFER_SIZE;
-
     s->USARTx = USART3;
 
     s->txDMAPeripheralBaseAddr = (uint32_t)&s->USARTx->DR;
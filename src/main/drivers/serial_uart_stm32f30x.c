@@ -60,8 +60,6 @@ void uartStartTxDMA(uartPort_t *s);
 uartPort_t *serialUSART1(uint32_t baudRate, portMode_t mode)
 {
     uartPort_t *s;
-    static volatile uint8_t rx1Buffer[UART1_RX_BUFFER_SIZE];
-    static volatile uint8_t tx1Buffer[UART1_TX_BUFFER_SIZE];
     NVIC_InitTypeDef NVIC_InitStructure;
     GPIO_InitTypeDef  GPIO_InitStructure;
 
@@ -70,11 +68,6 @@ uartPort_t *serialUSART1(uint32_t baudRate, portMode_t mode)
     
     s->port.baudRate = baudRate;
     
-    s->port.rxBuffer = rx1Buffer;
-    s->port.txBuffer = tx1Buffer;
-    s->port.rxBufferSize = UART1_RX_BUFFER_SIZE;
-    s->port.txBufferSize = UART1_TX_BUFFER_SIZE;
-    
 #ifdef USE_USART1_RX_DMA
     s->rxDMAChannel = DMA1_Channel5;
 #endif
@@ -126,8 +119,6 @@ uartPort_t *serialUSART1(uint32_t baudRate, portMode_t mode)
 uartPort_t *serialUSART2(uint32_t baudRate, portMode_t mode)
 {
     uartPort_t *s;
-    static volatile uint8_t rx2Buffer[UART2_RX_BUFFER_SIZE];
-    static volatile uint8_t tx2Buffer[UART2_TX_BUFFER_SIZE];
     NVIC_InitTypeDef NVIC_InitStructure;
     GPIO_InitTypeDef  GPIO_InitStructure;
 
@@ -136,11 +127,6 @@ uartPort_t *serialUSART2(uint32_t baudRate, portMode_t mode)
     
     s->port.baudRate = baudRate;
     
-    s->port.rxBufferSize = UART2_RX_BUFFER_SIZE;
-    s->port.txBufferSize = UART2_TX_BUFFER_SIZE;
-    s->port.rxBuffer = rx2Buffer;
-    s->port.txBuffer = tx2Buffer;
-
     s->USARTx = USART2;
     
 #ifdef USE_USART2_RX_DMA
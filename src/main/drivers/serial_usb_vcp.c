@@ -20,6 +20,8 @@
 
 #include "platform.h"
 
+#include "build_config.h"
+
 #include "usb_core.h"
 #include "usb_init.h"
 #include "hw_config.h"
@@ -58,6 +60,14 @@ uint8_t usbVcpAvailable(serialPort_t *instance)
     return receiveLength & 0xFF; // FIXME use uint32_t return type everywhere
 }
 
+uint8_t usbVcpTxFree(serialPort_t *instance)
+{
+    UNUSED(instance);
+
+    // writes wait for the endpoint rather than queue, there is always room
+    return 255;
+}
+
 uint8_t usbVcpRead(serialPort_t *instance)
 {
     uint8_t buf[1];
@@ -86,7 +96,23 @@ void usbVcpWrite(serialPort_t *instance, uint8_t c)
 
 }
 
-const struct serialPortVTable usbVTable[] = { { usbVcpWrite, usbVcpAvailable, usbVcpRead, usbVcpSetBaudRate, isUsbVcpTransmitBufferEmpty, usbVcpSetMode } };
+void usbVcpWriteBuf(serialPort_t *instance, const uint8_t *data, uint8_t count)
+{
+    UNUSED(instance);
+
+    uint32_t txed = 0;
+    uint32_t start = millis();
+
+    if (!(usbIsConnected() && usbIsConfigured())) {
+        return;
+    }
+
+    do {
+        txed += CDC_Send_DATA((uint8_t*)data + txed, count - txed);
+    } while (txed < count && (millis() - start < USB_TIMEOUT));
+}
+
+const struct serialPortVTable usbVTable[] = { { usbVcpWrite, usbVcpAvailable, usbVcpTxFree, usbVcpRead, usbVcpSetBaudRate, isUsbVcpTransmitBufferEmpty, usbVcpSetMode, usbVcpWriteBuf } };
 
 serialPort_t *usbVcpOpen(void)
 {
@@ -27,8 +27,10 @@ typedef struct {
 serialPort_t *usbVcpOpen(void);
 
 uint8_t usbVcpAvailable(serialPort_t *instance);
+uint8_t usbVcpTxFree(serialPort_t *instance);
 
 uint8_t usbVcpRead(serialPort_t *instance);
 
 void usbVcpWrite(serialPort_t *instance, uint8_t ch);
+void usbVcpWriteBuf(serialPort_t *instance, const uint8_t *data, uint8_t count);
 void usbPrintStr(const char *str);
@@ -36,36 +36,63 @@
  *
  */
 
+// The sensor pings on the falling edge of the trigger and answers with an echo pulse as wide as the
+// round trip.  The trigger pulse is timed across calls to hcsr04_update() rather than with a busy wait,
+// and the next ping follows as soon as the echo is back, no sooner than HCSR04_MIN_PING_INTERVAL_US after
+// the last one so its reflections have died down.
+#define HCSR04_TRIGGER_PULSE_US 11          // the trigger must be high for more than 10us
+#define HCSR04_MIN_PING_INTERVAL_US 30000
+#define HCSR04_ECHO_TIMEOUT_US 60000        // the echo pulse is at most 38ms, missing if not back by then
+
+typedef enum {
+    HCSR04_IDLE = 0,
+    HCSR04_TRIGGERING,
+    HCSR04_RANGING
+} hcsr04State_e;
+
 static uint16_t trigger_pin;
 static uint16_t echo_pin;
 static uint32_t exti_line;
 static uint8_t exti_pin_source;
 static IRQn_Type exti_irqn;
 
-static uint32_t last_measurement;
-static volatile int32_t *distance_ptr;
+static volatile hcsr04State_e state;
+static uint32_t trigger_time;
+static uint32_t ping_time;
+
+// the latest reading, sequence counts them so hcsr04_read() can tell a new one and a torn copy
+static volatile int32_t reading_distance;
+static volatile uint32_t reading_time;
+static volatile uint8_t reading_sequence;
+static uint8_t read_sequence;
+
+static void hcsr04_store_reading(int32_t distance, uint32_t time)
+{
+    reading_distance = distance;
+    reading_time = time;
+    reading_sequence++;
+}
 
 void ECHO_EXTI_IRQHandler(void)
 {
     static uint32_t timing_start;
-    uint32_t timing_stop;
+    uint32_t now = micros();
+
     if (digitalIn(GPIOB, echo_pin) != 0) {
-        timing_start = micros();
-    } else {
-        timing_stop = micros();
-        if (timing_stop > timing_start) {
-            // The speed of sound is 340 m/s or approx. 29 microseconds per centimeter.
-            // The ping travels out and back, so to find the distance of the
-            // object we take half of the distance traveled.
-            //
-            // 340 m/s = 0.034 cm/microsecond = 29.41176471 *2 = 58.82352941 rounded to 59
-            int32_t distance = (timing_stop - timing_start) / 59;
-            // this sonar range is up to 4meter , but 3meter is the safe working range (+tilted and roll)
-            if (distance > 300)
-                distance = -1;
-
-            *distance_ptr = distance;
-        }
+        timing_start = now;
+    } else if (state == HCSR04_RANGING) {
+        // The speed of sound is 340 m/s or approx. 29 microseconds per centimeter.
+        // The ping travels out and back, so to find the distance of the
+        // object we take half of the distance traveled.
+        //
+        // 340 m/s = 0.034 cm/microsecond = 29.41176471 *2 = 58.82352941 rounded to 59
+        int32_t distance = (now - timing_start) / 59;
+        // this sonar range is up to 4meter , but 3meter is the safe working range (+tilted and roll)
+        if (distance > 300)
+            distance = -1;
+
+        hcsr04_store_reading(distance, now);
+        state = HCSR04_IDLE;
     }
 
     EXTI_ClearITPendingBit(exti_line);
@@ -130,26 +157,57 @@ void hcsr04_init(sonar_config_t config)
 
     NVIC_EnableIRQ(exti_irqn);
 
-    last_measurement = millis() - 60; // force 1st measurement in hcsr04_get_distance()
+    state = HCSR04_IDLE;
+    ping_time = micros() - HCSR04_MIN_PING_INTERVAL_US; // ping on the first hcsr04_update()
+    read_sequence = reading_sequence;
 }
 
-// distance calculation is done asynchronously, using interrupt
-void hcsr04_get_distance(volatile int32_t *distance)
+// advances the trigger pulse and the echo timeout, the echo itself is timed by the interrupt
+void hcsr04_update(void)
 {
-    uint32_t current_time = millis();
+    uint32_t now = micros();
+
+    switch (state) {
+        case HCSR04_IDLE:
+            if (now - ping_time < HCSR04_MIN_PING_INTERVAL_US)
+                return;
+            digitalHi(GPIOB, trigger_pin);
+            trigger_time = now;
+            state = HCSR04_TRIGGERING;
+            break;
 
-    if (current_time < (last_measurement + 60)) {
-        // the repeat interval of trig signal should be greater than 60ms
-        // to avoid interference between connective measurements.
-        return;
+        case HCSR04_TRIGGERING:
+            if (now - trigger_time < HCSR04_TRIGGER_PULSE_US)
+                return;
+            ping_time = now;
+            state = HCSR04_RANGING;
+            digitalLo(GPIOB, trigger_pin);
+            break;
+
+        case HCSR04_RANGING:
+            if (now - ping_time < HCSR04_ECHO_TIMEOUT_US)
+                return;
+            // no echo edge came back, report it out of range and ping again
+            state = HCSR04_IDLE;
+            hcsr04_store_reading(-1, now);
+            break;
     }
+}
+
+bool hcsr04_read(hcsr04_reading_t *reading)
+{
+    uint8_t sequence;
+
+    do {
+        sequence = reading_sequence;
+        reading->distance = reading_distance;
+        reading->time = reading_time;
+    } while (sequence != reading_sequence);
 
-    last_measurement = current_time;
-    distance_ptr = distance;
+    if (sequence == read_sequence)
+        return false;
 
-    digitalHi(GPIOB, trigger_pin);
-    //  The width of trig signal must be greater than 10us
-    delayMicroseconds(11);
-    digitalLo(GPIOB, trigger_pin);
+    read_sequence = sequence;
+    return true;
 }
 #endif
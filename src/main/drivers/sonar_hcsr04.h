@@ -22,5 +22,12 @@ typedef enum {
     sonar_rc78,
 } sonar_config_t;
 
+typedef struct hcsr04_reading_s {
+    int32_t distance;   // in cm, -1 when out of range or no echo came back
+    uint32_t time;      // micros() at the end of the echo
+} hcsr04_reading_t;
+
 void hcsr04_init(sonar_config_t config);
-void hcsr04_get_distance(volatile int32_t *distance);
+void hcsr04_update(void);
+// true and the latest reading when there is one not read before
+bool hcsr04_read(hcsr04_reading_t *reading);
@@ -34,6 +34,8 @@
 static volatile uint32_t usTicks = 0;
 // current uptime for 1kHz systick timer. will rollover after 49 days. hopefully we won't care.
 static volatile uint32_t sysTickUptime = 0;
+// run from the systick interrupt every millisecond
+static sysTickCallbackPtr sysTickCallback = NULL;
 
 #ifdef STM32F303xC
 // from system_stm32f30x.c
@@ -55,6 +57,14 @@ static void cycleCounterInit(void)
 void SysTick_Handler(void)
 {
     sysTickUptime++;
+    if (sysTickCallback) {
+        sysTickCallback();
+    }
+}
+
+void setSysTickCallback(sysTickCallbackPtr callback)
+{
+    sysTickCallback = callback;
 }
 
 // Return system uptime in microseconds (rollover in 70minutes)
@@ -180,6 +190,9 @@ void delay(uint32_t ms)
 // FIXME replace mode with an enum so usage can be tracked, currently mode is a magic number
 void failureMode(uint8_t mode)
 {
+    // the beeper is this loop's alone from here on
+    sysTickCallback = NULL;
+
     LED1_ON;
     LED0_OFF;
     while (1) {
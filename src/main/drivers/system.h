@@ -24,6 +24,11 @@ void delay(uint32_t ms);
 uint32_t micros(void);
 uint32_t millis(void);
 
+typedef void (*sysTickCallbackPtr)(void);
+
+// the callback runs in the 1kHz systick interrupt, it must be short
+void setSysTickCallback(sysTickCallbackPtr callback);
+
 // failure
 void failureMode(uint8_t mode);
 
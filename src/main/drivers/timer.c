@@ -85,12 +85,6 @@ const timerHardware_t timerHardware[USABLE_TIMER_CHANNEL_COUNT] = {
     { TIM4, GPIOB, Pin_9, TIM_Channel_4, TIM4_IRQn, 0, Mode_IPD}           // PWM14
 };
 
-#define MAX_TIMERS 4 // TIM1..TIM4
-
-static const TIM_TypeDef const *timers[MAX_TIMERS] = {
-    TIM1, TIM2, TIM3, TIM4
-};
-
 #define TIMER_APB1_PERIPHERALS (RCC_APB1Periph_TIM2 | RCC_APB1Periph_TIM3 | RCC_APB1Periph_TIM4)
 #define TIMER_APB2_PERIPHERALS (RCC_APB2Periph_TIM1 | RCC_APB2Periph_GPIOA | RCC_APB2Periph_GPIOB)
 #endif
@@ -112,12 +106,6 @@ const timerHardware_t timerHardware[USABLE_TIMER_CHANNEL_COUNT] = {
     { TIM2, GPIOA, Pin_2, TIM_Channel_3, TIM2_IRQn, 1, GPIO_Mode_AF_PP},    // S6_OUT
 };
 
-#define MAX_TIMERS 4 // TIM1..TIM4
-
-static const TIM_TypeDef const *timers[MAX_TIMERS] = {
-    TIM1, TIM2, TIM3, TIM4
-};
-
 #define TIMER_APB1_PERIPHERALS (RCC_APB1Periph_TIM2 | RCC_APB1Periph_TIM3 | RCC_APB1Periph_TIM4)
 #define TIMER_APB2_PERIPHERALS (RCC_APB2Periph_TIM1 | RCC_APB2Periph_GPIOA | RCC_APB2Periph_GPIOB)
 #endif
@@ -140,12 +128,6 @@ const timerHardware_t timerHardware[USABLE_TIMER_CHANNEL_COUNT] = {
     { TIM2, GPIOA, Pin_2, TIM_Channel_3, TIM2_IRQn, 0, Mode_AF_PP}                    // PWM14 - PA2
 };
 
-#define MAX_TIMERS 7
-
-static const TIM_TypeDef const *timers[MAX_TIMERS] = {
-    TIM1, TIM2, TIM3, TIM4, TIM8, TIM16, TIM17
-};
-
 #define TIMER_APB1_PERIPHERALS (RCC_APB1Periph_TIM2 | RCC_APB1Periph_TIM3 | RCC_APB1Periph_TIM4)
 #define TIMER_APB2_PERIPHERALS (RCC_APB2Periph_TIM1 | RCC_APB2Periph_TIM8 | RCC_APB2Periph_TIM16 | RCC_APB2Periph_TIM17)
 #define TIMER_AHB_PERIPHERALS (RCC_AHBPeriph_GPIOA | RCC_AHBPeriph_GPIOB | RCC_AHBPeriph_GPIOC | RCC_AHBPeriph_GPIOD)
@@ -177,12 +159,6 @@ const timerHardware_t timerHardware[USABLE_TIMER_CHANNEL_COUNT] = {
     { TIM3,  GPIOA, Pin_4,  TIM_Channel_2, TIM3_IRQn, 0, Mode_AF_PP}                   // PWM18 - PA4
 };
 
-#define MAX_TIMERS 8
-
-static const TIM_TypeDef const *timers[MAX_TIMERS] = {
-    TIM1, TIM2, TIM3, TIM4, TIM8, TIM15, TIM16, TIM17
-};
-
 #define TIMER_APB1_PERIPHERALS (RCC_APB1Periph_TIM2 | RCC_APB1Periph_TIM3 | RCC_APB1Periph_TIM4)
 #define TIMER_APB2_PERIPHERALS (RCC_APB2Periph_TIM1 | RCC_APB2Periph_TIM8 | RCC_APB2Periph_TIM15 | RCC_APB2Periph_TIM16 | RCC_APB2Periph_TIM17)
 #define TIMER_AHB_PERIPHERALS (RCC_AHBPeriph_GPIOA | RCC_AHBPeriph_GPIOB | RCC_AHBPeriph_GPIOC | RCC_AHBPeriph_GPIOD | RCC_AHBPeriph_GPIOF)
@@ -208,12 +184,6 @@ const timerHardware_t timerHardware[USABLE_TIMER_CHANNEL_COUNT] = {
     { TIM17, GPIOA, Pin_7,  TIM_Channel_1, TIM1_TRG_COM_TIM17_IRQn, 1, Mode_AF_PP}, // PA7 - untested
 };
 
-#define MAX_TIMERS 7
-
-static const TIM_TypeDef const *timers[MAX_TIMERS] = {
-    TIM1, TIM2, TIM3, TIM4, TIM15, TIM16, TIM17
-};
-
 #define TIMER_APB1_PERIPHERALS (RCC_APB1Periph_TIM2 | RCC_APB1Periph_TIM3 | RCC_APB1Periph_TIM4)
 #define TIMER_APB2_PERIPHERALS (RCC_APB2Periph_TIM1 | RCC_APB2Periph_TIM15 | RCC_APB2Periph_TIM16 | RCC_APB2Periph_TIM17)
 #define TIMER_AHB_PERIPHERALS (RCC_AHBPeriph_GPIOA | RCC_AHBPeriph_GPIOB)
@@ -221,25 +191,54 @@ static const TIM_TypeDef const *timers[MAX_TIMERS] = {
 #endif
 
 
+// Every timer a target can use has a fixed slot, so each interrupt handler goes straight to its dispatch entry.
+typedef enum {
+    TIMER_INDEX_TIM1 = 0,
+    TIMER_INDEX_TIM2,
+    TIMER_INDEX_TIM3,
+    TIMER_INDEX_TIM4,
+#if defined(STM32F303xC) || defined(STM32F3DISCOVERY)
+    TIMER_INDEX_TIM8,
+    TIMER_INDEX_TIM15,
+    TIMER_INDEX_TIM16,
+    TIMER_INDEX_TIM17,
+#endif
+    MAX_TIMERS
+} timerIndex_e;
+
+static TIM_TypeDef *const timers[MAX_TIMERS] = {
+    TIM1, TIM2, TIM3, TIM4,
+#if defined(STM32F303xC) || defined(STM32F3DISCOVERY)
+    TIM8, TIM15, TIM16, TIM17
+#endif
+};
+
 #define CC_CHANNELS_PER_TIMER 4 // TIM_Channel_1..4
-static const uint16_t const channels[CC_CHANNELS_PER_TIMER] = {
+static const uint16_t channels[CC_CHANNELS_PER_TIMER] = {
     TIM_Channel_1, TIM_Channel_2, TIM_Channel_3, TIM_Channel_4
 };
 
-typedef struct timerConfig_s {
-    TIM_TypeDef *tim;
-    uint8_t channel;
+// the update and capture/compare interrupts, their flags sit at the same bits in SR and DIER
+#define TIMER_DISPATCHED_INTERRUPTS (TIM_IT_Update | TIM_IT_CC1 | TIM_IT_CC2 | TIM_IT_CC3 | TIM_IT_CC4)
+
+typedef struct timerChannelDispatch_s {
     timerCCCallbackPtr *edgeCallback;
     timerCCCallbackPtr *overflowCallback;
+    volatile captureCompare_t *captureRegister;
     uint8_t reference;
-} timerConfig_t;
+} timerChannelDispatch_t;
 
-static timerConfig_t timerConfig[MAX_TIMERS * CC_CHANNELS_PER_TIMER];
+typedef struct timerDispatch_s {
+    timerChannelDispatch_t channels[CC_CHANNELS_PER_TIMER];
+    uint8_t overflowChannels;               // bit per channel index with an overflow callback
+} timerDispatch_t;
+
+static timerDispatch_t timerDispatch[MAX_TIMERS];
 
 static uint8_t lookupTimerIndex(const TIM_TypeDef *tim)
 {
     uint8_t timerIndex = 0;
-    while (timers[timerIndex] != tim) {
+    while (timerIndex < MAX_TIMERS && timers[timerIndex] != tim) {
         timerIndex++;
     }
     return timerIndex;
@@ -254,9 +253,18 @@ static uint8_t lookupChannelIndex(const uint16_t channel)
     return channelIndex;
 }
 
-static uint8_t lookupTimerConfigIndex(TIM_TypeDef *tim, const uint16_t channel)
+static volatile captureCompare_t *lookupCaptureRegister(TIM_TypeDef *tim, const uint16_t channel)
 {
-    return lookupTimerIndex(tim) + (MAX_TIMERS * lookupChannelIndex(channel));
+    switch (channel) {
+        case TIM_Channel_1:
+            return &tim->CCR1;
+        case TIM_Channel_2:
+            return &tim->CCR2;
+        case TIM_Channel_3:
+            return &tim->CCR3;
+        default:
+            return &tim->CCR4;
+    }
 }
 
 void configureTimerChannelCallback(TIM_TypeDef *tim, uint8_t channel, uint8_t reference, timerCCCallbackPtr *edgeCallback)
@@ -268,16 +276,26 @@ void configureTimerChannelCallbacks(TIM_TypeDef *tim, uint8_t channel, uint8_t r
 {
     assert_param(IS_TIM_CHANNEL(channel));
 
-    uint8_t timerConfigIndex = lookupTimerConfigIndex(tim, channel);
+    uint8_t timerIndex = lookupTimerIndex(tim);
 
-    if (timerConfigIndex >= MAX_TIMERS * CC_CHANNELS_PER_TIMER) {
+    if (timerIndex >= MAX_TIMERS) {
         return;
     }
 
-    timerConfig[timerConfigIndex].edgeCallback = edgeCallback;
-    timerConfig[timerConfigIndex].overflowCallback = overflowCallback;
-    timerConfig[timerConfigIndex].channel = channel;
-    timerConfig[timerConfigIndex].reference = reference;
+    timerDispatch_t *dispatch = &timerDispatch[timerIndex];
+    uint8_t channelIndex = lookupChannelIndex(channel);
+    timerChannelDispatch_t *channelDispatch = &dispatch->channels[channelIndex];
+
+    channelDispatch->edgeCallback = edgeCallback;
+    channelDispatch->overflowCallback = overflowCallback;
+    channelDispatch->captureRegister = lookupCaptureRegister(tim, channel);
+    channelDispatch->reference = reference;
+
+    if (overflowCallback) {
+        dispatch->overflowChannels |= (1 << channelIndex);
+    } else {
+        dispatch->overflowChannels &= ~(1 << channelIndex);
+    }
 }
 
 void configureTimerInputCaptureCompareChannel(TIM_TypeDef *tim, const uint8_t channel)
@@ -342,113 +360,91 @@ void timerConfigure(const timerHardware_t *timerHardwarePtr, uint16_t period, ui
     timerNVICConfigure(timerHardwarePtr->irq);
 }
 
-timerConfig_t *findTimerConfig(TIM_TypeDef *tim, uint16_t channel)
-{
-    uint8_t timerConfigIndex = lookupTimerConfigIndex(tim, channel);
-    return &(timerConfig[timerConfigIndex]);
-}
-
-static void timCCxHandler(TIM_TypeDef *tim)
+/*
+ * SR is read once and the pending flags are visited lowest first, the update before CC1 to CC4, with one
+ * dispatch table lookup each.  The flags are cleared by writing 0 to them, so the single write of the
+ * inverted set leaves any flag raised since the read for the next interrupt.
+ */
+static void timCCxHandler(TIM_TypeDef *tim, timerDispatch_t *dispatch)
 {
-    captureCompare_t capture;
-    timerConfig_t *timerConfig;
-    uint8_t channel;
+    uint16_t pending = tim->SR & tim->DIER & TIMER_DISPATCHED_INTERRUPTS;
+    timerChannelDispatch_t *channel;
     uint8_t channelIndex;
 
-    if (TIM_GetITStatus(tim, TIM_IT_Update) == SET) {
-        TIM_ClearITPendingBit(tim, TIM_IT_Update);
-        capture = tim->ARR;
+    tim->SR = (uint16_t)~pending;
+
+    if (pending & TIM_IT_Update) {
+        captureCompare_t capture = tim->ARR;
+        uint8_t overflowChannels = dispatch->overflowChannels;
 
-        for (channelIndex = 0; channelIndex < CC_CHANNELS_PER_TIMER; channelIndex++) {
-            channel = channels[channelIndex];
-            timerConfig = findTimerConfig(tim, channel);
+        while (overflowChannels) {
+            channelIndex = __builtin_ctz(overflowChannels);
+            overflowChannels &= overflowChannels - 1;
 
-            if (!timerConfig->overflowCallback) {
-                continue;
-            }
-            timerConfig->overflowCallback(timerConfig->reference, capture);
+            channel = &dispatch->channels[channelIndex];
+            channel->overflowCallback(channel->reference, capture);
         }
     }
 
-    for (channelIndex = 0; channelIndex < CC_CHANNELS_PER_TIMER; channelIndex++) {
-        channel = channels[channelIndex];
-
-        if (channel == TIM_Channel_1 && TIM_GetITStatus(tim, TIM_IT_CC1) == SET) {
-            TIM_ClearITPendingBit(tim, TIM_IT_CC1);
-
-            timerConfig = findTimerConfig(tim, TIM_Channel_1);
-            capture = TIM_GetCapture1(tim);
-        } else if (channel == TIM_Channel_2 && TIM_GetITStatus(tim, TIM_IT_CC2) == SET) {
-            TIM_ClearITPendingBit(tim, TIM_IT_CC2);
-
-            timerConfig = findTimerConfig(tim, TIM_Channel_2);
-            capture = TIM_GetCapture2(tim);
-        } else if (channel == TIM_Channel_3 && TIM_GetITStatus(tim, TIM_IT_CC3) == SET) {
-            TIM_ClearITPendingBit(tim, TIM_IT_CC3);
-
-            timerConfig = findTimerConfig(tim, TIM_Channel_3);
-            capture = TIM_GetCapture3(tim);
-        } else if (channel == TIM_Channel_4 && TIM_GetITStatus(tim, TIM_IT_CC4) == SET) {
-            TIM_ClearITPendingBit(tim, TIM_IT_CC4);
-
-            timerConfig = findTimerConfig(tim, TIM_Channel_4);
-            capture = TIM_GetCapture4(tim);
-        } else {
-            continue; // avoid uninitialised variable dereference
-        }
+    // CC1IF is bit 1, so the shifted flags are the channel indexes
+    pending >>= 1;
+    while (pending) {
+        channelIndex = __builtin_ctz(pending);
+        pending &= pending - 1;
 
-        if (!timerConfig->edgeCallback) {
+        channel = &dispatch->channels[channelIndex];
+        if (!channel->edgeCallback) {
             continue;
         }
-        timerConfig->edgeCallback(timerConfig->reference, capture);
+        channel->edgeCallback(channel->reference, *channel->captureRegister);
     }
 }
 
 void TIM1_CC_IRQHandler(void)
 {
-    timCCxHandler(TIM1);
+    timCCxHandler(TIM1, &timerDispatch[TIMER_INDEX_TIM1]);
 }
 
 void TIM2_IRQHandler(void)
 {
-    timCCxHandler(TIM2);
+    timCCxHandler(TIM2, &timerDispatch[TIMER_INDEX_TIM2]);
 }
 
 void TIM3_IRQHandler(void)
 {
-    timCCxHandler(TIM3);
+    timCCxHandler(TIM3, &timerDispatch[TIMER_INDEX_TIM3]);
 }
 
 void TIM4_IRQHandler(void)
 {
-    timCCxHandler(TIM4);
+    timCCxHandler(TIM4, &timerDispatch[TIMER_INDEX_TIM4]);
 }
 
 #if defined(STM32F303xC) || defined(STM32F3DISCOVERY)
 void TIM8_CC_IRQHandler(void)
 {
-    timCCxHandler(TIM8);
+    timCCxHandler(TIM8, &timerDispatch[TIMER_INDEX_TIM8]);
 }
 
 void TIM1_BRK_TIM15_IRQHandler(void)
 {
-    timCCxHandler(TIM15);
+    timCCxHandler(TIM15, &timerDispatch[TIMER_INDEX_TIM15]);
 }
 
 void TIM1_UP_TIM16_IRQHandler(void)
 {
-    timCCxHandler(TIM16);
+    timCCxHandler(TIM16, &timerDispatch[TIMER_INDEX_TIM16]);
 }
 
 void TIM1_TRG_COM_TIM17_IRQHandler(void)
 {
-    timCCxHandler(TIM17);
+    timCCxHandler(TIM17, &timerDispatch[TIMER_INDEX_TIM17]);
 }
 #endif
 
 void timerInit(void)
 {
-    memset(timerConfig, 0, sizeof (timerConfig));
+    memset(timerDispatch, 0, sizeof (timerDispatch));
 
 #ifdef CC3D
     GPIO_PinRemapConfig(GPIO_PartialRemap_TIM3, ENABLE);
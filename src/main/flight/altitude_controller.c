@@ -0,0 +1,148 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Cascaded altitude controller.
+//
+// The altitude error sets a climb rate (p_alt), the climb rate error sets an acceleration (p_vel, i_vel)
+// and the acceleration sets the throttle as a multiple of the hover throttle, with alt_hold_accel_gain
+// percent of the measured acceleration error fed back on top.  d_vel is not used.  All three loops run every control cycle.  Between the 40Hz
+// altitude estimates the altitude and climb rate are carried forward on the earth frame acceleration, so
+// the throttle does not step when a new estimate arrives.
+//
+// The hover throttle starts as the throttle when alt hold engages and, with alt_hold_hover_learn set,
+// follows the throttle whenever the climb rate is small, so it is learned over the flight.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "common/axis.h"
+#include "common/maths.h"
+
+#include "flight/flight.h"
+#include "flight/altitude_controller.h"
+
+#define GRAVITY_CMSS 980.665f
+
+#define ESTIMATE_TIME_CONSTANT 0.05f        // seconds, how quickly the carried forward estimate follows the 40Hz one
+#define MAX_ALTITUDE_ERROR 500              // cm
+#define MAX_CLIMB_RATE 300                  // cm/s
+#define MAX_ACCELERATION 500                // cm/s/s
+#define MAX_VELOCITY_I 400                  // cm/s/s, a hover throttle 40% out
+#define HOVER_LEARN_MAX_CLIMB_RATE 50       // cm/s
+
+static pidProfile_t *pidProfile;
+static uint8_t hoverLearnTime;
+static uint8_t accelerationGain;
+static uint16_t minThrottle;
+static uint16_t maxThrottle;
+
+static float altitude;                      // carried forward estimate, cm
+static float velocity;                      // cm/s
+static int32_t targetAltitude;
+static int32_t targetVelocity;
+static bool holdVelocity;
+static float velocityI;                     // cm/s/s
+static float accelerationTarget;            // cm/s/s
+static float hoverThrottle;
+static bool hoverThrottleLearned;
+
+void configureAltitudeController(pidProfile_t *initialPidProfile, uint8_t initialHoverLearnTime, uint8_t initialAccelerationGain, uint16_t initialMinThrottle, uint16_t initialMaxThrottle)
+{
+    pidProfile = initialPidProfile;
+    hoverLearnTime = initialHoverLearnTime;
+    accelerationGain = initialAccelerationGain;
+    minThrottle = initialMinThrottle;
+    maxThrottle = initialMaxThrottle;
+}
+
+void altitudeControllerReset(altitudeEstimate_t *estimate, uint16_t throttle)
+{
+    altitude = estimate->altitude;
+    velocity = estimate->velocity;
+    targetAltitude = estimate->altitude;
+    holdVelocity = false;
+    velocityI = 0;
+    accelerationTarget = 0;
+
+    if (!hoverLearnTime || !hoverThrottleLearned) {
+        hoverThrottle = constrain(throttle, minThrottle, maxThrottle);
+        hoverThrottleLearned = hoverLearnTime > 0;
+    }
+}
+
+void altitudeControllerHoldAltitude(int32_t altitude)
+{
+    targetAltitude = altitude;
+    holdVelocity = false;
+}
+
+void altitudeControllerHoldVelocity(int32_t velocity)
+{
+    targetVelocity = velocity;
+    holdVelocity = true;
+}
+
+uint16_t altitudeControllerUpdate(altitudeEstimate_t *estimate, uint32_t dT)
+{
+    float dt = dT * 1e-6f;
+    float filterGain = dt / (ESTIMATE_TIME_CONSTANT + dt);
+    float climbRate;
+    float velocityError;
+    float accelerationError;
+    float throttle;
+
+    velocity += estimate->acceleration * dt;
+    altitude += velocity * dt;
+    velocity += (estimate->velocity - velocity) * filterGain;
+    altitude += (estimate->altitude - altitude) * filterGain;
+
+    // altitude -> climb rate
+    if (holdVelocity) {
+        climbRate = targetVelocity;
+    } else {
+        float error = constrainf(targetAltitude - altitude, -MAX_ALTITUDE_ERROR, MAX_ALTITUDE_ERROR);
+        climbRate = constrainf(pidProfile->P8[PIDALT] * error / 128.0f, -MAX_CLIMB_RATE, MAX_CLIMB_RATE);
+    }
+
+    // climb rate -> acceleration
+    velocityError = climbRate - velocity;
+    velocityI = constrainf(velocityI + pidProfile->I8[PIDVEL] * velocityError * dt / 32.0f, -MAX_VELOCITY_I, MAX_VELOCITY_I);
+    accelerationTarget = constrainf(pidProfile->P8[PIDVEL] * velocityError / 32.0f + velocityI, -MAX_ACCELERATION, MAX_ACCELERATION);
+
+    // acceleration -> throttle, thrust above min throttle taken as proportional to the throttle
+    accelerationError = accelerationTarget - estimate->acceleration;
+    throttle = minThrottle + (hoverThrottle - minThrottle) *
+        (1.0f + (accelerationTarget + accelerationGain * accelerationError / 100.0f) / GRAVITY_CMSS);
+    throttle = constrainf(throttle, minThrottle, maxThrottle);
+
+    if (hoverLearnTime && fabsf(velocity) < HOVER_LEARN_MAX_CLIMB_RATE) {
+        hoverThrottle += (throttle - hoverThrottle) * dt / hoverLearnTime;
+    }
+
+    return lrintf(throttle);
+}
+
+float altitudeControllerGetAccelerationTarget(void)
+{
+    return accelerationTarget;
+}
+
+uint16_t altitudeControllerGetHoverThrottle(void)
+{
+    return lrintf(hoverThrottle);
+}
@@ -0,0 +1,40 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+typedef struct altitudeEstimate_s {
+    int32_t altitude;                       // cm
+    float velocity;                         // cm/s
+    float acceleration;                     // earth frame less gravity, cm/s/s
+} altitudeEstimate_t;
+
+// hoverLearnTime is how many seconds the hover throttle takes to follow the throttle while the climb rate is
+// small, 0 takes the throttle at the moment alt hold engages as the hover throttle every time.
+// accelerationGain is the percentage of the measured acceleration error fed back into the throttle.
+void configureAltitudeController(pidProfile_t *initialPidProfile, uint8_t hoverLearnTime, uint8_t accelerationGain, uint16_t minThrottle, uint16_t maxThrottle);
+
+// starts holding the estimated altitude from the current throttle
+void altitudeControllerReset(altitudeEstimate_t *estimate, uint16_t throttle);
+void altitudeControllerHoldAltitude(int32_t altitude);
+void altitudeControllerHoldVelocity(int32_t velocity);
+
+// runs every control cycle, dT in us, and returns the throttle
+uint16_t altitudeControllerUpdate(altitudeEstimate_t *estimate, uint32_t dT);
+
+float altitudeControllerGetAccelerationTarget(void);
+uint16_t altitudeControllerGetHoverThrottle(void);
@@ -18,6 +18,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <math.h>
 
 #include "platform.h"
 
@@ -39,14 +40,21 @@
 #include "sensors/battery.h"
 #include "sensors/boardalignment.h"
 #include "sensors/gyro.h"
+#include "sensors/gyro_redundancy.h"
+#include "sensors/vibration.h"
+
 
 #include "io/escservo.h"
 #include "io/gimbal.h"
 #include "io/gps.h"
+#include "io/flight_log.h"
 #include "io/serial.h"
 #include "flight/failsafe.h"
 #include "flight/imu.h"
+#include "flight/altitude_controller.h"
 #include "flight/mixer.h"
+#include "flight/thrust_linear.h"
+#include "flight/servo_output.h"
 #include "flight/navigation.h"
 #include "telemetry/telemetry.h"
 
@@ -58,9 +66,38 @@
 #include "config/config_profile.h"
 #include "config/config_master.h"
 
+extern uint16_t cycleTime; // FIXME dependency on mw.c
+
 #ifdef BARO
 static int16_t initialThrottleHold;
 
+static void getAltitudeEstimate(altitudeEstimate_t *estimate)
+{
+    estimate->altitude = EstAlt;
+    estimate->velocity = EstVel;
+    estimate->acceleration = EstAccZ;
+}
+
+static void resetAltitudeController(void)
+{
+    altitudeEstimate_t estimate;
+
+    getAltitudeEstimate(&estimate);
+    altitudeControllerReset(&estimate, initialThrottleHold);
+}
+
+static uint16_t updateAltitudeController(void)
+{
+    altitudeEstimate_t estimate;
+
+    if (!isThrustFacingDownwards(&inclination)) {
+        return altitudeControllerGetHoverThrottle();
+    }
+
+    getAltitudeEstimate(&estimate);
+    return altitudeControllerUpdate(&estimate, cycleTime);
+}
+
 static void multirotorAltHold(void)
 {
     static uint8_t isAltHoldChanged = 0;
@@ -68,29 +105,31 @@ static void multirotorAltHold(void)
     if (currentProfile.alt_hold_fast_change) {
         // rapid alt changes
         if (abs(rcCommand[THROTTLE] - initialThrottleHold) > currentProfile.alt_hold_deadband) {
-            errorVelocityI = 0;
             isAltHoldChanged = 1;
             rcCommand[THROTTLE] += (rcCommand[THROTTLE] > initialThrottleHold) ? -currentProfile.alt_hold_deadband : currentProfile.alt_hold_deadband;
         } else {
             if (isAltHoldChanged) {
                 AltHold = EstAlt;
+                resetAltitudeController();
                 isAltHoldChanged = 0;
             }
-            rcCommand[THROTTLE] = constrain(initialThrottleHold + BaroPID, masterConfig.escAndServoConfig.minthrottle, masterConfig.escAndServoConfig.maxthrottle);
+            altitudeControllerHoldAltitude(AltHold);
+            rcCommand[THROTTLE] = updateAltitudeController();
         }
     } else {
         // slow alt changes for apfags
         if (abs(rcCommand[THROTTLE] - initialThrottleHold) > currentProfile.alt_hold_deadband) {
             // set velocity proportional to stick movement +100 throttle gives ~ +50 cm/s
-            setVelocity = (rcCommand[THROTTLE] - initialThrottleHold) / 2;
-            velocityControl = 1;
+            altitudeControllerHoldVelocity((rcCommand[THROTTLE] - initialThrottleHold) / 2);
             isAltHoldChanged = 1;
-        } else if (isAltHoldChanged) {
-            AltHold = EstAlt;
-            velocityControl = 0;
-            isAltHoldChanged = 0;
+        } else {
+            if (isAltHoldChanged) {
+                AltHold = EstAlt;
+                isAltHoldChanged = 0;
+            }
+            altitudeControllerHoldAltitude(AltHold);
         }
-        rcCommand[THROTTLE] = constrain(initialThrottleHold + BaroPID, masterConfig.escAndServoConfig.minthrottle, masterConfig.escAndServoConfig.maxthrottle);
+        rcCommand[THROTTLE] = updateAltitudeController();
     }
 }
 
@@ -100,7 +139,9 @@ static void fixedWingAltHold()
     // most likely need to check changes on pitch channel and 'reset' althold similar to
     // how throttle does it on multirotor
 
-    rcCommand[PITCH] += BaroPID * masterConfig.fixedwing_althold_dir;
+    altitudeControllerHoldAltitude(AltHold);
+    updateAltitudeController();
+    rcCommand[PITCH] += lrintf(altitudeControllerGetAccelerationTarget() / 2) * masterConfig.fixedwing_althold_dir;
 }
 
 void updateAltHold(void)
@@ -120,8 +161,7 @@ void updateAltHoldState(void)
             f.BARO_MODE = 1;
             AltHold = EstAlt;
             initialThrottleHold = rcCommand[THROTTLE];
-            errorVelocityI = 0;
-            BaroPID = 0;
+            resetAltitudeController();
         }
     } else {
         f.BARO_MODE = 0;
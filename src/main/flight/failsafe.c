@@ -36,6 +36,18 @@
  * failsafeInit() should only be called once.
  *
  * enable() should be called after system initialisation.
+ *
+ * The receiver code calls onValidDataReceived() with the time of every frame that checked out, whichever
+ * provider it came from, and onFailsafeIndicated() while the receiver itself reports a loss of signal.  The
+ * stages run on the time since the last valid frame, so how soon a loss is acted on does not depend on the
+ * loop or the frame rate:
+ *
+ * - FAILSAFE_SIGNAL_LOSS_US without a valid frame the signal is lost and the craft is held level, sticks
+ *   centred and the throttle where it was.
+ * - failsafe_delay after the last valid frame it lands at failsafe_throttle, and cannot be rearmed.
+ * - failsafe_off_delay after that the motors are stopped.
+ *
+ * A valid frame ends it at any stage.
  */
 
 static failsafe_t failsafe;
@@ -44,11 +56,12 @@ static failsafeConfig_t *failsafeConfig;
 
 static rxConfig_t *rxConfig;
 
-const failsafeVTable_t failsafeVTable[];
+extern const failsafeVTable_t failsafeVTable[];
 
 void reset(void)
 {
-    failsafe.counter = 0;
+    failsafe.stage = FAILSAFE_STAGE_IDLE;
+    failsafe.indicatedByReceiver = false;
 }
 
 /*
@@ -67,13 +80,17 @@ failsafe_t* failsafeInit(rxConfig_t *intialRxConfig)
     failsafe.vTable = failsafeVTable;
     failsafe.events = 0;
     failsafe.enabled = false;
+    failsafe.validDataAt = 0;
+    failsafe.dataReceived = false;
+    failsafe.holdThrottle = rxConfig->mincheck;
+    reset();
 
     return &failsafe;
 }
 
 bool isIdle(void)
 {
-    return failsafe.counter == 0;
+    return failsafe.stage == FAILSAFE_STAGE_IDLE;
 }
 
 bool isEnabled(void)
@@ -86,9 +103,14 @@ void enable(void)
     failsafe.enabled = true;
 }
 
+bool shouldForceLevel(void)
+{
+    return failsafe.stage != FAILSAFE_STAGE_IDLE;
+}
+
 bool hasTimerElapsed(void)
 {
-    return failsafe.counter > (5 * failsafeConfig->failsafe_delay);
+    return failsafe.stage >= FAILSAFE_STAGE_LANDING;
 }
 
 bool shouldForceLanding(bool armed)
@@ -98,7 +120,7 @@ bool shouldForceLanding(bool armed)
 
 bool shouldHaveCausedLandingByNow(void)
 {
-    return failsafe.counter > 5 * (failsafeConfig->failsafe_delay + failsafeConfig->failsafe_off_delay);
+    return failsafe.stage == FAILSAFE_STAGE_LANDED;
 }
 
 void failsafeAvoidRearm(void)
@@ -108,62 +130,110 @@ void failsafeAvoidRearm(void)
     f.PREVENT_ARMING = 1;
 }
 
-void onValidDataReceived(void)
+void onValidDataReceived(uint32_t currentTime)
 {
-    if (failsafe.counter > 20)
-        failsafe.counter -= 20;
-    else
-        failsafe.counter = 0;
+    failsafe.validDataAt = currentTime;
+    failsafe.dataReceived = true;
+    reset();
 }
 
-void updateState(void)
+/*
+ * Called while the receiver reports its own loss of signal.  It has already waited before doing so, so the
+ * guard time is skipped and the landing starts at once.
+ */
+void onFailsafeIndicated(void)
 {
-    uint8_t i;
+    failsafe.indicatedByReceiver = true;
+}
 
-    if (!hasTimerElapsed()) {
-        return;
+static failsafeStage_e nextStage(uint32_t currentTime)
+{
+    uint32_t signalLostFor = currentTime - failsafe.validDataAt;
+
+    switch (failsafe.stage) {
+        case FAILSAFE_STAGE_IDLE:
+            if (failsafe.indicatedByReceiver) {
+                return FAILSAFE_STAGE_LANDING;
+            }
+            if (signalLostFor >= FAILSAFE_SIGNAL_LOSS_US) {
+                return FAILSAFE_STAGE_HOLD;
+            }
+            break;
+        case FAILSAFE_STAGE_HOLD:
+            if (failsafe.indicatedByReceiver || signalLostFor >= failsafeConfig->failsafe_delay * 100000UL) {
+                return FAILSAFE_STAGE_LANDING;
+            }
+            break;
+        case FAILSAFE_STAGE_LANDING:
+            if (!f.ARMED || currentTime - failsafe.landingAt >= failsafeConfig->failsafe_off_delay * 100000UL) {
+                return FAILSAFE_STAGE_LANDED;
+            }
+            break;
+        case FAILSAFE_STAGE_LANDED:
+            break;
     }
+    return failsafe.stage;
+}
+
+/*
+ * True when updateState() has a stage to move on to, so the receiver code can run it without waiting for
+ * its next frame or the 50Hz fallback.
+ */
+bool isUpdateDue(uint32_t currentTime)
+{
+    return failsafe.enabled && nextStage(currentTime) != failsafe.stage;
+}
+
+void updateState(uint32_t currentTime)
+{
+    uint8_t i;
 
     if (!isEnabled()) {
-        reset();
+        // the signal is only missed from the moment failsafe is enabled
+        failsafe.validDataAt = currentTime;
         return;
     }
 
-    if (shouldForceLanding(f.ARMED)) { // Stabilize, and set Throttle to specified level
-        failsafeAvoidRearm();
+    if (failsafe.dataReceived) {
+        failsafe.dataReceived = false;
+        failsafe.holdThrottle = rcData[THROTTLE];
+    }
 
-        for (i = 0; i < 3; i++) {
-            rcData[i] = rxConfig->midrc;      // after specified guard time after RC signal is lost (in 0.1sec)
+    failsafeStage_e stage = nextStage(currentTime);
+    if (stage != failsafe.stage) {
+        failsafe.stage = stage;
+        if (stage == FAILSAFE_STAGE_LANDING) {
+            failsafe.landingAt = currentTime;
+            if (f.ARMED) {
+                failsafeAvoidRearm();
+                failsafe.events++;
+            }
         }
-        rcData[THROTTLE] = failsafeConfig->failsafe_throttle;
-        failsafe.events++;
     }
 
-    if (shouldHaveCausedLandingByNow() || !f.ARMED) {
-        mwDisarm();
+    switch (failsafe.stage) {
+        case FAILSAFE_STAGE_IDLE:
+            return;
+        case FAILSAFE_STAGE_HOLD:
+            rcData[THROTTLE] = failsafe.holdThrottle;
+            break;
+        case FAILSAFE_STAGE_LANDING:
+            rcData[THROTTLE] = failsafeConfig->failsafe_throttle;
+            break;
+        case FAILSAFE_STAGE_LANDED:
+            mwDisarm();
+            return;
     }
-}
 
-void incrementCounter(void)
-{
-    failsafe.counter++;
+    for (i = 0; i < 3; i++) {
+        rcData[i] = rxConfig->midrc;
+    }
 }
 
 // pulse duration is in micro secons (usec)
-void failsafeCheckPulse(uint8_t channel, uint16_t pulseDuration)
+bool failsafeCheckPulse(uint16_t pulseDuration)
 {
-    static uint8_t goodChannelMask;
-
-    if (channel < 4 &&
-        pulseDuration > failsafeConfig->failsafe_min_usec &&
-        pulseDuration < failsafeConfig->failsafe_max_usec
-    )
-        goodChannelMask |= (1 << channel);       // if signal is valid - mark channel as OK
-
-    if (goodChannelMask == 0x0F) {               // If first four channels have good pulses, clear FailSafe counter
-        goodChannelMask = 0;
-        onValidDataReceived();
-    }
+    return pulseDuration > failsafeConfig->failsafe_min_usec && pulseDuration < failsafeConfig->failsafe_max_usec;
 }
 
 
@@ -173,13 +243,14 @@ const failsafeVTable_t failsafeVTable[] = {
         shouldForceLanding,
         hasTimerElapsed,
         shouldHaveCausedLandingByNow,
-        incrementCounter,
+        onValidDataReceived,
         updateState,
         isIdle,
         failsafeCheckPulse,
         isEnabled,
-        enable
+        enable,
+        onFailsafeIndicated,
+        shouldForceLevel,
+        isUpdateDue
     }
 };
-
-
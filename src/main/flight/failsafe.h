@@ -18,6 +18,7 @@
 #pragma once
 
 #define FAILSAFE_POWER_ON_DELAY_US (1000 * 1000 * 5)
+#define FAILSAFE_SIGNAL_LOSS_US (1000 * 100)        // without a valid frame for this long the signal is taken as lost
 
 typedef struct failsafeConfig_s {
     uint8_t failsafe_delay;                 // Guard time for failsafe activation after signal lost. 1 step = 0.1sec - 1sec in example (10)
@@ -27,27 +28,40 @@ typedef struct failsafeConfig_s {
     uint16_t failsafe_max_usec;
 } failsafeConfig_t;
 
+typedef enum {
+    FAILSAFE_STAGE_IDLE = 0,
+    FAILSAFE_STAGE_HOLD,                    // signal lost, level with the sticks centred and the throttle held
+    FAILSAFE_STAGE_LANDING,                 // guard time over, descend at failsafe_throttle
+    FAILSAFE_STAGE_LANDED                   // motors stopped
+} failsafeStage_e;
+
 typedef struct failsafeVTable_s {
     void (*reset)(void);
     bool (*shouldForceLanding)(bool armed);
     bool (*hasTimerElapsed)(void);
     bool (*shouldHaveCausedLandingByNow)(void);
-    void (*incrementCounter)(void);
-    void (*updateState)(void);
+    void (*onValidDataReceived)(uint32_t currentTime);
+    void (*updateState)(uint32_t currentTime);
     bool (*isIdle)(void);
-    void (*checkPulse)(uint8_t channel, uint16_t pulseDuration);
+    bool (*checkPulse)(uint16_t pulseDuration);
     bool (*isEnabled)(void);
     void (*enable)(void);
-
+    void (*onFailsafeIndicated)(void);
+    bool (*shouldForceLevel)(void);
+    bool (*isUpdateDue)(uint32_t currentTime);
 } failsafeVTable_t;
 
 typedef struct failsafe_s {
     const failsafeVTable_t *vTable;
 
-    int16_t counter;
+    failsafeStage_e stage;
+    uint32_t validDataAt;                   // when the receiver last delivered a valid frame
+    uint32_t landingAt;
+    uint16_t holdThrottle;                  // from the last valid frame, kept while holding
     int16_t events;
     bool enabled;
+    bool dataReceived;                      // a valid frame since the last update
+    bool indicatedByReceiver;
 } failsafe_t;
 
 void useFailsafeConfig(failsafeConfig_t *failsafeConfigToUse);
-
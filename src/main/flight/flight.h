@@ -132,6 +132,8 @@ extern int16_t heading, magHold;
 extern int32_t EstAlt;
 extern int32_t AltHold;
 extern int32_t EstAlt;
+extern float EstVel;
+extern float EstAccZ;
 extern int32_t vario;
 
 void setPIDController(int type);
@@ -55,18 +55,15 @@ float accVelScale;
 int16_t smallAngle = 0;
 
 int32_t EstAlt;                // in cm
+float EstVel;                   // in cm/s
+float EstAccZ;                  // earth frame less gravity, in cm/s/s
 int32_t AltHold;
-int32_t setVelocity = 0;
-uint8_t velocityControl = 0;
-int32_t errorVelocityI = 0;
 
 int32_t vario = 0;                      // variometer in cm/s
 
 float throttleAngleScale;
 float fc_acc;
 
-int32_t BaroPID = 0;
-
 float magneticDeclination = 0.0f;       // calculated at startup from config
 float gyroScaleRad;
 
@@ -82,14 +79,12 @@ float anglerad[2] = { 0.0f, 0.0f };    // absolute angle inclination in radians
 static void getEstimatedAttitude(void);
 
 imuRuntimeConfig_t *imuRuntimeConfig;
-pidProfile_t *pidProfile;
 barometerConfig_t *barometerConfig;
 accDeadband_t *accDeadband;
 
-void configureImu(imuRuntimeConfig_t *initialImuRuntimeConfig, pidProfile_t *initialPidProfile, barometerConfig_t *intialBarometerConfig, accDeadband_t *initialAccDeadband)
+void configureImu(imuRuntimeConfig_t *initialImuRuntimeConfig, barometerConfig_t *intialBarometerConfig, accDeadband_t *initialAccDeadband)
 {
     imuRuntimeConfig = initialImuRuntimeConfig;
-    pidProfile = initialPidProfile;
     barometerConfig = intialBarometerConfig;
     accDeadband = initialAccDeadband;
 }
@@ -248,6 +243,7 @@ void acc_calc(uint32_t deltaT)
         accel_ned.V.Z -= acc_1G;
 
     accz_smooth = accz_smooth + (dT / (fc_acc + dT)) * (accel_ned.V.Z - accz_smooth); // low pass filter
+    EstAccZ = accz_smooth * accVelScale * 1000000.0f;
 
     // apply Deadband to reduce integration drift and vibration influence
     accSum[X] += applyDeadband(lrintf(accel_ned.V.X), accDeadband->xy);
@@ -384,42 +380,6 @@ int16_t calculateTiltAngle(rollAndPitchInclination_t *inclination)
 	return max(abs(inclination->values.rollDeciDegrees), abs(inclination->values.pitchDeciDegrees));
 }
 
-int32_t calculateBaroPid(int32_t vel_tmp, float accZ_tmp, float accZ_old)
-{
-    uint32_t newBaroPID = 0;
-    int32_t error;
-    int32_t setVel;
-
-    if (!isThrustFacingDownwards(&inclination)) {
-        return newBaroPID;
-    }
-
-    // Altitude P-Controller
-
-    if (!velocityControl) {
-        error = constrain(AltHold - EstAlt, -500, 500);
-        error = applyDeadband(error, 10); // remove small P parameter to reduce noise near zero position
-        setVel = constrain((pidProfile->P8[PIDALT] * error / 128), -300, +300); // limit velocity to +/- 3 m/s
-    } else {
-        setVel = setVelocity;
-    }
-    // Velocity PID-Controller
-
-    // P
-    error = setVel - vel_tmp;
-    newBaroPID = constrain((pidProfile->P8[PIDVEL] * error / 32), -300, +300);
-
-    // I
-    errorVelocityI += (pidProfile->I8[PIDVEL] * error);
-    errorVelocityI = constrain(errorVelocityI, -(8192 * 200), (8192 * 200));
-    newBaroPID += errorVelocityI / 8192;     // I in range +/-200
-
-    // D
-    newBaroPID -= constrain(pidProfile->D8[PIDVEL] * (accZ_tmp + accZ_old) / 512, -150, 150);
-
-    return newBaroPID;
-}
-
 void calculateEstimatedAltitude(uint32_t currentTime)
 {
     static uint32_t previousTime;
@@ -429,7 +389,6 @@ void calculateEstimatedAltitude(uint32_t currentTime)
     float vel_acc;
     int32_t vel_tmp;
     float accZ_tmp;
-    static float accZ_old = 0.0f;
     static float vel = 0.0f;
     static float accAlt = 0.0f;
     static int32_t lastBaroAlt;
@@ -459,7 +418,11 @@ void calculateEstimatedAltitude(uint32_t currentTime)
 
 #ifdef SONAR
     tiltAngle = calculateTiltAngle(&inclination);
-    sonarAlt = sonarCalculateAltitude(sonarAlt, tiltAngle);
+    sonarAlt = sonarCalculateAltitude(sonarGetDistance(currentTime), tiltAngle);
+    if (sonarAlt > 0) {
+        // the reading is up to a ping interval old, move it on by the climb since
+        sonarAlt += lrintf(vel * sonarGetSampleAge(currentTime) * 1e-6f);
+    }
 #endif
 
     if (sonarAlt > 0 && sonarAlt < 200) {
@@ -513,12 +476,9 @@ void calculateEstimatedAltitude(uint32_t currentTime)
     // By using CF it's possible to correct the drift of integrated accZ (velocity) without loosing the phase, i.e without delay
     vel = vel * barometerConfig->baro_cf_vel + baroVel * (1.0f - barometerConfig->baro_cf_vel);
     vel_tmp = lrintf(vel);
+    EstVel = vel;
 
     // set vario
     vario = applyDeadband(vel_tmp, 5);
-
-    BaroPID = calculateBaroPid(vel_tmp, accZ_tmp, accZ_old);
-
-    accZ_old = accZ_tmp;
 }
 #endif /* BARO */
@@ -17,10 +17,6 @@
 
 #pragma once
 
-extern int32_t errorVelocityI;
-extern uint8_t velocityControl;
-extern int32_t setVelocity;
-extern int32_t BaroPID;
 extern int16_t throttleAngleCorrection;
 
 typedef struct imuRuntimeConfig_s {
@@ -31,9 +27,10 @@ typedef struct imuRuntimeConfig_s {
     int8_t small_angle;
 } imuRuntimeConfig_t;
 
-void configureImu(imuRuntimeConfig_t *initialImuRuntimeConfig, pidProfile_t *initialPidProfile, barometerConfig_t *intialBarometerConfig, accDeadband_t *initialAccDeadband);
+void configureImu(imuRuntimeConfig_t *initialImuRuntimeConfig, barometerConfig_t *intialBarometerConfig, accDeadband_t *initialAccDeadband);
 
 void calculateEstimatedAltitude(uint32_t currentTime);
+bool isThrustFacingDownwards(rollAndPitchInclination_t *inclination);
 void computeIMU(rollAndPitchTrims_t *accelerometerTrims, uint8_t mixerConfiguration);
 void calculateThrottleAngleScale(uint16_t throttle_correction_angle);
 int16_t calculateThrottleAngleCorrection(uint8_t throttle_correction_value);
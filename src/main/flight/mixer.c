@@ -18,6 +18,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "platform.h"
 
@@ -34,12 +35,19 @@
 #include "io/escservo.h"
 #include "io/rc_controls.h"
 
+#include "sensors/battery.h"
+
 #include "flight/mixer.h"
+#include "flight/mixer_stats.h"
+#include "flight/thrust_linear.h"
+#include "flight/servo_output.h"
 #include "flight/flight.h"
 
 #include "config/runtime_config.h"
 #include "config/config.h"
 
+extern uint16_t cycleTime; // FIXME dependency on mw.c
+
 #define AUX_FORWARD_CHANNEL_TO_SERVO_COUNT 4
 
 static uint8_t numberMotor = 0;
@@ -300,6 +308,7 @@ void mixerUsePWMOutputConfiguration(pwmOutputConfiguration_t *pwmOutputConfigura
     else
         f.FIXED_WING = 0;
 
+    mixerStatsInit(currentMixer, numberMotor);
     mixerResetMotors();
 }
 
@@ -328,10 +337,15 @@ void mixerLoadMix(int index, motorMixer_t *customMixers)
     }
 }
 
+static void writeServo(uint8_t index, int16_t value)
+{
+    pwmWriteServo(index, servoOutputFilter(index, value, cycleTime));
+}
+
 static void updateGimbalServos(void)
 {
-    pwmWriteServo(0, servo[0]);
-    pwmWriteServo(1, servo[1]);
+    writeServo(0, servo[0]);
+    writeServo(1, servo[1]);
 }
 
 void writeServos(void)
@@ -341,26 +355,28 @@ void writeServos(void)
 
     switch (currentMixerConfiguration) {
         case MULTITYPE_BI:
-            pwmWriteServo(0, servo[4]);
-            pwmWriteServo(1, servo[5]);
+            writeServo(0, servo[4]);
+            writeServo(1, servo[5]);
             break;
 
         case MULTITYPE_TRI:
             if (mixerConfig->tri_unarmed_servo) {
                 // if unarmed flag set, we always move servo
-                pwmWriteServo(0, servo[5]);
+                writeServo(0, servo[5]);
             } else {
                 // otherwise, only move servo when copter is armed
                 if (f.ARMED)
-                    pwmWriteServo(0, servo[5]);
-                else
+                    writeServo(0, servo[5]);
+                else {
+                    servoOutputReset(0);
                     pwmWriteServo(0, 0); // kill servo signal completely.
+                }
             }
             break;
 
         case MULTITYPE_FLYING_WING:
-            pwmWriteServo(0, servo[3]);
-            pwmWriteServo(1, servo[4]);
+            writeServo(0, servo[3]);
+            writeServo(1, servo[4]);
             break;
 
         case MULTITYPE_GIMBAL:
@@ -368,16 +384,16 @@ void writeServos(void)
             break;
 
         case MULTITYPE_DUALCOPTER:
-            pwmWriteServo(0, servo[4]);
-            pwmWriteServo(1, servo[5]);
+            writeServo(0, servo[4]);
+            writeServo(1, servo[5]);
             break;
 
         case MULTITYPE_AIRPLANE:
         case MULTITYPE_SINGLECOPTER:
-            pwmWriteServo(0, servo[3]);
-            pwmWriteServo(1, servo[4]);
-            pwmWriteServo(2, servo[5]);
-            pwmWriteServo(3, servo[6]);
+            writeServo(0, servo[3]);
+            writeServo(1, servo[4]);
+            writeServo(2, servo[5]);
+            writeServo(3, servo[6]);
             break;
 
         default:
@@ -456,6 +472,7 @@ static void airplaneMixer(void)
 void mixTable(void)
 {
     int16_t maxMotor;
+    int16_t requested[MAX_SUPPORTED_MOTORS];
     uint32_t i;
 
     if (numberMotor > 3) {
@@ -464,9 +481,13 @@ void mixTable(void)
     }
 
     // motors for non-servo mixes
-    if (numberMotor > 1)
+    if (numberMotor > 1) {
+        // thrust falls with the battery voltage, so the same correction needs more throttle on a sagging pack
+        float pidScale = mixerConfig->vbat_pid_compensation ? vbatPidCompensation : 1.0f;
+
         for (i = 0; i < numberMotor; i++)
-            motor[i] = rcCommand[THROTTLE] * currentMixer[i].throttle + axisPID[PITCH] * currentMixer[i].pitch + axisPID[ROLL] * currentMixer[i].roll + -mixerConfig->yaw_direction * axisPID[YAW] * currentMixer[i].yaw;
+            motor[i] = rcCommand[THROTTLE] * currentMixer[i].throttle + pidScale * (axisPID[PITCH] * currentMixer[i].pitch + axisPID[ROLL] * currentMixer[i].roll + -mixerConfig->yaw_direction * axisPID[YAW] * currentMixer[i].yaw);
+    }
 
     // airplane / servo mixes
     switch (currentMixerConfiguration) {
@@ -561,10 +582,12 @@ void mixTable(void)
             if (firstServo + servoOffset < 0) {
                 continue; // there are not enough servos to forward all the AUX channels.
             }
-            pwmWriteServo(firstServo + servoOffset, rcData[channelOffset++]);
+            writeServo(firstServo + servoOffset, rcData[channelOffset++]);
         }
     }
 
+    memcpy(requested, motor, sizeof(requested));
+
     maxMotor = motor[0];
     for (i = 1; i < numberMotor; i++)
         if (motor[i] > maxMotor)
@@ -591,6 +614,14 @@ void mixTable(void)
             motor[i] = motor_disarmed[i];
         }
     }
+
+    // 3D and idling at low throttle set the outputs by rule, so only normal flight says anything about headroom
+    if (f.ARMED && numberMotor > 1 && !feature(FEATURE_3D) && rcData[THROTTLE] >= rxConfig->mincheck) {
+        mixerStatsUpdate(requested, motor, escAndServoConfig->minthrottle, escAndServoConfig->maxthrottle);
+
+        // the mix above is in thrust, turn it into the motor command that gives that thrust
+        applyThrustLinearisation(motor, numberMotor, escAndServoConfig->minthrottle, escAndServoConfig->maxthrottle);
+    }
 }
 
 
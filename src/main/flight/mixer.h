@@ -66,6 +66,7 @@ typedef struct mixer_t {
 typedef struct mixerConfig_s {
     int8_t yaw_direction;
     uint8_t tri_unarmed_servo;              // send tail servo correction pulses even when unarmed
+    uint8_t vbat_pid_compensation;          // scale the PID output up as the battery voltage drops, needs FEATURE_VBAT
 } mixerConfig_t;
 
 typedef struct flight3DConfig_s {
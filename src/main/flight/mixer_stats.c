@@ -0,0 +1,150 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Motor output saturation and headroom statistics.
+//
+// mixTable hands over what the mix asked for and what the motors actually got.  The difference per
+// motor is projected back onto each axis' mixer column to find how much of the roll, pitch and yaw PID
+// output was lost to clipping.  A uniform shift of all motors, as done when one motor hits max_throttle,
+// costs no authority and projects to zero on any mixer whose axis columns sum to zero.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "common/maths.h"
+
+#include "flight/mixer.h"
+#include "flight/mixer_stats.h"
+
+#define COEFFICIENT_SHIFT 8
+
+static mixerStats_t mixerStats;
+static uint8_t motorCount;
+
+static int16_t axisCoefficient[MAX_SUPPORTED_MOTORS][MIXER_STATS_AXIS_COUNT];      // mixer column, scaled by 1 << COEFFICIENT_SHIFT
+static uint16_t axisProjectionScale[MIXER_STATS_AXIS_COUNT];                       // 1 / sum of the squared column, scaled by 1 << (16 - COEFFICIENT_SHIFT)
+
+void mixerStatsReset(void)
+{
+    memset(&mixerStats, 0, sizeof(mixerStats));
+}
+
+void mixerStatsInit(const motorMixer_t *mixer, uint8_t motorCountToUse)
+{
+    float sumOfSquares[MIXER_STATS_AXIS_COUNT] = { 0, 0, 0 };
+    uint8_t i;
+    uint8_t axis;
+
+    motorCount = motorCountToUse;
+
+    for (i = 0; i < motorCount; i++) {
+        float column[MIXER_STATS_AXIS_COUNT] = { mixer[i].roll, mixer[i].pitch, mixer[i].yaw };
+
+        for (axis = 0; axis < MIXER_STATS_AXIS_COUNT; axis++) {
+            axisCoefficient[i][axis] = lrintf(column[axis] * (1 << COEFFICIENT_SHIFT));
+            sumOfSquares[axis] += column[axis] * column[axis];
+        }
+    }
+
+    for (axis = 0; axis < MIXER_STATS_AXIS_COUNT; axis++) {
+        // an axis the mixer has no motor authority on (e.g. yaw on a bicopter) is never reported
+        axisProjectionScale[axis] = sumOfSquares[axis] > 0 ? lrintf((1 << (16 - COEFFICIENT_SHIFT)) / sumOfSquares[axis]) : 0;
+    }
+
+    mixerStatsReset();
+}
+
+static void addToHistogram(uint16_t *histogram, int16_t output, int16_t minThrottle, int16_t maxThrottle)
+{
+    uint8_t bin = 0;
+    uint8_t i;
+
+    if (output >= maxThrottle) {
+        bin = MIXER_STATS_HISTOGRAM_BINS - 1;
+    } else if (output > minThrottle) {
+        bin = (output - minThrottle) * MIXER_STATS_HISTOGRAM_BINS / (maxThrottle - minThrottle);
+    }
+
+    if (histogram[bin] == UINT16_MAX) {
+        // keep the shape of the histogram rather than the absolute counts
+        for (i = 0; i < MIXER_STATS_HISTOGRAM_BINS; i++) {
+            histogram[i] >>= 1;
+        }
+    }
+    histogram[bin]++;
+}
+
+void mixerStatsUpdate(const int16_t *requested, const int16_t *output, int16_t minThrottle, int16_t maxThrottle)
+{
+    int32_t clippedPerAxis[MIXER_STATS_AXIS_COUNT] = { 0, 0, 0 };
+    uint8_t i;
+    uint8_t axis;
+
+    if (maxThrottle <= minThrottle) {
+        return;
+    }
+
+    mixerStats.cycles++;
+
+    for (i = 0; i < motorCount; i++) {
+        int16_t clipped = output[i] - requested[i];
+
+        addToHistogram(mixerStats.histogram[i], output[i], minThrottle, maxThrottle);
+
+        if (requested[i] > maxThrottle) {
+            mixerStats.upperLimitCycles[i]++;
+        } else if (requested[i] < minThrottle) {
+            mixerStats.lowerLimitCycles[i]++;
+        }
+
+        if (clipped) {
+            for (axis = 0; axis < MIXER_STATS_AXIS_COUNT; axis++) {
+                clippedPerAxis[axis] += axisCoefficient[i][axis] * clipped;
+            }
+        }
+    }
+
+    for (axis = 0; axis < MIXER_STATS_AXIS_COUNT; axis++) {
+        uint32_t lost = ((uint32_t)abs(clippedPerAxis[axis]) * axisProjectionScale[axis]) >> 16;
+
+        if (lost) {
+            mixerStats.authorityLostCycles[axis]++;
+            mixerStats.authorityLostSum[axis] += lost;
+        }
+    }
+}
+
+uint8_t mixerStatsMotorCount(void)
+{
+    return motorCount;
+}
+
+const mixerStats_t *getMixerStats(void)
+{
+    return &mixerStats;
+}
+
+// Average PID output clipped away on the axis, over the cycles it was clipped at all.
+uint16_t mixerStatsAverageAuthorityLost(uint8_t axis)
+{
+    if (!mixerStats.authorityLostCycles[axis]) {
+        return 0;
+    }
+    return mixerStats.authorityLostSum[axis] / mixerStats.authorityLostCycles[axis];
+}
@@ -0,0 +1,38 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define MIXER_STATS_HISTOGRAM_BINS 8        // bins evenly spread between min_throttle and max_throttle
+#define MIXER_STATS_AXIS_COUNT 3            // roll, pitch, yaw
+
+typedef struct mixerStats_s {
+    uint32_t cycles;                                            // armed cycles with throttle above min_check
+    uint16_t histogram[MAX_SUPPORTED_MOTORS][MIXER_STATS_HISTOGRAM_BINS];   // relative, halved when a bin fills up
+    uint32_t upperLimitCycles[MAX_SUPPORTED_MOTORS];            // cycles the mix asked for more than max_throttle
+    uint32_t lowerLimitCycles[MAX_SUPPORTED_MOTORS];            // cycles the mix asked for less than min_throttle
+    uint32_t authorityLostCycles[MIXER_STATS_AXIS_COUNT];       // cycles some of the axis PID output was clipped away
+    uint32_t authorityLostSum[MIXER_STATS_AXIS_COUNT];          // clipped away axis PID output, summed over those cycles
+} mixerStats_t;
+
+void mixerStatsInit(const motorMixer_t *mixer, uint8_t motorCount);
+void mixerStatsReset(void);
+void mixerStatsUpdate(const int16_t *requested, const int16_t *output, int16_t minThrottle, int16_t maxThrottle);
+
+uint8_t mixerStatsMotorCount(void);
+const mixerStats_t *getMixerStats(void);
+uint16_t mixerStatsAverageAuthorityLost(uint8_t axis);
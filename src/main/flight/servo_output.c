@@ -0,0 +1,102 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Servo output conditioning.
+//
+// Each servo output can have a first order low-pass on its command followed by a slew rate limit, so an
+// analog servo is not driven by every bit of PID noise and a large step reaches it as a ramp it can follow.
+// Both run every control cycle on the measured cycle time.  An output with neither set is passed through.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "common/maths.h"
+
+#include "flight/mixer.h"
+#include "flight/servo_output.h"
+
+typedef struct servoOutputState_s {
+    float lowpassTimeConstant;              // us
+    float lowpass;                          // us
+    float output;                           // us
+    bool primed;
+} servoOutputState_t;
+
+static servoOutputConfig_t *servoOutputConfig;
+static servoOutputState_t servoOutputState[MAX_SUPPORTED_SERVOS];
+
+void servoOutputInit(servoOutputConfig_t *servoOutputConfigToUse)
+{
+    uint8_t i;
+
+    servoOutputConfig = servoOutputConfigToUse;
+
+    for (i = 0; i < MAX_SUPPORTED_SERVOS; i++) {
+        servoOutputState[i].lowpassTimeConstant = 0;
+        if (servoOutputConfig[i].lowpass_hz) {
+            servoOutputState[i].lowpassTimeConstant = 1000000.0f / (2.0f * M_PI * servoOutputConfig[i].lowpass_hz);
+        }
+        servoOutputReset(i);
+    }
+}
+
+// the next command is taken as it is, after the output was stopped for instance
+void servoOutputReset(uint8_t index)
+{
+    servoOutputState[index].primed = false;
+}
+
+int16_t servoOutputFilter(uint8_t index, int16_t value, uint32_t dT)
+{
+    servoOutputState_t *state;
+    servoOutputConfig_t *config;
+
+    if (!servoOutputConfig || index >= MAX_SUPPORTED_SERVOS) {
+        return value;
+    }
+
+    state = &servoOutputState[index];
+    config = &servoOutputConfig[index];
+    if (!config->lowpass_hz && !config->slew_rate) {
+        return value;
+    }
+
+    if (!state->primed) {
+        state->lowpass = value;
+        state->output = value;
+        state->primed = true;
+        return value;
+    }
+
+    if (config->lowpass_hz) {
+        // the bilinear form stays close to the continuous filter up to a cutoff of about a tenth of the loop rate
+        float gain = min(2.0f * dT / (2.0f * state->lowpassTimeConstant + dT), 1.0f);
+        state->lowpass += (value - state->lowpass) * gain;
+    } else {
+        state->lowpass = value;
+    }
+
+    if (config->slew_rate) {
+        float maxStep = config->slew_rate * dT / 1000.0f;
+        state->output += constrainf(state->lowpass - state->output, -maxStep, maxStep);
+    } else {
+        state->output = state->lowpass;
+    }
+
+    return lrintf(state->output);
+}
@@ -0,0 +1,29 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// one per servo output, in the order the outputs are written
+typedef struct servoOutputConfig_s {
+    uint16_t pwm_rate;                      // Hz, 0 uses servo_pwm_rate.  Servos on one timer run at the lowest rate of the group
+    uint16_t lowpass_hz;                    // cutoff of the first order low-pass on the servo command, 0 disables it
+    uint8_t slew_rate;                      // most the pulse may change, in us per ms, 0 disables the limit
+} servoOutputConfig_t;
+
+void servoOutputInit(servoOutputConfig_t *servoOutputConfigToUse);
+int16_t servoOutputFilter(uint8_t index, int16_t value, uint32_t dT);
+void servoOutputReset(uint8_t index);
@@ -0,0 +1,115 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Thrust linearisation.
+//
+// Prop thrust grows roughly with the square of the motor command, so a fixed PID correction has more
+// effect at high throttle than at low throttle.  The thrust curve is modelled as
+//
+//   thrust = (1 - k) * command + k * command^2         (both normalised to 0..1 between min and max throttle)
+//
+// with k = thrust_linear / 100.  The mixer output is treated as thrust and turned back into a motor
+// command through a table of the inverse curve, built once when the config is activated and linearly
+// interpolated at run time.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "flight/thrust_linear.h"
+
+#define TABLE_FRACTION_BITS 15              // table entries are normalised commands scaled by 1 << 15
+#define INTERPOLATION_BITS 8                // position between two table entries
+
+static uint16_t commandForThrust[THRUST_LINEAR_SEGMENTS + 1];
+static bool enabled = false;
+
+void thrustLinearInit(thrustLinearConfig_t *thrustLinearConfig)
+{
+    float k = thrustLinearConfig->thrust_linear / 100.0f;
+    uint8_t i;
+
+    enabled = thrustLinearConfig->thrust_linear > 0;
+    if (!enabled) {
+        return;
+    }
+
+    for (i = 0; i <= THRUST_LINEAR_SEGMENTS; i++) {
+        float thrust = (float)i / THRUST_LINEAR_SEGMENTS;
+        float command = ((k - 1.0f) + sqrtf((1.0f - k) * (1.0f - k) + 4.0f * k * thrust)) / (2.0f * k);
+
+        commandForThrust[i] = lrintf(command * (1 << TABLE_FRACTION_BITS));
+    }
+    // pin the ends so min and max throttle map onto themselves exactly
+    commandForThrust[0] = 0;
+    commandForThrust[THRUST_LINEAR_SEGMENTS] = 1 << TABLE_FRACTION_BITS;
+}
+
+bool isThrustLinearisationEnabled(void)
+{
+    return enabled;
+}
+
+// reciprocal is (THRUST_LINEAR_SEGMENTS << (INTERPOLATION_BITS + 16)) / range, so the division is done once per call
+static int16_t lookupCommand(int16_t thrust, int16_t minThrottle, uint16_t range, uint32_t reciprocal)
+{
+    uint32_t position;
+    uint8_t index;
+    int32_t fraction;
+    int32_t command;
+
+    if (thrust <= minThrottle || thrust >= minThrottle + range) {
+        return thrust;
+    }
+
+    position = ((uint32_t)(thrust - minThrottle) * reciprocal) >> 16;
+    index = position >> INTERPOLATION_BITS;
+    fraction = position & ((1 << INTERPOLATION_BITS) - 1);
+
+    command = commandForThrust[index] + (((commandForThrust[index + 1] - commandForThrust[index]) * fraction) >> INTERPOLATION_BITS);
+
+    return minThrottle + ((command * range + (1 << (TABLE_FRACTION_BITS - 1))) >> TABLE_FRACTION_BITS);
+}
+
+static uint32_t reciprocalForRange(uint16_t range)
+{
+    return ((uint32_t)THRUST_LINEAR_SEGMENTS << (INTERPOLATION_BITS + 16)) / range;
+}
+
+int16_t thrustToMotorCommand(int16_t thrust, int16_t minThrottle, int16_t maxThrottle)
+{
+    if (!enabled || maxThrottle <= minThrottle) {
+        return thrust;
+    }
+    return lookupCommand(thrust, minThrottle, maxThrottle - minThrottle, reciprocalForRange(maxThrottle - minThrottle));
+}
+
+void applyThrustLinearisation(int16_t *motors, uint8_t motorCount, int16_t minThrottle, int16_t maxThrottle)
+{
+    uint16_t range = maxThrottle - minThrottle;
+    uint32_t reciprocal;
+    uint8_t i;
+
+    if (!enabled || maxThrottle <= minThrottle) {
+        return;
+    }
+
+    reciprocal = reciprocalForRange(range);
+    for (i = 0; i < motorCount; i++) {
+        motors[i] = lookupCommand(motors[i], minThrottle, range, reciprocal);
+    }
+}
@@ -0,0 +1,29 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define THRUST_LINEAR_SEGMENTS 32           // power of two, the table has one more entry than this
+
+typedef struct thrustLinearConfig_s {
+    uint8_t thrust_linear;                  // percentage of the thrust curve that is quadratic in the motor command, 0 disables linearisation
+} thrustLinearConfig_t;
+
+void thrustLinearInit(thrustLinearConfig_t *thrustLinearConfig);
+bool isThrustLinearisationEnabled(void);
+int16_t thrustToMotorCommand(int16_t thrust, int16_t minThrottle, int16_t maxThrottle);
+void applyThrustLinearisation(int16_t *motors, uint8_t motorCount, int16_t minThrottle, int16_t maxThrottle);
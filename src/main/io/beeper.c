@@ -28,168 +28,228 @@
 
 #include "io/beeper.h"
 
-#define DOUBLE_PAUSE_DURATION_MILLIS (LONG_PAUSE_DURATION_MILLIS * 2)
-#define LONG_PAUSE_DURATION_MILLIS 200
-#define SHORT_PAUSE_DURATION_MILLIS (LONG_PAUSE_DURATION_MILLIS / 4)
-#define MEDIUM_PAUSE_DURATION_MILLIS (LONG_PAUSE_DURATION_MILLIS / 2)
+// Each event has a sequence of tone and gap lengths in milliseconds, a tone first, repeated while the event is
+// active.  The main loop posts events as warnings come and go, the systick interrupt plays the highest priority
+// active event's sequence a millisecond at a time, so tones keep their length however long a loop takes.  A
+// higher priority event cuts in at once and the sequence it pre-empted starts over when it ends.
+//
+// Code that beeps with BEEP_ON/BEEP_OFF and delay() pauses the interrupt around it, the active events start
+// over once it resumes.
+
+#define BEEP_SHORT 50
+#define BEEP_MEDIUM 100
+#define BEEP_LONG 200
+#define BEEP_GAP 200
+#define BEEP_DOUBLE_GAP 400
+
+static const uint16_t confirmationBeeps[] = { BEEP_SHORT, BEEP_GAP, 0 };
+static const uint16_t autotuneBeeps[] = { BEEP_SHORT, BEEP_GAP, BEEP_MEDIUM, BEEP_GAP, BEEP_SHORT, BEEP_GAP, 0 };
+static const uint16_t batteryLowBeeps[] = { BEEP_SHORT, BEEP_GAP, BEEP_MEDIUM, BEEP_GAP, BEEP_MEDIUM, BEEP_DOUBLE_GAP, 0 };
+static const uint16_t switchBeeps[] = { BEEP_SHORT, BEEP_GAP, BEEP_SHORT, BEEP_GAP, BEEP_SHORT, BEEP_GAP, 0 };
+static const uint16_t gpsNoFixBeeps[] = { BEEP_SHORT, BEEP_GAP, BEEP_SHORT, BEEP_GAP, 0 };
+static const uint16_t failsafeLandingBeeps[] = { BEEP_SHORT, BEEP_GAP, BEEP_MEDIUM, BEEP_GAP, BEEP_LONG, BEEP_GAP, 0 };
+static const uint16_t failsafeFindMeBeeps[] = { BEEP_LONG, BEEP_DOUBLE_GAP, 0 };
+
+static const uint16_t * const beeperSequences[BEEPER_EVENT_COUNT] = {
+    confirmationBeeps,
+    autotuneBeeps,
+    batteryLowBeeps,
+    switchBeeps,
+    gpsNoFixBeeps,
+    failsafeLandingBeeps,
+    failsafeFindMeBeeps
+};
+
+#define BEEPER_SILENT BEEPER_EVENT_COUNT
+
+// the events beepcodeUpdateState owns
+#define BEEPER_WARNING_EVENTS (((1 << BEEPER_EVENT_COUNT) - 1) & ~(1 << BEEPER_CONFIRMATION))
+
+// written by the main loop only
+static volatile uint8_t beeperEvents;                   // a bit per active event
+static volatile uint8_t queuedConfirmationBeeps;
+static volatile uint8_t confirmationRequests;           // counts queueConfirmationBeep calls
+static volatile bool paused;
+static volatile uint8_t pauseRequests;                  // counts beeperPause calls
+
+// the interrupt's own
+static uint8_t playedEvents;
+static uint8_t confirmationRequestsSeen;
+static uint8_t pauseRequestsSeen;
+static uint8_t confirmationBeepsLeft;
+static uint8_t playing;                         // a beeperEvent_e or BEEPER_SILENT
+static uint8_t step;
+static uint16_t ticksLeft;
+static bool toneOn;
+
+// the main loop's own
+static uint8_t lastWarningEvents;
 
-#define SHORT_CONFIRMATION_BEEP_DURATION_MILLIS (SHORT_PAUSE_DURATION_MILLIS / 2)
+static failsafe_t* failsafe;
+
+static void setTone(bool on)
+{
+    if (on != toneOn) {
+        toneOn = on;
+        systemBeep(on);
+    }
+}
+
+static void playEvent(uint8_t event)
+{
+    playing = event;
+    if (event == BEEPER_SILENT) {
+        setTone(false);
+        return;
+    }
+    step = 0;
+    ticksLeft = beeperSequences[event][0];
+    setTone(true);
+}
 
-static uint8_t beeperIsOn = 0, beepDone = 0;
-static uint32_t beeperLastToggleTime;
-static void beep(uint16_t pulseMillis);
-static void beep_code(char first, char second, char third, char pause);
+// from the systick interrupt, every millisecond
+static void beeperTick(void)
+{
+    uint8_t events;
 
-static uint8_t toggleBeep = 0;
+    if (paused) {
+        return;
+    }
+    if (pauseRequests != pauseRequestsSeen) {
+        // the paused code left the beeper off
+        pauseRequestsSeen = pauseRequests;
+        toneOn = false;
+        playing = BEEPER_SILENT;
+        playedEvents = 0;
+    }
 
-typedef enum {
-    FAILSAFE_IDLE = 0,
-    FAILSAFE_LANDING,
-    FAILSAFE_FIND_ME
-} failsafeBeeperWarnings_e;
+    events = beeperEvents;
 
-static failsafe_t* failsafe;
+    if (confirmationRequests != confirmationRequestsSeen) {
+        confirmationRequestsSeen = confirmationRequests;
+        confirmationBeepsLeft = queuedConfirmationBeeps;
+    }
+    if (confirmationBeepsLeft) {
+        events |= 1 << BEEPER_CONFIRMATION;
+    }
+
+    if (events != playedEvents) {
+        uint8_t highest = events ? 31 - __builtin_clz(events) : BEEPER_SILENT;
+
+        playedEvents = events;
+        if (highest != playing) {
+            playEvent(highest);
+            return;
+        }
+    }
+
+    if (playing == BEEPER_SILENT || --ticksLeft) {
+        return;
+    }
+
+    step++;
+    if (!beeperSequences[playing][step]) {
+        if (playing == BEEPER_CONFIRMATION && --confirmationBeepsLeft == 0) {
+            // the next tick picks what is left
+            playEvent(BEEPER_SILENT);
+            return;
+        }
+        step = 0;
+    }
+    ticksLeft = beeperSequences[playing][step];
+    setTone(!(step & 1));
+}
 
 void beepcodeInit(failsafe_t *initialFailsafe)
 {
     failsafe = initialFailsafe;
+
+    beeperEvents = 0;
+    lastWarningEvents = 0;
+    confirmationRequestsSeen = confirmationRequests;
+    pauseRequestsSeen = pauseRequests;
+    confirmationBeepsLeft = 0;
+    playedEvents = 0;
+    playing = BEEPER_SILENT;
+    toneOn = false;
+
+    setSysTickCallback(beeperTick);
 }
 
-void beepcodeUpdateState(bool warn_vbat)
+/*
+ * From the main loop only.
+ */
+void beeperPostEvent(beeperEvent_e event, bool active)
 {
-    static uint8_t beeperOnBox;
-#ifdef GPS
-    static uint8_t warn_noGPSfix = 0;
-#endif
-    static failsafeBeeperWarnings_e warn_failsafe = FAILSAFE_IDLE;
+    uint8_t events = beeperEvents;
 
-    //=====================  BeeperOn via rcOptions =====================
-    if (rcOptions[BOXBEEPERON]) {       // unconditional beeper on via AUXn switch
-        beeperOnBox = 1;
+    if (active) {
+        events |= 1 << event;
     } else {
-        beeperOnBox = 0;
+        events &= ~(1 << event);
     }
-    //===================== Beeps for failsafe =====================
-    if (feature(FEATURE_FAILSAFE)) {
-        if (failsafe->vTable->shouldForceLanding(f.ARMED)) {
-            warn_failsafe = FAILSAFE_LANDING;
+    beeperEvents = events;
+}
 
-            if (failsafe->vTable->shouldHaveCausedLandingByNow()) {
-                warn_failsafe = FAILSAFE_FIND_ME;
-            }
-        }
+void beepcodeUpdateState(bool warn_vbat)
+{
+    uint8_t warningEvents = 0;
 
-        if (failsafe->vTable->hasTimerElapsed() && !f.ARMED) {
-            warn_failsafe = FAILSAFE_FIND_ME;
+    if (feature(FEATURE_FAILSAFE)) {
+        if (failsafe->vTable->shouldHaveCausedLandingByNow() || (failsafe->vTable->hasTimerElapsed() && !f.ARMED)) {
+            warningEvents |= 1 << BEEPER_FAILSAFE_FIND_ME;
         }
-
-        if (failsafe->vTable->isIdle()) {
-            warn_failsafe = FAILSAFE_IDLE;      // turn off alarm if TX is okay
+        if (failsafe->vTable->shouldForceLanding(f.ARMED)) {
+            warningEvents |= 1 << BEEPER_FAILSAFE_LANDING;
         }
     }
 
 #ifdef GPS
-    //===================== GPS fix notification handling =====================
     if (sensors(SENSOR_GPS)) {
-        if ((rcOptions[BOXGPSHOME] || rcOptions[BOXGPSHOLD]) && !f.GPS_FIX) {     // if no fix and gps funtion is activated: do warning beeps
-            warn_noGPSfix = 1;
-        } else {
-            warn_noGPSfix = 0;
+        // if no fix and gps funtion is activated: do warning beeps
+        if ((rcOptions[BOXGPSHOME] || rcOptions[BOXGPSHOLD]) && !f.GPS_FIX) {
+            warningEvents |= 1 << BEEPER_GPS_NO_FIX;
         }
     }
 #endif
 
-    //===================== Priority driven Handling =====================
-    // beepcode(length1,length2,length3,pause)
-    // D: Double, L: Long, M: Middle, S: Short, N: None
-    if (warn_failsafe == 2)
-        beep_code('L','N','N','D');                 // failsafe "find me" signal
-    else if (warn_failsafe == 1)
-        beep_code('S','M','L','M');                 // failsafe landing active
-#ifdef GPS
-    else if (warn_noGPSfix == 1)
-        beep_code('S','S','N','M');
-#endif
-    else if (beeperOnBox == 1)
-        beep_code('S','S','S','M');                 // beeperon
-    else if (warn_vbat)
-        beep_code('S','M','M','D');
-    else if (f.AUTOTUNE_MODE)
-        beep_code('S','M','S','M');
-    else if (toggleBeep > 0)
-        beep(50);                                   // fast confirmation beep
-    else {
-        beeperIsOn = 0;
-        BEEP_OFF;
+    if (rcOptions[BOXBEEPERON]) {       // unconditional beeper on via AUXn switch
+        warningEvents |= 1 << BEEPER_SWITCH;
     }
-}
+    if (warn_vbat) {
+        warningEvents |= 1 << BEEPER_BATTERY_LOW;
+    }
+    if (f.AUTOTUNE_MODE) {
+        warningEvents |= 1 << BEEPER_AUTOTUNE;
+    }
+
+    if (warningEvents == lastWarningEvents) {
+        return;
+    }
+    lastWarningEvents = warningEvents;
 
-// duration is specified in multiples of SHORT_CONFIRMATION_BEEP_DURATION_MILLIS
-void queueConfirmationBeep(uint8_t duration) {
-    toggleBeep = duration;
+    beeperEvents = (beeperEvents & ~BEEPER_WARNING_EVENTS) | warningEvents;
 }
 
-void beep_code(char first, char second, char third, char pause)
+// duration is the number of short confirmation beeps
+void queueConfirmationBeep(uint8_t duration)
 {
-    char patternChar[4];
-    uint16_t Duration;
-    static uint8_t icnt = 0;
-
-    patternChar[0] = first;
-    patternChar[1] = second;
-    patternChar[2] = third;
-    patternChar[3] = pause;
-    switch (patternChar[icnt]) {
-        case 'N':
-            Duration = 0;
-            break;
-        case 'S':
-            Duration = LONG_PAUSE_DURATION_MILLIS / 4;
-            break;
-        case 'M':
-            Duration = LONG_PAUSE_DURATION_MILLIS / 2;
-            break;
-        case 'D':
-            Duration = LONG_PAUSE_DURATION_MILLIS * 2;
-            break;
-        case 'L':
-        default:
-            Duration = LONG_PAUSE_DURATION_MILLIS;
-            break;
-    }
-
-    if (icnt < 3 && Duration != 0)
-        beep(Duration);
-    if (icnt >= 3 && (beeperLastToggleTime < millis() - Duration)) {
-        icnt = 0;
-        toggleBeep = 0;
-    }
-    if (beepDone == 1 || Duration == 0) {
-        if (icnt < 3)
-            icnt++;
-        beepDone = 0;
-        beeperIsOn = 0;
-        BEEP_OFF;
-    }
+    queuedConfirmationBeeps = duration;
+    confirmationRequests++;
 }
 
-static void beep(uint16_t pulseMillis)
+/*
+ * Stops the interrupt driving the beeper until beeperResume, for code that beeps with BEEP_ON/BEEP_OFF.
+ */
+void beeperPause(void)
 {
-    if (beeperIsOn) {
-        if (millis() >= beeperLastToggleTime + pulseMillis) {
-            beeperIsOn = 0;
-            BEEP_OFF;
-            beeperLastToggleTime = millis();
-            if (toggleBeep >0)
-                toggleBeep--;
-            beepDone = 1;
-        }
-        return;
-    }
+    pauseRequests++;
+    paused = true;
+    // the interrupt no longer touches the beeper
+    systemBeep(false);
+}
 
-    if (millis() >= (beeperLastToggleTime + LONG_PAUSE_DURATION_MILLIS)) {         // Beeper is off and long pause time is up -> turn it on
-        beeperIsOn = 1;
-        BEEP_ON;
-        beeperLastToggleTime = millis();      // save the time the buzer turned on
-    }
+void beeperResume(void)
+{
+    paused = false;
 }
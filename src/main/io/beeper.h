@@ -17,5 +17,22 @@
 
 #pragma once
 
+// in order of priority, the highest last
+typedef enum {
+    BEEPER_CONFIRMATION = 0,
+    BEEPER_AUTOTUNE,
+    BEEPER_BATTERY_LOW,
+    BEEPER_SWITCH,                          // the BEEPER box, to find the aircraft
+    BEEPER_GPS_NO_FIX,
+    BEEPER_FAILSAFE_LANDING,
+    BEEPER_FAILSAFE_FIND_ME,
+    BEEPER_EVENT_COUNT
+} beeperEvent_e;
+
 void beepcodeUpdateState(bool warn_vbat);
 void queueConfirmationBeep(uint8_t duration);
+
+void beeperPostEvent(beeperEvent_e event, bool active);
+
+void beeperPause(void);
+void beeperResume(void);
@@ -0,0 +1,510 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "common/maths.h"
+
+#include "drivers/flash_m25p16.h"
+
+#include "flash_log.h"
+
+// the erased check reads a page in chunks of this size, so it needs no page buffer of its own
+#define FLASH_LOG_CHECK_CHUNK_SIZE 32
+
+typedef struct flashLogBuffer_s {
+    uint32_t address;                       // of data[0] on the flash
+    uint16_t length;
+    bool queued;                            // full or flushed, waiting to be programmed
+    uint8_t data[M25P16_PAGE_SIZE];
+} flashLogBuffer_t;
+
+static const flashGeometry_t *geometry;
+static uint16_t sectorCount;
+
+static bool ready;
+static bool scanned;
+static bool erasing;
+static bool full;
+
+static uint8_t erasedSectors[FLASH_LOG_MAX_SECTORS / 8];
+
+static uint16_t startSector;
+static uint16_t logSectorCount;             // sectors with a header, the last one is the one being written
+static uint16_t headSequence;               // in the header of the last of them
+static uint32_t writeAddress;               // where the next byte written goes
+static uint32_t usedSize;                   // log bytes handed to the flash
+static uint32_t droppedBytes;
+static uint16_t eraseSector;
+
+// Every page of a sector is read back before the sector is taken for erased.  The check starts at the sector
+// the log needs next, which is read in full by the scan, and then goes round the chip one page per update.
+static uint16_t checkSector;
+static uint16_t checkedSectors;
+static uint16_t checkPage;
+
+static flashLogBuffer_t buffers[2];
+static uint8_t fillIndex;
+static uint8_t programIndex;
+
+static bool isSectorErased(uint16_t sector)
+{
+    return erasedSectors[sector / 8] & (1 << (sector % 8));
+}
+
+static void setSectorErased(uint16_t sector, bool erased)
+{
+    if (erased) {
+        erasedSectors[sector / 8] |= 1 << (sector % 8);
+    } else {
+        erasedSectors[sector / 8] &= ~(1 << (sector % 8));
+    }
+}
+
+static uint32_t sectorDataSize(void)
+{
+    return geometry->sectorSize - FLASH_LOG_SECTOR_HEADER_SIZE;
+}
+
+static bool isErased(const uint8_t *data, uint16_t length)
+{
+    while (length--) {
+        if (*data++ != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool readSectorHeader(uint16_t sector, uint16_t *sequence)
+{
+    uint8_t header[FLASH_LOG_SECTOR_HEADER_SIZE];
+
+    m25p16ReadBytes(sector * geometry->sectorSize, header, sizeof(header));
+    if ((header[0] | (header[1] << 8)) != FLASH_LOG_SECTOR_MAGIC) {
+        return false;
+    }
+    *sequence = header[2] | (header[3] << 8);
+    return true;
+}
+
+// the checked sectors are the ones just before checkSector
+static bool isSectorChecked(uint16_t sector)
+{
+    return (checkSector + sectorCount - 1 - sector) % sectorCount < checkedSectors;
+}
+
+static void nextSectorToCheck(void)
+{
+    checkSector = (checkSector + 1) % sectorCount;
+    checkedSectors++;
+    checkPage = 0;
+}
+
+static void checkNextPage(void)
+{
+    uint8_t chunk[FLASH_LOG_CHECK_CHUNK_SIZE];
+    uint32_t address = checkSector * geometry->sectorSize + checkPage * geometry->pageSize;
+    uint16_t offset;
+
+    for (offset = 0; offset < geometry->pageSize; offset += sizeof(chunk)) {
+        if (!m25p16ReadBytes(address + offset, chunk, sizeof(chunk))) {
+            return;
+        }
+        if (!isErased(chunk, sizeof(chunk))) {
+            nextSectorToCheck();
+            return;
+        }
+    }
+
+    if (++checkPage == geometry->pagesPerSector) {
+        setSectorErased(checkSector, true);
+        nextSectorToCheck();
+    }
+}
+
+// The log fills a sector page by page, so the written pages come before the erased ones.  A page of data
+// that is all 0xFF, and 0xFF bytes at the very end of the log, are taken for erased flash.
+static uint32_t findEndOfLogInSector(uint16_t sector)
+{
+    uint8_t *page = buffers[0].data;
+    uint32_t base = sector * geometry->sectorSize;
+    uint16_t firstErasedPage = 1;           // page 0 holds the header
+    uint16_t lastPage = geometry->pagesPerSector;
+    uint16_t length;
+
+    while (firstErasedPage < lastPage) {
+        uint16_t middle = (firstErasedPage + lastPage) / 2;
+        m25p16ReadBytes(base + middle * geometry->pageSize, page, geometry->pageSize);
+        if (isErased(page, geometry->pageSize)) {
+            lastPage = middle;
+        } else {
+            firstErasedPage = middle + 1;
+        }
+    }
+
+    m25p16ReadBytes(base + (firstErasedPage - 1) * geometry->pageSize, page, geometry->pageSize);
+    length = geometry->pageSize;
+    while (length > 0 && page[length - 1] == 0xFF) {
+        length--;
+    }
+    if (firstErasedPage == 1 && length < FLASH_LOG_SECTOR_HEADER_SIZE) {
+        length = FLASH_LOG_SECTOR_HEADER_SIZE;
+    }
+
+    return base + (firstErasedPage - 1) * geometry->pageSize + length;
+}
+
+static void findLog(void)
+{
+    uint16_t sector, sequence, previousSequence;
+    uint16_t headSector;
+
+    memset(erasedSectors, 0, sizeof(erasedSectors));
+    startSector = 0;
+    logSectorCount = 0;
+    headSequence = 0xFFFF;
+    usedSize = 0;
+    full = false;
+    checkSector = 0;
+    checkedSectors = 0;
+    checkPage = 0;
+
+    // the log starts at the sector with a header whose predecessor does not continue its sequence
+    for (sector = 0; sector < sectorCount; sector++) {
+        if (!readSectorHeader(sector, &sequence)) {
+            continue;
+        }
+        uint16_t previous = (sector + sectorCount - 1) % sectorCount;
+        if (!readSectorHeader(previous, &previousSequence) || previousSequence != (uint16_t)(sequence - 1)) {
+            startSector = sector;
+            logSectorCount = 1;
+            headSequence = sequence;
+            break;
+        }
+    }
+
+    writeAddress = startSector * geometry->sectorSize;
+    scanned = true;
+    if (!logSectorCount) {
+        return;
+    }
+
+    headSector = startSector;
+    while (logSectorCount < sectorCount) {
+        sector = (headSector + 1) % sectorCount;
+        if (!readSectorHeader(sector, &sequence) || sequence != (uint16_t)(headSequence + 1)) {
+            break;
+        }
+        headSector = sector;
+        headSequence = sequence;
+        logSectorCount++;
+    }
+
+    writeAddress = findEndOfLogInSector(headSector);
+    usedSize = (logSectorCount - 1) * sectorDataSize() + writeAddress - headSector * geometry->sectorSize - FLASH_LOG_SECTOR_HEADER_SIZE;
+    if (writeAddress == geometry->totalSize) {
+        writeAddress = 0;
+    }
+    checkSector = (headSector + 1) % sectorCount;
+}
+
+static void scanLog(void)
+{
+    findLog();
+
+    // the sector the log needs first is checked at once, so logging can start straight away
+    while (!checkedSectors) {
+        checkNextPage();
+    }
+}
+
+bool flashLogInit(void)
+{
+    ready = m25p16Init();
+    if (!ready) {
+        return false;
+    }
+
+    geometry = m25p16GetGeometry();
+    sectorCount = min(geometry->sectors, FLASH_LOG_MAX_SECTORS);
+
+    scanned = false;
+    erasing = false;
+    droppedBytes = 0;
+    memset(buffers, 0, sizeof(buffers));
+    fillIndex = programIndex = 0;
+
+    // a chip still busy after a reset is scanned from flashLogUpdate
+    if (m25p16IsReady()) {
+        scanLog();
+    }
+
+    return true;
+}
+
+static bool startBuffer(flashLogBuffer_t *buffer)
+{
+    buffer->address = writeAddress;
+    buffer->length = 0;
+
+    if (writeAddress % geometry->sectorSize) {
+        return true;
+    }
+
+    uint16_t sector = writeAddress / geometry->sectorSize;
+    if (logSectorCount == sectorCount || !isSectorErased(sector)) {
+        // a sector not checked yet may still turn out erased
+        full = logSectorCount == sectorCount || isSectorChecked(sector);
+        return false;
+    }
+
+    setSectorErased(sector, false);
+    logSectorCount++;
+    headSequence++;
+
+    buffer->data[0] = FLASH_LOG_SECTOR_MAGIC & 0xFF;
+    buffer->data[1] = FLASH_LOG_SECTOR_MAGIC >> 8;
+    buffer->data[2] = headSequence & 0xFF;
+    buffer->data[3] = headSequence >> 8;
+    buffer->length = FLASH_LOG_SECTOR_HEADER_SIZE;
+    writeAddress += FLASH_LOG_SECTOR_HEADER_SIZE;
+
+    return true;
+}
+
+static void queueBuffer(flashLogBuffer_t *buffer)
+{
+    buffer->queued = true;
+    fillIndex ^= 1;
+}
+
+void flashLogWrite(const uint8_t *data, uint16_t length)
+{
+    if (!ready || !scanned || erasing) {
+        droppedBytes += length;
+        return;
+    }
+
+    while (length) {
+        flashLogBuffer_t *buffer = &buffers[fillIndex];
+
+        if (buffer->queued || (!buffer->length && !startBuffer(buffer))) {
+            droppedBytes += length;
+            return;
+        }
+
+        uint32_t pageEnd = (buffer->address | (geometry->pageSize - 1)) + 1;
+        uint16_t count = min(length, pageEnd - writeAddress);
+
+        memcpy(buffer->data + buffer->length, data, count);
+        buffer->length += count;
+        writeAddress += count;
+        data += count;
+        length -= count;
+
+        if (writeAddress == pageEnd) {
+            if (writeAddress == geometry->totalSize) {
+                writeAddress = 0;
+            }
+            queueBuffer(buffer);
+        }
+    }
+}
+
+void flashLogFlush(void)
+{
+    flashLogBuffer_t *buffer = &buffers[fillIndex];
+
+    if (buffer->length && !buffer->queued) {
+        queueBuffer(buffer);
+    }
+}
+
+static void finishErase(void)
+{
+    erasing = false;
+    full = false;
+
+    if (logSectorCount) {
+        startSector = (startSector + logSectorCount) % sectorCount;
+    }
+    logSectorCount = 0;
+    usedSize = 0;
+    writeAddress = startSector * geometry->sectorSize;
+
+    // the header of the empty log keeps the start moving round the chip across reboots
+    if (startBuffer(&buffers[fillIndex])) {
+        queueBuffer(&buffers[fillIndex]);
+    }
+}
+
+static void continueErase(void)
+{
+    uint16_t sector;
+    bool anyErased = false;
+
+    if (!m25p16IsReady()) {
+        return;
+    }
+
+    // only the sectors found not erased are erased
+    if (checkedSectors < sectorCount) {
+        checkNextPage();
+        return;
+    }
+
+    while (eraseSector < sectorCount && isSectorErased(eraseSector)) {
+        eraseSector++;
+    }
+    if (eraseSector == sectorCount) {
+        finishErase();
+        return;
+    }
+
+    for (sector = 0; sector < sectorCount; sector++) {
+        anyErased |= isSectorErased(sector);
+    }
+    if (!anyErased && sectorCount == geometry->sectors) {
+        m25p16EraseCompletely();
+        memset(erasedSectors, 0xFF, sizeof(erasedSectors));
+        eraseSector = sectorCount;
+        return;
+    }
+
+    m25p16EraseSector(eraseSector * geometry->sectorSize);
+    setSectorErased(eraseSector, true);
+    eraseSector++;
+}
+
+void flashLogUpdate(void)
+{
+    if (!ready) {
+        return;
+    }
+
+    if (!scanned) {
+        if (m25p16IsReady()) {
+            scanLog();
+        }
+        return;
+    }
+
+    if (erasing) {
+        continueErase();
+        return;
+    }
+
+    flashLogBuffer_t *buffer = &buffers[programIndex];
+    if (!buffer->queued) {
+        if (checkedSectors < sectorCount && m25p16IsReady()) {
+            checkNextPage();
+        }
+        return;
+    }
+    if (!m25p16PageProgram(buffer->address, buffer->data, buffer->length)) {
+        return;
+    }
+
+    usedSize += buffer->length;
+    if (buffer->address % geometry->sectorSize == 0) {
+        usedSize -= FLASH_LOG_SECTOR_HEADER_SIZE;
+    }
+    buffer->queued = false;
+    buffer->length = 0;
+    programIndex ^= 1;
+}
+
+uint16_t flashLogRead(uint32_t offset, uint8_t *buffer, uint16_t length)
+{
+    uint16_t done = 0;
+
+    if (!ready || !scanned || erasing || offset >= usedSize) {
+        return 0;
+    }
+    length = min(length, usedSize - offset);
+
+    while (done < length) {
+        uint32_t logSector = offset / sectorDataSize();
+        uint32_t offsetInSector = offset % sectorDataSize();
+        uint32_t address = ((startSector + logSector) % sectorCount) * geometry->sectorSize + FLASH_LOG_SECTOR_HEADER_SIZE + offsetInSector;
+        uint16_t count = min((uint32_t)(length - done), sectorDataSize() - offsetInSector);
+
+        if (!m25p16ReadBytes(address, buffer + done, count)) {
+            break;
+        }
+        done += count;
+        offset += count;
+    }
+
+    return done;
+}
+
+void flashLogEraseAll(void)
+{
+    if (!ready || !scanned) {
+        return;
+    }
+
+    erasing = true;
+    eraseSector = 0;
+    memset(buffers, 0, sizeof(buffers));
+    fillIndex = programIndex = 0;
+}
+
+uint8_t flashLogGetState(void)
+{
+    uint8_t state = 0;
+
+    if (ready && scanned) {
+        state |= FLASH_LOG_STATE_READY;
+    }
+    if (erasing) {
+        state |= FLASH_LOG_STATE_ERASING;
+    }
+    if (scanned && checkedSectors < sectorCount) {
+        state |= FLASH_LOG_STATE_CHECKING;
+    }
+    if (full) {
+        state |= FLASH_LOG_STATE_FULL;
+    }
+    return state;
+}
+
+uint16_t flashLogSectorCount(void)
+{
+    return ready ? sectorCount : 0;
+}
+
+uint32_t flashLogTotalSize(void)
+{
+    return ready ? sectorCount * sectorDataSize() : 0;
+}
+
+uint32_t flashLogUsedSize(void)
+{
+    return usedSize;
+}
+
+uint32_t flashLogDroppedBytes(void)
+{
+    return droppedBytes;
+}
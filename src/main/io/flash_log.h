@@ -0,0 +1,58 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Append-only log on the SPI dataflash.  Each sector starts with a header holding a sequence number, so the
+// log can begin at any sector and wrap around the end of the chip; after an erase the next log starts in
+// the sector following the previous one, which spreads the erase cycles over the chip.
+
+#define FLASH_LOG_MAX_SECTORS 128
+#define FLASH_LOG_SECTOR_HEADER_SIZE 4
+#define FLASH_LOG_SECTOR_MAGIC 0x4C46      // "FL"
+
+typedef enum {
+    FLASH_LOG_STATE_READY    = 1 << 0,      // a supported chip was found
+    FLASH_LOG_STATE_ERASING  = 1 << 1,
+    FLASH_LOG_STATE_FULL     = 1 << 2,      // the next sector is not erased, writes are dropped
+    FLASH_LOG_STATE_CHECKING = 1 << 3,      // sectors without a header are still being read back
+} flashLogState_e;
+
+bool flashLogInit(void);
+
+// Copies the data into a page buffer and never waits for the flash; bytes that do not fit while both page
+// buffers are waiting to be programmed, or that need a sector not yet checked for erased, are dropped and
+// counted.
+void flashLogWrite(const uint8_t *data, uint16_t length);
+// queues the partly filled page, the rest of the page is filled by later writes
+void flashLogFlush(void);
+// programs a queued page, erases the next sector or checks a page for erased when the flash is ready, call
+// from the main loop
+void flashLogUpdate(void);
+
+// reads from the log by offset from its start, returns the bytes read, 0 while the flash is busy
+uint16_t flashLogRead(uint32_t offset, uint8_t *buffer, uint16_t length);
+
+// finishes the erased check, erases the sectors that are not erased, one per update, and then starts an empty
+// log
+void flashLogEraseAll(void);
+
+uint8_t flashLogGetState(void);
+uint16_t flashLogSectorCount(void);
+uint32_t flashLogTotalSize(void);
+uint32_t flashLogUsedSize(void);
+uint32_t flashLogDroppedBytes(void);
@@ -0,0 +1,104 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#include "common/axis.h"
+
+#include "flight/flight.h"
+#include "flight/mixer.h"
+
+#include "rx/rx.h"
+
+#include "io/rc_controls.h"
+#include "io/flash_log.h"
+
+#include "config/runtime_config.h"
+
+#include "flight_log.h"
+
+static flightLogConfig_t *flightLogConfig;
+
+static uint8_t loopsSinceRecord;
+static bool logging;
+
+void useFlightLogConfig(flightLogConfig_t *flightLogConfigToUse)
+{
+    flightLogConfig = flightLogConfigToUse;
+}
+
+static uint8_t *put16(uint8_t *dst, int16_t value)
+{
+    *dst++ = value & 0xFF;
+    *dst++ = (value >> 8) & 0xFF;
+    return dst;
+}
+
+static void writeRecord(uint32_t currentTime)
+{
+    uint8_t record[FLIGHT_LOG_RECORD_SIZE];
+    uint8_t *dst = record;
+    uint8_t i;
+
+    *dst++ = FLIGHT_LOG_RECORD_MARKER;
+    *dst++ = FLIGHT_LOG_RECORD_SIZE;
+    dst = put16(dst, currentTime & 0xFFFF);
+    dst = put16(dst, currentTime >> 16);
+
+    for (i = 0; i < 4; i++) {
+        dst = put16(dst, rcCommand[i]);
+    }
+    for (i = 0; i < XYZ_AXIS_COUNT; i++) {
+        dst = put16(dst, gyroADC[i]);
+    }
+    for (i = 0; i < XYZ_AXIS_COUNT; i++) {
+        dst = put16(dst, axisPID[i]);
+    }
+    for (i = 0; i < FLIGHT_LOG_MOTOR_COUNT; i++) {
+        dst = put16(dst, motor[i]);
+    }
+
+    flashLogWrite(record, FLIGHT_LOG_RECORD_SIZE);
+}
+
+void flightLogUpdate(uint32_t currentTime)
+{
+    if (!flightLogConfig->flight_log_rate || !(flashLogGetState() & FLASH_LOG_STATE_READY)) {
+        return;
+    }
+
+    if (!f.ARMED) {
+        if (logging) {
+            // the last records of the flight should not wait in the page buffer for the next one
+            flashLogFlush();
+            logging = false;
+        }
+        return;
+    }
+
+    // the first loop after arming is always logged
+    if (logging && ++loopsSinceRecord < flightLogConfig->flight_log_rate) {
+        return;
+    }
+
+    loopsSinceRecord = 0;
+    logging = true;
+    writeRecord(currentTime);
+}
@@ -0,0 +1,40 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Loop records for the flash log.  While armed every flight_log_rate-th control loop appends one record of
+// FLIGHT_LOG_RECORD_SIZE bytes, little endian:
+//
+//   marker (1)  FLIGHT_LOG_RECORD_MARKER
+//   size (1)    of the whole record, so a reader can skip records of a later, longer layout
+//   time (4)    micros() at the end of the loop
+//   rcCommand (4 x 2), gyroADC (3 x 2), axisPID (3 x 2), motor (FLIGHT_LOG_MOTOR_COUNT x 2)
+//
+// The partly filled page is flushed when the craft disarms.
+
+#define FLIGHT_LOG_RECORD_MARKER 0xA5
+#define FLIGHT_LOG_MOTOR_COUNT 8
+#define FLIGHT_LOG_RECORD_SIZE (1 + 1 + 4 + (4 + XYZ_AXIS_COUNT + XYZ_AXIS_COUNT + FLIGHT_LOG_MOTOR_COUNT) * 2)
+
+typedef struct flightLogConfig_s {
+    uint8_t flight_log_rate;                // log every nth control loop while armed, 0 to log nothing
+} flightLogConfig_t;
+
+void useFlightLogConfig(flightLogConfig_t *flightLogConfigToUse);
+// call once per control loop, after the motors are written
+void flightLogUpdate(uint32_t currentTime);
@@ -24,6 +24,8 @@
 
 #include "platform.h"
 
+#include "build_config.h"
+
 #include "common/maths.h"
 
 #include "drivers/system.h"
@@ -31,6 +33,7 @@
 #include "drivers/serial.h"
 #include "drivers/serial_uart.h"
 #include "io/serial.h"
+#include "io/serial_passthrough.h"
 
 #include "drivers/gpio.h"
 #include "drivers/light_led.h"
@@ -82,6 +85,10 @@ static gpsConfig_t *gpsConfig;
 static serialConfig_t *serialConfig;
 static serialPort_t *gpsPort;
 
+static bool gpsPassthroughActive;
+static serialPort_t *gpsPassthroughPort;
+static uint32_t gpsPassthroughPreviousBaudRate;
+
 typedef struct gpsInitData_t {
     uint8_t index;
     uint32_t baudrate;
@@ -294,6 +301,11 @@ void gpsInitHardware(void)
 
 void gpsThread(void)
 {
+    // the passthrough has the GPS bytes
+    if (gpsPassthroughActive) {
+        return;
+    }
+
     // read out available GPS bytes
     if (gpsPort) {
         while (serialTotalBytesWaiting(gpsPort))
@@ -560,7 +572,7 @@ static bool gpsNewFrameNMEA(char c)
         checksum_param = 0;
         break;
     default:
-        if (offset < 15)
+        if (offset < sizeof(string) - 1)     // leave room for the terminator
             string[offset++] = c;
         if (!checksum_param)
             parity ^= c;
@@ -836,13 +848,29 @@ static bool gpsNewFrameUBLOX(uint8_t data)
     return parsed;
 }
 
-gpsEnablePassthroughResult_e gpsEnablePassthrough(void)
+static void gpsPassthroughEnded(serialPassthroughEnd_e reason)
+{
+    UNUSED(reason);
+
+    waitForSerialPortToFinishTransmitting(gpsPassthroughPort);
+    serialSetBaudRate(gpsPassthroughPort, gpsPassthroughPreviousBaudRate);
+
+    // nothing was parsed during the passthrough, don't count it as lost communication
+    gpsData.lastMessage = millis();
+    gpsPassthroughActive = false;
+}
+
+gpsEnablePassthroughResult_e gpsEnablePassthrough(uint32_t idleTimeoutMs)
 {
     if (gpsData.state != GPS_RECEIVING_DATA)
         return GPS_PASSTHROUGH_NO_GPS;
 
-    serialPort_t *gpsPassthroughPort = findOpenSerialPort(FUNCTION_GPS_PASSTHROUGH);
+    if (isSerialPassthroughActive())
+        return GPS_PASSTHROUGH_IN_USE;
+
+    gpsPassthroughPort = findOpenSerialPort(FUNCTION_GPS_PASSTHROUGH);
     if (gpsPassthroughPort) {
+        gpsPassthroughPreviousBaudRate = serialGetBaudRate(gpsPassthroughPort);
 
         waitForSerialPortToFinishTransmitting(gpsPassthroughPort);
         serialSetBaudRate(gpsPassthroughPort, serialConfig->gps_passthrough_baudrate);
@@ -851,23 +879,10 @@ gpsEnablePassthroughResult_e gpsEnablePassthrough(void)
         if (!gpsPassthroughPort) {
             return GPS_PASSTHROUGH_NO_SERIAL_PORT;
         }
+        gpsPassthroughPreviousBaudRate = serialGetBaudRate(gpsPassthroughPort);
     }
 
-    LED0_OFF;
-    LED1_OFF;
-
-    while(1) {
-        if (serialTotalBytesWaiting(gpsPort)) {
-            LED0_ON;
-            serialWrite(gpsPassthroughPort, serialRead(gpsPort));
-            LED0_OFF;
-        }
-        if (serialTotalBytesWaiting(gpsPassthroughPort)) {
-            LED1_ON;
-            serialWrite(gpsPort, serialRead(gpsPassthroughPort));
-            LED1_OFF;
-        }
-    }
+    gpsPassthroughActive = serialPassthroughStart(gpsPassthroughPort, gpsPort, idleTimeoutMs, gpsPassthroughEnded);
     return GPS_PASSTHROUGH_ENABLED;
 }
 
@@ -55,7 +55,8 @@ typedef struct gpsConfig_s {
 typedef enum {
     GPS_PASSTHROUGH_ENABLED = 1,
     GPS_PASSTHROUGH_NO_GPS,
-    GPS_PASSTHROUGH_NO_SERIAL_PORT
+    GPS_PASSTHROUGH_NO_SERIAL_PORT,
+    GPS_PASSTHROUGH_IN_USE
 } gpsEnablePassthroughResult_e;
 
 typedef struct gpsCoordinateDDDMMmmmm_s {
@@ -102,5 +103,7 @@ extern uint8_t GPS_svinfo_cno[16];         // Carrier to Noise Ratio (Signal Str
 
 void gpsThread(void);
 bool gpsNewFrame(uint8_t c);
-gpsEnablePassthroughResult_e gpsEnablePassthrough(void);
+// returns once the passthrough is running, it ends after idleTimeoutMs without data from the host (0 for
+// never) or on the escape sequence, see serial_passthrough.h
+gpsEnablePassthroughResult_e gpsEnablePassthrough(uint32_t idleTimeoutMs);
 void updateGpsIndicator(uint32_t currentTime);
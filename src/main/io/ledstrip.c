@@ -32,6 +32,7 @@
 #include "config/runtime_config.h"
 #include "config/config.h"
 #include "rx/rx.h"
+#include "rx/rssi.h"
 #include "io/rc_controls.h"
 
 #include "io/ledstrip.h"
@@ -302,7 +303,8 @@ void applyLedModeLayer(void)
     }
 }
 
-void applyLedLowBatteryLayer(uint8_t batteryFlashState)
+// the battery LEDs flash red for a low battery, orange for a low link quality
+void applyLedWarningLayer(uint8_t warningFlashState, const rgbColor24bpp_t *warningColor)
 {
     const ledConfig_t *ledConfig;
 
@@ -315,8 +317,8 @@ void applyLedLowBatteryLayer(uint8_t batteryFlashState)
             continue;
         }
 
-        if (batteryFlashState == 0) {
-            setLedColor(ledIndex, &red);
+        if (warningFlashState == 0) {
+            setLedColor(ledIndex, warningColor);
         } else {
             setLedColor(ledIndex, &black);
         }
@@ -428,6 +430,7 @@ void updateLedStrip(void)
     static uint8_t indicatorFlashState = 0;
     static uint8_t batteryFlashState = 0;
     static bool batteryWarningEnabled = false;
+    static bool linkWarningEnabled = false;
 
     // LAYER 1
 
@@ -442,6 +445,7 @@ void updateLedStrip(void)
             batteryFlashState = 1;
 
             batteryWarningEnabled = feature(FEATURE_VBAT) && shouldSoundBatteryAlarm();
+            linkWarningEnabled = isLinkQualityLow();
         } else {
             batteryFlashState = 0;
 
@@ -449,7 +453,9 @@ void updateLedStrip(void)
     }
 
     if (batteryWarningEnabled) {
-        applyLedLowBatteryLayer(batteryFlashState);
+        applyLedWarningLayer(batteryFlashState, &red);
+    } else if (linkWarningEnabled) {
+        applyLedWarningLayer(batteryFlashState, &orange);
     }
 
     // LAYER 3
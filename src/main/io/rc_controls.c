@@ -59,10 +59,162 @@ throttleStatus_e calculateThrottleStatus(rxConfig_t *rxConfig, uint16_t deadband
     return THROTTLE_HIGH;
 }
 
-void processRcStickPositions(rxConfig_t *rxConfig, throttleStatus_e throttleStatus, uint32_t *activate, bool retarded_arm)
+typedef enum {
+    STICK_COMMAND_NONE = 0,
+    STICK_COMMAND_ARM,
+    STICK_COMMAND_DISARM,
+    STICK_COMMAND_GYRO_CALIBRATION,
+    STICK_COMMAND_INFLIGHT_ACC_CALIBRATION,
+    STICK_COMMAND_PROFILE_1,
+    STICK_COMMAND_PROFILE_2,
+    STICK_COMMAND_PROFILE_3,
+    STICK_COMMAND_ACC_CALIBRATION,
+    STICK_COMMAND_MAG_CALIBRATION,
+    STICK_COMMAND_TRIM_PITCH_UP,
+    STICK_COMMAND_TRIM_PITCH_DOWN,
+    STICK_COMMAND_TRIM_ROLL_RIGHT,
+    STICK_COMMAND_TRIM_ROLL_LEFT
+} stickCommand_e;
+
+// A stick position starts HOLDING when it changes.  Once it has been held for the hold time of the command it
+// stands for the command runs and the gesture is DONE until the sticks move, except the acc trims, which
+// step again every command_hold_time.  The hold is timed from when the position was first seen to stand for
+// the command, so how often this runs only decides how late after the hold time the command can be, at most
+// one RX frame, and sticks left in place while the command was not available, such as arm while armed, do
+// not run it the moment it becomes available.
+typedef enum {
+    STICK_COMMAND_HOLDING = 0,
+    STICK_COMMAND_DONE
+} stickCommandState_e;
+
+static stickCommand_e stickCommandFor(uint8_t rcSticks, uint32_t *activate, bool retarded_arm)
 {
-    static uint8_t rcDelayCommand;      // this indicates the number of time (multiple of RC measurement at 50Hz) the sticks must be maintained to run or switch off motors
+    if (f.ARMED) {
+        // Disarm on throttle down + yaw
+        if (activate[BOXARM] == 0 && (rcSticks == THR_LO + YAW_LO + PIT_CE + ROL_CE))
+            return STICK_COMMAND_DISARM;
+        // Disarm on roll (only when retarded_arm is enabled)
+        if (retarded_arm && activate[BOXARM] == 0 && (rcSticks == THR_LO + YAW_CE + PIT_CE + ROL_LO))
+            return STICK_COMMAND_DISARM;
+
+        return STICK_COMMAND_NONE;
+    }
+
+    switch (rcSticks) {
+        case THR_LO + YAW_LO + PIT_LO + ROL_CE:
+            return STICK_COMMAND_GYRO_CALIBRATION;
+        case THR_LO + YAW_LO + PIT_HI + ROL_HI:
+            return feature(FEATURE_INFLIGHT_ACC_CAL) ? STICK_COMMAND_INFLIGHT_ACC_CALIBRATION : STICK_COMMAND_NONE;
+        // Multiple configuration profiles
+        case THR_LO + YAW_LO + PIT_CE + ROL_LO:     // ROLL left  -> Profile 1
+            return STICK_COMMAND_PROFILE_1;
+        case THR_LO + YAW_LO + PIT_HI + ROL_CE:     // PITCH up   -> Profile 2
+            return STICK_COMMAND_PROFILE_2;
+        case THR_LO + YAW_LO + PIT_CE + ROL_HI:     // ROLL right -> Profile 3
+            return STICK_COMMAND_PROFILE_3;
+        case THR_LO + YAW_HI + PIT_CE + ROL_CE:     // Arm via YAW
+            return activate[BOXARM] == 0 ? STICK_COMMAND_ARM : STICK_COMMAND_NONE;
+        case THR_LO + YAW_CE + PIT_CE + ROL_HI:     // Arm via ROLL
+            return (retarded_arm && activate[BOXARM] == 0) ? STICK_COMMAND_ARM : STICK_COMMAND_NONE;
+        case THR_HI + YAW_LO + PIT_LO + ROL_CE:
+            return STICK_COMMAND_ACC_CALIBRATION;
+        case THR_HI + YAW_HI + PIT_LO + ROL_CE:
+            return STICK_COMMAND_MAG_CALIBRATION;
+        // Accelerometer Trim
+        case THR_HI + YAW_CE + PIT_HI + ROL_CE:
+            return STICK_COMMAND_TRIM_PITCH_UP;
+        case THR_HI + YAW_CE + PIT_LO + ROL_CE:
+            return STICK_COMMAND_TRIM_PITCH_DOWN;
+        case THR_HI + YAW_CE + PIT_CE + ROL_HI:
+            return STICK_COMMAND_TRIM_ROLL_RIGHT;
+        case THR_HI + YAW_CE + PIT_CE + ROL_LO:
+            return STICK_COMMAND_TRIM_ROLL_LEFT;
+        default:
+            return STICK_COMMAND_NONE;
+    }
+}
+
+static void applyAccelerometerTrimStep(stickCommand_e command)
+{
+    rollAndPitchTrims_t accelerometerTrimsDelta;
+    memset(&accelerometerTrimsDelta, 0, sizeof(accelerometerTrimsDelta));
+
+    switch (command) {
+        case STICK_COMMAND_TRIM_PITCH_UP:
+            accelerometerTrimsDelta.values.pitch = 2;
+            break;
+        case STICK_COMMAND_TRIM_PITCH_DOWN:
+            accelerometerTrimsDelta.values.pitch = -2;
+            break;
+        case STICK_COMMAND_TRIM_ROLL_RIGHT:
+            accelerometerTrimsDelta.values.roll = 2;
+            break;
+        case STICK_COMMAND_TRIM_ROLL_LEFT:
+            accelerometerTrimsDelta.values.roll = -2;
+            break;
+        default:
+            return;
+    }
+    applyAndSaveAccelerometerTrimsDelta(&accelerometerTrimsDelta);
+}
+
+static void runStickCommand(stickCommand_e command)
+{
+    switch (command) {
+        case STICK_COMMAND_ARM:
+            mwArm();
+            break;
+        case STICK_COMMAND_DISARM:
+            mwDisarm();
+            break;
+        case STICK_COMMAND_GYRO_CALIBRATION:
+            gyroSetCalibrationCycles(CALIBRATING_GYRO_CYCLES);
+
+#ifdef GPS
+            if (feature(FEATURE_GPS)) {
+                GPS_reset_home_position();
+            }
+#endif
+
+#ifdef BARO
+            if (sensors(SENSOR_BARO))
+                baroSetCalibrationCycles(10); // calibrate baro to new ground level (10 * 25 ms = ~250 ms non blocking)
+#endif
+
+            if (!sensors(SENSOR_MAG))
+                heading = 0; // reset heading to zero after gyro calibration
+            break;
+        case STICK_COMMAND_INFLIGHT_ACC_CALIBRATION:
+            handleInflightCalibrationStickPosition();
+            break;
+        case STICK_COMMAND_PROFILE_1:
+        case STICK_COMMAND_PROFILE_2:
+        case STICK_COMMAND_PROFILE_3:
+            changeProfile(command - STICK_COMMAND_PROFILE_1);
+            break;
+        case STICK_COMMAND_ACC_CALIBRATION:
+            accSetCalibrationCycles(CALIBRATING_ACC_CYCLES);
+            break;
+        case STICK_COMMAND_MAG_CALIBRATION:
+            f.CALIBRATE_MAG = 1;
+            break;
+        default:
+            applyAccelerometerTrimStep(command);
+            break;
+    }
+}
+
+static bool isAccelerometerTrimCommand(stickCommand_e command)
+{
+    return command >= STICK_COMMAND_TRIM_PITCH_UP && command <= STICK_COMMAND_TRIM_ROLL_LEFT;
+}
+
+void processRcStickPositions(rxConfig_t *rxConfig, stickCommandConfig_t *stickCommandConfig, throttleStatus_e throttleStatus, uint32_t *activate, bool retarded_arm, uint32_t currentTime)
+{
+    static stickCommandState_e state = STICK_COMMAND_DONE;
     static uint8_t rcSticks;            // this hold sticks position for command combos
+    static stickCommand_e heldCommand;
+    static uint32_t heldSince;
     uint8_t stTmp = 0;
     int i;
 
@@ -75,12 +227,11 @@ void processRcStickPositions(rxConfig_t *rxConfig, throttleStatus_e throttleStat
         if (rcData[i] < rxConfig->maxcheck)
             stTmp |= 0x40;  // check for MAX
     }
-    if (stTmp == rcSticks) {
-        if (rcDelayCommand < 250)
-            rcDelayCommand++;
-    } else
-        rcDelayCommand = 0;
-    rcSticks = stTmp;
+    if (stTmp != rcSticks) {
+        rcSticks = stTmp;
+        heldCommand = STICK_COMMAND_NONE;
+        state = STICK_COMMAND_HOLDING;
+    }
 
     // perform actions
     if (throttleStatus == THROTTLE_LOW) {
@@ -96,111 +247,30 @@ void processRcStickPositions(rxConfig_t *rxConfig, throttleStatus_e throttleStat
         }
     }
 
-    if (rcDelayCommand != 20) {
+    if (state != STICK_COMMAND_HOLDING) {
         return;
     }
 
-    if (f.ARMED) {      // actions during armed
-        // Disarm on throttle down + yaw
-        if (activate[BOXARM] == 0 && (rcSticks == THR_LO + YAW_LO + PIT_CE + ROL_CE))
-            mwDisarm();
-        // Disarm on roll (only when retarded_arm is enabled)
-        if (retarded_arm && activate[BOXARM] == 0 && (rcSticks == THR_LO + YAW_CE + PIT_CE + ROL_LO))
-            mwDisarm();
-
-        return;
+    stickCommand_e command = stickCommandFor(rcSticks, activate, retarded_arm);
+    if (command != heldCommand) {
+        heldCommand = command;
+        heldSince = currentTime;
     }
-
-    // actions during not armed
-    i = 0;
-
-    if (rcSticks == THR_LO + YAW_LO + PIT_LO + ROL_CE) {
-        // GYRO calibration
-        gyroSetCalibrationCycles(CALIBRATING_GYRO_CYCLES);
-
-#ifdef GPS
-        if (feature(FEATURE_GPS)) {
-            GPS_reset_home_position();
-        }
-#endif
-
-#ifdef BARO
-        if (sensors(SENSOR_BARO))
-            baroSetCalibrationCycles(10); // calibrate baro to new ground level (10 * 25 ms = ~250 ms non blocking)
-#endif
-
-        if (!sensors(SENSOR_MAG))
-            heading = 0; // reset heading to zero after gyro calibration
-
+    if (command == STICK_COMMAND_NONE) {
         return;
     }
 
-    if (feature(FEATURE_INFLIGHT_ACC_CAL) && (rcSticks == THR_LO + YAW_LO + PIT_HI + ROL_HI)) {
-        // Inflight ACC Calibration
-        handleInflightCalibrationStickPosition();
+    uint16_t holdTime = (command == STICK_COMMAND_ARM || command == STICK_COMMAND_DISARM) ?
+        stickCommandConfig->arm_hold_time : stickCommandConfig->command_hold_time;
+    if (currentTime - heldSince < (uint32_t)holdTime * 1000) {
         return;
     }
 
-    // Multiple configuration profiles
-    if (rcSticks == THR_LO + YAW_LO + PIT_CE + ROL_LO)          // ROLL left  -> Profile 1
-        i = 1;
-    else if (rcSticks == THR_LO + YAW_LO + PIT_HI + ROL_CE)     // PITCH up   -> Profile 2
-        i = 2;
-    else if (rcSticks == THR_LO + YAW_LO + PIT_CE + ROL_HI)     // ROLL right -> Profile 3
-        i = 3;
-    if (i) {
-        changeProfile(i - 1);
-        return;
-    }
+    runStickCommand(command);
 
-    if (activate[BOXARM] == 0 && (rcSticks == THR_LO + YAW_HI + PIT_CE + ROL_CE)) {
-        // Arm via YAW
-        mwArm();
-        return;
-    }
-
-    if (retarded_arm && activate[BOXARM] == 0 && (rcSticks == THR_LO + YAW_CE + PIT_CE + ROL_HI)) {
-        // Arm via ROLL
-        mwArm();
-        return;
-    }
-
-    if (rcSticks == THR_HI + YAW_LO + PIT_LO + ROL_CE) {
-        // Calibrating Acc
-        accSetCalibrationCycles(CALIBRATING_ACC_CYCLES);
-        return;
-    }
-
-
-    if (rcSticks == THR_HI + YAW_HI + PIT_LO + ROL_CE) {
-        // Calibrating Mag
-        f.CALIBRATE_MAG = 1;
-        return;
-    }
-
-
-    // Accelerometer Trim
-
-    rollAndPitchTrims_t accelerometerTrimsDelta;
-    memset(&accelerometerTrimsDelta, 0, sizeof(accelerometerTrimsDelta));
-
-    bool shouldApplyRollAndPitchTrimDelta = false;
-    if (rcSticks == THR_HI + YAW_CE + PIT_HI + ROL_CE) {
-        accelerometerTrimsDelta.values.pitch = 2;
-        shouldApplyRollAndPitchTrimDelta = true;
-    } else if (rcSticks == THR_HI + YAW_CE + PIT_LO + ROL_CE) {
-        accelerometerTrimsDelta.values.pitch = -2;
-        shouldApplyRollAndPitchTrimDelta = true;
-    } else if (rcSticks == THR_HI + YAW_CE + PIT_CE + ROL_HI) {
-        accelerometerTrimsDelta.values.roll = 2;
-        shouldApplyRollAndPitchTrimDelta = true;
-    } else if (rcSticks == THR_HI + YAW_CE + PIT_CE + ROL_LO) {
-        accelerometerTrimsDelta.values.roll = -2;
-        shouldApplyRollAndPitchTrimDelta = true;
-    }
-    if (shouldApplyRollAndPitchTrimDelta) {
-        applyAndSaveAccelerometerTrimsDelta(&accelerometerTrimsDelta);
-        rcDelayCommand = 0; // allow autorepetition
-        return;
+    if (isAccelerometerTrimCommand(command)) {
+        heldSince = currentTime;    // allow autorepetition
+    } else {
+        state = STICK_COMMAND_DONE;
     }
 }
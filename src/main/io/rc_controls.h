@@ -59,10 +59,15 @@ typedef struct controlRateConfig_s {
     uint8_t yawRate;
 } controlRateConfig_t;
 
+typedef struct stickCommandConfig_s {
+    uint16_t arm_hold_time;                 // ms the sticks must be held to arm or disarm
+    uint16_t command_hold_time;             // ms for calibrations and profile changes, and between acc trim steps
+} stickCommandConfig_t;
+
 extern int16_t rcCommand[4];
 
 bool areSticksInApModePosition(uint16_t ap_mode);
 throttleStatus_e calculateThrottleStatus(rxConfig_t *rxConfig, uint16_t deadband3d_throttle);
-void processRcStickPositions(rxConfig_t *rxConfig, throttleStatus_e throttleStatus, uint32_t *activate, bool retarded_arm);
+void processRcStickPositions(rxConfig_t *rxConfig, stickCommandConfig_t *stickCommandConfig, throttleStatus_e throttleStatus, uint32_t *activate, bool retarded_arm, uint32_t currentTime);
 
 
@@ -24,6 +24,8 @@
 
 #include "build_config.h"
 
+#include "common/maths.h"
+
 #include "drivers/system.h"
 #include "drivers/gpio.h"
 #include "drivers/timer.h"
@@ -63,6 +65,7 @@ const serialPortFunctionScenario_e serialPortScenarios[SERIAL_PORT_SCENARIO_COUN
 
 static serialConfig_t *serialConfig;
 static serialPort_t *serialPorts[SERIAL_PORT_COUNT];
+static serialBuffers_t serialPortBuffers[SERIAL_PORT_IDENTIFIER_COUNT];
 
 #ifdef STM32F303xC
 static serialPortFunction_t serialPortFunctions[SERIAL_PORT_COUNT] = {
@@ -115,13 +118,15 @@ static const serialPortConstraint_t serialPortConstraints[SERIAL_PORT_COUNT] = {
 #endif
 #endif
 
+// MSP replies and CLI dumps are written in one go so need the larger transmit buffers, a serial receiver
+// only needs room for one frame between loops.
 const functionConstraint_t functionConstraints[] = {
-        { FUNCTION_CLI,             9600, 115200, NO_AUTOBAUD, SPF_NONE },
-        { FUNCTION_GPS,             9600, 115200, AUTOBAUD,    SPF_NONE },
-        { FUNCTION_GPS_PASSTHROUGH, 9600, 115200, NO_AUTOBAUD, SPF_NONE },
-        { FUNCTION_MSP,             9600, 115200, NO_AUTOBAUD, SPF_NONE },
-        { FUNCTION_SERIAL_RX,       9600, 115200, NO_AUTOBAUD, SPF_SUPPORTS_SBUS_MODE | SPF_SUPPORTS_CALLBACK },
-        { FUNCTION_TELEMETRY,       9600, 19200,  NO_AUTOBAUD, SPF_NONE }
+        { FUNCTION_CLI,             9600, 115200, NO_AUTOBAUD, SPF_NONE,                                        128, 256 },
+        { FUNCTION_GPS,             9600, 115200, AUTOBAUD,    SPF_NONE,                                        128, 64 },
+        { FUNCTION_GPS_PASSTHROUGH, 9600, 115200, NO_AUTOBAUD, SPF_NONE,                                        128, 128 },
+        { FUNCTION_MSP,             9600, 115200, NO_AUTOBAUD, SPF_NONE,                                        256, 256 },
+        { FUNCTION_SERIAL_RX,       9600, 115200, NO_AUTOBAUD, SPF_SUPPORTS_SBUS_MODE | SPF_SUPPORTS_CALLBACK,  64,  16 },
+        { FUNCTION_TELEMETRY,       9600, 19200,  NO_AUTOBAUD, SPF_NONE,                                        64,  128 }
 };
 
 #define FUNCTION_CONSTRAINT_COUNT (sizeof(functionConstraints) / sizeof(functionConstraint_t))
@@ -364,6 +369,16 @@ void endSerialPortFunction(serialPort_t *port, serialPortFunction_e function)
     serialPortFunction->currentFunction = FUNCTION_NONE;
 }
 
+bool isSerialPortFunctionAllowed(serialPort_t *port, serialPortFunction_e function)
+{
+    serialPortFunction_t *serialPortFunction = findSerialPortFunctionByPort(port);
+    if (!serialPortFunction) {
+        return false;
+    }
+
+    return serialPortFunction->scenario & function;
+}
+
 functionConstraint_t *getConfiguredFunctionConstraint(serialPortFunction_e function)
 {
     static functionConstraint_t configuredFunctionConstraint;
@@ -410,6 +425,83 @@ functionConstraint_t *getConfiguredFunctionConstraint(serialPortFunction_e funct
     return &configuredFunctionConstraint;
 }
 
+static bool isSerialPortUsingBufferPool(serialPortIdentifier_e identifier)
+{
+#ifdef STM32F303xC
+    if (identifier == SERIAL_PORT_USB_VCP) {
+        return false; // the usb stack has its own buffers
+    }
+#endif
+#ifdef USE_SOFT_SERIAL
+    if (!feature(FEATURE_SOFTSERIAL) && (identifier == SERIAL_PORT_SOFTSERIAL1 || identifier == SERIAL_PORT_SOFTSERIAL2)) {
+        return false;
+    }
+#endif
+    UNUSED(identifier);
+    return true;
+}
+
+static void findSerialPortBufferSizes(serialPortIdentifier_e identifier, serialPortFunctionScenario_e scenario, uint16_t *rxBufferSize, uint16_t *txBufferSize)
+{
+    uint8_t index;
+
+    *rxBufferSize = 0;
+    *txBufferSize = 0;
+
+    if (!isSerialPortUsingBufferPool(identifier)) {
+        return;
+    }
+
+    for (index = 0; index < FUNCTION_CONSTRAINT_COUNT; index++) {
+        const functionConstraint_t *functionConstraint = &functionConstraints[index];
+        if (scenario & functionConstraint->function) {
+            *rxBufferSize = max(*rxBufferSize, functionConstraint->rxBufferSize);
+            *txBufferSize = max(*txBufferSize, functionConstraint->txBufferSize);
+        }
+    }
+}
+
+/*
+ * bytes of the serial buffer pool the ports would need for the scenarios in serialConfigToCheck, without applying them.
+ */
+uint16_t serialBufferPoolRequired(serialConfig_t *serialConfigToCheck)
+{
+    uint16_t required = 0;
+    uint16_t rxBufferSize;
+    uint16_t txBufferSize;
+    uint32_t portIndex = 0, serialPortIdentifier;
+
+    for (serialPortIdentifier = 0; serialPortIdentifier < SERIAL_PORT_IDENTIFIER_COUNT && portIndex < SERIAL_PORT_COUNT; serialPortIdentifier++) {
+        if (lookupSerialPortFunctionIndexByIdentifier(serialPortIdentifier) == IDENTIFIER_NOT_FOUND) {
+            continue;
+        }
+        serialPortFunctionScenario_e scenario = serialPortScenarios[serialConfigToCheck->serial_port_scenario[portIndex++]];
+
+        findSerialPortBufferSizes(serialPortIdentifier, scenario, &rxBufferSize, &txBufferSize);
+        required += rxBufferSize + txBufferSize;
+    }
+    return required;
+}
+
+static void allocateSerialPortBuffers(void)
+{
+    uint16_t rxBufferSize;
+    uint16_t txBufferSize;
+    uint8_t index;
+
+    for (index = 0; index < SERIAL_PORT_COUNT; index++) {
+        serialPortFunction_t *serialPortFunction = &serialPortFunctions[index];
+
+        findSerialPortBufferSizes(serialPortFunction->identifier, serialPortFunction->scenario, &rxBufferSize, &txBufferSize);
+        if (rxBufferSize == 0 && txBufferSize == 0) {
+            continue;
+        }
+
+        // a port without buffers cannot be opened, isSerialConfigValid makes sure they fit
+        serialAllocateBuffers(&serialPortBuffers[serialPortFunction->identifier], rxBufferSize, txBufferSize);
+    }
+}
+
 bool isSerialConfigValid(serialConfig_t *serialConfigToCheck)
 {
     serialPortSearchResult_t *searchResult;
@@ -417,6 +509,10 @@ bool isSerialConfigValid(serialConfig_t *serialConfigToCheck)
 
     serialConfig = serialConfigToCheck;
 
+    if (serialBufferPoolRequired(serialConfigToCheck) > SERIAL_BUFFER_POOL_SIZE) {
+        return false;
+    }
+
     functionConstraint = getConfiguredFunctionConstraint(FUNCTION_MSP);
     searchResult = findSerialPort(FUNCTION_MSP, functionConstraint);
     if (!searchResult) {
@@ -530,6 +626,11 @@ serialPort_t *openSerialPort(serialPortFunction_e function, serialReceiveCallbac
     const serialPortConstraint_t *serialPortConstraint = searchResult->portConstraint;
 
     serialPortIdentifier_e identifier = serialPortConstraint->identifier;
+    const serialBuffers_t *buffers = &serialPortBuffers[identifier];
+    if (isSerialPortUsingBufferPool(identifier) && !buffers->rxBuffer) {
+        return NULL;
+    }
+
     switch(identifier) {
 #ifdef STM32F303xC
         case SERIAL_PORT_USB_VCP:
@@ -538,26 +639,26 @@ serialPort_t *openSerialPort(serialPortFunction_e function, serialReceiveCallbac
 #endif
 #ifdef USE_USART1
         case SERIAL_PORT_USART1:
-            serialPort = uartOpen(USART1, callback, baudRate, mode, inversion);
+            serialPort = uartOpen(USART1, callback, baudRate, mode, inversion, buffers);
             break;
 #endif
 #ifdef USE_USART2
         case SERIAL_PORT_USART2:
-            serialPort = uartOpen(USART2, callback, baudRate, mode, inversion);
+            serialPort = uartOpen(USART2, callback, baudRate, mode, inversion, buffers);
             break;
 #endif
 #ifdef USE_USART3
         case SERIAL_PORT_USART3:
-            serialPort = uartOpen(USART3, callback, baudRate, mode, inversion);
+            serialPort = uartOpen(USART3, callback, baudRate, mode, inversion, buffers);
             break;
 #endif
 #ifdef USE_SOFT_SERIAL
         case SERIAL_PORT_SOFTSERIAL1:
-            serialPort = openSoftSerial(SOFTSERIAL1, callback, baudRate, inversion);
+            serialPort = openSoftSerial(SOFTSERIAL1, callback, baudRate, inversion, buffers);
             serialSetMode(serialPort, mode);
             break;
         case SERIAL_PORT_SOFTSERIAL2:
-            serialPort = openSoftSerial(SOFTSERIAL2, callback, baudRate, inversion);
+            serialPort = openSoftSerial(SOFTSERIAL2, callback, baudRate, inversion, buffers);
             serialSetMode(serialPort, mode);
             break;
 #endif
@@ -587,6 +688,7 @@ void serialInit(serialConfig_t *initialSerialConfig)
 {
     serialConfig = initialSerialConfig;
     applySerialConfigToPortFunctions(serialConfig);
+    allocateSerialPortBuffers();
 
     mspInit(serialConfig);
     cliInit(serialConfig);
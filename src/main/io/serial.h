@@ -38,6 +38,8 @@ typedef struct functionConstraint_s {
     uint32_t maxBaudRate;
     autoBaud_e autoBaud;
     uint8_t requiredSerialPortFeatures;
+    uint16_t rxBufferSize;              // a port gets the largest of each for the functions in its scenario
+    uint16_t txBufferSize;
 } functionConstraint_t;
 
 typedef enum {
@@ -124,6 +126,7 @@ typedef struct serialPortFunctionList_s {
 typedef struct serialConfig_s {
     uint8_t serial_port_scenario[SERIAL_PORT_COUNT];
     uint32_t msp_baudrate;
+    uint16_t msp_time_budget;               // us each loop may spend answering MSP across all ports, 0 for no limit
     uint32_t cli_baudrate;
     uint32_t gps_baudrate;
     uint32_t gps_passthrough_baudrate;
@@ -139,6 +142,7 @@ serialPort_t *openSerialPort(serialPortFunction_e functionMask, serialReceiveCal
 bool canOpenSerialPort(serialPortFunction_e function);
 void beginSerialPortFunction(serialPort_t *port, serialPortFunction_e function);
 void endSerialPortFunction(serialPort_t *port, serialPortFunction_e function);
+bool isSerialPortFunctionAllowed(serialPort_t *port, serialPortFunction_e function);
 
 void waitForSerialPortToFinishTransmitting(serialPort_t *serialPort);
 
@@ -146,6 +150,7 @@ void applySerialConfigToPortFunctions(serialConfig_t *serialConfig);
 bool isSerialConfigValid(serialConfig_t *serialConfig);
 bool doesConfigurationUsePort(serialPortIdentifier_e portIdentifier);
 bool isSerialPortFunctionShared(serialPortFunction_e functionToUse, uint16_t functionMask);
+uint16_t serialBufferPoolRequired(serialConfig_t *serialConfig);
 
 const serialPortFunctionList_t *getSerialPortFunctionList(void);
 
@@ -37,8 +37,12 @@
 #include "drivers/gpio.h"
 #include "drivers/timer.h"
 #include "drivers/pwm_rx.h"
+#include "drivers/pwm_mapping.h"
 #include "flight/flight.h"
 #include "flight/mixer.h"
+#include "flight/thrust_linear.h"
+#include "flight/servo_output.h"
+#include "flight/mixer_stats.h"
 #include "flight/navigation.h"
 #include "flight/failsafe.h"
 #include "rx/rx.h"
@@ -47,11 +51,18 @@
 #include "io/gimbal.h"
 #include "io/rc_controls.h"
 #include "io/serial.h"
+#include "io/serial_passthrough.h"
+#include "io/flight_log.h"
+#include "rx/spektrum.h"
+#include "rx/rssi.h"
 #include "sensors/battery.h"
 #include "sensors/boardalignment.h"
 #include "sensors/sensors.h"
 #include "sensors/acceleration.h"
 #include "sensors/gyro.h"
+#include "sensors/gyro_redundancy.h"
+#include "sensors/vibration.h"
+
 #include "sensors/barometer.h"
 #include "telemetry/telemetry.h"
 
@@ -79,12 +90,15 @@ static void cliHelp(char *cmdline);
 static void cliMap(char *cmdline);
 static void cliMixer(char *cmdline);
 static void cliMotor(char *cmdline);
+static void cliMotorStats(char *cmdline);
 static void cliProfile(char *cmdline);
 static void cliSave(char *cmdline);
+static void cliServo(char *cmdline);
 static void cliSet(char *cmdline);
 static void cliGet(char *cmdline);
 static void cliStatus(char *cmdline);
 static void cliVersion(char *cmdline);
+static void cliVibe(char *cmdline);
 
 extern uint16_t cycleTime; // FIXME dependency on mw.c
 
@@ -120,6 +134,11 @@ static const char * const sensorNames[] = {
     "GYRO", "ACC", "BARO", "MAG", "SONAR", "GPS", "GPS+MAG", NULL
 };
 
+// sync this with gyroSensor_e enum from sensors/gyro.h
+static const char * const gyroNames[] = {
+    "None", "FAKE", "MPU6050", "L3G4200D", "MPU3050", "L3GD20", "MPU6000", NULL
+};
+
 static const char * const accNames[] = {
     "", "ADXL345", "MPU6050", "MMA845x", "BMA280", "LSM303DLHC", "MPU6000", "FAKE", "None", NULL
 };
@@ -140,17 +159,20 @@ const clicmd_t cmdTable[] = {
     { "feature", "list or -val or val", cliFeature },
     { "get", "get variable value", cliGet },
 #ifdef GPS
-    { "gpspassthrough", "passthrough gps to serial", cliGpsPassthrough },
+    { "gpspassthrough", "passthrough gps to serial, [idle timeout s]", cliGpsPassthrough },
 #endif
     { "help", "", cliHelp },
     { "map", "mapping of rc channel order", cliMap },
     { "mixer", "mixer name or list", cliMixer },
     { "motor", "get/set motor output value", cliMotor },
+    { "motorstats", "show motor saturation and headroom, or reset", cliMotorStats },
     { "profile", "index (0 to 2)", cliProfile },
     { "save", "save and reboot", cliSave },
+    { "servo", "index rate lowpass_hz slew_rate or blank for list", cliServo },
     { "set", "name=value or blank or * for list", cliSet },
     { "status", "show system status", cliStatus },
     { "version", "", cliVersion },
+    { "vibe", "show vibration and clipping, or reset", cliVibe },
 };
 #define CMD_COUNT (sizeof(cmdTable) / sizeof(clicmd_t))
 
@@ -190,6 +212,8 @@ const clivalue_t valueTable[] = {
     { "min_throttle",               VAR_UINT16 | MASTER_VALUE,  &masterConfig.escAndServoConfig.minthrottle, PWM_RANGE_ZERO, PWM_RANGE_MAX },
     { "max_throttle",               VAR_UINT16 | MASTER_VALUE,  &masterConfig.escAndServoConfig.maxthrottle, PWM_RANGE_ZERO, PWM_RANGE_MAX },
     { "min_command",                VAR_UINT16 | MASTER_VALUE,  &masterConfig.escAndServoConfig.mincommand, PWM_RANGE_ZERO, PWM_RANGE_MAX },
+    { "thrust_linear",              VAR_UINT8  | MASTER_VALUE,  &masterConfig.thrustLinearConfig.thrust_linear, 0, 100 },
+
 
     { "3d_deadband_low",            VAR_UINT16 | MASTER_VALUE,  &masterConfig.flight3DConfig.deadband3d_low, PWM_RANGE_ZERO, PWM_RANGE_MAX }, // FIXME upper limit should match code in the mixer, 1500 currently
     { "3d_deadband_high",           VAR_UINT16 | MASTER_VALUE,  &masterConfig.flight3DConfig.deadband3d_high, PWM_RANGE_ZERO, PWM_RANGE_MAX }, // FIXME lower limit should match code in the mixer, 1500 currently,
@@ -197,9 +221,12 @@ const clivalue_t valueTable[] = {
     { "3d_deadband_throttle",       VAR_UINT16 | MASTER_VALUE,  &masterConfig.flight3DConfig.deadband3d_throttle, PWM_RANGE_ZERO, PWM_RANGE_MAX },
 
     { "motor_pwm_rate",             VAR_UINT16 | MASTER_VALUE,  &masterConfig.motor_pwm_rate, 50, 32000 },
+    { "motor_pwm_dither",           VAR_UINT8  | MASTER_VALUE,  &masterConfig.motor_pwm_dither, 0, 1 },
     { "servo_pwm_rate",             VAR_UINT16 | MASTER_VALUE,  &masterConfig.servo_pwm_rate, 50, 498 },
 
     { "retarded_arm",               VAR_UINT8  | MASTER_VALUE,  &masterConfig.retarded_arm, 0, 1 },
+    { "arm_hold_time",              VAR_UINT16 | MASTER_VALUE,  &masterConfig.stickCommandConfig.arm_hold_time, 0, 5000 },
+    { "command_hold_time",          VAR_UINT16 | MASTER_VALUE,  &masterConfig.stickCommandConfig.command_hold_time, 0, 5000 },
     { "small_angle",                VAR_UINT8  | MASTER_VALUE,  &masterConfig.small_angle, 0, 180 },
 
     { "flaps_speed",                VAR_UINT8  | MASTER_VALUE,  &masterConfig.airplaneConfig.flaps_speed, 0, 100 },
@@ -218,6 +245,7 @@ const clivalue_t valueTable[] = {
 
     { "reboot_character",           VAR_UINT8  | MASTER_VALUE,  &masterConfig.serialConfig.reboot_character, 48, 126 },
     { "msp_baudrate",               VAR_UINT32 | MASTER_VALUE,  &masterConfig.serialConfig.msp_baudrate, 1200, 115200 },
+    { "msp_time_budget",            VAR_UINT16 | MASTER_VALUE,  &masterConfig.serialConfig.msp_time_budget, 0, 3000 },
     { "cli_baudrate",               VAR_UINT32 | MASTER_VALUE,  &masterConfig.serialConfig.cli_baudrate, 1200, 115200 },
 
 #ifdef GPS
@@ -261,6 +289,7 @@ const clivalue_t valueTable[] = {
     { "align_gyro",                 VAR_UINT8  | MASTER_VALUE,  &masterConfig.sensorAlignmentConfig.gyro_align, 0, 8 },
     { "align_acc",                  VAR_UINT8  | MASTER_VALUE,  &masterConfig.sensorAlignmentConfig.acc_align, 0, 8 },
     { "align_mag",                  VAR_UINT8  | MASTER_VALUE,  &masterConfig.sensorAlignmentConfig.mag_align, 0, 8 },
+    { "align_gyro_secondary",       VAR_UINT8  | MASTER_VALUE,  &masterConfig.sensorAlignmentConfig.gyro_secondary_align, 0, 8 },
 
     { "align_board_roll",           VAR_INT16  | MASTER_VALUE,  &masterConfig.boardAlignment.rollDegrees, -180, 360 },
     { "align_board_pitch",          VAR_INT16  | MASTER_VALUE,  &masterConfig.boardAlignment.pitchDegrees, -180, 360 },
@@ -270,11 +299,16 @@ const clivalue_t valueTable[] = {
 
     { "gyro_lpf",                   VAR_UINT16 | MASTER_VALUE,  &masterConfig.gyro_lpf, 0, 256 },
     { "moron_threshold",            VAR_UINT8  | MASTER_VALUE,  &masterConfig.gyroConfig.gyroMovementCalibrationThreshold, 0, 128 },
+    { "gyro_redundancy",            VAR_UINT8  | MASTER_VALUE,  &masterConfig.gyroRedundancyConfig.gyro_redundancy, 0, 1 },
+    { "gyro_vote_threshold",        VAR_UINT16 | MASTER_VALUE,  &masterConfig.gyroRedundancyConfig.gyro_vote_threshold, 10, 10000 },
+    { "gyro_fault_cycles",          VAR_UINT8  | MASTER_VALUE,  &masterConfig.gyroRedundancyConfig.gyro_fault_cycles, 1, 255 },
     { "gyro_cmpf_factor",           VAR_UINT16 | MASTER_VALUE,  &masterConfig.gyro_cmpf_factor, 100, 1000 },
     { "gyro_cmpfm_factor",          VAR_UINT16 | MASTER_VALUE,  &masterConfig.gyro_cmpfm_factor, 100, 1000 },
 
     { "alt_hold_deadband",          VAR_UINT8  | PROFILE_VALUE, &currentProfile.alt_hold_deadband, 1, 250 },
     { "alt_hold_fast_change",       VAR_UINT8  | PROFILE_VALUE, &currentProfile.alt_hold_fast_change, 0, 1 },
+    { "alt_hold_hover_learn",       VAR_UINT8  | PROFILE_VALUE, &currentProfile.alt_hold_hover_learn, 0, 60 },
+    { "alt_hold_accel_gain",        VAR_UINT8  | PROFILE_VALUE, &currentProfile.alt_hold_accel_gain, 0, 200 },
 
     { "throttle_correction_value",  VAR_UINT8  | PROFILE_VALUE, &currentProfile.throttle_correction_value, 0, 150 },
     { "throttle_correction_angle",  VAR_UINT16 | PROFILE_VALUE, &currentProfile.throttle_correction_angle, 1, 900 },
@@ -285,6 +319,7 @@ const clivalue_t valueTable[] = {
 
     { "yaw_direction",              VAR_INT8   | PROFILE_VALUE, &currentProfile.mixerConfig.yaw_direction, -1, 1 },
     { "tri_unarmed_servo",          VAR_INT8   | PROFILE_VALUE, &currentProfile.mixerConfig.tri_unarmed_servo, 0, 1 },
+    { "vbat_pid_compensation",      VAR_UINT8  | PROFILE_VALUE, &currentProfile.mixerConfig.vbat_pid_compensation, 0, 1 },
 
     { "rc_rate",                    VAR_UINT8  | PROFILE_VALUE, &currentProfile.controlRateConfig.rcRate8, 0, 250 },
     { "rc_expo",                    VAR_UINT8  | PROFILE_VALUE, &currentProfile.controlRateConfig.rcExpo8, 0, 100 },
@@ -304,6 +339,10 @@ const clivalue_t valueTable[] = {
     { "gimbal_flags",               VAR_UINT8  | PROFILE_VALUE, &currentProfile.gimbalConfig.gimbal_flags, 0, 255},
 
     { "acc_hardware",               VAR_UINT8  | MASTER_VALUE,  &masterConfig.acc_hardware, 0, 5 },
+    { "acc_vibration_warning",      VAR_UINT16 | MASTER_VALUE,  &masterConfig.vibrationConfig.acc_vibration_warning, 0, 800 },
+#ifdef FLASH_LOG
+    { "flight_log_rate",            VAR_UINT8  | MASTER_VALUE,  &masterConfig.flightLogConfig.flight_log_rate, 0, 100 },
+#endif
     { "acc_lpf_factor",             VAR_UINT8  | PROFILE_VALUE, &currentProfile.acc_lpf_factor, 0, 250 },
     { "accxy_deadband",             VAR_UINT8  | PROFILE_VALUE, &currentProfile.accDeadband.xy, 0, 100 },
     { "accz_deadband",              VAR_UINT8  | PROFILE_VALUE, &currentProfile.accDeadband.z, 0, 100 },
@@ -394,10 +433,12 @@ static void cliAux(char *cmdline)
     } else {
         ptr = cmdline;
         i = atoi(ptr);
-        if (i < CHECKBOX_ITEM_COUNT) {
+        if (i >= 0 && i < CHECKBOX_ITEM_COUNT) {
             ptr = strchr(cmdline, ' ');
-            val = atoi(ptr);
-            currentProfile.activate[i] = val;
+            if (ptr) {
+                val = atoi(ptr);
+                currentProfile.activate[i] = val;
+            }
         } else {
             printf("Invalid Feature index: must be < %u\r\n", CHECKBOX_ITEM_COUNT);
         }
@@ -462,23 +503,23 @@ static void cliCMix(char *cmdline)
     } else {
         ptr = cmdline;
         i = atoi(ptr); // get motor number
-        if (--i < MAX_SUPPORTED_MOTORS) {
+        if (--i >= 0 && i < MAX_SUPPORTED_MOTORS) {
             ptr = strchr(ptr, ' ');
             if (ptr) {
                 masterConfig.customMixer[i].throttle = fastA2F(++ptr);
                 check++;
             }
-            ptr = strchr(ptr, ' ');
+            ptr = ptr ? strchr(ptr, ' ') : NULL;
             if (ptr) {
                 masterConfig.customMixer[i].roll = fastA2F(++ptr);
                 check++;
             }
-            ptr = strchr(ptr, ' ');
+            ptr = ptr ? strchr(ptr, ' ') : NULL;
             if (ptr) {
                 masterConfig.customMixer[i].pitch = fastA2F(++ptr);
                 check++;
             }
-            ptr = strchr(ptr, ' ');
+            ptr = ptr ? strchr(ptr, ' ') : NULL;
             if (ptr) {
                 masterConfig.customMixer[i].yaw = fastA2F(++ptr);
                 check++;
@@ -591,6 +632,10 @@ static void cliDump(char *cmdline)
         buf[i] = '\0';
         printf("map %s\r\n", buf);
 
+        printf("\r\n\r\n# servo\r\n");
+
+        cliServo("");
+
         printSectionBreak();
         dumpValues(MASTER_VALUE);
     }
@@ -706,9 +751,20 @@ static void cliFeature(char *cmdline)
 #ifdef GPS
 static void cliGpsPassthrough(char *cmdline)
 {
-    UNUSED(cmdline);
+    uint32_t idleTimeoutSeconds = 0;
+
+    if (strlen(cmdline) > 0) {
+        idleTimeoutSeconds = atoi(cmdline);
+    }
+
+    // printed first, the port may change to the passthrough baud rate
+    cliPrint("Passthrough to GPS, end with +++ between 1s pauses");
+    if (idleTimeoutSeconds) {
+        printf(" or %u s without data", idleTimeoutSeconds);
+    }
+    cliPrint("\r\n");
 
-    gpsEnablePassthroughResult_e result = gpsEnablePassthrough();
+    gpsEnablePassthroughResult_e result = gpsEnablePassthrough(idleTimeoutSeconds * 1000);
 
     switch (result) {
         case GPS_PASSTHROUGH_NO_GPS:
@@ -719,6 +775,10 @@ static void cliGpsPassthrough(char *cmdline)
             cliPrint("Error: Enable and plug in GPS first\r\n");
             break;
 
+        case GPS_PASSTHROUGH_IN_USE:
+            cliPrint("Error: A passthrough is already running\r\n");
+            break;
+
         default:
             break;
     }
@@ -843,6 +903,39 @@ static void cliMotor(char *cmdline)
     motor_disarmed[motor_index] = motor_value;
 }
 
+static void cliMotorStats(char *cmdline)
+{
+    static const char * const axisNames[MIXER_STATS_AXIS_COUNT] = { "roll", "pitch", "yaw" };
+    const mixerStats_t *stats = getMixerStats();
+    uint32_t total;
+    uint8_t i, bin;
+
+    if (strcasecmp(cmdline, "reset") == 0) {
+        mixerStatsReset();
+        cliPrint("Motor statistics reset\r\n");
+        return;
+    }
+
+    printf("Cycles: %d\r\n", stats->cycles);
+    if (!stats->cycles)
+        return;
+
+    for (i = 0; i < mixerStatsMotorCount(); i++) {
+        printf("Motor %d: upper limit %d, lower limit %d, histogram %%:", i, stats->upperLimitCycles[i], stats->lowerLimitCycles[i]);
+        total = 0;
+        for (bin = 0; bin < MIXER_STATS_HISTOGRAM_BINS; bin++)
+            total += stats->histogram[i][bin];
+        for (bin = 0; bin < MIXER_STATS_HISTOGRAM_BINS; bin++)
+            printf(" %d", total ? stats->histogram[i][bin] * 100 / total : 0);
+        cliPrint("\r\n");
+    }
+
+    for (i = 0; i < MIXER_STATS_AXIS_COUNT; i++) {
+        printf("Authority lost on %s: %d cycles, average %d\r\n", axisNames[i], stats->authorityLostCycles[i], mixerStatsAverageAuthorityLost(i));
+    }
+}
+
+
 static void cliProfile(char *cmdline)
 {
     uint8_t len;
@@ -873,6 +966,13 @@ static void cliSave(char *cmdline)
 {
     UNUSED(cmdline);
 
+    // a config that does not fit would be reset to the default serial config on the next boot
+    uint16_t serialBuffersRequired = serialBufferPoolRequired(&masterConfig.serialConfig);
+    if (serialBuffersRequired > SERIAL_BUFFER_POOL_SIZE) {
+        printf("Not saved, the serial ports need %d bytes of buffers and %d are available\r\n", serialBuffersRequired, SERIAL_BUFFER_POOL_SIZE);
+        return;
+    }
+
     cliPrint("Saving");
     copyCurrentProfileToProfileSlot(masterConfig.current_profile_index);
     writeEEPROM();
@@ -902,7 +1002,7 @@ static void cliWrite(uint8_t ch)
 static void cliPrintVar(const clivalue_t *var, uint32_t full)
 {
     int32_t value = 0;
-    char buf[8];
+    char buf[16];
 
     switch (var->type & VALUE_TYPE_MASK) {
         case VAR_UINT8:
@@ -961,6 +1061,50 @@ static void cliSetVar(const clivalue_t *var, const int_float_value_t value)
     }
 }
 
+static void cliServo(char *cmdline)
+{
+    int args[4];
+    int count = 0;
+    char *pch;
+    servoOutputConfig_t *config;
+
+    if (strlen(cmdline) == 0) {
+        for (count = 0; count < MAX_SUPPORTED_SERVOS; count++) {
+            config = &masterConfig.servoOutputConf[count];
+            printf("servo %d %d %d %d\r\n", count, config->pwm_rate, config->lowpass_hz, config->slew_rate);
+        }
+        return;
+    }
+
+    pch = strtok(cmdline, " ");
+    while (pch != NULL && count < 4) {
+        args[count++] = atoi(pch);
+        pch = strtok(NULL, " ");
+    }
+
+    if (count != 4) {
+        printf("Usage:\r\nservo index rate lowpass_hz slew_rate, rate 0 uses servo_pwm_rate\r\n");
+        return;
+    }
+    if (args[0] < 0 || args[0] >= MAX_SUPPORTED_SERVOS) {
+        printf("No such servo, use a number [0, %d]\r\n", MAX_SUPPORTED_SERVOS - 1);
+        return;
+    }
+    if (args[1] != 0 && (args[1] < 50 || args[1] > 498)) {
+        printf("Invalid rate, 0 or 50..498\r\n");
+        return;
+    }
+    if (args[2] < 0 || args[2] > 500 || args[3] < 0 || args[3] > 255) {
+        printf("Invalid filter, lowpass_hz 0..500, slew_rate 0..255\r\n");
+        return;
+    }
+
+    config = &masterConfig.servoOutputConf[args[0]];
+    config->pwm_rate = args[1];
+    config->lowpass_hz = args[2];
+    config->slew_rate = args[3];
+}
+
 static void cliSet(char *cmdline)
 {
     uint32_t i;
@@ -1052,6 +1196,9 @@ static void cliStatus(char *cmdline)
 
     printf("System Uptime: %d seconds, Voltage: %d * 0.1V (%dS battery)\r\n",
         millis() / 1000, vbat, batteryCellCount);
+    if (feature(FEATURE_VBAT) && feature(FEATURE_CURRENT_METER)) {
+        printf("Resting voltage: %d * 0.1V, pack resistance: %d mOhm\r\n", vbatResting, batteryResistance);
+    }
     mask = sensorsMask();
 
     printf("CPU %dMHz, detected sensors: ", (SystemCoreClock / 1000000));
@@ -1068,7 +1215,39 @@ static void cliStatus(char *cmdline)
     }
     cliPrint("\r\n");
 
-    printf("Cycle Time: %d, I2C Errors: %d, config size: %d\r\n", cycleTime, i2cGetErrorCounter(), sizeof(master_t));
+    printf("GYROHW: %s", gyroNames[gyroHardware]);
+    if (gyroRedundancySourceCount() > 1) {
+        printf(", redundant %s, healthy gyros: %d", gyroNames[gyroSecondaryHardware], gyroRedundancyHealthySourceCount());
+    }
+    cliPrint("\r\n");
+
+    const pwmOutputConfiguration_t *pwmOutputConfiguration = pwmGetOutputConfiguration();
+    if (pwmOutputConfiguration->servoCount) {
+        printf("Servo rates:");
+        for (i = 0; i < pwmOutputConfiguration->outputCount; i++) {
+            if (pwmOutputConfiguration->outputs[i].type == PWM_OUTPUT_SERVO)
+                printf(" %dHz", pwmOutputConfiguration->outputs[i].rate);
+        }
+        cliPrint("\r\n");
+    }
+    if (pwmCountTimerConflicts(pwmOutputConfiguration)) {
+        printf("Timer conflicts: %d outputs share a timer at different rates\r\n", pwmCountTimerConflicts(pwmOutputConfiguration));
+    }
+
+    printf("Cycle Time: %d, I2C Errors: %d, config size: %d, serial buffers: %d of %d bytes\r\n",
+        cycleTime, i2cGetErrorCounter(), sizeof(master_t), serialBufferPoolUsed(), SERIAL_BUFFER_POOL_SIZE);
+
+    const linkQuality_t *linkQuality = getLinkQuality();
+    printf("Link quality: %d%%, rssi %d%%, frames %d%% of the last %d, %d lost\r\n",
+        linkQuality->linkQuality, linkQuality->rssi, linkQuality->frameQuality, LINK_QUALITY_WINDOW, linkQuality->lostFrames);
+
+    if (feature(FEATURE_RX_SERIAL) && (masterConfig.rxConfig.serialrx_provider == SERIALRX_SPEKTRUM1024 ||
+            masterConfig.rxConfig.serialrx_provider == SERIALRX_SPEKTRUM2048)) {
+        const spektrumStats_t *spektrumStats = spektrumGetStats();
+        printf("Spektrum: %d frames/s, %d fades/s, %d bad frames, %d sync losses, system 0x%02x\r\n",
+            spektrumStats->frameRate, spektrumStats->fadesPerSecond, spektrumStats->badFrames,
+            spektrumStats->syncLosses, spektrumStats->system);
+    }
 }
 
 static void cliVersion(char *cmdline)
@@ -1078,12 +1257,47 @@ static void cliVersion(char *cmdline)
     cliPrint("Cleanflight - " __DATE__ " / " __TIME__ " - (" __TARGET__ ")");
 }
 
+static void cliVibe(char *cmdline)
+{
+    uint8_t axis;
+
+    if (strcasecmp(cmdline, "reset") == 0) {
+        vibrationReset();
+        cliPrint("Vibration statistics reset\r\n");
+        return;
+    }
+
+    if (sensors(SENSOR_ACC)) {
+        printf("Acc RMS (mG):");
+        for (axis = 0; axis < XYZ_AXIS_COUNT; axis++)
+            printf(" %d", (uint32_t)vibrationRms(VIBRATION_SENSOR_ACC, axis) * 1000 / acc_1G);
+        printf(", peak:");
+        for (axis = 0; axis < XYZ_AXIS_COUNT; axis++)
+            printf(" %d", (uint32_t)vibrationPeak(VIBRATION_SENSOR_ACC, axis) * 1000 / acc_1G);
+        printf(", clipped: %d\r\n", vibrationClipCount(VIBRATION_SENSOR_ACC));
+    }
+
+    printf("Gyro RMS (deg/s):");
+    for (axis = 0; axis < XYZ_AXIS_COUNT; axis++)
+        printf(" %d", lrintf(vibrationRms(VIBRATION_SENSOR_GYRO, axis) * gyro.scale));
+    printf(", peak:");
+    for (axis = 0; axis < XYZ_AXIS_COUNT; axis++)
+        printf(" %d", lrintf(vibrationPeak(VIBRATION_SENSOR_GYRO, axis) * gyro.scale));
+    printf(", clipped: %d\r\n", vibrationClipCount(VIBRATION_SENSOR_GYRO));
+}
+
+
 void cliProcess(void)
 {
     if (!cliMode) {
         cliEnter();
     }
 
+    // a passthrough started from the CLI has its port until it ends
+    if (isSerialPortInPassthrough(cliPort)) {
+        return;
+    }
+
     while (serialTotalBytesWaiting(cliPort)) {
         uint8_t c = serialRead(cliPort);
         if (c == '\t' || c == '?') {
@@ -1158,7 +1372,7 @@ void cliProcess(void)
                 cliBuffer[--bufferIndex] = 0;
                 cliPrint("\010 \010");
             }
-        } else if (bufferIndex < sizeof(cliBuffer) && c >= 32 && c <= 126) {
+        } else if (bufferIndex < sizeof(cliBuffer) - 1 && c >= 32 && c <= 126) {
             if (!bufferIndex && c == 32)
                 continue;
             cliBuffer[bufferIndex++] = c;
@@ -37,15 +37,22 @@
 
 #include "flight/flight.h"
 #include "flight/mixer.h"
+#include "flight/thrust_linear.h"
+#include "flight/servo_output.h"
+#include "flight/mixer_stats.h"
 #include "flight/failsafe.h"
 #include "flight/navigation.h"
 #include "rx/rx.h"
 #include "rx/msp.h"
+#include "rx/rssi.h"
 #include "io/escservo.h"
 #include "io/rc_controls.h"
 #include "io/gps.h"
 #include "io/gimbal.h"
 #include "io/serial.h"
+#include "io/serial_passthrough.h"
+#include "io/flash_log.h"
+#include "io/flight_log.h"
 #include "telemetry/telemetry.h"
 #include "sensors/boardalignment.h"
 #include "sensors/sensors.h"
@@ -54,6 +61,9 @@
 #include "sensors/barometer.h"
 #include "sensors/compass.h"
 #include "sensors/gyro.h"
+#include "sensors/gyro_redundancy.h"
+#include "sensors/vibration.h"
+
 
 #include "config/runtime_config.h"
 #include "config/config.h"
@@ -64,10 +74,9 @@
 
 #include "serial_msp.h"
 
-static serialPort_t *mspPort;
+static serialConfig_t *serialConfig;
 
 extern uint16_t cycleTime; // FIXME dependency on mw.c
-extern uint16_t rssi; // FIXME dependency on mw.c
 extern int16_t debug[4]; // FIXME dependency on mw.c
 
 // Multiwii Serial Protocol 0
@@ -132,9 +141,20 @@ extern int16_t debug[4]; // FIXME dependency on mw.c
 #define MSP_ACC_TRIM             240    //out message         get acc angle trim values
 #define MSP_SET_ACC_TRIM         239    //in message          set acc angle trim values
 #define MSP_GPSSVINFO            164    //out message         get Signal Strength (only U-Blox)
+#define MSP_VIBRATION            165    //out message         acc and gyro vibration RMS, peak and clipped sample count
+#define MSP_MOTOR_STATS          166    //out message         motor upper/lower limit cycles and per axis authority lost to clipping
+#define MSP_MOTOR_HISTOGRAM      167    //out message         motor output histograms between min and max throttle
+#define MSP_LINK_QUALITY         168    //out message         link quality, smoothed rssi, frame quality and frame counts
+
+#define MSP_DATAFLASH_SUMMARY    70     //out message         state, sectors, log size, log bytes used and dropped
+#define MSP_DATAFLASH_READ       71     //out message         log bytes from the given offset
+#define MSP_DATAFLASH_ERASE      72     //in message          erase the log
 
 #define INBUF_SIZE 64
 
+#define MSP_DATAFLASH_READ_DEFAULT_SIZE 128
+#define MSP_DATAFLASH_READ_MAX_SIZE 192     // leaves room in the 256 byte transmit buffer
+
 #define ACTIVATE_MASK 0xFFF // see
 
 struct box_t {
@@ -186,46 +206,74 @@ static const char pidnames[] =
     "MAG;"
     "VEL;";
 
-static uint8_t checksum, indRX, inBuf[INBUF_SIZE];
-static uint8_t cmdMSP;
+typedef enum {
+    IDLE,
+    HEADER_START,
+    HEADER_M,
+    HEADER_ARROW,
+    HEADER_SIZE,
+    HEADER_CMD
+} mspState_e;
+
+// each MSP port parses its own frames, a command that arrives split over several loops on one port is not
+// disturbed by traffic on another
+typedef struct mspPort_s {
+    serialPort_t *port;
+    uint8_t offset;
+    uint8_t dataSize;
+    uint8_t checksum;
+    uint8_t indRX;
+    uint8_t inBuf[INBUF_SIZE];
+    mspState_e c_state;
+    uint8_t cmdMSP;
+    bool evaluatesOtherData;        // whether the reboot and CLI characters are looked for between frames
+} mspPort_t;
+
+#define MAX_MSP_PORT_COUNT 2
+
+static mspPort_t mspPorts[MAX_MSP_PORT_COUNT];
+static uint8_t mspPortCount;
+static uint8_t nextMspPortIndex;    // where the next mspProcess starts, after the port the budget ran out on
+
+static mspPort_t *currentPort;      // the port being answered
 
 void serialize32(uint32_t a)
 {
     static uint8_t t;
     t = a;
-    serialWrite(mspPort, t);
-    checksum ^= t;
+    serialWrite(currentPort->port, t);
+    currentPort->checksum ^= t;
     t = a >> 8;
-    serialWrite(mspPort, t);
-    checksum ^= t;
+    serialWrite(currentPort->port, t);
+    currentPort->checksum ^= t;
     t = a >> 16;
-    serialWrite(mspPort, t);
-    checksum ^= t;
+    serialWrite(currentPort->port, t);
+    currentPort->checksum ^= t;
     t = a >> 24;
-    serialWrite(mspPort, t);
-    checksum ^= t;
+    serialWrite(currentPort->port, t);
+    currentPort->checksum ^= t;
 }
 
 void serialize16(int16_t a)
 {
     static uint8_t t;
     t = a;
-    serialWrite(mspPort, t);
-    checksum ^= t;
+    serialWrite(currentPort->port, t);
+    currentPort->checksum ^= t;
     t = a >> 8 & 0xff;
-    serialWrite(mspPort, t);
-    checksum ^= t;
+    serialWrite(currentPort->port, t);
+    currentPort->checksum ^= t;
 }
 
 void serialize8(uint8_t a)
 {
-    serialWrite(mspPort, a);
-    checksum ^= a;
+    serialWrite(currentPort->port, a);
+    currentPort->checksum ^= a;
 }
 
 uint8_t read8(void)
 {
-    return inBuf[indRX++] & 0xff;
+    return currentPort->inBuf[currentPort->indRX++] & 0xff;
 }
 
 uint16_t read16(void)
@@ -247,9 +295,9 @@ void headSerialResponse(uint8_t err, uint8_t s)
     serialize8('$');
     serialize8('M');
     serialize8(err ? '!' : '>');
-    checksum = 0;               // start calculating a new checksum
+    currentPort->checksum = 0;  // start calculating a new checksum
     serialize8(s);
-    serialize8(cmdMSP);
+    serialize8(currentPort->cmdMSP);
 }
 
 void headSerialReply(uint8_t s)
@@ -264,7 +312,7 @@ void headSerialError(uint8_t s)
 
 void tailSerialReply(void)
 {
-    serialize8(checksum);
+    serialize8(currentPort->checksum);
 }
 
 void s_struct(uint8_t *cb, uint8_t siz)
@@ -309,11 +357,14 @@ reset:
 // This rate is chosen since softserial supports it.
 #define MSP_FALLBACK_BAUDRATE 19200
 
-static void openAllMSPSerialPorts(serialConfig_t *serialConfig)
+static void openAllMSPSerialPorts(void)
 {
     serialPort_t *port;
 
-    mspPort = NULL; // XXX delete this when adding support for MSP on more than one port.
+    memset(mspPorts, 0, sizeof(mspPorts));
+    mspPortCount = 0;
+    nextMspPortIndex = 0;
+
     do {
 
         uint32_t baudRate = serialConfig->msp_baudrate;
@@ -332,22 +383,21 @@ static void openAllMSPSerialPorts(serialConfig_t *serialConfig)
             }
         } while (!port);
 
-        // XXX delete this when adding support for MSP on more than one port.
-        if (port && !mspPort) {
-            mspPort = port; // just use the first one opened for now
+        if (port && mspPortCount < MAX_MSP_PORT_COUNT) {
+            // a telemetry radio on a second port must not be able to reboot the board or start the CLI
+            mspPorts[mspPortCount].evaluatesOtherData = mspPortCount == 0 || isSerialPortFunctionAllowed(port, FUNCTION_CLI);
+            mspPorts[mspPortCount++].port = port;
         }
 
     } while (port);
-
-    // XXX this function might help with adding support for MSP on more than one port, if not delete it.
-    const serialPortFunctionList_t *serialPortFunctionList = getSerialPortFunctionList();
-    UNUSED(serialPortFunctionList);
 }
 
-void mspInit(serialConfig_t *serialConfig)
+void mspInit(serialConfig_t *initialSerialConfig)
 {
     int idx;
 
+    serialConfig = initialSerialConfig;
+
     // calculate used boxes based on features and fill availableBoxes[] array
     memset(availableBoxes, 0xFF, sizeof(availableBoxes));
 
@@ -396,18 +446,19 @@ void mspInit(serialConfig_t *serialConfig)
 
     numberBoxItems = idx;
 
-    openAllMSPSerialPorts(serialConfig);
+    openAllMSPSerialPorts();
 }
 
 static void evaluateCommand(void)
 {
-    uint32_t i, tmp, junk;
+    uint32_t i, j, tmp, junk;
+
 #ifdef GPS
     uint8_t wp_no;
     int32_t lat = 0, lon = 0, alt = 0;
 #endif
 
-    switch (cmdMSP) {
+    switch (currentPort->cmdMSP) {
     case MSP_SET_RAW_RC:
         // FIXME need support for more than 8 channels
         for (i = 0; i < 8; i++)
@@ -826,6 +877,87 @@ static void evaluateCommand(void)
         serialize32(U_ID_1);
         serialize32(U_ID_2);
         break;
+    case MSP_VIBRATION:
+        headSerialReply(VIBRATION_SENSOR_COUNT * (XYZ_AXIS_COUNT * 2 * 2 + 4));
+        for (i = 0; i < VIBRATION_SENSOR_COUNT; i++) {
+            for (j = 0; j < XYZ_AXIS_COUNT; j++)
+                serialize16(vibrationRms((vibrationSensor_e)i, j));
+            for (j = 0; j < XYZ_AXIS_COUNT; j++)
+                serialize16(vibrationPeak((vibrationSensor_e)i, j));
+            serialize32(vibrationClipCount((vibrationSensor_e)i));
+        }
+        break;
+    case MSP_LINK_QUALITY:
+        headSerialReply(3 + 2 + 4 + 4);
+        serialize8(getLinkQuality()->linkQuality);
+        serialize8(getLinkQuality()->rssi);
+        serialize8(getLinkQuality()->frameQuality);
+        serialize16(getLinkQuality()->frameInterval);
+        serialize32(getLinkQuality()->validFrames);
+        serialize32(getLinkQuality()->lostFrames);
+        break;
+    case MSP_MOTOR_STATS:
+        tmp = mixerStatsMotorCount();
+        headSerialReply(1 + 4 + tmp * 8 + MIXER_STATS_AXIS_COUNT * 6);
+        serialize8(tmp);
+        serialize32(getMixerStats()->cycles);
+        for (i = 0; i < tmp; i++) {
+            serialize32(getMixerStats()->upperLimitCycles[i]);
+            serialize32(getMixerStats()->lowerLimitCycles[i]);
+        }
+        for (i = 0; i < MIXER_STATS_AXIS_COUNT; i++) {
+            serialize32(getMixerStats()->authorityLostCycles[i]);
+            serialize16(mixerStatsAverageAuthorityLost(i));
+        }
+        break;
+    case MSP_MOTOR_HISTOGRAM:
+        tmp = mixerStatsMotorCount();
+        headSerialReply(2 + tmp * MIXER_STATS_HISTOGRAM_BINS * 2);
+        serialize8(tmp);
+        serialize8(MIXER_STATS_HISTOGRAM_BINS);
+        for (i = 0; i < tmp; i++) {
+            for (j = 0; j < MIXER_STATS_HISTOGRAM_BINS; j++)
+                serialize16(getMixerStats()->histogram[i][j]);
+        }
+        break;
+
+#ifdef FLASH_LOG
+    case MSP_DATAFLASH_SUMMARY:
+        headSerialReply(1 + 4 * 4);
+        serialize8(flashLogGetState());
+        serialize32(flashLogSectorCount());
+        serialize32(flashLogTotalSize());
+        serialize32(flashLogUsedSize());
+        serialize32(flashLogDroppedBytes());
+        break;
+    case MSP_DATAFLASH_READ:
+        {
+            uint8_t data[MSP_DATAFLASH_READ_MAX_SIZE];
+            uint32_t address = read32();
+            uint16_t length = MSP_DATAFLASH_READ_DEFAULT_SIZE;
+
+            if (currentPort->dataSize >= 6) {
+                length = min(read16(), MSP_DATAFLASH_READ_MAX_SIZE);
+            }
+            // nothing comes back while the flash is busy, the reader asks again
+            length = flashLogRead(address, data, length);
+
+            headSerialReply(4 + length);
+            serialize32(address);
+            for (i = 0; i < length; i++)
+                serialize8(data[i]);
+        }
+        break;
+    case MSP_DATAFLASH_ERASE:
+        if (f.ARMED) {
+            headSerialError(0);
+        } else {
+            flashLogEraseAll();
+            headSerialReply(0);
+        }
+        break;
+#endif
+
 #ifdef GPS
     case MSP_GPSSVINFO:
         headSerialReply(1 + (GPS_numCh * 4));
@@ -845,56 +977,77 @@ static void evaluateCommand(void)
     tailSerialReply();
 }
 
+// returns true once a complete frame was answered
+static bool mspProcessReceivedData(mspPort_t *mspPort, uint8_t c)
+{
+    if (mspPort->c_state == IDLE) {
+        mspPort->c_state = (c == '$') ? HEADER_START : IDLE;
+        if (mspPort->c_state == IDLE && !f.ARMED && mspPort->evaluatesOtherData)
+            evaluateOtherData(c); // if not armed evaluate all other incoming serial data
+    } else if (mspPort->c_state == HEADER_START) {
+        mspPort->c_state = (c == 'M') ? HEADER_M : IDLE;
+    } else if (mspPort->c_state == HEADER_M) {
+        mspPort->c_state = (c == '<') ? HEADER_ARROW : IDLE;
+    } else if (mspPort->c_state == HEADER_ARROW) {
+        if (c > INBUF_SIZE) {       // now we are expecting the payload size
+            mspPort->c_state = IDLE;
+            return false;
+        }
+        mspPort->dataSize = c;
+        mspPort->offset = 0;
+        mspPort->checksum = 0;
+        mspPort->indRX = 0;
+        mspPort->checksum ^= c;
+        mspPort->c_state = HEADER_SIZE;      // the command is to follow
+    } else if (mspPort->c_state == HEADER_SIZE) {
+        mspPort->cmdMSP = c;
+        mspPort->checksum ^= c;
+        mspPort->c_state = HEADER_CMD;
+    } else if (mspPort->c_state == HEADER_CMD && mspPort->offset < mspPort->dataSize) {
+        mspPort->checksum ^= c;
+        mspPort->inBuf[mspPort->offset++] = c;
+    } else if (mspPort->c_state == HEADER_CMD && mspPort->offset >= mspPort->dataSize) {
+        mspPort->c_state = IDLE;
+        if (mspPort->checksum == c) {        // compare calculated and transferred checksum
+            currentPort = mspPort;
+            evaluateCommand();      // we got a valid packet, evaluate it
+            return true;
+        }
+    }
+    return false;
+}
+
+// Every port answers at most one command per round and the rounds go on until the ports have nothing left or
+// msp_time_budget is spent.  What is left waits in the receive buffers for the next loop, and the next loop
+// starts on the port after the one the budget ran out on, so a busy port cannot lock out the others.
 void mspProcess(void)
 {
-    uint8_t c;
-    static uint8_t offset;
-    static uint8_t dataSize;
-    static enum _serial_state {
-        IDLE,
-        HEADER_START,
-        HEADER_M,
-        HEADER_ARROW,
-        HEADER_SIZE,
-        HEADER_CMD,
-    } c_state = IDLE;
-
-    while (serialTotalBytesWaiting(mspPort)) {
-        c = serialRead(mspPort);
-
-        if (c_state == IDLE) {
-            c_state = (c == '$') ? HEADER_START : IDLE;
-            if (c_state == IDLE && !f.ARMED)
-                evaluateOtherData(c); // if not armed evaluate all other incoming serial data
-        } else if (c_state == HEADER_START) {
-            c_state = (c == 'M') ? HEADER_M : IDLE;
-        } else if (c_state == HEADER_M) {
-            c_state = (c == '<') ? HEADER_ARROW : IDLE;
-        } else if (c_state == HEADER_ARROW) {
-            if (c > INBUF_SIZE) {       // now we are expecting the payload size
-                c_state = IDLE;
-                continue;
+    uint32_t startedAt = micros();
+    uint8_t served;
+    uint8_t index;
+    bool answered;
+
+    do {
+        answered = false;
+
+        for (served = 0; served < mspPortCount; served++) {
+            index = (nextMspPortIndex + served) % mspPortCount;
+            mspPort_t *mspPort = &mspPorts[index];
+
+            // a port bridged by a passthrough is served again when it ends
+            while (!isSerialPortInPassthrough(mspPort->port) && serialTotalBytesWaiting(mspPort->port)) {
+                if (mspProcessReceivedData(mspPort, serialRead(mspPort->port))) {
+                    answered = true;
+                    break;
+                }
             }
-            dataSize = c;
-            offset = 0;
-            checksum = 0;
-            indRX = 0;
-            checksum ^= c;
-            c_state = HEADER_SIZE;      // the command is to follow
-        } else if (c_state == HEADER_SIZE) {
-            cmdMSP = c;
-            checksum ^= c;
-            c_state = HEADER_CMD;
-        } else if (c_state == HEADER_CMD && offset < dataSize) {
-            checksum ^= c;
-            inBuf[offset++] = c;
-        } else if (c_state == HEADER_CMD && offset >= dataSize) {
-            if (checksum == c) {        // compare calculated and transferred checksum
-                evaluateCommand();      // we got a valid packet, evaluate it
+
+            if (serialConfig->msp_time_budget && micros() - startedAt >= serialConfig->msp_time_budget) {
+                nextMspPortIndex = (index + 1) % mspPortCount;
+                return;
             }
-            c_state = IDLE;
         }
-    }
+    } while (answered);
 }
 
 static const uint8_t mspTelemetryCommandSequence[] = {
@@ -905,6 +1058,7 @@ static const uint8_t mspTelemetryCommandSequence[] = {
     MSP_ALTITUDE,
     MSP_RAW_GPS,
     MSP_RC,
+    MSP_LINK_QUALITY,
     MSP_MOTOR_PINS,
     MSP_ATTITUDE,
     MSP_SERVO
@@ -912,11 +1066,20 @@ static const uint8_t mspTelemetryCommandSequence[] = {
 
 #define MSP_TELEMETRY_COMMAND_SEQUENCE_ENTRY_COUNT (sizeof(mspTelemetryCommandSequence) / sizeof(mspTelemetryCommandSequence[0]))
 
+// telemetry goes out on the first MSP port with its own reply state, so a frame that is half received there is
+// not disturbed
 void sendMspTelemetry(void)
 {
+    static mspPort_t telemetryPort;
     static uint32_t sequenceIndex = 0;
 
-    cmdMSP = mspTelemetryCommandSequence[sequenceIndex];
+    if (!mspPortCount || isSerialPortInPassthrough(mspPorts[0].port)) {
+        return;
+    }
+
+    telemetryPort.port = mspPorts[0].port;
+    telemetryPort.cmdMSP = mspTelemetryCommandSequence[sequenceIndex];
+    currentPort = &telemetryPort;
     evaluateCommand();
 
     sequenceIndex++;
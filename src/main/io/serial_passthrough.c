@@ -0,0 +1,154 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "common/maths.h"
+
+#include "drivers/system.h"
+#include "drivers/serial.h"
+
+#include "serial_passthrough.h"
+
+static bool active;
+static serialPort_t *hostPort;
+static serialPort_t *devicePort;
+static uint32_t idleTimeoutMs;
+static serialPassthroughEndCallbackPtr endCallback;
+
+static uint32_t lastHostByteAt;
+static uint8_t escapeCount;
+
+static serialPassthroughStats_t stats;
+
+bool isSerialPassthroughActive(void)
+{
+    return active;
+}
+
+bool isSerialPortInPassthrough(const serialPort_t *port)
+{
+    return active && (port == hostPort || port == devicePort);
+}
+
+const serialPassthroughStats_t *serialPassthroughGetStats(void)
+{
+    return &stats;
+}
+
+bool serialPassthroughStart(serialPort_t *host, serialPort_t *device, uint32_t timeoutMs, serialPassthroughEndCallbackPtr callback)
+{
+    if (active || !host || !device) {
+        return false;
+    }
+
+    hostPort = host;
+    devicePort = device;
+    idleTimeoutMs = timeoutMs;
+    endCallback = callback;
+
+    lastHostByteAt = millis();
+    escapeCount = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    active = true;
+    return true;
+}
+
+static void serialPassthroughEnd(serialPassthroughEnd_e reason)
+{
+    active = false;
+    if (endCallback) {
+        endCallback(reason);
+    }
+}
+
+void serialPassthroughStop(void)
+{
+    if (active) {
+        serialPassthroughEnd(SERIAL_PASSTHROUGH_END_STOPPED);
+    }
+}
+
+static void watchForEscape(const uint8_t *data, uint8_t count, uint32_t now)
+{
+    while (count--) {
+        if (*(data++) == SERIAL_PASSTHROUGH_ESCAPE_CHARACTER && escapeCount < SERIAL_PASSTHROUGH_ESCAPE_LENGTH &&
+                (escapeCount > 0 || now - lastHostByteAt >= SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS)) {
+            escapeCount++;
+        } else {
+            escapeCount = 0;
+        }
+        lastHostByteAt = now;
+    }
+}
+
+// moves what fits without waiting, returns the bytes moved
+static uint32_t forward(serialPort_t *from, serialPort_t *to, bool fromHost, uint32_t now)
+{
+    uint8_t block[SERIAL_PASSTHROUGH_BLOCK_SIZE];
+    uint32_t moved = 0;
+
+    while (true) {
+        uint8_t waiting = serialTotalBytesWaiting(from);
+        uint8_t room = serialTotalTxFree(to);
+        uint8_t count = min(min(waiting, room), SERIAL_PASSTHROUGH_BLOCK_SIZE);
+        if (!count) {
+            break;
+        }
+
+        for (uint8_t i = 0; i < count; i++) {
+            block[i] = serialRead(from);
+        }
+        if (fromHost) {
+            watchForEscape(block, count, now);
+        }
+        serialWriteBuf(to, block, count);
+
+        moved += count;
+        stats.largestBlock = max(stats.largestBlock, count);
+    }
+    return moved;
+}
+
+void serialPassthroughUpdate(void)
+{
+    if (!active) {
+        return;
+    }
+
+    uint32_t now = millis();
+    stats.updates++;
+
+    stats.hostToDevice += forward(hostPort, devicePort, true, now);
+    stats.deviceToHost += forward(devicePort, hostPort, false, now);
+
+    uint32_t quietFor = now - lastHostByteAt;
+
+    if (escapeCount == SERIAL_PASSTHROUGH_ESCAPE_LENGTH && quietFor >= SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS) {
+        serialPassthroughEnd(SERIAL_PASSTHROUGH_END_ESCAPED);
+        return;
+    }
+
+    if (idleTimeoutMs && quietFor >= idleTimeoutMs) {
+        serialPassthroughEnd(SERIAL_PASSTHROUGH_END_TIMED_OUT);
+    }
+}
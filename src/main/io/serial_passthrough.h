@@ -0,0 +1,58 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Forwards everything received on one serial port to the other until it is stopped, an escape sequence is
+// received from the host side or the host side has been quiet for the idle timeout.  Bytes are moved in
+// blocks, as many as the receiving port has waiting and the sending port has room for, so nothing is
+// dropped by the firmware and the main loop carries on between updates.
+//
+// The escape sequence is three '+' with a second of silence from the host before and after it, as on a
+// modem; the '+' are forwarded like any other bytes.
+
+#define SERIAL_PASSTHROUGH_BLOCK_SIZE 32
+#define SERIAL_PASSTHROUGH_ESCAPE_CHARACTER '+'
+#define SERIAL_PASSTHROUGH_ESCAPE_LENGTH 3
+#define SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS 1000
+
+typedef enum {
+    SERIAL_PASSTHROUGH_END_STOPPED = 0,
+    SERIAL_PASSTHROUGH_END_ESCAPED,
+    SERIAL_PASSTHROUGH_END_TIMED_OUT,
+} serialPassthroughEnd_e;
+
+typedef void (*serialPassthroughEndCallbackPtr)(serialPassthroughEnd_e reason);
+
+typedef struct serialPassthroughStats_s {
+    uint32_t hostToDevice;
+    uint32_t deviceToHost;
+    uint32_t updates;
+    uint8_t largestBlock;
+} serialPassthroughStats_t;
+
+// Returns false if a passthrough is already running.  An idle timeout of 0 never times out, the callback,
+// which may be NULL, is called once when the passthrough ends.
+bool serialPassthroughStart(serialPort_t *hostPort, serialPort_t *devicePort, uint32_t idleTimeoutMs, serialPassthroughEndCallbackPtr endCallback);
+void serialPassthroughStop(void);
+// call from the main loop, as often as it runs
+void serialPassthroughUpdate(void);
+
+bool isSerialPassthroughActive(void);
+// the host and device ports belong to the passthrough while it runs, MSP and the CLI leave them alone
+bool isSerialPortInPassthrough(const serialPort_t *port);
+const serialPassthroughStats_t *serialPassthroughGetStats(void);
@@ -25,12 +25,15 @@
 #include "drivers/light_led.h"
 #include "drivers/sound_beeper.h"
 
+#include "io/beeper.h"
+
 #include "statusindicator.h"
 
 void blinkLedAndSoundBeeper(uint8_t num, uint8_t wait, uint8_t repeat)
 {
     uint8_t i, r;
 
+    beeperPause();
     for (r = 0; r < repeat; r++) {
         for (i = 0; i < num; i++) {
             LED0_TOGGLE;            // switch LEDPIN state
@@ -40,6 +43,7 @@ void blinkLedAndSoundBeeper(uint8_t num, uint8_t wait, uint8_t repeat)
         }
         delay(60);
     }
+    beeperResume();
 }
 
 
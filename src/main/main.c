@@ -37,9 +37,12 @@
 #include "drivers/pwm_mapping.h"
 #include "drivers/pwm_rx.h"
 #include "drivers/adc.h"
+#include "drivers/bus_spi.h"
 
 #include "flight/flight.h"
 #include "flight/mixer.h"
+#include "flight/thrust_linear.h"
+#include "flight/servo_output.h"
 
 #include "io/serial.h"
 #include "flight/failsafe.h"
@@ -50,12 +53,17 @@
 #include "io/escservo.h"
 #include "io/rc_controls.h"
 #include "io/gimbal.h"
+#include "io/flash_log.h"
+#include "io/flight_log.h"
 #include "sensors/sensors.h"
 #include "sensors/sonar.h"
 #include "sensors/barometer.h"
 #include "sensors/compass.h"
 #include "sensors/acceleration.h"
 #include "sensors/gyro.h"
+#include "sensors/gyro_redundancy.h"
+#include "sensors/vibration.h"
+
 #include "telemetry/telemetry.h"
 #include "sensors/battery.h"
 #include "sensors/boardalignment.h"
@@ -88,7 +96,7 @@ void rxInit(rxConfig_t *rxConfig, failsafe_t *failsafe);
 void beepcodeInit(failsafe_t *initialFailsafe);
 void gpsInit(serialConfig_t *serialConfig, gpsConfig_t *initialGpsConfig);
 void navigationInit(gpsProfile_t *initialGpsProfile, pidProfile_t *pidProfile);
-bool sensorsAutodetect(sensorAlignmentConfig_t *sensorAlignmentConfig, uint16_t gyroLpf, uint8_t accHardwareToUse, int16_t magDeclinationFromConfig);
+bool sensorsAutodetect(sensorAlignmentConfig_t *sensorAlignmentConfig, uint16_t gyroLpf, uint8_t accHardwareToUse, int16_t magDeclinationFromConfig, bool detectRedundantGyro);
 void imuInit(void);
 void ledStripInit(void);
 
@@ -142,7 +150,7 @@ void init(void)
     // We have these sensors; SENSORS_SET defined in board.h depending on hardware platform
     sensorsSet(SENSORS_SET);
     // drop out any sensors that don't seem to work, init all the others. halt if gyro is dead.
-    sensorsOK = sensorsAutodetect(&masterConfig.sensorAlignmentConfig, masterConfig.gyro_lpf, masterConfig.acc_hardware, currentProfile.mag_declination);
+    sensorsOK = sensorsAutodetect(&masterConfig.sensorAlignmentConfig, masterConfig.gyro_lpf, masterConfig.acc_hardware, currentProfile.mag_declination, masterConfig.gyroRedundancyConfig.gyro_redundancy);
 
     // production debug output
 #ifdef PROD_DEBUG
@@ -199,7 +207,10 @@ void init(void)
     pwm_params.useServos = isMixerUsingServos();
     pwm_params.extraServos = currentProfile.gimbalConfig.gimbal_flags & GIMBAL_FORWARDAUX;
     pwm_params.motorPwmRate = masterConfig.motor_pwm_rate;
+    pwm_params.brushedMotorDithering = masterConfig.motor_pwm_dither;
     pwm_params.servoPwmRate = masterConfig.servo_pwm_rate;
+    for (i = 0; i < MAX_PWM_SERVOS; i++)
+        pwm_params.servoPwmRates[i] = masterConfig.servoOutputConf[i].pwm_rate;
     pwm_params.idlePulse = PULSE_1MS; // standard PWM for brushless ESC (default, overridden below)
     if (feature(FEATURE_3D))
         pwm_params.idlePulse = masterConfig.flight3DConfig.neutral3d;
@@ -248,6 +259,12 @@ void init(void)
         initTelemetry();
 #endif
 
+#ifdef FLASH_LOG
+    if (spiInit(M25P16_SPI_INSTANCE)) {
+        flashLogInit();
+    }
+#endif
+
     previousTime = micros();
 
     if (masterConfig.mixerConfiguration == MULTITYPE_GIMBAL) {
@@ -265,9 +282,15 @@ void init(void)
     // FIXME this is a hack, perhaps add a FUNCTION_LOOPBACK to support it properly
     loopbackPort = (serialPort_t*)&(softSerialPorts[0]);
     if (!loopbackPort->vTable) {
-        loopbackPort = openSoftSerial(0, NULL, 19200, SERIAL_NOT_INVERTED);
+        serialBuffers_t loopbackBuffers;
+        loopbackPort = NULL;
+        if (serialAllocateBuffers(&loopbackBuffers, 64, 64)) {
+            loopbackPort = openSoftSerial(0, NULL, 19200, SERIAL_NOT_INVERTED, &loopbackBuffers);
+        }
+    }
+    if (loopbackPort) {
+        serialPrint(loopbackPort, "LOOPBACK\r\n");
     }
-    serialPrint(loopbackPort, "LOOPBACK\r\n");
 #endif
 
     // Now that everything has powered up the voltage and cell count be determined.
@@ -42,6 +42,8 @@
 #include "sensors/acceleration.h"
 #include "sensors/barometer.h"
 #include "sensors/gyro.h"
+#include "sensors/gyro_redundancy.h"
+#include "sensors/vibration.h"
 #include "sensors/battery.h"
 #include "io/beeper.h"
 #include "io/escservo.h"
@@ -50,14 +52,20 @@
 #include "flight/imu.h"
 #include "flight/autotune.h"
 #include "flight/mixer.h"
+#include "flight/thrust_linear.h"
+#include "flight/servo_output.h"
 #include "flight/navigation.h"
 #include "io/gimbal.h"
+#include "io/flash_log.h"
+#include "io/flight_log.h"
 #include "io/gps.h"
 #include "io/ledstrip.h"
 #include "io/serial_cli.h"
+#include "io/serial_passthrough.h"
 #include "io/serial.h"
 #include "io/statusindicator.h"
 #include "rx/rx.h"
+#include "rx/rssi.h"
 #include "io/rc_controls.h"
 #include "io/rc_curves.h"
 #include "rx/msp.h"
@@ -229,12 +237,18 @@ void annexCode(void)
 
         	if (feature(FEATURE_VBAT)) {
         		updateBatteryVoltage();
-                batteryWarningEnabled = shouldSoundBatteryAlarm();
         	}
 
         	if (feature(FEATURE_CURRENT_METER)) {
         		updateCurrentMeter(vbatCycleTime);
         	}
+
+            if (feature(FEATURE_VBAT)) {
+                if (feature(FEATURE_CURRENT_METER)) {
+                    updateBatteryLoadEstimate();
+                }
+                batteryWarningEnabled = shouldSoundBatteryAlarm();
+            }
         	vbatCycleTime = 0;
         }
     }
@@ -242,7 +256,13 @@ void annexCode(void)
     beepcodeUpdateState(batteryWarningEnabled);
 
     if (f.ARMED) {
-        LED0_ON;
+        if (isVibrationWarningActive()) {
+            enableWarningLed(currentTime);
+            updateWarningLed(currentTime);
+        } else {
+            disableWarningLed();
+            LED0_ON;
+        }
     } else {
         if (isCalibrating()) {
             LED0_TOGGLE;
@@ -259,7 +279,7 @@ void annexCode(void)
             f.OK_TO_ARM = 0;
         }
 
-        if (f.OK_TO_ARM) {
+        if (f.OK_TO_ARM && !isVibrationWarningActive()) {
             disableWarningLed();
         } else {
             enableWarningLed(currentTime);
@@ -436,7 +456,7 @@ void processRx(void)
     int i;
     uint32_t auxState = 0;
 
-    calculateRxChannelsAndUpdateFailsafe(currentTime);
+    calculateRxChannels(currentTime);
 
     // in 3D mode, we need to be able to disarm by switch at any time
     if (feature(FEATURE_3D)) {
@@ -452,7 +472,7 @@ void processRx(void)
             failsafe->vTable->enable();
         }
 
-        failsafe->vTable->updateState();
+        failsafe->vTable->updateState(currentTime);
     }
 
     throttleStatus_e throttleStatus = calculateThrottleStatus(&masterConfig.rxConfig, masterConfig.flight3DConfig.deadband3d_throttle);
@@ -462,7 +482,7 @@ void processRx(void)
         resetErrorGyro();
     }
 
-    processRcStickPositions(&masterConfig.rxConfig, throttleStatus, currentProfile.activate, masterConfig.retarded_arm);
+    processRcStickPositions(&masterConfig.rxConfig, &masterConfig.stickCommandConfig, throttleStatus, currentProfile.activate, masterConfig.retarded_arm, currentTime);
 
     if (feature(FEATURE_INFLIGHT_ACC_CAL)) {
         updateInflightCalibrationState();
@@ -490,7 +510,7 @@ void processRx(void)
     for (i = 0; i < CHECKBOX_ITEM_COUNT; i++)
         rcOptions[i] = (auxState & currentProfile.activate[i]) > 0;
 
-    if ((rcOptions[BOXANGLE] || (feature(FEATURE_FAILSAFE) && failsafe->vTable->hasTimerElapsed())) && (sensors(SENSOR_ACC))) {
+    if ((rcOptions[BOXANGLE] || (feature(FEATURE_FAILSAFE) && failsafe->vTable->shouldForceLevel())) && (sensors(SENSOR_ACC))) {
         // bumpless transfer to Level mode
         if (!f.ANGLE_MODE) {
             resetErrorAngle();
@@ -563,7 +583,7 @@ void loop(void)
     static bool haveProcessedAnnexCodeOnce = false;
 #endif
 
-    updateRx();
+    updateRx(currentTime);
 
     if (shouldProcessRx(currentTime)) {
         processRx();
@@ -639,6 +659,10 @@ void loop(void)
         mixTable();
         writeServos();
         writeMotors();
+
+#ifdef FLASH_LOG
+        flightLogUpdate(currentTime);
+#endif
     }
 
 #ifdef TELEMETRY
@@ -652,4 +676,10 @@ void loop(void)
         updateLedStrip();
     }
 #endif
+
+    serialPassthroughUpdate();
+
+#ifdef FLASH_LOG
+    flashLogUpdate();
+#endif
 }
@@ -0,0 +1,237 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "common/maths.h"
+
+#include "config/config.h"
+
+#include "drivers/adc.h"
+
+#include "rx/rx.h"
+#include "rx/rssi.h"
+
+// The frame quality is the share of the last LINK_QUALITY_WINDOW frame slots that held a valid frame.  A slot is
+// a frame that arrived, valid or reported lost by the receiver, or a frame interval that passed without one.  The
+// slots are a grid locked to the frames as they arrive: the interval starts as the mean of the first gaps, then
+// each frame pulls the grid a quarter of the way to it and the interval a little way.  A frame the main loop sees
+// late is still nearest its own slot, a slot more than half an interval past due with no frame is missing.
+//
+// RSSI from a channel or the ADC is smoothed with a first order filter over about eight samples.  The link quality
+// is the lower of the RSSI and the frame quality: the RSSI falls ahead of frame loss, interference loses frames at
+// a good RSSI.
+
+#define RSSI_MAX 1023
+#define RSSI_FILTER_SHIFT 3                 // an eighth of the difference per sample
+#define RSSI_FRACTION_BITS 8
+
+#define FRAME_INTERVAL_MIN 1000
+#define FRAME_INTERVAL_MAX 50000            // 20Hz
+#define FRAME_INTERVAL_LEARN_GAPS 8
+#define FRAME_PHASE_SHIFT 2                 // a quarter of the error per frame into the grid
+#define FRAME_INTERVAL_SHIFT 5              // and a 32nd into the interval
+
+uint16_t rssi;                  // range: [0;1023]
+
+static rxConfig_t *rxConfig;
+
+static linkQuality_t linkQuality;
+
+static uint64_t frameHistory;               // a bit per slot, set for a valid frame, the newest in bit 0
+static uint8_t frameSlots;                  // slots in the history so far, up to LINK_QUALITY_WINDOW
+static bool frameSeen;
+static uint32_t lastFrameAt;
+static uint32_t slotAt;                     // when the slot of the last frame was due
+static uint32_t slotsMissedSinceFrame;      // already counted while waiting for the next frame
+static uint32_t learnGapSum;
+static uint8_t learnGaps;
+
+static uint32_t rssiFiltered;               // [0;1023] << RSSI_FRACTION_BITS
+static bool rssiFilterPrimed;
+
+void rssiInit(rxConfig_t *rxConfigToUse)
+{
+    rxConfig = rxConfigToUse;
+
+    memset(&linkQuality, 0, sizeof(linkQuality));
+    frameHistory = 0;
+    frameSlots = 0;
+    frameSeen = false;
+    slotsMissedSinceFrame = 0;
+    learnGapSum = 0;
+    learnGaps = 0;
+    rssiFilterPrimed = false;
+    rssi = 0;
+}
+
+static void recordSlots(uint32_t count, bool valid)
+{
+    if (count >= LINK_QUALITY_WINDOW) {
+        frameHistory = valid ? ~0ULL : 0;
+        frameSlots = LINK_QUALITY_WINDOW;
+    } else {
+        frameHistory <<= count;
+        if (valid) {
+            frameHistory |= (1ULL << count) - 1;
+        }
+        frameSlots = min(frameSlots + count, LINK_QUALITY_WINDOW);
+    }
+
+    if (valid) {
+        linkQuality.validFrames += count;
+    } else {
+        linkQuality.lostFrames += count;
+    }
+    linkQuality.frameQuality = __builtin_popcountll(frameHistory) * 100 / frameSlots;
+}
+
+// counts the slots that have passed since the last frame while waiting, the rest of them when the next frame arrives
+static void recordMissedSlots(uint32_t currentTime)
+{
+    int32_t interval = linkQuality.frameInterval;
+    int32_t sinceSlot = currentTime - slotAt;     // a frame can arrive ahead of its slot
+    uint32_t missed;
+
+    if (learnGaps < FRAME_INTERVAL_LEARN_GAPS || sinceSlot < interval + interval / 2) {
+        return;
+    }
+
+    missed = (sinceSlot + interval / 2) / interval - 1;
+    if (missed > slotsMissedSinceFrame) {
+        recordSlots(missed - slotsMissedSinceFrame, false);
+        slotsMissedSinceFrame = missed;
+    }
+}
+
+static void trackFrameSlot(uint32_t currentTime)
+{
+    int32_t interval = linkQuality.frameInterval;
+    uint32_t gap = currentTime - lastFrameAt;
+    int32_t slot;
+    int32_t error;
+
+    if (gap == 0) {
+        // frames the receiver reports lost along with this one
+        return;
+    }
+
+    if (learnGaps < FRAME_INTERVAL_LEARN_GAPS) {
+        learnGapSum += min(gap, FRAME_INTERVAL_MAX);
+        if (++learnGaps == FRAME_INTERVAL_LEARN_GAPS) {
+            linkQuality.frameInterval = max(learnGapSum / FRAME_INTERVAL_LEARN_GAPS, FRAME_INTERVAL_MIN);
+        }
+        slotAt = currentTime;
+        return;
+    }
+
+    slot = max(((int32_t)(currentTime - slotAt) + interval / 2) / interval, 1);
+    error = currentTime - (slotAt + slot * interval);
+
+    slotAt += slot * interval + error / (1 << FRAME_PHASE_SHIFT);
+    linkQuality.frameInterval = constrain(interval + error / (int32_t)(slot << FRAME_INTERVAL_SHIFT), FRAME_INTERVAL_MIN, FRAME_INTERVAL_MAX);
+}
+
+static void recordFrames(uint32_t currentTime, uint8_t count, bool valid)
+{
+    if (frameSeen) {
+        recordMissedSlots(currentTime);
+        trackFrameSlot(currentTime);
+    } else {
+        slotAt = currentTime;
+    }
+    frameSeen = true;
+    lastFrameAt = currentTime;
+    slotsMissedSinceFrame = 0;
+
+    recordSlots(count, valid);
+}
+
+void rssiFrameReceived(uint32_t currentTime)
+{
+    recordFrames(currentTime, 1, true);
+}
+
+/*
+ * Frames that arrived marked as lost, or a count of frames the receiver reports it lost since the last one.  They
+ * take the slots of frames that arrived, the frame interval keeps running from them.
+ */
+void rssiFramesLost(uint32_t currentTime, uint8_t count)
+{
+    if (!count) {
+        return;
+    }
+    recordFrames(currentTime, count, false);
+}
+
+static bool readRssiSample(uint16_t *sample)
+{
+    if (rxConfig->rssi_channel > 0) {
+        // [1000;2000] from the receiver
+        *sample = constrain(rcData[rxConfig->rssi_channel - 1] - 1000, 0, 1000) * RSSI_MAX / 1000;
+        return true;
+    }
+    if (feature(FEATURE_RSSI_ADC)) {
+        *sample = adcGetChannel(ADC_RSSI) >> 2;     // 12 bits
+        return true;
+    }
+    return false;
+}
+
+/*
+ * At frame rate, or at 50Hz while frames are not arriving.
+ */
+void updateRSSI(uint32_t currentTime)
+{
+    uint16_t sample;
+
+    if (frameSeen) {
+        recordMissedSlots(currentTime);
+    }
+
+    if (!readRssiSample(&sample)) {
+        linkQuality.rssi = 0;
+        linkQuality.linkQuality = linkQuality.frameQuality;
+        rssi = linkQuality.linkQuality * RSSI_MAX / 100;
+        return;
+    }
+
+    if (!rssiFilterPrimed) {
+        rssiFiltered = (uint32_t)sample << RSSI_FRACTION_BITS;
+        rssiFilterPrimed = true;
+    } else {
+        rssiFiltered += (((int32_t)sample << RSSI_FRACTION_BITS) - (int32_t)rssiFiltered) / (1 << RSSI_FILTER_SHIFT);
+    }
+    rssi = (rssiFiltered + (1 << (RSSI_FRACTION_BITS - 1))) >> RSSI_FRACTION_BITS;
+
+    linkQuality.rssi = (rssi * 100 + RSSI_MAX / 2) / RSSI_MAX;
+    linkQuality.linkQuality = min(linkQuality.rssi, linkQuality.frameQuality);
+}
+
+const linkQuality_t *getLinkQuality(void)
+{
+    return &linkQuality;
+}
+
+bool isLinkQualityLow(void)
+{
+    return linkQuality.linkQuality < LINK_QUALITY_WARNING;
+}
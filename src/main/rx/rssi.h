@@ -0,0 +1,41 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define LINK_QUALITY_WINDOW 64              // frame slots the frame quality is taken over
+#define LINK_QUALITY_WARNING 50             // percent, below it the link is reported as low
+
+typedef struct linkQuality_s {
+    uint8_t linkQuality;                    // percent, the lower of the RSSI and the frame quality
+    uint8_t rssi;                           // percent, smoothed, 0 without an RSSI source
+    uint8_t frameQuality;                   // percent of the last LINK_QUALITY_WINDOW frame slots with a valid frame
+    uint16_t frameInterval;                 // microseconds, learnt from the gaps between frames
+    uint32_t validFrames;
+    uint32_t lostFrames;                    // reported lost by the receiver or never arrived
+} linkQuality_t;
+
+extern uint16_t rssi;                       // range: [0;1023], the RSSI or without an RSSI source the link quality
+
+void rssiInit(rxConfig_t *rxConfig);
+
+void rssiFrameReceived(uint32_t currentTime);
+void rssiFramesLost(uint32_t currentTime, uint8_t count);
+void updateRSSI(uint32_t currentTime);
+
+const linkQuality_t *getLinkQuality(void);
+bool isLinkQualityLow(void);
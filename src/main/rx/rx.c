@@ -43,6 +43,7 @@
 #include "rx/msp.h"
 
 #include "rx/rx.h"
+#include "rx/rssi.h"
 
 extern int16_t debug[4];
 
@@ -56,8 +57,6 @@ bool rxMspInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadR
 
 const char rcChannelLetters[] = "AERT1234";
 
-uint16_t rssi;                  // range: [0;1023]
-
 int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];     // interval [1000;2000]
 
 #define PPM_AND_PWM_SAMPLE_COUNT 4
@@ -110,6 +109,8 @@ void rxInit(rxConfig_t *rxConfig, failsafe_t *initialFailsafe)
 
     failsafe = initialFailsafe;
 
+    rssiInit(rxConfig);
+
 #ifdef SERIAL_RX
     if (feature(FEATURE_RX_SERIAL)) {
         serialRxInit(rxConfig);
@@ -126,9 +127,13 @@ void rxInit(rxConfig_t *rxConfig, failsafe_t *initialFailsafe)
 }
 
 #ifdef SERIAL_RX
+static uint32_t serialRxLostFrames;
+
 void serialRxInit(rxConfig_t *rxConfig)
 {
     bool enabled = false;
+
+    serialRxLostFrames = 0;
     switch (rxConfig->serialrx_provider) {
         case SERIALRX_SPEKTRUM1024:
         case SERIALRX_SPEKTRUM2048:
@@ -161,6 +166,40 @@ bool isSerialRxFrameComplete(rxConfig_t *rxConfig)
     }
     return false;
 }
+
+static bool isSerialRxFailsafeIndicated(rxConfig_t *rxConfig)
+{
+    switch (rxConfig->serialrx_provider) {
+        case SERIALRX_SBUS:
+            return sbusFailsafeIndicated();
+        case SERIALRX_SUMD:
+            return sumdFailsafeIndicated();
+    }
+    return false;
+}
+
+// frames the receiver sent marked as lost, for Spektrum the frames the satellite counts as faded
+static uint32_t serialRxLostFrameCount(rxConfig_t *rxConfig)
+{
+    switch (rxConfig->serialrx_provider) {
+        case SERIALRX_SPEKTRUM1024:
+        case SERIALRX_SPEKTRUM2048:
+            return spektrumGetStats()->fades;
+        case SERIALRX_SBUS:
+            return sbusLostFrameCount();
+        case SERIALRX_SUMD:
+            return sumdLostFrameCount();
+    }
+    return 0;
+}
+
+static void updateSerialRxLostFrames(uint32_t currentTime)
+{
+    uint32_t lostFrameCount = serialRxLostFrameCount(rxConfig);
+
+    rssiFramesLost(currentTime, min(lostFrameCount - serialRxLostFrames, LINK_QUALITY_WINDOW));
+    serialRxLostFrames = lostFrameCount;
+}
 #endif
 
 uint8_t calculateChannelRemapping(uint8_t *channelMap, uint8_t channelMapEntryCount, uint8_t channelToRemap)
@@ -174,8 +213,38 @@ uint8_t calculateChannelRemapping(uint8_t *channelMap, uint8_t channelMapEntryCo
 static bool rcDataReceived = false;
 static uint32_t rxUpdateAt = 0;
 
+/*
+ * A new PPM frame, or a new pulse on every parallel PWM input.
+ */
+static bool isPwmFrameReceived(void)
+{
+    if (!rcReadRawFunc || !isPWMDataBeingReceived()) {
+        return false;
+    }
+    resetPWMDataReceivedState();
+    return true;
+}
+
+/*
+ * Every channel the receiver sends inside the failsafe limits.  Receivers that stop sending on signal loss leave
+ * a gap, ones that send their own failsafe values send pulses outside the limits.
+ */
+static bool isPwmDataValid(void)
+{
+    uint8_t chan;
+
+    for (chan = 0; chan < rxRuntimeConfig.channelCount; chan++) {
+        uint16_t pulse = rcReadRawFunc(&rxRuntimeConfig, chan);
 
-void updateRx(void)
+        // channels past the end of the PPM frame and PWM inputs with nothing on them read 0
+        if (pulse != 0 && !failsafe->vTable->checkPulse(pulse)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void updateRx(uint32_t currentTime)
 {
     rcDataReceived = false;
 
@@ -183,6 +252,11 @@ void updateRx(void)
     // calculate rc stuff from serial-based receivers (spek/sbus)
     if (feature(FEATURE_RX_SERIAL)) {
         rcDataReceived = isSerialRxFrameComplete(rxConfig);
+        updateSerialRxLostFrames(currentTime);
+
+        if (feature(FEATURE_FAILSAFE) && isSerialRxFailsafeIndicated(rxConfig)) {
+            failsafe->vTable->onFailsafeIndicated();
+        }
     }
 #endif
 
@@ -190,16 +264,32 @@ void updateRx(void)
         rcDataReceived = rxMspFrameComplete();
     }
 
-    if (rcDataReceived) {
-        if (feature(FEATURE_FAILSAFE)) {
-            failsafe->vTable->reset();
+    if (feature(FEATURE_RX_PPM | FEATURE_RX_PARALLEL_PWM)) {
+        if (!isPwmFrameReceived()) {
+            return;
+        }
+        if (!isPwmDataValid()) {
+            rssiFramesLost(currentTime, 1);
+            return;
         }
+    } else if (!rcDataReceived) {
+        return;
+    }
+
+    rssiFrameReceived(currentTime);
+
+    if (feature(FEATURE_FAILSAFE)) {
+        failsafe->vTable->onValidDataReceived(currentTime);
     }
 }
 
 bool shouldProcessRx(uint32_t currentTime)
 {
-    return rcDataReceived || ((int32_t)(currentTime - rxUpdateAt) >= 0); // data driven or 50Hz
+    if (rcDataReceived || ((int32_t)(currentTime - rxUpdateAt) >= 0)) { // data driven or 50Hz
+        return true;
+    }
+    // a failsafe stage is acted on as soon as it is reached
+    return feature(FEATURE_FAILSAFE) && failsafe->vTable->isUpdateDue(currentTime);
 }
 
 static bool isRxDataDriven(void) {
@@ -240,13 +330,6 @@ void processRxChannels(void)
 {
     uint8_t chan;
 
-    bool shouldCheckPulse = true;
-
-    if (feature(FEATURE_FAILSAFE | FEATURE_RX_PPM)) {
-        shouldCheckPulse = isPPMDataBeingReceived();
-        resetPPMDataReceivedState();
-    }
-
     for (chan = 0; chan < rxRuntimeConfig.channelCount; chan++) {
 
         if (!rcReadRawFunc) {
@@ -259,10 +342,6 @@ void processRxChannels(void)
         // sample the channel
         uint16_t sample = rcReadRawFunc(&rxRuntimeConfig, rawChannel);
 
-        if (feature(FEATURE_FAILSAFE) && shouldCheckPulse) {
-            failsafe->vTable->checkPulse(rawChannel, sample);
-        }
-
         // validate the range
         if (sample < PULSE_MIN || sample > PULSE_MAX)
             sample = rxConfig->midrc;
@@ -281,8 +360,6 @@ void processDataDrivenRx(void)
         return;
     }
 
-    failsafe->vTable->reset();
-
     processRxChannels();
 
     rcDataReceived = false;
@@ -295,14 +372,10 @@ void processNonDataDrivenRx(void)
     processRxChannels();
 }
 
-void calculateRxChannelsAndUpdateFailsafe(uint32_t currentTime)
+void calculateRxChannels(uint32_t currentTime)
 {
     rxUpdateAt = currentTime + DELAY_50_HZ;
 
-    if (feature(FEATURE_FAILSAFE)) {
-        failsafe->vTable->incrementCounter();
-    }
-
     if (isRxDataDriven()) {
         processDataDrivenRx();
     } else {
@@ -320,59 +393,3 @@ void parseRcChannels(const char *input, rxConfig_t *rxConfig)
             rxConfig->rcmap[s - rcChannelLetters] = c - input;
     }
 }
-
-void updateRSSIPWM(void)
-{
-    int16_t pwmRssi = 0;
-    // Read value of AUX channel as rssi
-    pwmRssi = rcData[rxConfig->rssi_channel - 1];
-
-
-    // Range of rawPwmRssi is [1000;2000]. rssi should be in [0;1023];
-    rssi = (uint16_t)((constrain(pwmRssi - 1000, 0, 1000) / 1000.0f) * 1023.0f);
-}
-
-#define RSSI_ADC_SAMPLE_COUNT 16
-#define RSSI_SCALE (0xFFF / 100.0f)
-
-void updateRSSIADC(uint32_t currentTime)
-{
-    static uint8_t adcRssiSamples[RSSI_ADC_SAMPLE_COUNT];
-    static uint8_t adcRssiSampleIndex = 0;
-    static uint32_t rssiUpdateAt = 0;
-
-    if ((int32_t)(currentTime - rssiUpdateAt) < 0) {
-        return;
-    }
-    rssiUpdateAt = currentTime + DELAY_50_HZ;
-
-    int16_t adcRssiMean = 0;
-    uint16_t adcRssiSample = adcGetChannel(ADC_RSSI);
-    uint8_t rssiPercentage = adcRssiSample / RSSI_SCALE;
-
-    adcRssiSampleIndex = (adcRssiSampleIndex + 1) % RSSI_ADC_SAMPLE_COUNT;
-
-    adcRssiSamples[adcRssiSampleIndex] = rssiPercentage;
-
-    uint8_t sampleIndex;
-
-    for (sampleIndex = 0; sampleIndex < RSSI_ADC_SAMPLE_COUNT; sampleIndex++) {
-        adcRssiMean += adcRssiSamples[sampleIndex];
-    }
-
-    adcRssiMean = adcRssiMean / RSSI_ADC_SAMPLE_COUNT;
-
-    rssi = (uint16_t)((constrain(adcRssiMean, 0, 100) / 100.0f) * 1023.0f);
-}
-
-void updateRSSI(uint32_t currentTime)
-{
-
-    if (rxConfig->rssi_channel > 0) {
-        updateRSSIPWM();
-    } else if (feature(FEATURE_RSSI_ADC)) {
-        updateRSSIADC(currentTime);
-    }
-}
-
-
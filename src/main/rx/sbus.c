@@ -42,7 +42,12 @@
 
 #define SBUS_BAUDRATE 100000
 
+#define SBUS_FLAG_FRAME_LOST (1 << 2)
+#define SBUS_FLAG_FAILSAFE_ACTIVE (1 << 3)
+
 static bool sbusFrameDone = false;
+static bool sbusFailsafe = false;
+static uint32_t sbusLostFrames = 0;         // sent in failsafe or marked lost by the receiver
 static void sbusDataReceive(uint16_t c);
 static uint16_t sbusReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan);
 
@@ -61,6 +66,9 @@ bool sbusInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadRa
 {
     int b;
 
+    sbusFrameDone = false;
+    sbusFailsafe = false;
+    sbusLostFrames = 0;
     sBusPort = openSerialPort(FUNCTION_SERIAL_RX, sbusDataReceive, SBUS_BAUDRATE, (portMode_t)(MODE_RX | MODE_SBUS), SERIAL_INVERTED);
 
     for (b = 0; b < SBUS_MAX_CHANNEL; b++)
@@ -127,8 +135,16 @@ bool sbusFrameComplete(void)
         return false;
     }
     sbusFrameDone = false;
-    if ((sbus.in[22] >> 3) & 0x0001) {
+    if (sbus.in[22] & SBUS_FLAG_FAILSAFE_ACTIVE) {
         // internal failsafe enabled and rx failsafe flag set
+        sbusFailsafe = true;
+        sbusLostFrames++;
+        return false;
+    }
+    sbusFailsafe = false;
+    if (sbus.in[22] & SBUS_FLAG_FRAME_LOST) {
+        // the receiver missed a packet and repeats the last channels, which says nothing about the link
+        sbusLostFrames++;
         return false;
     }
     sbusChannelData[0] = sbus.msg.chan0;
@@ -146,6 +162,16 @@ bool sbusFrameComplete(void)
     return true;
 }
 
+bool sbusFailsafeIndicated(void)
+{
+    return sbusFailsafe;
+}
+
+uint32_t sbusLostFrameCount(void)
+{
+    return sbusLostFrames;
+}
+
 static uint16_t sbusReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
 {
     UNUSED(rxRuntimeConfig);
@@ -18,4 +18,6 @@
 #pragma once
 
 bool sbusFrameComplete(void);
+bool sbusFailsafeIndicated(void);
+uint32_t sbusLostFrameCount(void);
 void sbusUpdateSerialRxFunctionConstraint(functionConstraint_t *functionConstraint);
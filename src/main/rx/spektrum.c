@@ -18,6 +18,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "platform.h"
 
@@ -31,22 +32,62 @@
 #include "rx/spektrum.h"
 
 // driver for spektrum satellite receiver / sbus
+//
+// A frame is 16 bytes, a fade counter and a system byte then seven channel words, sent every 11 or 22ms.
+// Until the receiver is in sync every byte is timed and a frame starts after a gap; once a frame has checked
+// out only the first and last bytes of each frame are, a frame that took too long to arrive has lost bytes
+// and one that starts too soon after the last had extra ones, either drops sync.
+//
+// With more channels than fit in a frame they are split over two frames.  The frames of one cycle are
+// merged and published together, the cycle is learnt from the channel ids in each frame.
 
 #define SPEKTRUM_MAX_SUPPORTED_CHANNEL_COUNT 12
 #define SPEKTRUM_2048_CHANNEL_COUNT 12
 #define SPEKTRUM_1024_CHANNEL_COUNT 7
 
 #define SPEK_FRAME_SIZE 16
+#define SPEK_CHANNELS_PER_FRAME 7
+#define SPEK_MAX_FRAMES_PER_CYCLE 2
 
 #define SPEKTRUM_BAUDRATE 115200
 
+#define SPEK_BYTE_TIME_US 87                                        // 10 bits at 115200 baud
+#define SPEK_FRAME_GAP_US 5000                                      // shortest gap between frames
+#define SPEK_MAX_FRAME_DURATION_US (2 * SPEK_FRAME_SIZE * SPEK_BYTE_TIME_US)
+#define SPEK_STATS_INTERVAL_US 1000000
+
+#define SPEK_EMPTY_WORD 0xFFFF
+#define SPEK_1024_UNUSED_BITS 0xC000                                // above the channel id in 1024 mode
+
 static uint8_t spek_chan_shift;
 static uint8_t spek_chan_mask;
+static uint8_t spekChannelCount;
 static bool rcFrameComplete = false;
 static bool spekHiRes = false;
 static bool spekDataIncoming = false;
 
 static volatile uint8_t spekFrame[SPEK_FRAME_SIZE];
+static uint8_t spekFramePosition;
+static bool spekSynced;
+static bool spekFrameAfterGap;              // the frame being received started after a gap
+static uint32_t spekLastByteAt;             // only kept while hunting
+static uint32_t spekFrameStartAt;
+static uint32_t spekFrameEndAt;
+static uint8_t spekLastFades;
+
+// channel values as frames arrive and as published at the end of each cycle
+static uint16_t spekPendingChannels[SPEKTRUM_MAX_SUPPORTED_CHANNEL_COUNT];
+static volatile uint16_t spekPublishedChannels[SPEKTRUM_MAX_SUPPORTED_CHANNEL_COUNT];
+static uint16_t spekPendingMask;
+static bool spekPendingPublished;
+static uint16_t spekCycleStartMask;         // channel ids of the frame that starts a cycle
+static uint8_t spekCycleFrames;             // learnt frames per cycle, 0 until a cycle has been seen
+static uint8_t spekFramesInCycle;
+
+static spektrumStats_t spekStats;
+static uint32_t spekStatsWindowStartAt;
+static uint16_t spekStatsWindowFrames;
+static uint16_t spekStatsWindowFades;
 
 static void spektrumDataReceive(uint16_t c);
 static uint16_t spektrumReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan);
@@ -60,6 +101,15 @@ void spektrumUpdateSerialRxFunctionConstraint(functionConstraint_t *functionCons
     functionConstraint->requiredSerialPortFeatures = SPF_SUPPORTS_CALLBACK;
 }
 
+static void spektrumResetCycle(void)
+{
+    spekPendingMask = 0;
+    spekPendingPublished = true;
+    spekCycleStartMask = 0;
+    spekCycleFrames = 0;
+    spekFramesInCycle = 0;
+}
+
 bool spektrumInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
 {
     switch (rxConfig->serialrx_provider) {
@@ -78,6 +128,16 @@ bool spektrumInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcRe
             rxRuntimeConfig->channelCount = SPEKTRUM_1024_CHANNEL_COUNT;
             break;
     }
+    spekChannelCount = rxRuntimeConfig->channelCount;
+
+    rcFrameComplete = false;
+    spekDataIncoming = false;
+    spekSynced = false;
+    spekFrameAfterGap = false;
+    spekFramePosition = 0;
+    spekLastByteAt = micros() - SPEK_FRAME_GAP_US - 1;
+    spektrumResetCycle();
+    memset(&spekStats, 0, sizeof(spekStats));
 
     spektrumPort = openSerialPort(FUNCTION_SERIAL_RX, spektrumDataReceive, SPEKTRUM_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED);
     if (callback)
@@ -86,25 +146,171 @@ bool spektrumInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcRe
     return spektrumPort != NULL;
 }
 
+static uint16_t spektrumFrameWord(uint8_t index)
+{
+    return (spekFrame[2 + index * 2] << 8) | spekFrame[3 + index * 2];
+}
+
+static bool spektrumFrameValid(void)
+{
+    uint8_t i;
+
+    if (spekSynced) {
+        // the system does not change and the fade counter only counts up
+        if (spekFrame[1] != spekStats.system || (uint8_t)(spekFrame[0] - spekLastFades) >= 0x80) {
+            return false;
+        }
+    }
+
+    for (i = 0; i < SPEK_CHANNELS_PER_FRAME; i++) {
+        uint16_t word = spektrumFrameWord(i);
+        if (word != SPEK_EMPTY_WORD && !spekHiRes && (word & SPEK_1024_UNUSED_BITS)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the bytes up to the next gap are the rest of a frame
+static void spektrumLoseSync(uint32_t now)
+{
+    spekSynced = false;
+    spekFrameAfterGap = false;
+    spekLastByteAt = now;
+    spekStats.syncLosses++;
+}
+
+static void spektrumPublish(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < SPEKTRUM_MAX_SUPPORTED_CHANNEL_COUNT; i++) {
+        spekPublishedChannels[i] = spekPendingChannels[i];
+    }
+    spekPendingPublished = true;
+    spekDataIncoming = true;
+    rcFrameComplete = true;
+    spekStats.cycles++;
+}
+
+static void spektrumMergeFrame(void)
+{
+    uint16_t frameMask = 0;
+    uint8_t i;
+
+    for (i = 0; i < SPEK_CHANNELS_PER_FRAME; i++) {
+        uint16_t word = spektrumFrameWord(i);
+        uint8_t channel = 0x0F & (word >> (8 + spek_chan_shift));
+        if (word == SPEK_EMPTY_WORD || channel >= spekChannelCount) {
+            continue;
+        }
+        spekPendingChannels[channel] = word & ((spek_chan_mask << 8) | 0xFF);
+        frameMask |= 1 << channel;
+    }
+
+    if (frameMask == spekCycleStartMask || spekFramesInCycle >= SPEK_MAX_FRAMES_PER_CYCLE) {
+        // a new cycle, what is pending is the whole of the last one even if a frame of it was lost
+        if (!spekPendingPublished) {
+            spektrumPublish();
+        }
+        spekCycleFrames = spekFramesInCycle;
+        spekFramesInCycle = 0;
+        spekPendingMask = 0;
+    }
+    if (spekFramesInCycle == 0) {
+        spekCycleStartMask = frameMask;
+    }
+    spekFramesInCycle++;
+    spekPendingMask |= frameMask;
+    spekPendingPublished = false;
+
+    if (spekPendingMask == (1 << spekChannelCount) - 1 || spekFramesInCycle == spekCycleFrames) {
+        spektrumPublish();
+    }
+}
+
+static void spektrumUpdateStats(uint32_t now)
+{
+    uint8_t fades = spekFrame[0] - spekLastFades;
+
+    spekStats.frames++;
+    spekStats.fades += fades;
+    spekStats.lastFrameAt = now;
+
+    spekStatsWindowFrames++;
+    spekStatsWindowFades += fades;
+    if (now - spekStatsWindowStartAt >= SPEK_STATS_INTERVAL_US) {
+        uint32_t duration = now - spekStatsWindowStartAt;
+        spekStats.frameRate = (uint32_t)spekStatsWindowFrames * SPEK_STATS_INTERVAL_US / duration;
+        spekStats.fadesPerSecond = (uint32_t)spekStatsWindowFades * SPEK_STATS_INTERVAL_US / duration;
+        spekStatsWindowStartAt = now;
+        spekStatsWindowFrames = 0;
+        spekStatsWindowFades = 0;
+    }
+}
+
+static void spektrumFrameEnd(uint32_t now)
+{
+    if (!spekFrameAfterGap || now - spekFrameStartAt > SPEK_MAX_FRAME_DURATION_US || !spektrumFrameValid()) {
+        spekStats.badFrames++;
+        if (spekSynced) {
+            spektrumLoseSync(now);
+        }
+        spekFrameAfterGap = false;
+        return;
+    }
+
+    if (!spekSynced) {
+        // fades counted before the receiver was in sync are not ours
+        spekSynced = true;
+        spekStats.system = spekFrame[1];
+        spekLastFades = spekFrame[0];
+        spekStatsWindowStartAt = now;
+        spekStatsWindowFrames = 0;
+        spekStatsWindowFades = 0;
+        spektrumResetCycle();
+    }
+
+    spektrumUpdateStats(now);
+    spekLastFades = spekFrame[0];
+    spekFrameEndAt = now;
+
+    spektrumMergeFrame();
+}
+
 // Receive ISR callback
 static void spektrumDataReceive(uint16_t c)
 {
-    uint32_t spekTime;
-    static uint32_t spekTimeLast, spekTimeInterval;
-    static uint8_t spekFramePosition;
+    uint32_t now = 0;
 
-    spekDataIncoming = true;
-    spekTime = micros();
-    spekTimeInterval = spekTime - spekTimeLast;
-    spekTimeLast = spekTime;
-    if (spekTimeInterval > 5000)
-        spekFramePosition = 0;
-    spekFrame[spekFramePosition] = (uint8_t)c;
-    if (spekFramePosition == SPEK_FRAME_SIZE - 1) {
-        rcFrameComplete = true;
-    } else {
-        spekFramePosition++;
+    if (!spekSynced) {
+        now = micros();
+        if (now - spekLastByteAt > SPEK_FRAME_GAP_US) {
+            spekFramePosition = 0;
+            spekFrameAfterGap = true;
+        }
+        spekLastByteAt = now;
+        if (spekFramePosition == 0) {
+            spekFrameStartAt = now;
+        }
+    } else if (spekFramePosition == 0) {
+        now = micros();
+        if (now - spekFrameEndAt < SPEK_FRAME_GAP_US) {
+            // there were bytes after the end of the last frame, it did not end where it seemed to
+            spektrumLoseSync(now);
+        }
+        spekFrameStartAt = now;
+    } else if (spekFramePosition == SPEK_FRAME_SIZE - 1) {
+        now = micros();
+    }
+
+    spekFrame[spekFramePosition++] = (uint8_t)c;
+    if (spekFramePosition < SPEK_FRAME_SIZE) {
+        return;
     }
+
+    spekFramePosition = 0;
+    spektrumFrameEnd(now);
 }
 
 bool spektrumFrameComplete(void)
@@ -112,17 +318,25 @@ bool spektrumFrameComplete(void)
     return rcFrameComplete;
 }
 
+const spektrumStats_t *spektrumGetStats(void)
+{
+    // the rates are worked out as frames arrive, none for a while means none
+    if (micros() - spekStats.lastFrameAt > SPEK_STATS_INTERVAL_US) {
+        spekStats.frameRate = 0;
+        spekStats.fadesPerSecond = 0;
+    }
+    return &spekStats;
+}
+
 static uint16_t spektrumReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
 {
     uint16_t data;
     static uint32_t spekChannelData[SPEKTRUM_MAX_SUPPORTED_CHANNEL_COUNT];
-    uint8_t b;
+    uint8_t i;
 
     if (rcFrameComplete) {
-        for (b = 3; b < SPEK_FRAME_SIZE; b += 2) {
-            uint8_t spekChannel = 0x0F & (spekFrame[b - 1] >> spek_chan_shift);
-            if (spekChannel < rxRuntimeConfig->channelCount && spekChannel < SPEKTRUM_MAX_SUPPORTED_CHANNEL_COUNT)
-                spekChannelData[spekChannel] = ((uint32_t)(spekFrame[b - 1] & spek_chan_mask) << 8) + spekFrame[b];
+        for (i = 0; i < SPEKTRUM_MAX_SUPPORTED_CHANNEL_COUNT; i++) {
+            spekChannelData[i] = spekPublishedChannels[i];
         }
         rcFrameComplete = false;
     }
@@ -17,5 +17,18 @@
 
 #pragma once
 
+typedef struct spektrumStats_s {
+    uint32_t frames;                // frames that checked out
+    uint32_t cycles;                // sets of channels published, a frame or two of them
+    uint32_t badFrames;             // bytes lost or added, or a header or channel word that does not fit
+    uint32_t syncLosses;
+    uint32_t fades;                 // counted by the satellite since it was in sync
+    uint32_t lastFrameAt;           // micros() at the end of the last good frame
+    uint16_t frameRate;             // frames per second over the last second
+    uint16_t fadesPerSecond;
+    uint8_t system;                 // DSM2 or DSMX, 11 or 22ms and the resolution, from the frame header
+} spektrumStats_t;
+
 bool spektrumFrameComplete(void);
+const spektrumStats_t *spektrumGetStats(void);
 void spektrumUpdateSerialRxFunctionConstraint(functionConstraint_t *functionConstraint);
@@ -34,22 +34,75 @@
 
 // driver for SUMD receiver using UART2
 
-// FIXME test support for more than 8 channels, should probably work up to 12 channels
-
 #define SUMD_SYNCBYTE 0xA8
-#define SUMD_MAX_CHANNEL 16
-#define SUMD_BUFFSIZE (SUMD_MAX_CHANNEL * 2 + 5) // 6 channels + 5 = 17 bytes for 6 channels
+#define SUMD_STATUS_LIVE 0x01
+#define SUMD_STATUS_FAILSAFE 0x81
+
+// Graupner receivers send 2 to 32 channels, those past MAX_SUPPORTED_RC_CHANNEL_COUNT are checked but not decoded
+#define SUMD_MIN_CHANNEL 2
+#define SUMD_MAX_CHANNEL 32
+#if SUMD_MAX_CHANNEL > MAX_SUPPORTED_RC_CHANNEL_COUNT
+#define SUMD_DECODED_CHANNEL_COUNT MAX_SUPPORTED_RC_CHANNEL_COUNT
+#else
+#define SUMD_DECODED_CHANNEL_COUNT SUMD_MAX_CHANNEL
+#endif
+
+#define SUMD_HEADER_SIZE 3
+#define SUMD_CRC_SIZE 2
+#define SUMD_BUFFSIZE (SUMD_HEADER_SIZE + SUMD_MAX_CHANNEL * 2 + SUMD_CRC_SIZE) // 69 bytes for 32 channels
+
+#define SUMD_FRAME_GAP_US 4000
 
 #define SUMD_BAUDRATE 115200
 
 static bool sumdFrameDone = false;
+static bool sumdFailsafe = false;
+static uint32_t sumdLostFrames = 0;         // with the failsafe or any status but live
 static void sumdDataReceive(uint16_t c);
 static uint16_t sumdReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan);
 
-static uint32_t sumdChannelData[SUMD_MAX_CHANNEL];
+static uint16_t sumdChannelData[SUMD_DECODED_CHANNEL_COUNT];
 
 static serialPort_t *sumdPort;
 
+// CRC-16/XMODEM, polynomial 0x1021 with a zero start value, a byte at a time
+static const uint16_t sumdCrcTable[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+#define SUMD_CRC_UPDATE(crc, c) (((crc) << 8) ^ sumdCrcTable[(((crc) >> 8) ^ (c)) & 0xFF])
+
 void sumdUpdateSerialRxFunctionConstraint(functionConstraint_t *functionConstraint)
 {
     functionConstraint->minBaudRate = SUMD_BAUDRATE;
@@ -60,11 +113,15 @@ void sumdUpdateSerialRxFunctionConstraint(functionConstraint_t *functionConstrai
 bool sumdInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
 {
     UNUSED(rxConfig);
+    sumdFrameDone = false;
+    sumdFailsafe = false;
+    sumdLostFrames = 0;
+
     sumdPort = openSerialPort(FUNCTION_SERIAL_RX, sumdDataReceive, SUMD_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED);
     if (callback)
         *callback = sumdReadRawRC;
 
-    rxRuntimeConfig->channelCount = SUMD_MAX_CHANNEL;
+    rxRuntimeConfig->channelCount = SUMD_DECODED_CHANNEL_COUNT;
 
     return sumdPort != NULL;
 }
@@ -78,26 +135,37 @@ static void sumdDataReceive(uint16_t c)
     uint32_t sumdTime;
     static uint32_t sumdTimeLast;
     static uint8_t sumdIndex;
+    static uint8_t sumdFrameLength;
+    static uint16_t sumdCrc;
 
     sumdTime = micros();
-    if ((sumdTime - sumdTimeLast) > 4000)
+    if ((sumdTime - sumdTimeLast) > SUMD_FRAME_GAP_US)
         sumdIndex = 0;
     sumdTimeLast = sumdTime;
 
     if (sumdIndex == 0) {
         if (c != SUMD_SYNCBYTE)
             return;
-        else
-            sumdFrameDone = false; // lazy main loop didnt fetch the stuff
+        sumdFrameDone = false; // lazy main loop didnt fetch the stuff
+        sumdCrc = 0;
     }
-    if (sumdIndex == 2)
+    if (sumdIndex == 2) {
+        if (c < SUMD_MIN_CHANNEL || c > SUMD_MAX_CHANNEL) {
+            sumdIndex = 0;
+            return;
+        }
         sumdChannels = (uint8_t)c;
-    if (sumdIndex < SUMD_BUFFSIZE)
-        sumd[sumdIndex] = (uint8_t)c;
+        sumdFrameLength = SUMD_HEADER_SIZE + sumdChannels * 2 + SUMD_CRC_SIZE;
+    }
+
+    sumd[sumdIndex] = (uint8_t)c;
+    sumdCrc = SUMD_CRC_UPDATE(sumdCrc, (uint8_t)c);
     sumdIndex++;
-    if (sumdIndex == sumdChannels * 2 + 5) {
+
+    // running the crc over the crc bytes as well leaves zero when the frame is intact
+    if (sumdIndex > 2 && sumdIndex == sumdFrameLength) {
         sumdIndex = 0;
-        sumdFrameDone = true;
+        sumdFrameDone = (sumdCrc == 0);
     }
 }
 
@@ -109,6 +177,7 @@ static void sumdDataReceive(uint16_t c)
 bool sumdFrameComplete(void)
 {
     uint8_t channelIndex;
+    uint8_t channelCount;
 
     if (!sumdFrameDone) {
         return false;
@@ -116,14 +185,24 @@ bool sumdFrameComplete(void)
 
     sumdFrameDone = false;
 
-    if (sumd[1] != 0x01) {
+    // the receiver has lost the transmitter and sends its own hold or failsafe positions
+    if (sumd[1] == SUMD_STATUS_FAILSAFE) {
+        sumdFailsafe = true;
+        sumdLostFrames++;
         return false;
     }
 
-    if (sumdChannels > SUMD_MAX_CHANNEL)
-        sumdChannels = SUMD_MAX_CHANNEL;
+    if (sumd[1] != SUMD_STATUS_LIVE) {
+        sumdLostFrames++;
+        return false;
+    }
 
-    for (channelIndex = 0; channelIndex < sumdChannels; channelIndex++) {
+    sumdFailsafe = false;
+
+    channelCount = sumdChannels;
+    if (channelCount > SUMD_DECODED_CHANNEL_COUNT)
+        channelCount = SUMD_DECODED_CHANNEL_COUNT;
+    for (channelIndex = 0; channelIndex < channelCount; channelIndex++) {
         sumdChannelData[channelIndex] = (
             (sumd[SUMD_BYTES_PER_CHANNEL * channelIndex + SUMD_OFFSET_CHANNEL_1_HIGH] << 8) |
             sumd[SUMD_BYTES_PER_CHANNEL * channelIndex + SUMD_OFFSET_CHANNEL_1_LOW]
@@ -132,6 +211,16 @@ bool sumdFrameComplete(void)
     return true;
 }
 
+bool sumdFailsafeIndicated(void)
+{
+    return sumdFailsafe;
+}
+
+uint32_t sumdLostFrameCount(void)
+{
+    return sumdLostFrames;
+}
+
 static uint16_t sumdReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
 {
     UNUSED(rxRuntimeConfig);
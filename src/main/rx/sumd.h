@@ -18,4 +18,6 @@
 #pragma once
 
 bool sumdFrameComplete(void);
+bool sumdFailsafeIndicated(void);
+uint32_t sumdLostFrameCount(void);
 void sumdUpdateSerialRxFunctionConstraint(functionConstraint_t *functionConstraint);
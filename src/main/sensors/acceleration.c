@@ -31,6 +31,7 @@
 #include "config/config.h"
 
 #include "sensors/acceleration.h"
+#include "sensors/vibration.h"
 
 acc_t acc;                       // acc access functions
 uint8_t accHardware = ACC_DEFAULT;  // which accel chip is used/detected
@@ -165,6 +166,7 @@ void updateAccelerationReadings(rollAndPitchTrims_t *rollAndPitchTrims)
 {
     acc.read(accADC);
     alignSensors(accADC, accADC, accAlign);
+    vibrationUpdate(VIBRATION_SENSOR_ACC, accADC);
 
     if (!isAccelerationCalibrationComplete()) {
         performAcclerationCalibration(rollAndPitchTrims);
@@ -17,6 +17,9 @@
 
 #include "stdbool.h"
 #include "stdint.h"
+#include <math.h>
+
+#include "common/maths.h"
 
 #include "drivers/adc.h"
 #include "drivers/system.h"
@@ -28,12 +31,17 @@ uint8_t batteryCellCount = 3;       // cell count
 uint16_t batteryWarningVoltage;     // annoying beeper after this one, battery ready to be dead
 
 uint8_t vbat = 0;                   // battery voltage in 0.1V steps
+uint8_t vbatResting = 0;            // battery voltage with the sag under the present load added back, in 0.1V steps
+uint16_t batteryResistance = 0;     // estimated pack resistance in milliohms, 0 until the load has varied enough to tell
+float vbatPidCompensation = 1.0f;   // full pack voltage over the present voltage, the gain that keeps thrust response constant
 
 int32_t amperage = 0;               // amperage read by current sensor in centiampere (1/100th A)
 int32_t mAhDrawn = 0;               // milliampere hours drawn from the battery since start
 
 static batteryConfig_t *batteryConfig;
 
+static bool loadEstimateStarted = false;
+
 uint16_t batteryAdcToVoltage(uint16_t src)
 {
     // calculate battery voltage based on ADC reading
@@ -42,6 +50,14 @@ uint16_t batteryAdcToVoltage(uint16_t src)
 }
 
 #define BATTERY_SAMPLE_COUNT 8
+#define VBAT_PID_COMPENSATION_MAX 1.5f
+
+static void updatePidCompensation(void)
+{
+    if (vbat > 0) {
+        vbatPidCompensation = constrainf((float)batteryCellCount * batteryConfig->vbatmaxcellvoltage / vbat, 1.0f, VBAT_PID_COMPENSATION_MAX);
+    }
+}
 
 void updateBatteryVoltage(void)
 {
@@ -58,16 +74,21 @@ void updateBatteryVoltage(void)
         vbatSampleTotal += vbatSamples[index];
     }
     vbat = batteryAdcToVoltage(vbatSampleTotal / BATTERY_SAMPLE_COUNT);
+    // without a current meter there is no telling sag from discharge
+    vbatResting = vbat;
+
+    updatePidCompensation();
 }
 
 bool shouldSoundBatteryAlarm(void)
 {
-    return !((vbat > batteryWarningVoltage) || (vbat < batteryConfig->vbatmincellvoltage));
+    return !((vbatResting > batteryWarningVoltage) || (vbatResting < batteryConfig->vbatmincellvoltage));
 }
 
 void batteryInit(batteryConfig_t *initialBatteryConfig)
 {
     batteryConfig = initialBatteryConfig;
+    loadEstimateStarted = false;
 
     uint32_t i;
 
@@ -84,6 +105,7 @@ void batteryInit(batteryConfig_t *initialBatteryConfig)
 
     batteryCellCount = i;
     batteryWarningVoltage = batteryCellCount * batteryConfig->vbatmincellvoltage; // 3.3V per cell minimum, configurable in CLI
+    updatePidCompensation();
 }
 
 #define ADCVREF 33L
@@ -109,3 +131,56 @@ void updateCurrentMeter(int32_t lastUpdateAt)
 	mAhdrawnRaw += (amperage * lastUpdateAt) / 1000;
 	mAhDrawn = mAhdrawnRaw / (3600 * 100);
 }
+
+// The pack is modelled as an open circuit voltage behind a resistance, V = Voc - R * I.  Voltage and
+// current are sampled together and R is the slope of an exponentially weighted least squares fit of one on
+// the other over the last few seconds, which follows the pack as it warms and discharges.  The fit only
+// moves while the current has varied enough to say anything about the slope.
+#define LOAD_ESTIMATE_WEIGHT (1.0f / 256)               // about 5 seconds of samples at the VBATFREQ rate
+#define LOAD_ESTIMATE_MIN_CURRENT_VARIANCE 4.0f         // A^2
+#define LOAD_ESTIMATE_MAX_RESISTANCE 0.5f               // ohms
+#define RESTING_VOLTAGE_WEIGHT (1.0f / 8)
+
+static float batteryAdcToVolts(uint16_t src)
+{
+    return src * 3.3f / 0xFFF * batteryConfig->vbatscale / 10.0f;
+}
+
+void updateBatteryLoadEstimate(void)
+{
+    static float meanVolts, meanAmps;
+    static float covariance, currentVariance;
+    static float resistance;
+    static float restingVolts;
+
+    // both channels come from the same DMA scan, microseconds apart
+    float volts = batteryAdcToVolts(adcGetChannel(ADC_BATTERY));
+    float amps = currentSensorToCentiamps(adcGetChannel(ADC_CURRENT)) / 100.0f;
+    float voltsDelta, ampsDelta;
+
+    if (!loadEstimateStarted) {
+        meanVolts = volts;
+        meanAmps = amps;
+        covariance = 0;
+        currentVariance = 0;
+        resistance = 0;
+        restingVolts = volts;
+        loadEstimateStarted = true;
+    }
+
+    voltsDelta = volts - meanVolts;
+    ampsDelta = amps - meanAmps;
+    meanVolts += LOAD_ESTIMATE_WEIGHT * voltsDelta;
+    meanAmps += LOAD_ESTIMATE_WEIGHT * ampsDelta;
+    covariance = (1.0f - LOAD_ESTIMATE_WEIGHT) * (covariance + LOAD_ESTIMATE_WEIGHT * voltsDelta * ampsDelta);
+    currentVariance = (1.0f - LOAD_ESTIMATE_WEIGHT) * (currentVariance + LOAD_ESTIMATE_WEIGHT * ampsDelta * ampsDelta);
+
+    if (currentVariance > LOAD_ESTIMATE_MIN_CURRENT_VARIANCE) {
+        resistance = constrainf(-covariance / currentVariance, 0.0f, LOAD_ESTIMATE_MAX_RESISTANCE);
+    }
+
+    restingVolts += RESTING_VOLTAGE_WEIGHT * (volts + resistance * amps - restingVolts);
+
+    batteryResistance = lrintf(resistance * 1000);
+    vbatResting = constrain(lrintf(restingVolts * 10), 0, 255);
+}
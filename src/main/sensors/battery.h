@@ -30,6 +30,9 @@ typedef struct batteryConfig_s {
 } batteryConfig_t;
 
 extern uint8_t vbat;
+extern uint8_t vbatResting;
+extern uint16_t batteryResistance;
+extern float vbatPidCompensation;
 extern uint8_t batteryCellCount;
 extern uint16_t batteryWarningVoltage;
 extern int32_t amperage;
@@ -41,4 +44,5 @@ void updateBatteryVoltage(void);
 void batteryInit(batteryConfig_t *initialBatteryConfig);
 
 void updateCurrentMeter(int32_t lastUpdateAt);
+void updateBatteryLoadEstimate(void);
 int32_t currentMeterToCentiamps(uint16_t src);
@@ -17,6 +17,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "platform.h"
 
@@ -28,6 +29,8 @@
 #include "sensors/sensors.h"
 #include "io/statusindicator.h"
 #include "sensors/boardalignment.h"
+#include "sensors/gyro_redundancy.h"
+#include "sensors/vibration.h"
 
 #include "sensors/gyro.h"
 
@@ -38,6 +41,20 @@ static gyroConfig_t *gyroConfig;
 gyro_t gyro;                      // gyro access functions
 sensor_align_e gyroAlign = 0;
 
+uint8_t gyroHardware = GYRO_NONE;
+uint8_t gyroSecondaryHardware = GYRO_NONE;
+
+gyro_t gyroSecondary;             // redundant gyro, read is NULL when none is fitted
+sensor_align_e gyroSecondaryAlign = 0;
+
+static int16_t gyroSecondaryADC[XYZ_AXIS_COUNT];
+static int16_t gyroSecondaryZero[XYZ_AXIS_COUNT];
+
+typedef struct gyroCalibration_s {
+    int32_t g[XYZ_AXIS_COUNT];
+    stdev_t var[XYZ_AXIS_COUNT];
+} gyroCalibration_t;
+
 void useGyroConfig(gyroConfig_t *gyroConfigToUse)
 {
     gyroConfig = gyroConfigToUse;
@@ -63,39 +80,53 @@ bool isOnFirstGyroCalibrationCycle(void)
     return calibratingG == CALIBRATING_GYRO_CYCLES;
 }
 
-static void performAcclerationCalibration(uint8_t gyroMovementCalibrationThreshold)
+static bool calibrateGyroSource(gyroCalibration_t *calibration, int16_t *adc, int16_t *zero, uint8_t gyroMovementCalibrationThreshold)
 {
     int8_t axis;
-    static int32_t g[3];
-    static stdev_t var[3];
 
     for (axis = 0; axis < 3; axis++) {
 
         // Reset g[axis] at start of calibration
         if (isOnFirstGyroCalibrationCycle()) {
-            g[axis] = 0;
-            devClear(&var[axis]);
+            calibration->g[axis] = 0;
+            devClear(&calibration->var[axis]);
         }
 
         // Sum up CALIBRATING_GYRO_CYCLES readings
-        g[axis] += gyroADC[axis];
-        devPush(&var[axis], gyroADC[axis]);
+        calibration->g[axis] += adc[axis];
+        devPush(&calibration->var[axis], adc[axis]);
 
         // Reset global variables to prevent other code from using un-calibrated data
-        gyroADC[axis] = 0;
-        gyroZero[axis] = 0;
+        adc[axis] = 0;
+        zero[axis] = 0;
 
         if (isOnFinalGyroCalibrationCycle()) {
-            float dev = devStandardDeviation(&var[axis]);
+            float dev = devStandardDeviation(&calibration->var[axis]);
             // check deviation and startover if idiot was moving the model
             if (gyroMovementCalibrationThreshold && dev > gyroMovementCalibrationThreshold) {
-                gyroSetCalibrationCycles(CALIBRATING_GYRO_CYCLES);
-                return;
+                return false;
             }
-            gyroZero[axis] = (g[axis] + (CALIBRATING_GYRO_CYCLES / 2)) / CALIBRATING_GYRO_CYCLES;
+            zero[axis] = (calibration->g[axis] + (CALIBRATING_GYRO_CYCLES / 2)) / CALIBRATING_GYRO_CYCLES;
             blinkLedAndSoundBeeper(10, 15, 1);
         }
     }
+    return true;
+}
+
+static void performAcclerationCalibration(uint8_t gyroMovementCalibrationThreshold)
+{
+    static gyroCalibration_t calibration[GYRO_SOURCE_COUNT];
+
+    if (!calibrateGyroSource(&calibration[GYRO_SOURCE_PRIMARY], gyroADC, gyroZero, gyroMovementCalibrationThreshold)) {
+        gyroSetCalibrationCycles(CALIBRATING_GYRO_CYCLES);
+        return;
+    }
+
+    if (gyroSecondary.read && !calibrateGyroSource(&calibration[GYRO_SOURCE_SECONDARY], gyroSecondaryADC, gyroSecondaryZero, gyroMovementCalibrationThreshold)) {
+        gyroSetCalibrationCycles(CALIBRATING_GYRO_CYCLES);
+        return;
+    }
+
     calibratingG--;
 }
 
@@ -104,18 +135,58 @@ static void applyGyroZero(void)
     int8_t axis;
     for (axis = 0; axis < 3; axis++) {
         gyroADC[axis] -= gyroZero[axis];
+        gyroSecondaryADC[axis] -= gyroSecondaryZero[axis];
     }
 }
 
+static void voteRedundantGyros(void)
+{
+    int16_t samples[GYRO_SOURCE_COUNT][XYZ_AXIS_COUNT];
+
+    memcpy(samples[GYRO_SOURCE_PRIMARY], gyroADC, sizeof(samples[0]));
+    memcpy(samples[GYRO_SOURCE_SECONDARY], gyroSecondaryADC, sizeof(samples[0]));
+
+    gyroRedundancyUpdate(samples, gyroADC);
+}
+
+void gyroInit(void)
+{
+    gyro.init();
+
+    if (!gyroSecondary.read) {
+        gyroRedundancyInit(1, 1.0f);
+        return;
+    }
+
+    gyroSecondary.init();
+    gyroRedundancyInit(GYRO_SOURCE_COUNT, gyroSecondary.scale / gyro.scale);
+}
+
 void gyroGetADC(void)
 {
+    bool wasCalibrated = isGyroCalibrationComplete();
+
     // range: +/- 8192; +/- 2000 deg/sec
     gyro.read(gyroADC);
     alignSensors(gyroADC, gyroADC, gyroAlign);
+    vibrationUpdate(VIBRATION_SENSOR_GYRO, gyroADC);
+
+    // both gyros are sampled back to back so the voter compares readings taken at the same time
+    if (gyroSecondary.read) {
+        gyroSecondary.read(gyroSecondaryADC);
+        alignSensors(gyroSecondaryADC, gyroSecondaryADC, gyroSecondaryAlign);
+    }
 
-    if (!isGyroCalibrationComplete()) {
+    if (!wasCalibrated) {
         performAcclerationCalibration(gyroConfig->gyroMovementCalibrationThreshold);
+        if (isGyroCalibrationComplete()) {
+            gyroRedundancyReset();
+        }
     }
 
     applyGyroZero();
+
+    if (gyroSecondary.read && wasCalibrated) {
+        voteRedundantGyros();
+    }
 }
@@ -17,8 +17,22 @@
 
 #pragma once
 
+typedef enum {
+    GYRO_NONE = 0,
+    GYRO_FAKE,
+    GYRO_MPU6050,
+    GYRO_L3G4200D,
+    GYRO_MPU3050,
+    GYRO_L3GD20,
+    GYRO_SPI_MPU6000
+} gyroSensor_e;
+
+extern uint8_t gyroHardware;
+extern uint8_t gyroSecondaryHardware;
 extern gyro_t gyro;
 extern sensor_align_e gyroAlign;
+extern gyro_t gyroSecondary;
+extern sensor_align_e gyroSecondaryAlign;
 
 typedef struct gyroConfig_s {
     uint8_t gyroMovementCalibrationThreshold; // people keep forgetting that moving model while init results in wrong gyro offsets. and then they never reset gyro. so this is now on by default.
@@ -26,6 +40,7 @@ typedef struct gyroConfig_s {
 
 void useGyroConfig(gyroConfig_t *gyroConfigToUse);
 void gyroSetCalibrationCycles(uint16_t calibrationCyclesRequired);
+void gyroInit(void);
 void gyroGetADC(void);
 bool isGyroCalibrationComplete(void);
 
@@ -0,0 +1,260 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Voting between two gyros sampled in the same cycle.
+//
+// While both gyros are healthy and agree the output is their average.  A gyro that saturates, stops
+// changing or disagrees with the other one is dropped from the output in the same cycle, and isolated
+// for good once the fault persists.  When the two disagree there is no third opinion, so the one
+// closest to the previous output is trusted.
+//
+// A rate beyond the range of both gyros, in a crash or a fast flip, saturates one of them while the other
+// reads close to the same limit.  That saturation is no fault of the gyro and is not counted towards
+// isolating it.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "common/axis.h"
+#include "common/maths.h"
+
+#include "sensors/gyro_redundancy.h"
+
+#define SCALE_SHIFT 12
+#define NEAR_SATURATION_PERCENT 90
+
+static gyroRedundancyConfig_t *gyroRedundancyConfig;
+
+static gyroSourceState_t sourceStates[GYRO_SOURCE_COUNT];
+static uint8_t sourceCount = 1;
+static int32_t secondaryScale = 1 << SCALE_SHIFT;      // fixed point, secondary units to primary units
+static int32_t nearSaturation[GYRO_SOURCE_COUNT];      // primary units, the other gyro at or beyond this shares a saturation
+static int16_t previousOutput[XYZ_AXIS_COUNT];
+
+void useGyroRedundancyConfig(gyroRedundancyConfig_t *gyroRedundancyConfigToUse)
+{
+    gyroRedundancyConfig = gyroRedundancyConfigToUse;
+}
+
+void gyroRedundancyReset(void)
+{
+    memset(sourceStates, 0, sizeof(sourceStates));
+    memset(previousOutput, 0, sizeof(previousOutput));
+}
+
+void gyroRedundancyInit(uint8_t count, float secondaryToPrimaryScale)
+{
+    sourceCount = count;
+    secondaryScale = lrintf(secondaryToPrimaryScale * (1 << SCALE_SHIFT));
+    nearSaturation[GYRO_SOURCE_PRIMARY] = GYRO_SATURATION_LIMIT * NEAR_SATURATION_PERCENT / 100;
+    nearSaturation[GYRO_SOURCE_SECONDARY] = ((GYRO_SATURATION_LIMIT * secondaryScale) >> SCALE_SHIFT) * NEAR_SATURATION_PERCENT / 100;
+    gyroRedundancyReset();
+}
+
+static bool isSampleOutOfRange(int16_t *sample)
+{
+    uint8_t axis;
+
+    for (axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        if (sample[axis] >= GYRO_SATURATION_LIMIT || sample[axis] <= -GYRO_SATURATION_LIMIT) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool isSampleStuck(gyroSourceState_t *state, int16_t *sample)
+{
+    if (memcmp(state->previous, sample, sizeof(state->previous)) == 0) {
+        if (state->unchangedCycles < GYRO_STUCK_CYCLES) {
+            state->unchangedCycles++;
+        }
+    } else {
+        state->unchangedCycles = 0;
+        memcpy(state->previous, sample, sizeof(state->previous));
+    }
+    return state->unchangedCycles >= GYRO_STUCK_CYCLES;
+}
+
+// the source saturates on an axis where the other gyro reads close to the source's own limit
+static bool isSaturationShared(int16_t samples[GYRO_SOURCE_COUNT][XYZ_AXIS_COUNT], int16_t scaled[GYRO_SOURCE_COUNT][XYZ_AXIS_COUNT], uint8_t source)
+{
+    uint8_t other = source == GYRO_SOURCE_PRIMARY ? GYRO_SOURCE_SECONDARY : GYRO_SOURCE_PRIMARY;
+    uint8_t axis;
+
+    for (axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        if ((samples[source][axis] >= GYRO_SATURATION_LIMIT || samples[source][axis] <= -GYRO_SATURATION_LIMIT)
+                && abs(scaled[other][axis]) >= nearSaturation[source]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t distanceFromPreviousOutput(int16_t *sample)
+{
+    uint32_t distance = 0;
+    uint8_t axis;
+
+    for (axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        distance += abs(sample[axis] - previousOutput[axis]);
+    }
+    return distance;
+}
+
+static bool doSamplesDisagree(int16_t *a, int16_t *b)
+{
+    uint8_t axis;
+
+    for (axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        if (abs(a[axis] - b[axis]) > gyroRedundancyConfig->gyro_vote_threshold) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void updateFaultCounters(uint8_t usableSources, uint8_t sharedSaturationSources)
+{
+    uint8_t source;
+
+    for (source = 0; source < sourceCount; source++) {
+        gyroSourceState_t *state = &sourceStates[source];
+
+        if (state->isolatedBy) {
+            continue;
+        }
+
+        if (!state->faults) {
+            state->faultyCycles = 0;
+            continue;
+        }
+
+        // never isolate the last usable gyro, a bad reading beats no reading at all
+        if (!(usableSources & ~(1 << source))) {
+            continue;
+        }
+
+        if (state->faults == GYRO_FAULT_OUT_OF_RANGE && (sharedSaturationSources & (1 << source))) {
+            continue;
+        }
+
+        state->faultyCycles++;
+        if ((state->faults & GYRO_FAULT_STUCK) || state->faultyCycles >= gyroRedundancyConfig->gyro_fault_cycles) {
+            state->isolatedBy = state->faults;
+        }
+    }
+}
+
+void gyroRedundancyUpdate(int16_t samples[GYRO_SOURCE_COUNT][XYZ_AXIS_COUNT], int16_t *output)
+{
+    int16_t scaled[GYRO_SOURCE_COUNT][XYZ_AXIS_COUNT];
+    uint8_t usableSources = 0;
+    uint8_t sharedSaturationSources = 0;
+    uint8_t source;
+    uint8_t axis;
+
+    if (sourceCount < GYRO_SOURCE_COUNT) {
+        memcpy(output, samples[GYRO_SOURCE_PRIMARY], sizeof(scaled[0]));
+        return;
+    }
+
+    for (axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        scaled[GYRO_SOURCE_PRIMARY][axis] = samples[GYRO_SOURCE_PRIMARY][axis];
+        scaled[GYRO_SOURCE_SECONDARY][axis] = constrain((samples[GYRO_SOURCE_SECONDARY][axis] * secondaryScale) >> SCALE_SHIFT, INT16_MIN, INT16_MAX);
+    }
+
+    for (source = 0; source < sourceCount; source++) {
+        gyroSourceState_t *state = &sourceStates[source];
+
+        state->faults = GYRO_FAULT_NONE;
+        if (state->isolatedBy) {
+            continue;
+        }
+
+        if (isSampleOutOfRange(samples[source])) {
+            state->faults |= GYRO_FAULT_OUT_OF_RANGE;
+            if (isSaturationShared(samples, scaled, source)) {
+                sharedSaturationSources |= 1 << source;
+            }
+        }
+        if (isSampleStuck(state, samples[source])) {
+            state->faults |= GYRO_FAULT_STUCK;
+        }
+        if (!state->faults) {
+            usableSources |= 1 << source;
+        }
+    }
+
+    if (usableSources == ((1 << GYRO_SOURCE_PRIMARY) | (1 << GYRO_SOURCE_SECONDARY))
+            && doSamplesDisagree(scaled[GYRO_SOURCE_PRIMARY], scaled[GYRO_SOURCE_SECONDARY])) {
+        gyroSource_e suspect = GYRO_SOURCE_SECONDARY;
+        if (distanceFromPreviousOutput(scaled[GYRO_SOURCE_PRIMARY]) > distanceFromPreviousOutput(scaled[GYRO_SOURCE_SECONDARY])) {
+            suspect = GYRO_SOURCE_PRIMARY;
+        }
+        sourceStates[suspect].faults |= GYRO_FAULT_DISAGREEMENT;
+        usableSources &= ~(1 << suspect);
+    }
+
+    updateFaultCounters(usableSources, sharedSaturationSources);
+
+    switch (usableSources) {
+        case (1 << GYRO_SOURCE_PRIMARY) | (1 << GYRO_SOURCE_SECONDARY):
+            for (axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                output[axis] = (scaled[GYRO_SOURCE_PRIMARY][axis] + scaled[GYRO_SOURCE_SECONDARY][axis]) / 2;
+            }
+            break;
+        case 1 << GYRO_SOURCE_SECONDARY:
+            memcpy(output, scaled[GYRO_SOURCE_SECONDARY], sizeof(scaled[0]));
+            break;
+        case 1 << GYRO_SOURCE_PRIMARY:
+            memcpy(output, scaled[GYRO_SOURCE_PRIMARY], sizeof(scaled[0]));
+            break;
+        default:
+            // nothing trustworthy this cycle, fall back to whichever gyro is still in use
+            source = sourceStates[GYRO_SOURCE_PRIMARY].isolatedBy ? GYRO_SOURCE_SECONDARY : GYRO_SOURCE_PRIMARY;
+            memcpy(output, scaled[source], sizeof(scaled[0]));
+            break;
+    }
+
+    memcpy(previousOutput, output, sizeof(previousOutput));
+}
+
+uint8_t gyroRedundancySourceCount(void)
+{
+    return sourceCount;
+}
+
+uint8_t gyroRedundancyHealthySourceCount(void)
+{
+    uint8_t healthy = 0;
+    uint8_t source;
+
+    for (source = 0; source < sourceCount; source++) {
+        if (!sourceStates[source].isolatedBy) {
+            healthy++;
+        }
+    }
+    return healthy;
+}
+
+const gyroSourceState_t *gyroRedundancySourceState(gyroSource_e source)
+{
+    return &sourceStates[source];
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define GYRO_SATURATION_LIMIT 32000         // raw samples at or beyond this are treated as out of range
+#define GYRO_STUCK_CYCLES 100               // identical raw samples on all axes for this many cycles means the gyro is stuck
+
+typedef enum {
+    GYRO_SOURCE_PRIMARY = 0,
+    GYRO_SOURCE_SECONDARY,
+    GYRO_SOURCE_COUNT
+} gyroSource_e;
+
+typedef enum {
+    GYRO_FAULT_NONE = 0,
+    GYRO_FAULT_OUT_OF_RANGE = 1 << 0,
+    GYRO_FAULT_STUCK = 1 << 1,
+    GYRO_FAULT_DISAGREEMENT = 1 << 2
+} gyroFault_e;
+
+typedef struct gyroRedundancyConfig_s {
+    uint8_t gyro_redundancy;                // detect and use a second gyro when one is fitted
+    uint16_t gyro_vote_threshold;           // per-axis difference between the two gyros, in primary gyro units, above which they disagree
+    uint8_t gyro_fault_cycles;              // consecutive faulty cycles before a gyro is isolated
+} gyroRedundancyConfig_t;
+
+typedef struct gyroSourceState_s {
+    int16_t previous[XYZ_AXIS_COUNT];
+    uint16_t unchangedCycles;
+    uint16_t faultyCycles;
+    uint8_t faults;                         // gyroFault_e bits seen in the last cycle
+    uint8_t isolatedBy;                     // gyroFault_e bits that caused isolation, 0 while in use
+} gyroSourceState_t;
+
+void useGyroRedundancyConfig(gyroRedundancyConfig_t *gyroRedundancyConfigToUse);
+void gyroRedundancyInit(uint8_t sourceCount, float secondaryToPrimaryScale);
+void gyroRedundancyReset(void);
+void gyroRedundancyUpdate(int16_t samples[GYRO_SOURCE_COUNT][XYZ_AXIS_COUNT], int16_t *output);
+
+uint8_t gyroRedundancySourceCount(void);
+uint8_t gyroRedundancyHealthySourceCount(void);
+const gyroSourceState_t *gyroRedundancySourceState(gyroSource_e source);
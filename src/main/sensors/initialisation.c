@@ -53,6 +53,7 @@
 #include "sensors/gyro.h"
 #include "sensors/compass.h"
 #include "sensors/sonar.h"
+#include "sensors/vibration.h"
 
 
 // Use these to help with porting to new boards
@@ -155,6 +156,7 @@ extern uint8_t batteryCellCount;
 extern float magneticDeclination;
 
 extern gyro_t gyro;
+extern gyro_t gyroSecondary;
 extern baro_t baro;
 extern acc_t acc;
 
@@ -180,59 +182,93 @@ bool fakeAccDetect(acc_t *acc)
 {
     acc->init = fakeAccInit;
     acc->read = fakeAccRead;
+    acc->fullScaleG = 16;
     acc->revisionCode = 0;
     return true;
 }
 #endif
 
-bool detectGyro(uint16_t gyroLpf)
+// Tries the gyro drivers in order, starting at gyroHardwareToTry, and returns the first one found.
+static gyroSensor_e detectGyroHardware(gyro_t *gyroToDetect, sensor_align_e *align, uint16_t gyroLpf, gyroSensor_e gyroHardwareToTry)
 {
-    gyroAlign = ALIGN_DEFAULT;
+    *align = ALIGN_DEFAULT;
+
+    switch (gyroHardwareToTry) {
+        case GYRO_NONE:
+        case GYRO_FAKE:
 #ifdef USE_FAKE_GYRO
-    if (fakeGyroDetect(&gyro, gyroLpf)) {
-        return true;
-    }
+            if (fakeGyroDetect(gyroToDetect, gyroLpf)) {
+                return GYRO_FAKE;
+            }
 #endif
-
+            ; // fallthrough
+        case GYRO_MPU6050:
 #ifdef USE_GYRO_MPU6050
-    if (mpu6050GyroDetect(&gyro, gyroLpf)) {
+            if (mpu6050GyroDetect(gyroToDetect, gyroLpf)) {
 #ifdef NAZE
-        gyroAlign = CW0_DEG;
+                *align = CW0_DEG;
 #endif
-        return true;
-    }
+                return GYRO_MPU6050;
+            }
 #endif
-
+            ; // fallthrough
+        case GYRO_L3G4200D:
 #ifdef USE_GYRO_L3G4200D
-    if (l3g4200dDetect(&gyro, gyroLpf)) {
+            if (l3g4200dDetect(gyroToDetect, gyroLpf)) {
 #ifdef NAZE
-        gyroAlign = CW0_DEG;
+                *align = CW0_DEG;
 #endif
-        return true;
-    }
+                return GYRO_L3G4200D;
+            }
 #endif
-
+            ; // fallthrough
+        case GYRO_MPU3050:
 #ifdef USE_GYRO_MPU3050
-    if (mpu3050Detect(&gyro, gyroLpf)) {
+            if (mpu3050Detect(gyroToDetect, gyroLpf)) {
 #ifdef NAZE
-        gyroAlign = CW0_DEG;
+                *align = CW0_DEG;
 #endif
-        return true;
-    }
+                return GYRO_MPU3050;
+            }
 #endif
-
+            ; // fallthrough
+        case GYRO_L3GD20:
 #ifdef USE_GYRO_L3GD20
-    if (l3gd20Detect(&gyro, gyroLpf)) {
-        return true;
-    }
+            if (l3gd20Detect(gyroToDetect, gyroLpf)) {
+                return GYRO_L3GD20;
+            }
 #endif
-
+            ; // fallthrough
+        case GYRO_SPI_MPU6000:
 #ifdef USE_GYRO_SPI_MPU6000
-    if (mpu6000SpiGyroDetect(&gyro, gyroLpf)) {
+            if (mpu6000SpiGyroDetect(gyroToDetect, gyroLpf)) {
+                return GYRO_SPI_MPU6000;
+            }
+#endif
+            ; // prevent compiler error
+    }
+    return GYRO_NONE;
+}
+
+bool detectGyro(uint16_t gyroLpf, bool detectRedundantGyro)
+{
+    gyroHardware = detectGyroHardware(&gyro, &gyroAlign, gyroLpf, GYRO_NONE);
+    if (gyroHardware == GYRO_NONE) {
+        return false;
+    }
+
+    if (!detectRedundantGyro || gyroHardware == GYRO_FAKE) {
         return true;
     }
-#endif
-    return false;
+
+    // only look for a second gyro among the drivers after the one found, so the same device is never picked twice.
+    gyroSecondaryHardware = detectGyroHardware(&gyroSecondary, &gyroSecondaryAlign, gyroLpf, gyroHardware + 1);
+    if (gyroSecondaryHardware == GYRO_MPU3050 && gyroHardware == GYRO_MPU6050) {
+        // mpu3050 detection only checks for an ack on the address the mpu6050 already answers on
+        memset(&gyroSecondary, 0, sizeof(gyroSecondary));
+        gyroSecondaryHardware = detectGyroHardware(&gyroSecondary, &gyroSecondaryAlign, gyroLpf, GYRO_L3GD20);
+    }
+    return true;
 }
 
 static void detectAcc(uint8_t accHardwareToUse)
@@ -366,6 +402,9 @@ void reconfigureAlignment(sensorAlignmentConfig_t *sensorAlignmentConfig)
     if (sensorAlignmentConfig->gyro_align != ALIGN_DEFAULT) {
         gyroAlign = sensorAlignmentConfig->gyro_align;
     }
+    if (sensorAlignmentConfig->gyro_secondary_align != ALIGN_DEFAULT) {
+        gyroSecondaryAlign = sensorAlignmentConfig->gyro_secondary_align;
+    }
     if (sensorAlignmentConfig->acc_align != ALIGN_DEFAULT) {
         accAlign = sensorAlignmentConfig->acc_align;
     }
@@ -374,13 +413,14 @@ void reconfigureAlignment(sensorAlignmentConfig_t *sensorAlignmentConfig)
     }
 }
 
-bool sensorsAutodetect(sensorAlignmentConfig_t *sensorAlignmentConfig, uint16_t gyroLpf, uint8_t accHardwareToUse, int16_t magDeclinationFromConfig)
+bool sensorsAutodetect(sensorAlignmentConfig_t *sensorAlignmentConfig, uint16_t gyroLpf, uint8_t accHardwareToUse, int16_t magDeclinationFromConfig, bool detectRedundantGyro)
 {
     int16_t deg, min;
     memset(&acc, sizeof(acc), 0);
     memset(&gyro, sizeof(gyro), 0);
+    memset(&gyroSecondary, 0, sizeof(gyroSecondary));
 
-    if (!detectGyro(gyroLpf)) {
+    if (!detectGyro(gyroLpf, detectRedundantGyro)) {
         return false;
     }
     detectAcc(accHardwareToUse);
@@ -392,7 +432,8 @@ bool sensorsAutodetect(sensorAlignmentConfig_t *sensorAlignmentConfig, uint16_t
     if (sensors(SENSOR_ACC))
         acc.init();
     // this is safe because either mpu6050 or mpu3050 or lg3d20 sets it, and in case of fail, we never get here.
-    gyro.init();
+    gyroInit();
+    vibrationInit(acc_1G, acc.fullScaleG);
 
 #ifdef MAG
     if (hmc5883lDetect()) {
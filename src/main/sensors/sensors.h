@@ -47,6 +47,7 @@ typedef struct sensorAlignmentConfig_s {
     sensor_align_e gyro_align;              // gyro alignment
     sensor_align_e acc_align;               // acc alignment
     sensor_align_e mag_align;               // mag alignment
+    sensor_align_e gyro_secondary_align;    // redundant gyro alignment
 } sensorAlignmentConfig_t;
 
 extern int16_t heading;
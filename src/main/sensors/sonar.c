@@ -35,25 +35,80 @@ int32_t sonarAlt = -1;	// in cm , -1 indicate sonar is not in range
 
 #ifdef SONAR
 
+#define SONAR_MEDIAN_SAMPLES 5
+#define SONAR_MAX_SAMPLE_AGE_US 100000  // readings older than this are not used for the altitude
+
+static int32_t sonarSamples[SONAR_MEDIAN_SAMPLES];
+static uint8_t sonarSampleIndex;
+static uint8_t sonarSampleCount;
+static int32_t sonarDistance = -1;      // median of the latest readings, in cm
+static uint32_t sonarSampleTime;
+
 void Sonar_init(void)
 {
     hcsr04_init(sonar_rc78);
     sensorsSet(SENSOR_SONAR);
     sonarAlt = 0;
+    sonarSampleIndex = 0;
+    sonarSampleCount = 0;
+    sonarDistance = -1;
+}
+
+// out of range readings take part as -1, so a lone dropout or a spike from a stray echo does not get through
+static int32_t sonarMedian(void)
+{
+    int32_t sorted[SONAR_MEDIAN_SAMPLES];
+    int i, j;
+
+    for (i = 0; i < sonarSampleCount; i++) {
+        int32_t sample = sonarSamples[i];
+        for (j = i; j > 0 && sorted[j - 1] > sample; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = sample;
+    }
+
+    return sorted[sonarSampleCount / 2];
 }
 
 void Sonar_update(void)
 {
-    hcsr04_get_distance(&sonarAlt);
+    hcsr04_reading_t reading;
+
+    hcsr04_update();
+
+    if (!hcsr04_read(&reading))
+        return;
+
+    sonarSamples[sonarSampleIndex] = reading.distance;
+    sonarSampleIndex = (sonarSampleIndex + 1) % SONAR_MEDIAN_SAMPLES;
+    if (sonarSampleCount < SONAR_MEDIAN_SAMPLES)
+        sonarSampleCount++;
+
+    sonarDistance = sonarMedian();
+    sonarSampleTime = reading.time;
+}
+
+int32_t sonarGetDistance(uint32_t currentTime)
+{
+    if (sonarSampleCount == 0 || sonarGetSampleAge(currentTime) > SONAR_MAX_SAMPLE_AGE_US)
+        return -1;
+
+    return sonarDistance;
+}
+
+uint32_t sonarGetSampleAge(uint32_t currentTime)
+{
+    return currentTime - sonarSampleTime;
 }
 
-int32_t sonarCalculateAltitude(int32_t sonarAlt, int16_t tiltAngle)
+int32_t sonarCalculateAltitude(int32_t sonarDistance, int16_t tiltAngle)
 {
     // calculate sonar altitude only if the sonar is facing downwards(<25deg)
-    if (tiltAngle > 250)
+    if (sonarDistance < 0 || tiltAngle > 250)
         return -1;
 
-    return sonarAlt * (900.0f - tiltAngle) / 900.0f;
+    return sonarDistance * (900.0f - tiltAngle) / 900.0f;
 }
 
 #endif
@@ -22,4 +22,8 @@ extern int32_t sonarAlt;
 void Sonar_init(void);
 void Sonar_update(void);
 
-int32_t sonarCalculateAltitude(int32_t sonarAlt, int16_t tiltAngle);
+// median filtered distance in cm, -1 when out of range or the latest reading is too old to use
+int32_t sonarGetDistance(uint32_t currentTime);
+uint32_t sonarGetSampleAge(uint32_t currentTime);
+
+int32_t sonarCalculateAltitude(int32_t sonarDistance, int16_t tiltAngle);
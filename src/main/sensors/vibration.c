@@ -0,0 +1,157 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Vibration and clipping metrics for the acc and gyro.
+//
+// Every raw sample goes through a first order high pass, the square of the result feeds a running mean
+// and its magnitude a peak-hold.  Only integer adds and shifts plus one multiply per axis are done in
+// the loop, the square root is left to whoever reads the RMS.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "common/axis.h"
+#include "common/maths.h"
+
+#include "sensors/vibration.h"
+
+static vibrationConfig_t *vibrationConfig;
+
+static vibrationMetrics_t metrics[VIBRATION_SENSOR_COUNT];
+static bool filterPrimed[VIBRATION_SENSOR_COUNT];
+static uint16_t acc1G = 256;
+static uint16_t clipWarningCycles;
+
+void useVibrationConfig(vibrationConfig_t *vibrationConfigToUse)
+{
+    vibrationConfig = vibrationConfigToUse;
+}
+
+void vibrationInit(uint16_t acc1GToUse, uint8_t accFullScaleG)
+{
+    int32_t accClipLimit;
+
+    acc1G = acc1GToUse;
+
+    // stay a little inside the nominal range, some sensors saturate slightly before it
+    accClipLimit = (int32_t)acc1G * accFullScaleG * 15 / 16;
+    metrics[VIBRATION_SENSOR_ACC].clipLimit = min(accClipLimit, VIBRATION_GYRO_CLIP_LIMIT);
+    metrics[VIBRATION_SENSOR_GYRO].clipLimit = VIBRATION_GYRO_CLIP_LIMIT;
+
+    memset(filterPrimed, 0, sizeof(filterPrimed));
+    vibrationReset();
+}
+
+// Clears the statistics, the high pass filters keep running so there is no settling transient.
+void vibrationReset(void)
+{
+    uint8_t sensor;
+    uint8_t axis;
+
+    for (sensor = 0; sensor < VIBRATION_SENSOR_COUNT; sensor++) {
+        for (axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            metrics[sensor].axis[axis].meanSquare = 0;
+            metrics[sensor].axis[axis].peak = 0;
+        }
+        metrics[sensor].clipCount = 0;
+    }
+    clipWarningCycles = 0;
+}
+
+void vibrationUpdate(vibrationSensor_e sensor, int16_t *sample)
+{
+    vibrationMetrics_t *sensorMetrics = &metrics[sensor];
+    bool clipped = false;
+    uint8_t axis;
+
+    if (!filterPrimed[sensor]) {
+        // start the low pass at the first sample, otherwise gravity would show up as a huge vibration
+        for (axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            sensorMetrics->axis[axis].average = (int32_t)sample[axis] << VIBRATION_HPF_SHIFT;
+        }
+        filterPrimed[sensor] = true;
+    }
+
+    for (axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        vibrationAxis_t *axisMetrics = &sensorMetrics->axis[axis];
+        int32_t highPassed;
+        uint16_t magnitude;
+
+        if (sample[axis] >= sensorMetrics->clipLimit || sample[axis] <= -sensorMetrics->clipLimit) {
+            clipped = true;
+        }
+
+        axisMetrics->average += sample[axis] - (axisMetrics->average >> VIBRATION_HPF_SHIFT);
+        highPassed = constrain(sample[axis] - (axisMetrics->average >> VIBRATION_HPF_SHIFT), -INT16_MAX, INT16_MAX);
+
+        // both terms are below 2^30 so the difference can't overflow
+        axisMetrics->meanSquare += (highPassed * highPassed - axisMetrics->meanSquare) >> VIBRATION_RMS_SHIFT;
+
+        magnitude = abs(highPassed);
+        if (magnitude > axisMetrics->peak) {
+            axisMetrics->peak = magnitude;
+        }
+    }
+
+    if (clipped) {
+        sensorMetrics->clipCount++;
+        clipWarningCycles = VIBRATION_CLIP_WARNING_CYCLES;
+    } else if (sensor == VIBRATION_SENSOR_GYRO && clipWarningCycles) {
+        // the gyro is sampled exactly once per cycle, so it paces the warning timeout
+        clipWarningCycles--;
+    }
+}
+
+uint16_t vibrationRms(vibrationSensor_e sensor, uint8_t axis)
+{
+    return lrintf(sqrtf(metrics[sensor].axis[axis].meanSquare));
+}
+
+uint16_t vibrationPeak(vibrationSensor_e sensor, uint8_t axis)
+{
+    return metrics[sensor].axis[axis].peak;
+}
+
+uint32_t vibrationClipCount(vibrationSensor_e sensor)
+{
+    return metrics[sensor].clipCount;
+}
+
+bool isVibrationWarningActive(void)
+{
+    int32_t warningRms;
+    uint8_t axis;
+
+    if (clipWarningCycles) {
+        return true;
+    }
+
+    if (!vibrationConfig->acc_vibration_warning) {
+        return false;
+    }
+
+    warningRms = (int32_t)vibrationConfig->acc_vibration_warning * acc1G / 100;
+    for (axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        if (metrics[VIBRATION_SENSOR_ACC].axis[axis].meanSquare > warningRms * warningRms) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define VIBRATION_HPF_SHIFT 4               // high pass corner is roughly looprate / (2 * PI * 16), ~10Hz at 1kHz
+#define VIBRATION_RMS_SHIFT 7               // mean square averages over roughly 128 samples
+#define VIBRATION_GYRO_CLIP_LIMIT 32000     // raw gyro samples at or beyond this are at the rails
+#define VIBRATION_CLIP_WARNING_CYCLES 1000  // cycles the warning stays on after the last clipped sample
+
+typedef enum {
+    VIBRATION_SENSOR_ACC = 0,
+    VIBRATION_SENSOR_GYRO,
+    VIBRATION_SENSOR_COUNT
+} vibrationSensor_e;
+
+typedef struct vibrationConfig_s {
+    uint16_t acc_vibration_warning;         // acc RMS in 0.01G above which the status LED warns, 0 to warn on clipping only
+} vibrationConfig_t;
+
+typedef struct vibrationAxis_s {
+    int32_t average;                        // low passed sample, scaled by 1 << VIBRATION_HPF_SHIFT
+    int32_t meanSquare;                     // running mean square of the high passed sample
+    uint16_t peak;                          // largest high passed magnitude since the last reset
+} vibrationAxis_t;
+
+typedef struct vibrationMetrics_s {
+    vibrationAxis_t axis[XYZ_AXIS_COUNT];
+    uint32_t clipCount;                     // samples with any axis at the rails
+    int16_t clipLimit;
+} vibrationMetrics_t;
+
+void useVibrationConfig(vibrationConfig_t *vibrationConfigToUse);
+void vibrationInit(uint16_t acc1G, uint8_t accFullScaleG);
+void vibrationReset(void);
+void vibrationUpdate(vibrationSensor_e sensor, int16_t *sample);
+
+uint16_t vibrationRms(vibrationSensor_e sensor, uint8_t axis);
+uint16_t vibrationPeak(vibrationSensor_e sensor, uint8_t axis);
+uint32_t vibrationClipCount(vibrationSensor_e sensor);
+bool isVibrationWarningActive(void);
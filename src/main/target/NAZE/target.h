@@ -55,9 +55,12 @@
 
 #define I2C_DEVICE (I2CDEV_2)
 
-// #define SOFT_I2C // enable to test software i2c
-// #define SOFT_I2C_PB1011 // If SOFT_I2C is enabled above, need to define pinout as well (I2C1 = PB67, I2C2 = PB1011)
-// #define SOFT_I2C_PB67
+// rev5 boards can carry an M25P16 on SPI2
+#define M25P16_CS_GPIO GPIOB
+#define M25P16_CS_PIN GPIO_Pin_12
+#define M25P16_SPI_INSTANCE SPI2
+
+// #define SOFT_I2C // enable to test software i2c, on the I2C_DEVICE pins
 
 
 #define SENSORS_SET (SENSOR_ACC | SENSOR_BARO | SENSOR_MAG)
@@ -68,3 +71,4 @@
 #define SOFT_SERIAL
 #define SERIAL_RX
 #define AUTOTUNE
+#define FLASH_LOG
@@ -45,6 +45,8 @@
 #include "sensors/battery.h"
 #include "flight/flight.h"
 #include "io/gps.h"
+#include "rx/rx.h"
+#include "rx/rssi.h"
 
 #include "telemetry/telemetry.h"
 #include "telemetry/frsky.h"
@@ -157,6 +159,13 @@ static void sendTemperature1(void)
     serialize16(telemTemperature1 / 10);
 }
 
+// link quality in percent, the receiver sends its own RSSI
+static void sendTemperature2(void)
+{
+    sendDataHead(ID_TEMPRATURE2);
+    serialize16(getLinkQuality()->linkQuality);
+}
+
 static void sendTime(void)
 {
     uint32_t seconds = millis() / 1000;
@@ -373,6 +382,7 @@ void handleFrSkyTelemetry(void)
 
     if ((cycleNum % 8) == 0) {      // Sent every 1s
         sendTemperature1();
+        sendTemperature2();
 
         if (feature(FEATURE_VBAT)) {
             sendVoltage();
@@ -0,0 +1,47 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define BENCH_INPUT_COUNT 64                // inputs are cycled through, power of two
+
+typedef void (*benchSetupFuncPtr)(void);
+typedef void (*benchRunFuncPtr)(uint32_t iteration);
+
+typedef struct benchmark_s {
+    const char *name;
+    uint32_t iterations;                    // calls per measured run
+    benchSetupFuncPtr setup;                // called before every run, may be NULL
+    benchRunFuncPtr run;                    // one call of the function under test
+    struct benchmark_s *next;
+} benchmark_t;
+
+// micros() on the host, benchmarks move it on as the firmware loop would
+extern uint32_t simulatedMicros;
+
+void registerBenchmark(benchmark_t *benchmark);
+
+struct benchRegistrar {
+    benchRegistrar(benchmark_t *benchmark) { registerBenchmark(benchmark); }
+};
+
+// Defines the body of a benchmark, run once per iteration with the iteration number.
+#define BENCHMARK(name, setupFunc, iterationCount) \
+    static void bench_##name(uint32_t iteration); \
+    static benchmark_t benchmark_##name = { #name, iterationCount, setupFunc, bench_##name, NULL }; \
+    static benchRegistrar registrar_##name(&benchmark_##name); \
+    static void bench_##name(uint32_t iteration)
@@ -0,0 +1,370 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "platform.h"
+
+#include "common/axis.h"
+#include "common/maths.h"
+
+#include "drivers/accgyro.h"
+#include "drivers/gpio.h"
+#include "drivers/timer.h"
+#include "drivers/pwm_mapping.h"
+#include "drivers/pwm_output.h"
+
+#include "sensors/sensors.h"
+#include "sensors/gyro.h"
+#include "sensors/barometer.h"
+#include "sensors/boardalignment.h"
+#include "sensors/vibration.h"
+
+#include "rx/rx.h"
+#include "io/rc_controls.h"
+#include "io/escservo.h"
+#include "io/gimbal.h"
+
+#include "flight/flight.h"
+#include "sensors/acceleration.h"
+#include "flight/mixer.h"
+#include "flight/thrust_linear.h"
+#include "flight/imu.h"
+
+#include "config/runtime_config.h"
+
+#include "bench.h"
+
+typedef void (*pidControllerFuncPtr)(pidProfile_t *pidProfile, controlRateConfig_t *controlRateConfig,
+        uint16_t max_angle_inclination, rollAndPitchTrims_t *angleTrim);
+extern pidControllerFuncPtr pid_controller;
+extern uint16_t cycleTime;
+
+void mixerUseConfigs(servoParam_t *servoConfToUse, flight3DConfig_t *flight3DConfigToUse,
+        escAndServoConfig_t *escAndServoConfigToUse, mixerConfig_t *mixerConfigToUse,
+        airplaneConfig_t *airplaneConfigToUse, rxConfig_t *rxConfigToUse, gimbalConfig_t *gimbalConfigToUse);
+void mixerInit(MultiType mixerConfiguration, motorMixer_t *customMixers);
+void mixerUsePWMOutputConfiguration(pwmOutputConfiguration_t *pwmOutputConfiguration);
+void imuInit(void);
+void rotateV(struct fp_vector *v, fp_angles_t *delta);
+int32_t applyDeadband(int32_t value, int32_t deadband);
+
+#define ACC_1G 512
+
+// sensor readings of a quad in gentle forward flight with some vibration on top
+static int16_t gyroSamples[BENCH_INPUT_COUNT][XYZ_AXIS_COUNT];
+static int16_t accSamples[BENCH_INPUT_COUNT][XYZ_AXIS_COUNT];
+static int16_t stickSamples[BENCH_INPUT_COUNT][4];
+
+static pidProfile_t pidProfile;
+static controlRateConfig_t controlRateConfig;
+static rollAndPitchTrims_t trims;
+static imuRuntimeConfig_t imuRuntimeConfig;
+static barometerConfig_t barometerConfig;
+static accDeadband_t accDeadband;
+
+static servoParam_t servoConf[MAX_SUPPORTED_SERVOS];
+static flight3DConfig_t flight3DConfig;
+static escAndServoConfig_t escAndServoConfig;
+static mixerConfig_t mixerConfig;
+static airplaneConfig_t airplaneConfig;
+static rxConfig_t rxConfig;
+static gimbalConfig_t gimbalConfig;
+static motorMixer_t customMixer[MAX_SUPPORTED_MOTORS];
+
+static void generateSamples(void)
+{
+    for (int i = 0; i < BENCH_INPUT_COUNT; i++) {
+        float phase = i * 2 * M_PI / BENCH_INPUT_COUNT;
+
+        gyroSamples[i][X] = lrintf(40 * sinf(phase) + 8 * sinf(phase * 13));
+        gyroSamples[i][Y] = lrintf(-25 * cosf(phase) + 8 * sinf(phase * 11));
+        gyroSamples[i][Z] = lrintf(10 * sinf(phase * 2));
+
+        accSamples[i][X] = lrintf(60 + 30 * sinf(phase * 17));
+        accSamples[i][Y] = lrintf(-20 + 30 * sinf(phase * 19));
+        accSamples[i][Z] = lrintf(ACC_1G + 40 * sinf(phase * 23));
+
+        stickSamples[i][ROLL] = lrintf(100 * sinf(phase));
+        stickSamples[i][PITCH] = lrintf(-150 * cosf(phase));
+        stickSamples[i][YAW] = lrintf(30 * sinf(phase * 3));
+        stickSamples[i][THROTTLE] = lrintf(1450 + 200 * sinf(phase));
+    }
+}
+
+static void setupPid(void)
+{
+    generateSamples();
+
+    pidProfile.P8[ROLL] = 40;
+    pidProfile.I8[ROLL] = 30;
+    pidProfile.D8[ROLL] = 23;
+    pidProfile.P8[PITCH] = 40;
+    pidProfile.I8[PITCH] = 30;
+    pidProfile.D8[PITCH] = 23;
+    pidProfile.P8[YAW] = 85;
+    pidProfile.I8[YAW] = 45;
+    pidProfile.P8[PIDLEVEL] = 90;
+    pidProfile.I8[PIDLEVEL] = 10;
+    pidProfile.D8[PIDLEVEL] = 100;
+    pidProfile.P_f[ROLL] = 2.5f;
+    pidProfile.I_f[ROLL] = 0.6f;
+    pidProfile.D_f[ROLL] = 0.06f;
+    pidProfile.P_f[PITCH] = 2.5f;
+    pidProfile.I_f[PITCH] = 0.6f;
+    pidProfile.D_f[PITCH] = 0.06f;
+    pidProfile.P_f[YAW] = 8.0f;
+    pidProfile.I_f[YAW] = 0.5f;
+    pidProfile.D_f[YAW] = 0.05f;
+    pidProfile.A_level = 5.0f;
+    pidProfile.H_level = 3.0f;
+
+    controlRateConfig.rcRate8 = 90;
+    controlRateConfig.rcExpo8 = 65;
+    controlRateConfig.rollPitchRate = 0;
+    controlRateConfig.yawRate = 0;
+
+    memset(&f, 0, sizeof(f));
+    f.ARMED = 1;
+    cycleTime = 3500;
+
+    resetErrorAngle();
+    resetErrorGyro();
+}
+
+static void applyPidInputs(uint32_t iteration)
+{
+    int16_t *stick = stickSamples[iteration & (BENCH_INPUT_COUNT - 1)];
+    int16_t *gyro = gyroSamples[iteration & (BENCH_INPUT_COUNT - 1)];
+
+    rcCommand[ROLL] = stick[ROLL];
+    rcCommand[PITCH] = stick[PITCH];
+    rcCommand[YAW] = stick[YAW];
+    rcCommand[THROTTLE] = stick[THROTTLE];
+    gyroData[FD_ROLL] = gyro[X];
+    gyroData[FD_PITCH] = gyro[Y];
+    gyroData[FD_YAW] = gyro[Z];
+}
+
+static void setupPidMultiWii(void)
+{
+    setupPid();
+    setPIDController(0);
+}
+
+BENCHMARK(pidMultiWii, setupPidMultiWii, 2000000)
+{
+    applyPidInputs(iteration);
+    pid_controller(&pidProfile, &controlRateConfig, 500, &trims);
+}
+
+static void setupPidRewrite(void)
+{
+    setupPid();
+    setPIDController(1);
+}
+
+BENCHMARK(pidRewrite, setupPidRewrite, 2000000)
+{
+    applyPidInputs(iteration);
+    pid_controller(&pidProfile, &controlRateConfig, 500, &trims);
+}
+
+static void setupMixer(void)
+{
+    static pwmOutputConfiguration_t pwmOutputConfiguration;
+
+    generateSamples();
+    memset(&f, 0, sizeof(f));
+    f.ARMED = 1;
+
+    escAndServoConfig.minthrottle = 1150;
+    escAndServoConfig.maxthrottle = 1850;
+    escAndServoConfig.mincommand = 1000;
+    mixerConfig.yaw_direction = 1;
+    rxConfig.mincheck = 1100;
+    rxConfig.midrc = 1500;
+    rxConfig.maxcheck = 1900;
+
+    mixerUseConfigs(servoConf, &flight3DConfig, &escAndServoConfig, &mixerConfig, &airplaneConfig, &rxConfig, &gimbalConfig);
+    mixerInit(MULTITYPE_QUADX, customMixer);
+    mixerUsePWMOutputConfiguration(&pwmOutputConfiguration);
+}
+
+BENCHMARK(mixTable, setupMixer, 2000000)
+{
+    int16_t *stick = stickSamples[iteration & (BENCH_INPUT_COUNT - 1)];
+
+    rcCommand[THROTTLE] = stick[THROTTLE];
+    rcData[THROTTLE] = stick[THROTTLE];
+    rcCommand[YAW] = stick[YAW];
+    axisPID[ROLL] = stick[ROLL];
+    axisPID[PITCH] = stick[PITCH];
+    axisPID[YAW] = stick[YAW];
+    mixTable();
+}
+
+static int16_t thrustMotors[4];
+
+static void setupThrustLinear(void)
+{
+    thrustLinearConfig_t thrustLinearConfig;
+
+    generateSamples();
+    thrustLinearConfig.thrust_linear = 60;
+    thrustLinearInit(&thrustLinearConfig);
+}
+
+// a quad's worth of motors, the way mixTable hands them over
+BENCHMARK(applyThrustLinearisation, setupThrustLinear, 5000000)
+{
+    int16_t *stick = stickSamples[iteration & (BENCH_INPUT_COUNT - 1)];
+
+    thrustMotors[0] = stick[THROTTLE] + stick[ROLL];
+    thrustMotors[1] = stick[THROTTLE] - stick[ROLL];
+    thrustMotors[2] = stick[THROTTLE] + stick[PITCH];
+    thrustMotors[3] = stick[THROTTLE] - stick[PITCH];
+    applyThrustLinearisation(thrustMotors, 4, 1150, 1850);
+}
+
+static void setupImu(void)
+{
+    generateSamples();
+    memset(&f, 0, sizeof(f));
+
+    acc_1G = ACC_1G;
+    sensorsSet(SENSOR_ACC);
+    gyro.scale = (4.0f / 16.4f) * (M_PI / 180.0f) * 0.000001f;
+    simulatedMicros = 0;
+
+    imuRuntimeConfig.acc_lpf_factor = 4;
+    imuRuntimeConfig.acc_unarmedcal = 1;
+    imuRuntimeConfig.gyro_cmpf_factor = 600;
+    imuRuntimeConfig.gyro_cmpfm_factor = 250;
+    imuRuntimeConfig.small_angle = 25;
+    accDeadband.xy = 40;
+    accDeadband.z = 40;
+
+    configureImu(&imuRuntimeConfig, &barometerConfig, &accDeadband);
+    imuInit();
+}
+
+// getEstimatedAttitude is static, computeIMU is the way in.  The readings are copied in by the gyroGetADC
+// and updateAccelerationReadings stubs below.
+BENCHMARK(getEstimatedAttitude, setupImu, 1000000)
+{
+    (void)iteration;
+    computeIMU(&trims, MULTITYPE_QUADX);
+}
+
+static fp_angles_t rotateDeltas[BENCH_INPUT_COUNT];
+static t_fp_vector rotated;
+
+static void setupRotateV(void)
+{
+    generateSamples();
+    for (int i = 0; i < BENCH_INPUT_COUNT; i++) {
+        // one 3.5ms cycle of gyro movement at 2000dps full scale
+        rotateDeltas[i].angles.roll = gyroSamples[i][X] * 0.0035f * (2000.0f / 32768.0f) * (M_PI / 180.0f);
+        rotateDeltas[i].angles.pitch = gyroSamples[i][Y] * 0.0035f * (2000.0f / 32768.0f) * (M_PI / 180.0f);
+        rotateDeltas[i].angles.yaw = gyroSamples[i][Z] * 0.0035f * (2000.0f / 32768.0f) * (M_PI / 180.0f);
+    }
+    rotated.V.X = 0;
+    rotated.V.Y = 0;
+    rotated.V.Z = ACC_1G;
+}
+
+BENCHMARK(rotateV, setupRotateV, 2000000)
+{
+    rotateV(&rotated.V, &rotateDeltas[iteration & (BENCH_INPUT_COUNT - 1)]);
+}
+
+static int32_t deadbandSum;
+
+BENCHMARK(applyDeadband, generateSamples, 10000000)
+{
+    deadbandSum += applyDeadband(accSamples[iteration & (BENCH_INPUT_COUNT - 1)][X], 40);
+}
+
+static int16_t alignedSample[XYZ_AXIS_COUNT];
+
+static void setupAlignSensors(void)
+{
+    boardAlignment_t boardAlignment;
+
+    generateSamples();
+    memset(&boardAlignment, 0, sizeof(boardAlignment));
+    initBoardAlignment(&boardAlignment);
+}
+
+BENCHMARK(alignSensors, setupAlignSensors, 10000000)
+{
+    alignSensors(gyroSamples[iteration & (BENCH_INPUT_COUNT - 1)], alignedSample, CW270_DEG);
+}
+
+static vibrationConfig_t vibrationConfig;
+
+static void setupVibration(void)
+{
+    generateSamples();
+    useVibrationConfig(&vibrationConfig);
+    vibrationInit(ACC_1G, 8);
+}
+
+BENCHMARK(vibrationUpdate, setupVibration, 10000000)
+{
+    vibrationUpdate(VIBRATION_SENSOR_GYRO, gyroSamples[iteration & (BENCH_INPUT_COUNT - 1)]);
+}
+
+// STUBS
+
+uint16_t acc_1G;
+gyro_t gyro;
+int16_t magADC[XYZ_AXIS_COUNT];
+int32_t BaroAlt;
+int32_t sonarAlt;
+int16_t debug[4];
+uint16_t cycleTime;
+int16_t rcCommand[4];
+rxRuntimeConfig_t rxRuntimeConfig;
+float vbatPidCompensation = 1.0f;
+
+void gyroGetADC(void)
+{
+    static uint32_t index;
+    simulatedMicros += 3500;
+    memcpy(gyroADC, gyroSamples[index++ & (BENCH_INPUT_COUNT - 1)], sizeof(gyroADC));
+}
+
+void updateAccelerationReadings(rollAndPitchTrims_t *rollAndPitchTrims)
+{
+    static uint32_t index;
+    (void)rollAndPitchTrims;
+    memcpy(accADC, accSamples[index++ & (BENCH_INPUT_COUNT - 1)], sizeof(accADC));
+}
+
+bool feature(uint32_t mask)
+{
+    (void)mask;
+    return false;
+}
+
+bool isBaroCalibrationComplete(void) { return true; }
+void performBaroCalibrationCycle(void) {}
+int32_t baroCalculateAltitude(void) { return 0; }
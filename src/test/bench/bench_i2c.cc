@@ -0,0 +1,81 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/gpio.h"
+#include "drivers/bus_i2c.h"
+
+#include "bench.h"
+
+#define SCL_PERIOD_CYCLES (72000000 / 400000)  // longer than the low or the high phase
+#define SCL_PIN Pin_10
+#define SDA_PIN Pin_11
+#define MPU_ADDRESS 0x68
+#define MPU_ACCEL_XOUT_H 0x3B
+#define MPU_BURST_LENGTH 14
+
+static bool masterScl = true;
+static bool masterSda = true;
+static uint32_t clocks;                     // falling SCL edges since the last start
+
+// Just enough of a slave to ack every byte, it pulls SDA low for every ninth clock.  Every read of the cycle
+// counter finds the next phase due, so what is measured is the time the driver itself takes.
+static void busTick(void)
+{
+    uint32_t written = hostGPIOB.BSRR;
+
+    hostDWT.CYCCNT.value += SCL_PERIOD_CYCLES;
+    if (written) {
+        bool scl = written & SCL_PIN;
+        bool sda = written & SDA_PIN;
+
+        if (masterScl && scl && masterSda && !sda) {
+            clocks = 0;
+        } else if (masterScl && !scl) {
+            clocks++;
+        }
+        masterScl = scl;
+        masterSda = sda;
+        hostGPIOB.BSRR = 0;
+    }
+    bool ack = clocks && clocks % 9 == 0;
+    hostGPIOB.IDR = (masterScl ? SCL_PIN : 0) | (masterSda && !ack ? SDA_PIN : 0);
+}
+
+static void setupI2c(void)
+{
+    hostDWT.CYCCNT.onRead = busTick;
+    i2cInit(I2CDEV_2);
+}
+
+// the 14 byte accelerometer, temperature and gyro read of the MPU6050, at 400kHz about 390us of bus time
+BENCHMARK(i2cSoftBurstRead, setupI2c, 100000)
+{
+    static uint8_t buf[MPU_BURST_LENGTH];
+
+    (void)iteration;
+    i2cRead(MPU_ADDRESS, MPU_ACCEL_XOUT_H, MPU_BURST_LENGTH, buf);
+}
+
+// STUBS
+
+DWT_Type hostDWT;
+CoreDebug_Type hostCoreDebug;
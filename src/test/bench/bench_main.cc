@@ -0,0 +1,306 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Runs every registered benchmark, reports ns and instructions per call as JSON and optionally compares
+// against a baseline written by an earlier run.
+//
+//   bench [--output file] [--baseline file] [--tolerance percent] [--ns-tolerance percent] [--filter name]
+//
+// Exits non-zero when any benchmark got slower than the baseline by more than the tolerance.  Instruction
+// counts are compared when both runs have them, as they hardly vary between runs; otherwise ns per call,
+// with a wider tolerance as timing on a busy host easily moves by a fifth.  Below MIN_COMPARED_NS a call
+// is within the scheduler noise, those are only reported when there are no instruction counts.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "bench.h"
+
+#define RUNS 9                              // best of
+#define DEFAULT_TOLERANCE_PERCENT 10
+#define DEFAULT_NS_TOLERANCE_PERCENT 50
+#define MIN_COMPARED_NS 10
+#define MAX_BENCHMARKS 32
+
+typedef struct benchResult_s {
+    char name[64];
+    uint32_t iterations;
+    double nsPerCall;
+    double instructionsPerCall;             // negative when not counted
+} benchResult_t;
+
+static benchmark_t *benchmarks;
+
+uint32_t simulatedMicros;
+
+uint32_t micros(void)
+{
+    return simulatedMicros;
+}
+
+void registerBenchmark(benchmark_t *benchmark)
+{
+    // keep the order of definition
+    benchmark_t **tail = &benchmarks;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = benchmark;
+}
+
+static int openInstructionCounter(void)
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void startInstructionCounter(int counter)
+{
+#ifdef __linux__
+    if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)counter;
+#endif
+}
+
+static int64_t stopInstructionCounter(int counter)
+{
+#ifdef __linux__
+    uint64_t count;
+
+    if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter, &count, sizeof(count)) == sizeof(count)) {
+            return count;
+        }
+    }
+#else
+    (void)counter;
+#endif
+    return -1;
+}
+
+static uint64_t nanos(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+static void runBenchmark(benchmark_t *benchmark, int counter, benchResult_t *result)
+{
+    uint64_t bestNs = UINT64_MAX;
+    int64_t bestInstructions = -1;
+    uint32_t i;
+
+    for (int run = 0; run < RUNS; run++) {
+        if (benchmark->setup) {
+            benchmark->setup();
+        }
+
+        startInstructionCounter(counter);
+        uint64_t start = nanos();
+        for (i = 0; i < benchmark->iterations; i++) {
+            benchmark->run(i);
+        }
+        uint64_t elapsed = nanos() - start;
+        int64_t instructions = stopInstructionCounter(counter);
+
+        if (elapsed < bestNs) {
+            bestNs = elapsed;
+        }
+        if (instructions >= 0 && (bestInstructions < 0 || instructions < bestInstructions)) {
+            bestInstructions = instructions;
+        }
+    }
+
+    snprintf(result->name, sizeof(result->name), "%s", benchmark->name);
+    result->iterations = benchmark->iterations;
+    result->nsPerCall = (double)bestNs / benchmark->iterations;
+    result->instructionsPerCall = bestInstructions < 0 ? -1 : (double)bestInstructions / benchmark->iterations;
+}
+
+static void writeResults(FILE *out, const benchResult_t *results, int count)
+{
+    fprintf(out, "{\n  \"benchmarks\": [\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "    { \"name\": \"%s\", \"iterations\": %u, \"ns_per_call\": %.2f, \"instructions_per_call\": ",
+                results[i].name, results[i].iterations, results[i].nsPerCall);
+        if (results[i].instructionsPerCall < 0) {
+            fprintf(out, "null");
+        } else {
+            fprintf(out, "%.1f", results[i].instructionsPerCall);
+        }
+        fprintf(out, " }%s\n", i < count - 1 ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+// Reads back what writeResults wrote, one benchmark per line.
+static int readBaseline(const char *filename, benchResult_t *results, int maxCount)
+{
+    FILE *in = fopen(filename, "r");
+    char line[256];
+    int count = 0;
+
+    if (!in) {
+        return -1;
+    }
+
+    while (count < maxCount && fgets(line, sizeof(line), in)) {
+        benchResult_t *result = &results[count];
+        char instructions[32];
+
+        if (sscanf(line, " { \"name\": \"%63[^\"]\", \"iterations\": %u, \"ns_per_call\": %lf, \"instructions_per_call\": %31[^ }]",
+                result->name, &result->iterations, &result->nsPerCall, instructions) != 4) {
+            continue;
+        }
+        result->instructionsPerCall = strcmp(instructions, "null") ? atof(instructions) : -1;
+        count++;
+    }
+
+    fclose(in);
+    return count;
+}
+
+static int compareWithBaseline(const benchResult_t *results, int count, const benchResult_t *baseline, int baselineCount,
+        int tolerancePercent, int nsTolerancePercent)
+{
+    int regressions = 0;
+
+    for (int i = 0; i < count; i++) {
+        const benchResult_t *reference = NULL;
+
+        for (int j = 0; j < baselineCount; j++) {
+            if (!strcmp(results[i].name, baseline[j].name)) {
+                reference = &baseline[j];
+            }
+        }
+        if (!reference) {
+            fprintf(stderr, "%-24s no baseline\n", results[i].name);
+            continue;
+        }
+
+        bool byInstructions = results[i].instructionsPerCall >= 0 && reference->instructionsPerCall >= 0;
+        double current = byInstructions ? results[i].instructionsPerCall : results[i].nsPerCall;
+        double previous = byInstructions ? reference->instructionsPerCall : reference->nsPerCall;
+        double change = previous > 0 ? (current - previous) * 100 / previous : 0;
+        bool compared = byInstructions || previous >= MIN_COMPARED_NS;
+        bool regressed = compared && change > (byInstructions ? tolerancePercent : nsTolerancePercent);
+
+        fprintf(stderr, "%-24s %10.1f %s, baseline %10.1f, %+6.1f%%%s\n", results[i].name, current,
+                byInstructions ? "instructions" : "ns", previous, change,
+                regressed ? "  REGRESSION" : compared ? "" : "  (not compared)");
+        if (regressed) {
+            regressions++;
+        }
+    }
+
+    return regressions;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *outputFilename = NULL;
+    const char *baselineFilename = NULL;
+    const char *filter = NULL;
+    int tolerancePercent = DEFAULT_TOLERANCE_PERCENT;
+    int nsTolerancePercent = DEFAULT_NS_TOLERANCE_PERCENT;
+    static benchResult_t results[MAX_BENCHMARKS];
+    static benchResult_t baseline[MAX_BENCHMARKS];
+    int count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+            outputFilename = argv[++i];
+        } else if (!strcmp(argv[i], "--baseline") && i + 1 < argc) {
+            baselineFilename = argv[++i];
+        } else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+            tolerancePercent = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--ns-tolerance") && i + 1 < argc) {
+            nsTolerancePercent = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--output file] [--baseline file] [--tolerance percent] [--ns-tolerance percent] [--filter name]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int counter = openInstructionCounter();
+    if (counter < 0) {
+        fprintf(stderr, "perf_event_open not available, instructions are not counted\n");
+    }
+
+    for (benchmark_t *benchmark = benchmarks; benchmark && count < MAX_BENCHMARKS; benchmark = benchmark->next) {
+        if (filter && !strstr(benchmark->name, filter)) {
+            continue;
+        }
+        runBenchmark(benchmark, counter, &results[count++]);
+    }
+
+    if (outputFilename) {
+        FILE *out = fopen(outputFilename, "w");
+        if (!out) {
+            perror(outputFilename);
+            return 2;
+        }
+        writeResults(out, results, count);
+        fclose(out);
+    } else {
+        writeResults(stdout, results, count);
+    }
+
+    if (baselineFilename) {
+        int baselineCount = readBaseline(baselineFilename, baseline, MAX_BENCHMARKS);
+        if (baselineCount < 0) {
+            perror(baselineFilename);
+            return 2;
+        }
+        if (compareWithBaseline(results, count, baseline, baselineCount, tolerancePercent, nsTolerancePercent)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
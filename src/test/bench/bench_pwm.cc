@@ -0,0 +1,80 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/gpio.h"
+#include "drivers/timer.h"
+#include "drivers/pwm_mapping.h"
+#include "drivers/pwm_output.h"
+
+#include "bench.h"
+
+#define BRUSHED_MOTOR_PWM_RATE 32000
+
+// motors 0 and 1 brushed on TIM3, one written plainly and one dithered
+static const timerHardware_t motorTimerHardware[] = {
+    { TIM3, GPIOA, Pin_6, TIM_Channel_1, TIM3_IRQn, 0, Mode_IPD },
+    { TIM3, GPIOA, Pin_7, TIM_Channel_2, TIM3_IRQn, 0, Mode_IPD }
+};
+
+static uint16_t motorCommands[BENCH_INPUT_COUNT];
+
+static void setupBrushedMotors(void)
+{
+    static bool configured;
+
+    // the driver hands out a new output port on every call, so the motors are only configured once
+    if (!configured) {
+        pwmBrushedMotorConfig(&motorTimerHardware[0], 0, BRUSHED_MOTOR_PWM_RATE, 0, false);
+        pwmBrushedMotorConfig(&motorTimerHardware[1], 1, BRUSHED_MOTOR_PWM_RATE, 0, true);
+        configured = true;
+    }
+
+    for (int i = 0; i < BENCH_INPUT_COUNT; i++) {
+        motorCommands[i] = 1000 + (i * 157) % 1001;
+    }
+}
+
+// one brushed motor write, the scale worked out at configuration
+BENCHMARK(pwmWriteBrushed, setupBrushedMotors, 10000000)
+{
+    pwmWriteMotor(0, motorCommands[iteration & (BENCH_INPUT_COUNT - 1)]);
+}
+
+// the same write with the dropped fraction carried into the next one
+BENCHMARK(pwmWriteBrushedDithered, setupBrushedMotors, 10000000)
+{
+    pwmWriteMotor(1, motorCommands[iteration & (BENCH_INPUT_COUNT - 1)]);
+}
+
+// STUBS
+
+void gpioInit(GPIO_TypeDef *gpio, gpio_config_t *config) { (void)gpio; (void)config; }
+void TIM_OCStructInit(TIM_OCInitTypeDef *TIM_OCInitStruct) { memset(TIM_OCInitStruct, 0, sizeof(*TIM_OCInitStruct)); }
+void TIM_OC1Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct) { (void)TIMx; (void)TIM_OCInitStruct; }
+void TIM_OC2Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct) { (void)TIMx; (void)TIM_OCInitStruct; }
+void TIM_OC3Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct) { (void)TIMx; (void)TIM_OCInitStruct; }
+void TIM_OC4Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct) { (void)TIMx; (void)TIM_OCInitStruct; }
+void TIM_OC1PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload) { (void)TIMx; (void)TIM_OCPreload; }
+void TIM_OC2PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload) { (void)TIMx; (void)TIM_OCPreload; }
+void TIM_OC3PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload) { (void)TIMx; (void)TIM_OCPreload; }
+void TIM_OC4PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload) { (void)TIMx; (void)TIM_OCPreload; }
+void TIM_CtrlPWMOutputs(TIM_TypeDef *TIMx, FunctionalState NewState) { (void)TIMx; (void)NewState; }
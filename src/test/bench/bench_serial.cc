@@ -0,0 +1,254 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/serial.h"
+#include "drivers/serial_uart.h"
+#include "io/serial.h"
+
+#include "rx/rx.h"
+#include "rx/rssi.h"
+#include "rx/sbus.h"
+#include "rx/sumd.h"
+
+#include "bench.h"
+
+bool sbusInit(rxConfig_t *initialRxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback);
+bool sumdInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback);
+
+#define SBUS_FRAME_SIZE 25
+#define SUMD_CHANNEL_COUNT 16
+#define SUMD_FRAME_SIZE (SUMD_CHANNEL_COUNT * 2 + 5)
+
+USART_TypeDef hostUSART1, hostUSART2, hostUSART3;
+
+static uartPort_t hostPort;
+static volatile uint8_t rxBuffer[256];
+static volatile uint8_t txBuffer[256];
+static const serialBuffers_t buffers = { rxBuffer, txBuffer, sizeof(rxBuffer), sizeof(txBuffer) };
+
+static serialPort_t *uart;
+
+// A port without DMA, the way USART2 and USART3 run, so every byte goes through the ring buffers.
+static void setupUart(void)
+{
+    uart = uartOpen(USART1, NULL, 115200, MODE_RXTX, SERIAL_NOT_INVERTED, &buffers);
+}
+
+// one byte in through the receive interrupt and back out, as the MSP and telemetry loops do
+BENCHMARK(uartRingBuffer, setupUart, 10000000)
+{
+    // what usartIrqCallback does with a received byte
+    uart->rxBuffer[uart->rxBufferHead] = iteration;
+    uart->rxBufferHead = (uart->rxBufferHead + 1) % uart->rxBufferSize;
+
+    while (uartTotalBytesWaiting(uart)) {
+        uartWrite(uart, uartRead(uart));
+    }
+    uart->txBufferTail = uart->txBufferHead;
+}
+
+static rxConfig_t rxConfig;
+static rxRuntimeConfig_t sbusRuntimeConfig;
+static rcReadRawDataPtr sbusReadRawRC;
+// the receive callback of the driver opened last
+static serialReceiveCallbackPtr rxDataReceive;
+
+static uint8_t sbusFrames[BENCH_INPUT_COUNT][SBUS_FRAME_SIZE];
+
+static void setupSbus(void)
+{
+    rxConfig.midrc = 1500;
+    sbusInit(&rxConfig, &sbusRuntimeConfig, &sbusReadRawRC);
+
+    for (int i = 0; i < BENCH_INPUT_COUNT; i++) {
+        uint8_t *frame = sbusFrames[i];
+        uint32_t bits = 0;
+        uint8_t bitCount = 0;
+        uint8_t *out = &frame[1];
+
+        memset(frame, 0, SBUS_FRAME_SIZE);
+        frame[0] = 0x0F;
+        for (int channel = 0; channel < 16; channel++) {
+            bits |= (uint32_t)((172 + (i * 29 + channel * 113) % 1640) & 0x7FF) << bitCount;
+            bitCount += 11;
+            while (bitCount >= 8) {
+                *out++ = bits & 0xFF;
+                bits >>= 8;
+                bitCount -= 8;
+            }
+        }
+    }
+}
+
+// a whole frame at the 3ms SBUS frame rate, byte by byte through the receive callback, then all channels read
+BENCHMARK(sbusFrame, setupSbus, 1000000)
+{
+    uint8_t *frame = sbusFrames[iteration & (BENCH_INPUT_COUNT - 1)];
+    uint8_t channel;
+
+    simulatedMicros += 3000;
+    for (int i = 0; i < SBUS_FRAME_SIZE; i++) {
+        rxDataReceive(frame[i]);
+    }
+    if (sbusFrameComplete()) {
+        for (channel = 0; channel < sbusRuntimeConfig.channelCount; channel++) {
+            rcData[channel] = sbusReadRawRC(&sbusRuntimeConfig, channel);
+        }
+    }
+}
+
+static rxRuntimeConfig_t sumdRuntimeConfig;
+static rcReadRawDataPtr sumdReadRawRC;
+
+static uint8_t sumdFrames[BENCH_INPUT_COUNT][SUMD_FRAME_SIZE];
+
+// CRC-16/XMODEM a bit at a time, the way the frames were checked before the table
+static uint16_t sumdBitwiseCrc(const uint8_t *data, uint8_t length)
+{
+    uint16_t crc = 0;
+
+    while (length--) {
+        crc ^= *data++ << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static void setupSumd(void)
+{
+    sumdInit(&rxConfig, &sumdRuntimeConfig, &sumdReadRawRC);
+
+    for (int i = 0; i < BENCH_INPUT_COUNT; i++) {
+        uint8_t *frame = sumdFrames[i];
+        uint8_t *out = &frame[3];
+
+        frame[0] = 0xA8;
+        frame[1] = 0x01;
+        frame[2] = SUMD_CHANNEL_COUNT;
+        for (int channel = 0; channel < SUMD_CHANNEL_COUNT; channel++) {
+            uint16_t value = (1000 + (i * 29 + channel * 113) % 1000) * 8;
+            *out++ = value >> 8;
+            *out++ = value & 0xFF;
+        }
+        uint16_t crc = sumdBitwiseCrc(frame, SUMD_FRAME_SIZE - 2);
+        *out++ = crc >> 8;
+        *out++ = crc & 0xFF;
+    }
+}
+
+// a 16 channel frame at the 10ms SUMD frame rate with its crc checked byte by byte in the receive callback
+BENCHMARK(sumdFrame, setupSumd, 1000000)
+{
+    uint8_t *frame = sumdFrames[iteration & (BENCH_INPUT_COUNT - 1)];
+    uint8_t channel;
+
+    simulatedMicros += 10000;
+    for (int i = 0; i < SUMD_FRAME_SIZE; i++) {
+        rxDataReceive(frame[i]);
+    }
+    if (sumdFrameComplete()) {
+        for (channel = 0; channel < sumdRuntimeConfig.channelCount; channel++) {
+            rcData[channel] = sumdReadRawRC(&sumdRuntimeConfig, channel);
+        }
+    }
+}
+
+// the same frames checked with the bitwise crc, for comparison with the table in sumdFrame
+BENCHMARK(sumdBitwiseCrc, setupSumd, 1000000)
+{
+    uint8_t *frame = sumdFrames[iteration & (BENCH_INPUT_COUNT - 1)];
+
+    rcData[0] = sumdBitwiseCrc(frame, SUMD_FRAME_SIZE);
+}
+
+static rxConfig_t rssiRxConfig;
+
+static void setupRssi(void)
+{
+    memset(&rssiRxConfig, 0, sizeof(rssiRxConfig));
+    rssiRxConfig.rssi_channel = 8;
+    rssiInit(&rssiRxConfig);
+}
+
+// the link quality and RSSI work for an SBUS frame, with one in eight lost and one in sixteen missing
+BENCHMARK(rssiFrame, setupRssi, 10000000)
+{
+    uint32_t frameAt = iteration * 9000;
+
+    if ((iteration & 15) == 15) {
+        return;
+    }
+    if ((iteration & 7) == 3) {
+        rssiFramesLost(frameAt, 1);
+    } else {
+        rssiFrameReceived(frameAt);
+    }
+    rcData[7] = 1000 + (iteration & 1023);
+    updateRSSI(frameAt);
+}
+
+// STUBS
+
+int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
+
+uint16_t adcGetChannel(uint8_t channel)
+{
+    (void)channel;
+    return 0;
+}
+
+uartPort_t *serialUSART1(uint32_t baudRate, portMode_t mode)
+{
+    (void)baudRate;
+    (void)mode;
+
+    hostPort.port.vTable = uartVTable;
+    hostPort.USARTx = USART1;
+
+    return &hostPort;
+}
+
+serialPort_t *openSerialPort(serialPortFunction_e functionMask, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, serialInversion_e inversion)
+{
+    (void)functionMask;
+    (void)baudRate;
+    (void)mode;
+    (void)inversion;
+
+    rxDataReceive = callback;
+    return &hostPort.port;
+}
+
+void USART_Init(USART_TypeDef *USARTx, USART_InitTypeDef *USART_InitStruct) { (void)USARTx; (void)USART_InitStruct; }
+void USART_Cmd(USART_TypeDef *USARTx, FunctionalState NewState) { (void)USARTx; (void)NewState; }
+void USART_ITConfig(USART_TypeDef *USARTx, uint16_t USART_IT, FunctionalState NewState) { (void)USARTx; (void)USART_IT; (void)NewState; }
+void USART_ClearITPendingBit(USART_TypeDef *USARTx, uint16_t USART_IT) { (void)USARTx; (void)USART_IT; }
+void USART_DMACmd(USART_TypeDef *USARTx, uint16_t USART_DMAReq, FunctionalState NewState) { (void)USARTx; (void)USART_DMAReq; (void)NewState; }
+void DMA_StructInit(DMA_InitTypeDef *DMA_InitStruct) { memset(DMA_InitStruct, 0, sizeof(*DMA_InitStruct)); }
+void DMA_DeInit(DMA_Channel_TypeDef *DMAy_Channelx) { (void)DMAy_Channelx; }
+void DMA_Init(DMA_Channel_TypeDef *DMAy_Channelx, DMA_InitTypeDef *DMA_InitStruct) { (void)DMAy_Channelx; (void)DMA_InitStruct; }
+void DMA_Cmd(DMA_Channel_TypeDef *DMAy_Channelx, FunctionalState NewState) { (void)DMAy_Channelx; (void)NewState; }
+void DMA_ITConfig(DMA_Channel_TypeDef *DMAy_Channelx, uint32_t DMA_IT, FunctionalState NewState) { (void)DMAy_Channelx; (void)DMA_IT; (void)NewState; }
+void DMA_SetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx, uint16_t DataNumber) { (void)DMAy_Channelx; (void)DataNumber; }
+uint16_t DMA_GetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx) { (void)DMAy_Channelx; return 0; }
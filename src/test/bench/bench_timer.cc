@@ -0,0 +1,96 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/gpio.h"
+#include "drivers/timer.h"
+
+#include "bench.h"
+
+void timerInit(void);
+void TIM2_IRQHandler(void);
+
+// volatile so the captures are not optimised away
+static volatile captureCompare_t lastCapture;
+static volatile uint32_t overflows;
+
+static void captureCallback(uint8_t reference, captureCompare_t capture)
+{
+    (void)reference;
+    lastCapture = capture;
+}
+
+static void overflowCallback(uint8_t reference, captureCompare_t capture)
+{
+    (void)reference;
+    (void)capture;
+    overflows++;
+}
+
+// TIM2 with all four channels capturing, as the parallel PWM inputs RC1 to RC4 run
+static void setupTimer(void)
+{
+    memset(&hostTIM2, 0, sizeof(hostTIM2));
+    timerInit();
+    for (int i = 0; i < 4; i++) {
+        configureTimerCaptureCompareInterrupt(&timerHardware[i], i, captureCallback, overflowCallback);
+    }
+}
+
+// one edge on one channel, the interrupt every PWM and PPM input edge causes
+BENCHMARK(timerCaptureIrq, setupTimer, 10000000)
+{
+    static const uint16_t flags[4] = { TIM_IT_CC1, TIM_IT_CC2, TIM_IT_CC3, TIM_IT_CC4 };
+
+    hostTIM2.CCR1 = iteration;
+    hostTIM2.SR.raise(flags[iteration & 3]);
+    TIM2_IRQHandler();
+}
+
+// the counter overflowing while all four channels have an edge pending
+BENCHMARK(timerAllChannelsIrq, setupTimer, 10000000)
+{
+    hostTIM2.CCR1 = iteration;
+    hostTIM2.SR.raise(TIM_IT_Update | TIM_IT_CC1 | TIM_IT_CC2 | TIM_IT_CC3 | TIM_IT_CC4);
+    TIM2_IRQHandler();
+}
+
+// STUBS
+
+GPIO_TypeDef hostGPIOA, hostGPIOB;
+TIM_TypeDef hostTIM1, hostTIM2, hostTIM3, hostTIM4;
+uint32_t SystemCoreClock = 72000000;
+
+void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t TIM_IT, FunctionalState NewState)
+{
+    if (NewState == ENABLE) {
+        TIMx->DIER |= TIM_IT;
+    } else {
+        TIMx->DIER &= ~TIM_IT;
+    }
+}
+
+void TIM_TimeBaseStructInit(TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct) { (void)TIM_TimeBaseInitStruct; }
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct) { (void)TIMx; (void)TIM_TimeBaseInitStruct; }
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState) { (void)TIMx; (void)NewState; }
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct) { (void)NVIC_InitStruct; }
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState) { (void)RCC_APB1Periph; (void)NewState; }
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState) { (void)RCC_APB2Periph; (void)NewState; }
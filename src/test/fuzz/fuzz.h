@@ -0,0 +1,41 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Fuzz targets for the parsers that take bytes from outside the board: MSP, the CLI, the GPS protocols and the
+// serial receivers.  Each target defines LLVMFuzzerTestOneInput, which libFuzzer calls with every input it
+// generates; fuzz_main.c calls it the same way with the files of a corpus where libFuzzer is not available.
+//
+// The targets run the firmware parsers unchanged.  The serial port below stands in for the UART: what the
+// parser reads is the fuzz input, what it writes is counted and dropped.
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+// bytes serialRead returns, the data must stay valid until they are read
+void fuzzSerialSetInput(const uint8_t *data, size_t size);
+size_t fuzzSerialInputRemaining(void);
+
+// the port returned by openSerialPort, once per function until fuzzSerialReset
+extern serialPort_t fuzzSerialPort;
+extern serialReceiveCallbackPtr fuzzSerialRxCallback;
+extern uint32_t fuzzSerialTxCount;
+
+void fuzzSerialReset(void);
+
+// micros() and millis() on the host, targets move the clock on as bytes arrive
+extern uint32_t fuzzMicros;
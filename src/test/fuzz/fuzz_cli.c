@@ -0,0 +1,75 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+#include "io/serial_cli.h"
+#include "io/gps.h"
+#include "rx/spektrum.h"
+
+#include "fuzz.h"
+#include "fuzz_stubs.h"
+
+void cliInit(serialConfig_t *serialConfig);
+void initPrintfSupport(void);
+
+// the firmware one hands the CLI port to the passthrough service
+gpsEnablePassthroughResult_e gpsEnablePassthrough(uint32_t idleTimeoutMs)
+{
+    UNUSED(idleTimeoutMs);
+    return GPS_PASSTHROUGH_NO_GPS;
+}
+
+// the statistics of a receiver that never sent a frame
+const spektrumStats_t *spektrumGetStats(void)
+{
+    static const spektrumStats_t stats;
+    return &stats;
+}
+
+// ends the last line and leaves the command buffer empty for the next input
+static const uint8_t endOfInput[] = { '\r' };
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool initialised;
+
+    fuzzSerialReset();
+    serialConfig_t *serialConfig = fuzzResetConfig();
+
+    if (!initialised) {
+        initPrintfSupport();
+        cliInit(serialConfig);
+        initialised = true;
+    }
+
+    fuzzSerialSetInput(data, size);
+    cliProcess();
+
+    fuzzSerialSetInput(endOfInput, sizeof(endOfInput));
+    cliProcess();
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "platform.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+#include "io/gps.h"
+
+#include "fuzz.h"
+
+void gpsInit(serialConfig_t *serialConfig, gpsConfig_t *initialGpsConfig);
+
+// the parser keeps its state between inputs, as it does between bytes on the wire; every message starts
+// over at the sync bytes
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static serialConfig_t serialConfig;
+    static gpsConfig_t gpsConfig;
+    static bool initialised;
+
+    if (!initialised) {
+        serialConfig.gps_baudrate = 115200;
+        gpsConfig.provider = GPS_UBLOX;
+        gpsInit(&serialConfig, &gpsConfig);
+        initialised = true;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        gpsNewFrame(data[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Replays a corpus through a fuzz target where libFuzzer is not available, e.g. with gcc, and reports how fast
+// the parser goes.  Every input is run once, so the sanitizers the target was built with check the whole
+// corpus, then the corpus is run over and over until the time is up.
+//
+//   fuzz_<target> [--time seconds] file|directory...
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define MAX_INPUTS 4096
+#define MAX_INPUT_SIZE (64 * 1024)
+
+typedef struct fuzzInput_s {
+    uint8_t *data;
+    size_t size;
+} fuzzInput_t;
+
+static fuzzInput_t inputs[MAX_INPUTS];
+static unsigned inputCount;
+
+static int loadFile(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+
+    if (inputCount >= MAX_INPUTS) {
+        fprintf(stderr, "more than %d inputs, ignoring %s\n", MAX_INPUTS, path);
+        fclose(file);
+        return 0;
+    }
+
+    fuzzInput_t *input = &inputs[inputCount];
+    input->data = malloc(MAX_INPUT_SIZE);
+    input->size = fread(input->data, 1, MAX_INPUT_SIZE, file);
+    fclose(file);
+
+    // shrink to size so the address sanitizer sees reads past the end of the input
+    input->data = realloc(input->data, input->size ? input->size : 1);
+    inputCount++;
+    return 0;
+}
+
+static int loadPath(const char *path)
+{
+    struct stat status;
+
+    if (stat(path, &status) != 0) {
+        fprintf(stderr, "cannot find %s\n", path);
+        return -1;
+    }
+    if (!S_ISDIR(status.st_mode)) {
+        return loadFile(path);
+    }
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return -1;
+    }
+
+    struct dirent *entry;
+    int result = 0;
+    while ((entry = readdir(dir)) != NULL && result == 0) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char entryPath[1024];
+        snprintf(entryPath, sizeof(entryPath), "%s/%s", path, entry->d_name);
+        result = loadPath(entryPath);
+    }
+    closedir(dir);
+    return result;
+}
+
+static double nowSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    double timeBudget = 1;
+    const char *name = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0];
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            timeBudget = atof(argv[++i]);
+        } else if (loadPath(argv[i]) != 0) {
+            return 1;
+        }
+    }
+
+    if (!inputCount) {
+        fprintf(stderr, "usage: %s [--time seconds] file|directory...\n", argv[0]);
+        return 1;
+    }
+
+    for (unsigned i = 0; i < inputCount; i++) {
+        LLVMFuzzerTestOneInput(inputs[i].data, inputs[i].size);
+    }
+
+    uint64_t runs = 0;
+    uint64_t bytes = 0;
+    double start = nowSeconds();
+    double elapsed;
+    do {
+        for (unsigned i = 0; i < inputCount; i++) {
+            LLVMFuzzerTestOneInput(inputs[i].data, inputs[i].size);
+            bytes += inputs[i].size;
+        }
+        runs += inputCount;
+        elapsed = nowSeconds() - start;
+    } while (elapsed < timeBudget);
+
+    printf("%s: %u inputs, %llu runs, %llu bytes, %.2f MB/s\n", name, inputCount,
+        (unsigned long long)runs, (unsigned long long)bytes, bytes / elapsed / 1e6);
+
+    for (unsigned i = 0; i < inputCount; i++) {
+        free(inputs[i].data);
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+#include "io/serial_msp.h"
+
+#include "fuzz.h"
+#include "fuzz_stubs.h"
+
+void mspInit(serialConfig_t *serialConfig);
+
+#define MSP_MAX_FRAME_SIZE (3 + 1 + 1 + 64 + 1)    // header, size, command, payload, checksum
+
+static const uint8_t idle[MSP_MAX_FRAME_SIZE];
+
+// Every input runs against the same configuration, the commands that set it would otherwise make the
+// result depend on the inputs before.
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool initialised;
+
+    fuzzSerialReset();
+    serialConfig_t *serialConfig = fuzzResetConfig();
+
+    if (!initialised) {
+        mspInit(serialConfig);
+        initialised = true;
+    }
+
+    fuzzSerialSetInput(data, size);
+    mspProcess();
+
+    // leave the parser idle for the next input
+    fuzzSerialSetInput(idle, sizeof(idle));
+    mspProcess();
+    return 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "rx/rx.h"
+
+#include "fuzz.h"
+#include "fuzz_rx.h"
+
+#define GAP_STEP_US 100
+
+// volatile so the reads are not optimised away
+static volatile uint16_t channelSum;
+
+void fuzzReceiveFrames(const uint8_t *data, size_t size, uint32_t byteTime, fuzzFrameCompleteFuncPtr frameComplete,
+    rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr readRawRC)
+{
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        fuzzMicros += byteTime + data[i] * GAP_STEP_US;
+        fuzzSerialRxCallback(data[i + 1]);
+
+        if (!frameComplete()) {
+            continue;
+        }
+        for (uint8_t channel = 0; channel < rxRuntimeConfig->channelCount; channel++) {
+            channelSum += readRawRC(rxRuntimeConfig, channel);
+        }
+    }
+}
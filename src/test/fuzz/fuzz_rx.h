@@ -0,0 +1,27 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+typedef bool (*fuzzFrameCompleteFuncPtr)(void);
+
+// Plays the input into the callback of a serial receiver as pairs of a gap and a byte, the gap in 100us
+// steps on top of the time the byte takes on the wire so the fuzzer can split and join frames.  The frame
+// complete function is polled after every byte as the main loop would, and every channel read when it
+// reports a frame.
+void fuzzReceiveFrames(const uint8_t *data, size_t size, uint32_t byteTime, fuzzFrameCompleteFuncPtr frameComplete,
+    rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr readRawRC);
@@ -0,0 +1,51 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "rx/rx.h"
+#include "rx/sbus.h"
+
+#include "fuzz.h"
+#include "fuzz_rx.h"
+
+bool sbusInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback);
+
+#define SBUS_BYTE_TIME_US 120           // 12 bits at 100000 baud
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static rxConfig_t rxConfig;
+    static rxRuntimeConfig_t rxRuntimeConfig;
+    static rcReadRawDataPtr readRawRC;
+
+    fuzzSerialReset();
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    rxConfig.midrc = 1500;
+    sbusInit(&rxConfig, &rxRuntimeConfig, &readRawRC);
+
+    fuzzReceiveFrames(data, size, SBUS_BYTE_TIME_US, sbusFrameComplete, &rxRuntimeConfig, readRawRC);
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "fuzz.h"
+
+serialPort_t fuzzSerialPort;
+serialReceiveCallbackPtr fuzzSerialRxCallback;
+uint32_t fuzzSerialTxCount;
+uint32_t fuzzMicros;
+
+static const uint8_t *inputData;
+static size_t inputSize;
+static uint32_t openedFunctions;
+
+static serialPortFunction_t serialPortFunctions[] = {
+    { SERIAL_PORT_USART1, &fuzzSerialPort, SCENARIO_UNUSED, FUNCTION_NONE },
+};
+
+static const serialPortFunctionList_t serialPortFunctionList = {
+    sizeof(serialPortFunctions) / sizeof(serialPortFunctions[0]),
+    serialPortFunctions
+};
+
+void fuzzSerialSetInput(const uint8_t *data, size_t size)
+{
+    inputData = data;
+    inputSize = size;
+}
+
+size_t fuzzSerialInputRemaining(void)
+{
+    return inputSize;
+}
+
+void fuzzSerialReset(void)
+{
+    openedFunctions = 0;
+    fuzzSerialRxCallback = NULL;
+    fuzzSerialTxCount = 0;
+    fuzzMicros = 0;
+    fuzzSerialSetInput(NULL, 0);
+}
+
+uint32_t micros(void)
+{
+    return fuzzMicros;
+}
+
+uint32_t millis(void)
+{
+    return fuzzMicros / 1000;
+}
+
+// the firmware opens ports until none is left, so every function gets the single port only once
+serialPort_t *openSerialPort(serialPortFunction_e function, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, serialInversion_e inversion)
+{
+    if (openedFunctions & function) {
+        return NULL;
+    }
+    openedFunctions |= function;
+
+    fuzzSerialPort.mode = mode;
+    fuzzSerialPort.inversion = inversion;
+    fuzzSerialPort.baudRate = baudRate;
+    fuzzSerialPort.callback = callback;
+    fuzzSerialRxCallback = callback;
+    serialPortFunctions[0].currentFunction = function;
+
+    return &fuzzSerialPort;
+}
+
+serialPort_t *findOpenSerialPort(uint16_t functionMask)
+{
+    UNUSED(functionMask);
+    return NULL;
+}
+
+void beginSerialPortFunction(serialPort_t *port, serialPortFunction_e function)
+{
+    UNUSED(port);
+    serialPortFunctions[0].currentFunction = function;
+}
+
+bool isSerialPortFunctionAllowed(serialPort_t *port, serialPortFunction_e function)
+{
+    UNUSED(port);
+    return serialPortFunctions[0].scenario & function;
+}
+
+// the reboot and CLI characters are not followed, the CLI has a target of its own
+void evaluateOtherData(uint8_t sr)
+{
+    UNUSED(sr);
+}
+
+const serialPortFunctionList_t *getSerialPortFunctionList(void)
+{
+    return &serialPortFunctionList;
+}
+
+uint8_t serialTotalBytesWaiting(serialPort_t *instance)
+{
+    UNUSED(instance);
+    return inputSize > 0xFF ? 0xFF : inputSize;
+}
+
+uint8_t serialRead(serialPort_t *instance)
+{
+    UNUSED(instance);
+    if (!inputSize) {
+        return 0;
+    }
+    inputSize--;
+    return *inputData++;
+}
+
+void serialWrite(serialPort_t *instance, uint8_t ch)
+{
+    UNUSED(instance);
+    UNUSED(ch);
+    fuzzSerialTxCount++;
+}
+
+void serialPrint(serialPort_t *instance, const char *str)
+{
+    while (*str) {
+        serialWrite(instance, *str++);
+    }
+}
+
+bool isSerialTransmitBufferEmpty(serialPort_t *instance)
+{
+    UNUSED(instance);
+    return true;
+}
+
+void waitForSerialPortToFinishTransmitting(serialPort_t *instance)
+{
+    UNUSED(instance);
+}
+
+void serialSetBaudRate(serialPort_t *instance, uint32_t baudRate)
+{
+    instance->baudRate = baudRate;
+}
+
+uint32_t serialGetBaudRate(serialPort_t *instance)
+{
+    return instance->baudRate;
+}
+
+uint16_t serialBufferPoolUsed(void)
+{
+    return 0;
+}
+
+uint16_t serialBufferPoolRequired(serialConfig_t *serialConfig)
+{
+    UNUSED(serialConfig);
+    return 0;
+}
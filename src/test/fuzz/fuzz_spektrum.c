@@ -0,0 +1,56 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "rx/rx.h"
+#include "rx/spektrum.h"
+
+#include "fuzz.h"
+#include "fuzz_rx.h"
+
+bool spektrumInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback);
+
+#define SPEKTRUM_BYTE_TIME_US 87        // 10 bits at 115200 baud
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static rxConfig_t rxConfig;
+    static rxRuntimeConfig_t rxRuntimeConfig;
+    static rcReadRawDataPtr readRawRC;
+
+    if (size < 1) {
+        return 0;
+    }
+
+    // the first byte picks the resolution, the frames follow
+    fuzzSerialReset();
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    rxConfig.serialrx_provider = (data[0] & 1) ? SERIALRX_SPEKTRUM2048 : SERIALRX_SPEKTRUM1024;
+    spektrumInit(&rxConfig, &rxRuntimeConfig, &readRawRC);
+
+    fuzzReceiveFrames(data + 1, size - 1, SPEKTRUM_BYTE_TIME_US, spektrumFrameComplete, &rxRuntimeConfig, readRawRC);
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "common/axis.h"
+
+#include "drivers/system.h"
+#include "drivers/accgyro.h"
+#include "drivers/serial.h"
+#include "drivers/bus_i2c.h"
+#include "drivers/gpio.h"
+#include "drivers/timer.h"
+#include "drivers/pwm_rx.h"
+#include "drivers/pwm_mapping.h"
+
+#include "flight/flight.h"
+#include "flight/mixer.h"
+#include "flight/thrust_linear.h"
+#include "flight/servo_output.h"
+#include "flight/failsafe.h"
+#include "flight/navigation.h"
+
+#include "rx/rx.h"
+#include "rx/msp.h"
+#include "rx/rssi.h"
+
+#include "io/escservo.h"
+#include "io/rc_controls.h"
+#include "io/gps.h"
+#include "io/gimbal.h"
+#include "io/serial.h"
+#include "io/serial_passthrough.h"
+#include "io/flight_log.h"
+
+#include "telemetry/telemetry.h"
+
+#include "sensors/boardalignment.h"
+#include "sensors/sensors.h"
+#include "sensors/battery.h"
+#include "sensors/acceleration.h"
+#include "sensors/barometer.h"
+#include "sensors/compass.h"
+#include "sensors/gyro.h"
+#include "sensors/gyro_redundancy.h"
+#include "sensors/vibration.h"
+
+#include "config/runtime_config.h"
+#include "config/config.h"
+#include "config/config_profile.h"
+#include "config/config_master.h"
+
+#include "fuzz_stubs.h"
+
+master_t masterConfig;
+profile_t currentProfile;
+
+flags_t f;
+int16_t debug[4];
+uint16_t cycleTime;
+uint32_t SystemCoreClock = 72000000;
+uint32_t hostUniqueId[3] = { 0x12345678, 0x9ABCDEF0, 0x0F1E2D3C };
+
+int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
+uint8_t rcOptions[CHECKBOX_ITEM_COUNT];
+uint16_t rssi;
+rxRuntimeConfig_t rxRuntimeConfig;
+const char rcChannelLetters[] = "AERT1234";
+
+int16_t motor[MAX_SUPPORTED_MOTORS];
+int16_t motor_disarmed[MAX_SUPPORTED_MOTORS];
+int16_t servo[MAX_SUPPORTED_SERVOS];
+
+acc_t acc;
+gyro_t gyro;
+uint8_t accHardware;
+uint8_t gyroHardware;
+uint8_t gyroSecondaryHardware;
+uint16_t acc_1G = 256;
+int16_t accSmooth[XYZ_AXIS_COUNT];
+int16_t gyroData[FLIGHT_DYNAMICS_INDEX_COUNT];
+int16_t magADC[XYZ_AXIS_COUNT];
+rollAndPitchInclination_t inclination;
+int16_t heading;
+int16_t magHold;
+int32_t EstAlt;
+int32_t AltHold;
+int32_t vario;
+
+uint8_t vbat;
+uint8_t vbatResting;
+uint16_t batteryResistance;
+uint8_t batteryCellCount;
+int32_t amperage;
+int32_t mAhDrawn;
+
+int32_t GPS_home[2];
+int32_t GPS_hold[2];
+uint16_t GPS_distanceToHome;
+int16_t GPS_directionToHome;
+navigationMode_e nav_mode;
+
+static uint32_t enabledFeatures;
+static uint32_t enabledSensors;
+
+serialConfig_t *fuzzResetConfig(void)
+{
+    memset(&masterConfig, 0, sizeof(masterConfig));
+    memset(&currentProfile, 0, sizeof(currentProfile));
+
+    masterConfig.mixerConfiguration = MULTITYPE_QUADX;
+    masterConfig.rxConfig.midrc = 1500;
+    masterConfig.rxConfig.mincheck = 1100;
+    masterConfig.rxConfig.maxcheck = 1900;
+    masterConfig.escAndServoConfig.minthrottle = 1150;
+    masterConfig.escAndServoConfig.maxthrottle = 1850;
+    masterConfig.escAndServoConfig.mincommand = 1000;
+    masterConfig.batteryConfig.vbatscale = 110;
+    masterConfig.batteryConfig.vbatmaxcellvoltage = 43;
+    masterConfig.batteryConfig.vbatmincellvoltage = 33;
+    masterConfig.looptime = 3500;
+
+    masterConfig.serialConfig.msp_baudrate = 115200;
+    masterConfig.serialConfig.cli_baudrate = 115200;
+    masterConfig.serialConfig.gps_baudrate = 115200;
+    masterConfig.serialConfig.gps_passthrough_baudrate = 115200;
+
+    currentProfile.controlRateConfig.rcRate8 = 90;
+    currentProfile.controlRateConfig.rcExpo8 = 65;
+    currentProfile.controlRateConfig.thrMid8 = 50;
+    currentProfile.tpa_breakpoint = 1500;
+
+    enabledFeatures = FEATURE_VBAT | FEATURE_GPS;
+    enabledSensors = SENSOR_ACC | SENSOR_BARO | SENSOR_MAG | SENSOR_GPS;
+    memset(&f, 0, sizeof(f));
+
+    return &masterConfig.serialConfig;
+}
+
+bool feature(uint32_t mask)
+{
+    return enabledFeatures & mask;
+}
+
+void featureSet(uint32_t mask)
+{
+    enabledFeatures |= mask;
+}
+
+void featureClear(uint32_t mask)
+{
+    enabledFeatures &= ~mask;
+}
+
+uint32_t featureMask(void)
+{
+    return enabledFeatures;
+}
+
+bool sensors(uint32_t mask)
+{
+    return enabledSensors & mask;
+}
+
+void sensorsSet(uint32_t mask)
+{
+    enabledSensors |= mask;
+}
+
+void sensorsClear(uint32_t mask)
+{
+    enabledSensors &= ~mask;
+}
+
+uint32_t sensorsMask(void)
+{
+    return enabledSensors;
+}
+
+// the configuration stays in RAM, every input starts from fuzzResetConfig
+void readEEPROM(void) {}
+void writeEEPROM(void) {}
+void resetEEPROM(void) {}
+void copyCurrentProfileToProfileSlot(uint8_t profileSlotIndex) { UNUSED(profileSlotIndex); }
+
+void systemReset(bool toBootloader) { UNUSED(toBootloader); }
+uint16_t i2cGetErrorCounter(void) { return 0; }
+
+void accSetCalibrationCycles(uint16_t calibrationCyclesRequired) { UNUSED(calibrationCyclesRequired); }
+uint8_t gyroRedundancySourceCount(void) { return 1; }
+uint8_t gyroRedundancyHealthySourceCount(void) { return 1; }
+
+void mixerLoadMix(int index, motorMixer_t *customMixers) { UNUSED(index); UNUSED(customMixers); }
+void mixerResetMotors(void) {}
+
+static pwmOutputConfiguration_t pwmOutputConfiguration;
+const pwmOutputConfiguration_t *pwmGetOutputConfiguration(void) { return &pwmOutputConfiguration; }
+uint8_t pwmCountTimerConflicts(const pwmOutputConfiguration_t *configuration) { UNUSED(configuration); return 0; }
+
+void parseRcChannels(const char *input, rxConfig_t *rxConfig) { UNUSED(input); UNUSED(rxConfig); }
+
+static linkQuality_t linkQuality;
+const linkQuality_t *getLinkQuality(void) { return &linkQuality; }
+void rxMspFrameRecieve(void) {}
+
+void GPS_set_next_wp(int32_t *lat, int32_t *lon) { UNUSED(lat); UNUSED(lon); }
+void onGpsNewData(void) {}
+
+// the GPS passthrough is never started by the parsers
+bool serialPassthroughStart(serialPort_t *hostPort, serialPort_t *devicePort, uint32_t idleTimeoutMs, serialPassthroughEndCallbackPtr endCallback)
+{
+    UNUSED(hostPort);
+    UNUSED(devicePort);
+    UNUSED(idleTimeoutMs);
+    UNUSED(endCallback);
+    return false;
+}
+bool isSerialPassthroughActive(void) { return false; }
+bool isSerialPortInPassthrough(const serialPort_t *port) { UNUSED(port); return false; }
@@ -0,0 +1,496 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The firmware MSP code on the host, answering on two ptys so host tools such as support/msptool can talk to
+// it without a board, one standing in for the configurator on USB and the other for a telemetry radio on a
+// UART.  mspProcess runs once per looptime as it does from the main loop, reading what arrived since through
+// receive buffers the size of the UART ones.  The configuration and sensors are the stand-ins the MSP fuzz
+// target uses.
+//
+//   msp_pty [-l looptime us] [-b msp_time_budget us] [-s link] [-S second link] [-t seconds]
+//
+// With -t it talks to both ports itself for that long: the first is kept busy with as many requests as its
+// receive buffer holds while the second asks for the attitude every TELEMETRY_INTERVAL_US.  It reports the
+// replies and the worst reply delay on each port and how long mspProcess held up the loop, and the exit
+// status is non-zero if a request went unanswered or a reply was corrupt.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+#include "io/serial_msp.h"
+
+#include "fuzz_stubs.h"
+
+#include "pty.h"
+
+void mspInit(serialConfig_t *serialConfig);
+
+#define DEFAULT_LOOPTIME_US 3500
+#define DEFAULT_TIME_BUDGET_US 300      // as config.c sets msp_time_budget
+#define PTY_PORT_COUNT 2
+#define RX_BUFFER_SIZE 256              // what the serial buffer pool gives an MSP port
+#define TX_BUFFER_SIZE 256
+
+#define MSP_STATUS 101
+#define MSP_RAW_IMU 102
+#define MSP_MOTOR 104
+#define MSP_RC 105
+#define MSP_ATTITUDE 108
+#define MSP_ALTITUDE 109
+
+#define REQUEST_SIZE 6                  // a request without payload
+#define MAX_PENDING_REQUESTS (RX_BUFFER_SIZE / REQUEST_SIZE)
+#define TELEMETRY_INTERVAL_US 20000
+#define DRAIN_US 200000
+
+typedef struct ptyPort_s {
+    serialPort_t port;
+    int fd;
+    bool opened;
+
+    uint8_t rxBuffer[RX_BUFFER_SIZE];
+    uint16_t rxHead;
+    uint16_t rxCount;
+
+    uint8_t txBuffer[TX_BUFFER_SIZE];
+    uint16_t txCount;
+} ptyPort_t;
+
+// the far end of a port in the self test
+typedef struct client_s {
+    const char *name;
+    int fd;
+
+    uint8_t pending[MAX_PENDING_REQUESTS];  // commands asked for and not answered yet, oldest first
+    uint64_t sentAt[MAX_PENDING_REQUESTS];
+    uint8_t pendingHead;
+    uint8_t pendingCount;
+
+    uint8_t reply[3 + 1 + 1 + 255 + 1];
+    uint16_t replyLength;
+
+    uint32_t requests;
+    uint32_t replies;
+    uint32_t corrupt;
+    uint64_t worstDelay;
+} client_t;
+
+static ptyPort_t ptyPorts[PTY_PORT_COUNT];
+
+static serialPortFunction_t serialPortFunctions[PTY_PORT_COUNT] = {
+    { SERIAL_PORT_USART1, &ptyPorts[0].port, SCENARIO_MSP_ONLY, FUNCTION_NONE },
+    { SERIAL_PORT_USART2, &ptyPorts[1].port, SCENARIO_MSP_ONLY, FUNCTION_NONE },
+};
+
+static const serialPortFunctionList_t serialPortFunctionList = {
+    PTY_PORT_COUNT,
+    serialPortFunctions
+};
+
+static uint64_t monotonicMicros(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+uint32_t micros(void)
+{
+    return monotonicMicros();
+}
+
+uint32_t millis(void)
+{
+    return monotonicMicros() / 1000;
+}
+
+static void flushTx(ptyPort_t *ptyPort)
+{
+    uint16_t written = 0;
+
+    while (written < ptyPort->txCount) {
+        ssize_t result = write(ptyPort->fd, ptyPort->txBuffer + written, ptyPort->txCount - written);
+        if (result < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                break;          // nobody reading, the bytes are lost as on an unplugged UART
+            }
+            struct pollfd pollFd = { ptyPort->fd, POLLOUT, 0 };
+            poll(&pollFd, 1, 10);
+            continue;
+        }
+        written += result;
+    }
+    ptyPort->txCount = 0;
+}
+
+static void fillRx(ptyPort_t *ptyPort)
+{
+    while (ptyPort->rxCount < sizeof(ptyPort->rxBuffer)) {
+        uint16_t tail = (ptyPort->rxHead + ptyPort->rxCount) % sizeof(ptyPort->rxBuffer);
+        uint16_t space = (tail >= ptyPort->rxHead) ? sizeof(ptyPort->rxBuffer) - tail : (size_t)(ptyPort->rxHead - tail);
+        ssize_t length = read(ptyPort->fd, ptyPort->rxBuffer + tail, space);
+        if (length <= 0) {
+            break;
+        }
+        ptyPort->rxCount += length;
+    }
+}
+
+static ptyPort_t *ptyPortOf(serialPort_t *instance)
+{
+    return (ptyPort_t *)instance;
+}
+
+serialPort_t *openSerialPort(serialPortFunction_e function, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, serialInversion_e inversion)
+{
+    // MSP opens ports until none is left
+    if (function != FUNCTION_MSP) {
+        return NULL;
+    }
+
+    for (int i = 0; i < PTY_PORT_COUNT; i++) {
+        ptyPort_t *ptyPort = &ptyPorts[i];
+        if (ptyPort->opened) {
+            continue;
+        }
+        ptyPort->opened = true;
+        ptyPort->port.mode = mode;
+        ptyPort->port.inversion = inversion;
+        ptyPort->port.baudRate = baudRate;
+        ptyPort->port.callback = callback;
+        serialPortFunctions[i].currentFunction = function;
+        return &ptyPort->port;
+    }
+    return NULL;
+}
+
+serialPort_t *findOpenSerialPort(uint16_t functionMask)
+{
+    UNUSED(functionMask);
+    return NULL;
+}
+
+const serialPortFunctionList_t *getSerialPortFunctionList(void)
+{
+    return &serialPortFunctionList;
+}
+
+bool isSerialPortFunctionAllowed(serialPort_t *port, serialPortFunction_e function)
+{
+    for (int i = 0; i < PTY_PORT_COUNT; i++) {
+        if (serialPortFunctions[i].port == port) {
+            return serialPortFunctions[i].scenario & function;
+        }
+    }
+    return false;
+}
+
+// neither the board nor the host is rebooted for the reboot character, and there is no CLI to start
+void evaluateOtherData(uint8_t sr)
+{
+    UNUSED(sr);
+}
+
+uint8_t serialTotalBytesWaiting(serialPort_t *instance)
+{
+    ptyPort_t *ptyPort = ptyPortOf(instance);
+    return ptyPort->rxCount > 0xFF ? 0xFF : ptyPort->rxCount;
+}
+
+uint8_t serialRead(serialPort_t *instance)
+{
+    ptyPort_t *ptyPort = ptyPortOf(instance);
+    if (!ptyPort->rxCount) {
+        return 0;
+    }
+    uint8_t c = ptyPort->rxBuffer[ptyPort->rxHead];
+    ptyPort->rxHead = (ptyPort->rxHead + 1) % sizeof(ptyPort->rxBuffer);
+    ptyPort->rxCount--;
+    return c;
+}
+
+void serialWrite(serialPort_t *instance, uint8_t ch)
+{
+    ptyPort_t *ptyPort = ptyPortOf(instance);
+    if (ptyPort->txCount == sizeof(ptyPort->txBuffer)) {
+        flushTx(ptyPort);
+    }
+    ptyPort->txBuffer[ptyPort->txCount++] = ch;
+}
+
+void serialPrint(serialPort_t *instance, const char *str)
+{
+    while (*str) {
+        serialWrite(instance, *str++);
+    }
+}
+
+bool isSerialTransmitBufferEmpty(serialPort_t *instance)
+{
+    return ptyPortOf(instance)->txCount == 0;
+}
+
+void waitForSerialPortToFinishTransmitting(serialPort_t *instance)
+{
+    flushTx(ptyPortOf(instance));
+}
+
+void serialSetBaudRate(serialPort_t *instance, uint32_t baudRate)
+{
+    instance->baudRate = baudRate;
+}
+
+uint32_t serialGetBaudRate(serialPort_t *instance)
+{
+    return instance->baudRate;
+}
+
+// one pass of the main loop, returns how long mspProcess took
+static uint32_t runOnce(uint32_t looptime, uint64_t *nextLoop)
+{
+    if (looptime) {
+        *nextLoop += looptime;
+        struct timespec wakeAt = { *nextLoop / 1000000, (*nextLoop % 1000000) * 1000 };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeAt, NULL);
+    } else {
+        struct pollfd pollFds[PTY_PORT_COUNT];
+        for (int i = 0; i < PTY_PORT_COUNT; i++) {
+            pollFds[i].fd = ptyPorts[i].fd;
+            pollFds[i].events = POLLIN;
+        }
+        poll(pollFds, PTY_PORT_COUNT, 100);
+    }
+
+    for (int i = 0; i < PTY_PORT_COUNT; i++) {
+        fillRx(&ptyPorts[i]);
+    }
+
+    uint64_t startedAt = monotonicMicros();
+    mspProcess();
+    uint32_t processUs = monotonicMicros() - startedAt;
+
+    for (int i = 0; i < PTY_PORT_COUNT; i++) {
+        flushTx(&ptyPorts[i]);
+    }
+    return processUs;
+}
+
+static bool clientOpen(client_t *client, const char *name, ptyPort_t *ptyPort)
+{
+    memset(client, 0, sizeof(*client));
+    client->name = name;
+    client->fd = open(ptsname(ptyPort->fd), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    return client->fd >= 0;
+}
+
+static void clientRequest(client_t *client, uint8_t command)
+{
+    uint8_t request[REQUEST_SIZE] = { '$', 'M', '<', 0, command, command };
+
+    if (client->pendingCount == MAX_PENDING_REQUESTS || write(client->fd, request, sizeof(request)) != sizeof(request)) {
+        return;
+    }
+    uint8_t index = (client->pendingHead + client->pendingCount) % MAX_PENDING_REQUESTS;
+    client->pending[index] = command;
+    client->sentAt[index] = monotonicMicros();
+    client->pendingCount++;
+    client->requests++;
+}
+
+static void clientReplied(client_t *client)
+{
+    uint8_t size = client->reply[3];
+    uint8_t checksum = 0;
+
+    for (int i = 3; i < 5 + size; i++) {
+        checksum ^= client->reply[i];
+    }
+
+    if (client->reply[2] != '>' || checksum != client->reply[5 + size] || !client->pendingCount ||
+            client->reply[4] != client->pending[client->pendingHead]) {
+        client->corrupt++;
+        return;
+    }
+
+    uint64_t delay = monotonicMicros() - client->sentAt[client->pendingHead];
+    if (delay > client->worstDelay) {
+        client->worstDelay = delay;
+    }
+    client->pendingHead = (client->pendingHead + 1) % MAX_PENDING_REQUESTS;
+    client->pendingCount--;
+    client->replies++;
+}
+
+static void clientRead(client_t *client)
+{
+    uint8_t bytes[1024];
+    ssize_t length;
+
+    while ((length = read(client->fd, bytes, sizeof(bytes))) > 0) {
+        for (ssize_t i = 0; i < length; i++) {
+            uint8_t c = bytes[i];
+
+            // resynchronise on the next header after anything unexpected
+            if ((client->replyLength == 0 && c != '$') || (client->replyLength == 1 && c != 'M')) {
+                client->replyLength = 0;
+                client->corrupt += (c != '$');
+                continue;
+            }
+            client->reply[client->replyLength++] = c;
+            if (client->replyLength > 3 && client->replyLength == 6 + client->reply[3]) {
+                clientReplied(client);
+                client->replyLength = 0;
+            }
+        }
+    }
+}
+
+static void reportClient(const client_t *client)
+{
+    printf("%s: %u requests, %u replies, %u corrupt, worst reply delay %.1fms\n", client->name,
+        client->requests, client->replies, client->corrupt, client->worstDelay / 1000.0);
+}
+
+static int selfTest(uint32_t seconds, uint32_t looptime, uint32_t budget)
+{
+    static const uint8_t configuratorCommands[] = { MSP_STATUS, MSP_RAW_IMU, MSP_MOTOR, MSP_RC, MSP_ATTITUDE, MSP_ALTITUDE };
+    client_t configurator, telemetry;
+    uint64_t nextLoop = monotonicMicros();
+    uint64_t end = nextLoop + (uint64_t)seconds * 1000000;
+    uint64_t nextTelemetryAt = nextLoop;
+    uint64_t totalProcessUs = 0;
+    uint32_t worstProcessUs = 0;
+    uint32_t loops = 0;
+    uint32_t overBudget = 0;
+    uint32_t commandIndex = 0;
+
+    if (!clientOpen(&configurator, "configurator port", &ptyPorts[0]) || !clientOpen(&telemetry, "telemetry port", &ptyPorts[1])) {
+        fprintf(stderr, "cannot open the pty slaves: %s\n", strerror(errno));
+        return 1;
+    }
+
+    while (monotonicMicros() < end) {
+        while (configurator.pendingCount < MAX_PENDING_REQUESTS) {
+            clientRequest(&configurator, configuratorCommands[commandIndex++ % sizeof(configuratorCommands)]);
+        }
+        if (monotonicMicros() >= nextTelemetryAt) {
+            clientRequest(&telemetry, MSP_ATTITUDE);
+            nextTelemetryAt += TELEMETRY_INTERVAL_US;
+        }
+
+        uint32_t processUs = runOnce(looptime, &nextLoop);
+        totalProcessUs += processUs;
+        worstProcessUs = processUs > worstProcessUs ? processUs : worstProcessUs;
+        overBudget += (budget && processUs > budget);
+        loops++;
+
+        clientRead(&configurator);
+        clientRead(&telemetry);
+    }
+
+    // let what is on its way arrive
+    uint64_t drainedBy = monotonicMicros() + DRAIN_US;
+    while (monotonicMicros() < drainedBy && (configurator.pendingCount || telemetry.pendingCount)) {
+        runOnce(looptime, &nextLoop);
+        clientRead(&configurator);
+        clientRead(&telemetry);
+    }
+
+    reportClient(&configurator);
+    reportClient(&telemetry);
+    printf("mspProcess per loop: mean %.1fus, worst %uus, %u of %u loops over the %uus budget\n",
+        loops ? (double)totalProcessUs / loops : 0.0, worstProcessUs, overBudget, loops, budget);
+
+    bool lost = configurator.pendingCount || telemetry.pendingCount || configurator.corrupt || telemetry.corrupt;
+    return lost ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t looptime = DEFAULT_LOOPTIME_US;
+    uint32_t budget = DEFAULT_TIME_BUDGET_US;
+    uint32_t seconds = 0;
+    const char *links[PTY_PORT_COUNT] = { NULL, NULL };
+    int option;
+
+    while ((option = getopt(argc, argv, "l:b:s:S:t:h")) != -1) {
+        switch (option) {
+            case 'l':
+                looptime = strtoul(optarg, NULL, 10);
+                break;
+            case 'b':
+                budget = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                links[0] = optarg;
+                break;
+            case 'S':
+                links[1] = optarg;
+                break;
+            case 't':
+                seconds = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-l looptime us] [-b msp_time_budget us] [-s link] [-S second link] [-t seconds]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    for (int i = 0; i < PTY_PORT_COUNT; i++) {
+        ptyPorts[i].fd = ptyOpen(links[i]);
+        if (ptyPorts[i].fd < 0) {
+            fprintf(stderr, "cannot open a pty: %s\n", strerror(errno));
+            return 1;
+        }
+        // ptsname returns the same buffer each time
+        printf("%s%s", i ? " and " : "MSP on ", links[i] ? links[i] : ptsname(ptyPorts[i].fd));
+    }
+    printf(", looptime %uus, budget %uus\n", looptime, budget);
+    fflush(stdout);
+
+    serialConfig_t *serialConfig = fuzzResetConfig();
+    serialConfig->msp_time_budget = budget;
+    mspInit(serialConfig);
+
+    if (seconds) {
+        return selfTest(seconds, looptime, budget);
+    }
+
+    uint64_t nextLoop = monotonicMicros();
+    for (;;) {
+        runOnce(looptime, &nextLoop);
+    }
+}
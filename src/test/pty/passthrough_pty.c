@@ -0,0 +1,422 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Two emulated UARTs bridged by the firmware passthrough service, each on its own pty, for finding out what
+// the passthrough sustains at a baud rate.  The UARTs move bytes between their ring buffers and the ptys no
+// faster than the baud rate allows and drop a received byte when the ring is full, as an overrun on the
+// board would.  serialPassthroughUpdate runs once per update interval, the host port has the buffers of an
+// MSP/CLI port and the device port those of a GPS port unless -d says otherwise.
+//
+// The UARTs and the passthrough run on a simulated clock that sleeps to keep up with the real one, so a
+// host process that is not scheduled for a while catches up in update interval steps rather than seeing
+// its ring buffers overrun.
+//
+//   passthrough_pty [-b baud] [-l update interval us] [-d device rx:tx sizes] [-s host link] [-S device link]
+//                   [-t seconds]
+//
+// With -t it streams a pattern into both ptys at the baud rate for that long, checks what comes out of the
+// other one, reports the throughput each way and then ends the passthrough with the escape sequence.  The
+// exit status is non-zero if bytes were lost or the escape sequence did not end the passthrough.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/serial.h"
+#include "io/serial_passthrough.h"
+
+#include "pty.h"
+
+#define DEFAULT_BAUD_RATE 115200
+#define DEFAULT_UPDATE_INTERVAL_US 1000
+#define HOST_RX_BUFFER_SIZE 256             // what the serial buffer pool gives an MSP/CLI port
+#define HOST_TX_BUFFER_SIZE 256
+#define DEVICE_RX_BUFFER_SIZE 128           // and a GPS port
+#define DEVICE_TX_BUFFER_SIZE 64
+#define MAX_BUFFER_SIZE 256
+
+#define PATTERN_LENGTH 251                  // prime, so a byte tells how many were lost before it
+#define WRITER_LEAD_BYTES 64                // kept queued in the pty ahead of the line so it never idles
+#define DRAIN_US 200000
+
+typedef struct emulatedUart_s {
+    serialPort_t port;
+    const char *name;
+    int fd;                                 // pty master, the UART pins
+
+    uint8_t rx[MAX_BUFFER_SIZE];
+    uint8_t tx[MAX_BUFFER_SIZE];
+
+    uint64_t rxLineBytes;                   // byte slots used on each line since the start
+    uint64_t txLineBytes;
+    uint32_t overruns;
+} emulatedUart_t;
+
+// one direction of the self test
+typedef struct stream_s {
+    int writeFd;                            // pty slaves, the far ends of the UARTs
+    int readFd;
+    uint64_t written;
+    uint64_t expected;                      // index of the next pattern byte
+    uint64_t received;
+    uint64_t receivedInTime;                // by the end of the test, for the throughput
+    uint64_t corrupted;                     // bytes further on in the pattern than was written
+} stream_t;
+
+static uint32_t baudRate = DEFAULT_BAUD_RATE;
+
+static emulatedUart_t hostUart;
+static emulatedUart_t deviceUart;
+
+static uint64_t startedAt;
+static uint64_t simulatedUs;
+static uint32_t updateInterval = DEFAULT_UPDATE_INTERVAL_US;
+
+static uint64_t monotonicMicros(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+uint32_t millis(void)
+{
+    return simulatedUs / 1000;
+}
+
+static uint64_t lineBytesIn(uint64_t us)
+{
+    // 8N1, ten bits a byte
+    return us * baudRate / 10000000;
+}
+
+static uint8_t emulatedUartTotalBytesWaiting(serialPort_t *instance)
+{
+    return (instance->rxBufferHead - instance->rxBufferTail) & (instance->rxBufferSize - 1);
+}
+
+static uint8_t emulatedUartTotalTxFree(serialPort_t *instance)
+{
+    return (instance->txBufferTail - instance->txBufferHead - 1) & (instance->txBufferSize - 1);
+}
+
+static uint8_t emulatedUartRead(serialPort_t *instance)
+{
+    uint8_t ch = instance->rxBuffer[instance->rxBufferTail];
+    instance->rxBufferTail = (instance->rxBufferTail + 1) % instance->rxBufferSize;
+    return ch;
+}
+
+static void emulatedUartWrite(serialPort_t *instance, uint8_t ch)
+{
+    instance->txBuffer[instance->txBufferHead] = ch;
+    instance->txBufferHead = (instance->txBufferHead + 1) % instance->txBufferSize;
+}
+
+static void emulatedUartSetBaudRate(serialPort_t *instance, uint32_t baudRate)
+{
+    instance->baudRate = baudRate;
+}
+
+static bool isEmulatedUartTransmitBufferEmpty(serialPort_t *instance)
+{
+    return instance->txBufferHead == instance->txBufferTail;
+}
+
+static void emulatedUartSetMode(serialPort_t *instance, portMode_t mode)
+{
+    instance->mode = mode;
+}
+
+static const struct serialPortVTable emulatedUartVTable[] = {
+    {
+        emulatedUartWrite,
+        emulatedUartTotalBytesWaiting,
+        emulatedUartTotalTxFree,
+        emulatedUartRead,
+        emulatedUartSetBaudRate,
+        isEmulatedUartTransmitBufferEmpty,
+        emulatedUartSetMode,
+        NULL,
+    }
+};
+
+static bool emulatedUartOpen(emulatedUart_t *uart, const char *name, const char *link, uint16_t rxBufferSize, uint16_t txBufferSize)
+{
+    uart->fd = ptyOpen(link);
+    if (uart->fd < 0) {
+        fprintf(stderr, "cannot open a pty: %s\n", strerror(errno));
+        return false;
+    }
+
+    uart->name = name;
+    uart->port.vTable = emulatedUartVTable;
+    uart->port.mode = MODE_RXTX;
+    uart->port.baudRate = baudRate;
+    uart->port.rxBuffer = uart->rx;
+    uart->port.rxBufferSize = rxBufferSize;
+    uart->port.txBuffer = uart->tx;
+    uart->port.txBufferSize = txBufferSize;
+
+    return true;
+}
+
+// moves what the baud rate allows since the last call between the pty and the ring buffers, slots on a line
+// with nothing to send are gone, as they are on the wire
+static void emulatedUartUpdate(emulatedUart_t *uart)
+{
+    serialPort_t *port = &uart->port;
+    uint8_t bytes[MAX_BUFFER_SIZE * 4];
+    uint64_t lineBytes = lineBytesIn(simulatedUs);
+
+    uint64_t rxSlots = lineBytes - uart->rxLineBytes;
+    uart->rxLineBytes = lineBytes;
+    if (rxSlots > sizeof(bytes)) {
+        rxSlots = sizeof(bytes);
+    }
+    ssize_t length = rxSlots ? read(uart->fd, bytes, rxSlots) : 0;
+    for (ssize_t i = 0; i < length; i++) {
+        if (emulatedUartTotalBytesWaiting(port) == port->rxBufferSize - 1) {
+            uart->overruns++;
+            continue;
+        }
+        port->rxBuffer[port->rxBufferHead] = bytes[i];
+        port->rxBufferHead = (port->rxBufferHead + 1) % port->rxBufferSize;
+    }
+
+    uint64_t txSlots = lineBytes - uart->txLineBytes;
+    uart->txLineBytes = lineBytes;
+    uint16_t count = 0;
+    while (count < txSlots && !isEmulatedUartTransmitBufferEmpty(port)) {
+        bytes[count++] = port->txBuffer[port->txBufferTail];
+        port->txBufferTail = (port->txBufferTail + 1) % port->txBufferSize;
+    }
+    if (count && write(uart->fd, bytes, count) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "%s pty write failed: %s\n", uart->name, strerror(errno));
+    }
+}
+
+static int openSlave(emulatedUart_t *uart)
+{
+    return open(ptsname(uart->fd), O_RDWR | O_NOCTTY | O_NONBLOCK);
+}
+
+static void streamWrite(stream_t *stream)
+{
+    uint8_t bytes[MAX_BUFFER_SIZE * 4];
+    uint64_t target = lineBytesIn(simulatedUs) + WRITER_LEAD_BYTES;
+    uint64_t count = target > stream->written ? target - stream->written : 0;
+
+    if (count > sizeof(bytes)) {
+        count = sizeof(bytes);
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        bytes[i] = (stream->written + i) % PATTERN_LENGTH;
+    }
+    ssize_t length = count ? write(stream->writeFd, bytes, count) : 0;
+    if (length > 0) {
+        stream->written += length;
+    }
+}
+
+static void streamRead(stream_t *stream, bool check)
+{
+    uint8_t bytes[MAX_BUFFER_SIZE * 4];
+    ssize_t length;
+
+    while ((length = read(stream->readFd, bytes, sizeof(bytes))) > 0) {
+        for (ssize_t i = 0; check && i < length; i++) {
+            uint8_t skipped = (bytes[i] + PATTERN_LENGTH - stream->expected % PATTERN_LENGTH) % PATTERN_LENGTH;
+            stream->expected += skipped + 1;
+            stream->received++;
+            if (stream->expected > stream->written) {
+                stream->corrupted++;
+            }
+        }
+    }
+}
+
+// one update interval of the UARTs and the passthrough
+static void runOnce(void)
+{
+    simulatedUs += updateInterval;
+
+    uint64_t wakeAt = startedAt + simulatedUs;
+    if (wakeAt > monotonicMicros()) {
+        struct timespec wakeAtSpec = { wakeAt / 1000000, (wakeAt % 1000000) * 1000 };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeAtSpec, NULL);
+    }
+
+    emulatedUartUpdate(&hostUart);
+    emulatedUartUpdate(&deviceUart);
+    serialPassthroughUpdate();
+}
+
+static void reportStream(const char *name, const stream_t *stream, uint32_t overruns, uint64_t durationUs)
+{
+    double bytesPerSecond = stream->receivedInTime * 1000000.0 / durationUs;
+    double lineRate = baudRate / 10.0;
+
+    printf("%s: %.0f bytes/s, %.1f%% of the line rate, %llu of %llu bytes lost, %u overruns, %llu corrupt\n",
+        name, bytesPerSecond, 100.0 * bytesPerSecond / lineRate,
+        (unsigned long long)(stream->written - stream->received), (unsigned long long)stream->written, overruns,
+        (unsigned long long)stream->corrupted);
+}
+
+static int selfTest(uint32_t seconds)
+{
+    stream_t toDevice = { openSlave(&hostUart), openSlave(&deviceUart), 0, 0, 0, 0, 0 };
+    stream_t toHost = { openSlave(&deviceUart), openSlave(&hostUart), 0, 0, 0, 0, 0 };
+
+    if (toDevice.writeFd < 0 || toDevice.readFd < 0 || toHost.writeFd < 0 || toHost.readFd < 0) {
+        fprintf(stderr, "cannot open the pty slaves: %s\n", strerror(errno));
+        return 1;
+    }
+
+    uint64_t end = (uint64_t)seconds * 1000000;
+
+    while (simulatedUs < end) {
+        streamWrite(&toDevice);
+        streamWrite(&toHost);
+        runOnce();
+        streamRead(&toDevice, true);
+        streamRead(&toHost, true);
+    }
+
+    toDevice.receivedInTime = toDevice.received;
+    toHost.receivedInTime = toHost.received;
+
+    // let what is on its way arrive
+    while (simulatedUs < end + DRAIN_US) {
+        runOnce();
+        streamRead(&toDevice, true);
+        streamRead(&toHost, true);
+    }
+
+    const serialPassthroughStats_t *stats = serialPassthroughGetStats();
+    reportStream("host -> device", &toDevice, hostUart.overruns, end);
+    reportStream("device -> host", &toHost, deviceUart.overruns, end);
+    printf("%.0f updates/s, largest block %u bytes\n", stats->updates * 1000000.0 / simulatedUs, stats->largestBlock);
+
+    uint64_t escapeAt = simulatedUs + SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS * 1100;
+    while (simulatedUs < escapeAt) {
+        runOnce();
+    }
+    if (write(toDevice.writeFd, "+++", 3) != 3) {
+        fprintf(stderr, "cannot write the escape sequence\n");
+    }
+    uint64_t escapedBy = simulatedUs + SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS * 1100;
+    while (simulatedUs < escapedBy && isSerialPassthroughActive()) {
+        runOnce();
+        streamRead(&toDevice, false);
+    }
+
+    bool escaped = !isSerialPassthroughActive();
+    printf("escape sequence: %s\n", escaped ? "ended the passthrough" : "ignored");
+
+    bool lost = toDevice.written != toDevice.received || toHost.written != toHost.received ||
+        toDevice.corrupted || toHost.corrupted;
+    return (lost || !escaped) ? 1 : 0;
+}
+
+static void passthroughEnded(serialPassthroughEnd_e reason)
+{
+    UNUSED(reason);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t seconds = 0;
+    unsigned deviceRxBufferSize = DEVICE_RX_BUFFER_SIZE;
+    unsigned deviceTxBufferSize = DEVICE_TX_BUFFER_SIZE;
+    const char *hostLink = NULL;
+    const char *deviceLink = NULL;
+    int option;
+
+    while ((option = getopt(argc, argv, "b:l:d:s:S:t:h")) != -1) {
+        switch (option) {
+            case 'b':
+                baudRate = strtoul(optarg, NULL, 10);
+                break;
+            case 'l':
+                updateInterval = strtoul(optarg, NULL, 10);
+                break;
+            case 'd':
+                if (sscanf(optarg, "%u:%u", &deviceRxBufferSize, &deviceTxBufferSize) != 2 ||
+                        deviceRxBufferSize > MAX_BUFFER_SIZE || deviceTxBufferSize > MAX_BUFFER_SIZE ||
+                        (deviceRxBufferSize & (deviceRxBufferSize - 1)) || (deviceTxBufferSize & (deviceTxBufferSize - 1))) {
+                    fprintf(stderr, "buffer sizes are powers of two up to %u\n", MAX_BUFFER_SIZE);
+                    return 1;
+                }
+                break;
+            case 's':
+                hostLink = optarg;
+                break;
+            case 'S':
+                deviceLink = optarg;
+                break;
+            case 't':
+                seconds = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-b baud] [-l update interval us] [-d device rx:tx sizes] "
+                    "[-s host link] [-S device link] [-t seconds]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (!baudRate || !updateInterval ||
+            !emulatedUartOpen(&hostUart, "host", hostLink, HOST_RX_BUFFER_SIZE, HOST_TX_BUFFER_SIZE) ||
+            !emulatedUartOpen(&deviceUart, "device", deviceLink, deviceRxBufferSize, deviceTxBufferSize)) {
+        return 1;
+    }
+
+    // ptsname returns the same buffer each time
+    printf("host on %s, ", hostLink ? hostLink : ptsname(hostUart.fd));
+    printf("device on %s, %u baud, update every %uus, buffers rx:tx host %u:%u device %u:%u\n",
+        deviceLink ? deviceLink : ptsname(deviceUart.fd), baudRate, updateInterval,
+        HOST_RX_BUFFER_SIZE, HOST_TX_BUFFER_SIZE, deviceRxBufferSize, deviceTxBufferSize);
+    fflush(stdout);
+
+    startedAt = monotonicMicros();
+    serialPassthroughStart(&hostUart.port, &deviceUart.port, 0, passthroughEnded);
+
+    if (seconds) {
+        return selfTest(seconds);
+    }
+
+    while (isSerialPassthroughActive()) {
+        runOnce();
+    }
+    printf("passthrough ended\n");
+    return 0;
+}
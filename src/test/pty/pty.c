@@ -0,0 +1,57 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "pty.h"
+
+int ptyOpen(const char *link)
+{
+    struct termios options;
+
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        return -1;
+    }
+
+    const char *slaveName = ptsname(fd);
+    int slaveFd = slaveName ? open(slaveName, O_RDWR | O_NOCTTY) : -1;
+    if (slaveFd < 0 || tcgetattr(slaveFd, &options) != 0) {
+        return -1;
+    }
+    // nothing echoed or translated
+    cfmakeraw(&options);
+    tcsetattr(slaveFd, TCSANOW, &options);
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    if (link) {
+        unlink(link);
+        if (symlink(slaveName, link) != 0) {
+            return -1;
+        }
+    }
+
+    return fd;
+}
@@ -15,8 +15,11 @@
  * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
 
 #include <limits.h>
+#include "drivers/adc.h"
 #include "sensors/battery.h"
 
 #include "unittest_macros.h"
@@ -60,12 +63,163 @@ TEST(BatteryTest, BatteryADCToVoltage)
     }
 }
 
+// A 4S pack as an open circuit voltage behind 25 milliohms, sampled at the VBATFREQ rate.  The current sensor
+// gives 40mV per amp.
+#define PACK_RESISTANCE 0.025f
+#define SAMPLE_US 21000
+#define SAMPLES_PER_SECOND (1000000 / SAMPLE_US)
+
+static uint16_t adcChannels[ADC_CHANNEL_COUNT];
+static batteryConfig_t packConfig;
+static uint32_t noiseState;
+
+static void setPack(float openCircuitVolts, float amps)
+{
+    float volts = openCircuitVolts - PACK_RESISTANCE * amps;
+
+    adcChannels[ADC_BATTERY] = lrintf(volts * 10 * 0xFFF / (3.3f * packConfig.vbatscale));
+    adcChannels[ADC_CURRENT] = lrintf(amps * packConfig.currentMeterScale / 10.0f * 4095 / 3300);
+}
+
+static void setupPack(float openCircuitVolts)
+{
+    packConfig.vbatscale = ELEVEN_TO_ONE_VOLTAGE_DIVIDER;
+    packConfig.vbatmaxcellvoltage = 43;
+    packConfig.vbatmincellvoltage = 33;
+    packConfig.currentMeterScale = 400;
+    packConfig.currentMeterOffset = 0;
+    noiseState = 1;
+
+    setPack(openCircuitVolts, 0);
+    batteryInit(&packConfig);
+}
+
+static void sample(void)
+{
+    updateBatteryVoltage();
+    updateCurrentMeter(SAMPLE_US);
+    updateBatteryLoadEstimate();
+}
+
+// hover current with a punch every few seconds and some noise, as flown
+static float flightCurrent(int sampleIndex)
+{
+    noiseState = noiseState * 1103515245 + 12345;
+    float noise = ((int32_t)((noiseState >> 8) & 0xFFFF) - 0x8000) * 2.0f / 0x8000;
+
+    return ((sampleIndex % (4 * SAMPLES_PER_SECOND)) < SAMPLES_PER_SECOND ? 40.0f : 15.0f) + noise;
+}
+
+// flies with the open circuit voltage falling linearly and returns whether the alarm ever sounded
+static bool fly(float fromVolts, float toVolts, int seconds, bool varyCurrent)
+{
+    bool alarm = false;
+    int samples = seconds * SAMPLES_PER_SECOND;
+
+    for (int i = 0; i < samples; i++) {
+        setPack(fromVolts + (toVolts - fromVolts) * i / samples, varyCurrent ? flightCurrent(i) : 20.0f);
+        sample();
+        alarm |= shouldSoundBatteryAlarm();
+    }
+    return alarm;
+}
+
+TEST(BatteryTest, EstimatesPackResistance)
+{
+    // given
+    setupPack(16.8f);
+    EXPECT_EQ(4, batteryCellCount);
+    EXPECT_EQ(0, batteryResistance);
+
+    // when
+    fly(16.8f, 15.6f, 60, true);
+
+    // then
+    EXPECT_NEAR(25, batteryResistance, 4);
+    EXPECT_NEAR(156, vbatResting, 2);
+}
+
+TEST(BatteryTest, AlarmIgnoresSagUnderLoad)
+{
+    // given a pack at 3.45V per cell, which sags below the 3.3V alarm when punched
+    setupPack(14.0f);
+    fly(14.0f, 13.8f, 30, true);
+
+    // when
+    bool sagged = false;
+    bool alarm = false;
+    for (int i = 0; i < 10 * SAMPLES_PER_SECOND; i++) {
+        setPack(13.8f, flightCurrent(i));
+        sample();
+        sagged |= vbat < batteryWarningVoltage;
+        alarm |= shouldSoundBatteryAlarm();
+    }
+
+    // then
+    EXPECT_TRUE(sagged);
+    EXPECT_FALSE(alarm);
+
+    // and it still sounds once the pack is really empty
+    EXPECT_TRUE(fly(13.8f, 12.8f, 20, true));
+}
+
+TEST(BatteryTest, SteadyCurrentKeepsEstimate)
+{
+    // given
+    setupPack(16.4f);
+    fly(16.4f, 16.0f, 60, true);
+    uint16_t learned = batteryResistance;
+
+    // when the current stops varying the fit has nothing to go on
+    fly(16.0f, 15.6f, 60, false);
+
+    // then it keeps what it had and still corrects for the sag
+    EXPECT_NEAR(learned, batteryResistance, 1);
+    EXPECT_NEAR(156, vbatResting, 2);
+}
+
+TEST(BatteryTest, NoCurrentVariationLeavesVoltageAlone)
+{
+    // given
+    setupPack(16.0f);
+
+    // when
+    fly(16.0f, 16.0f, 30, false);
+
+    // then
+    EXPECT_EQ(0, batteryResistance);
+    EXPECT_EQ(vbat, vbatResting);
+}
+
+TEST(BatteryTest, PidCompensationFollowsVoltage)
+{
+    // given a full pack, a little under the 4.3V per cell taken as full
+    setupPack(16.8f);
+
+    // then
+    EXPECT_EQ(4, batteryCellCount);
+    EXPECT_FLOAT_EQ(172.0f / vbat, vbatPidCompensation);
+
+    // when
+    setupPack(14.4f);
+
+    // then
+    EXPECT_NEAR(144, vbat, 1);
+    EXPECT_FLOAT_EQ(172.0f / vbat, vbatPidCompensation);
+
+    // when a 2S pack is run flat the gain is still bounded
+    setupPack(5.0f);
+
+    // then
+    EXPECT_EQ(2, batteryCellCount);
+    EXPECT_FLOAT_EQ(1.5f, vbatPidCompensation);
+}
+
 // STUBS
 
 uint16_t adcGetChannel(uint8_t channel)
 {
-    UNUSED(channel);
-    return 0;
+    return adcChannels[channel];
 }
 
 void delay(uint32_t ms)
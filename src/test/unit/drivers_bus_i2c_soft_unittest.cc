@@ -0,0 +1,501 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/gpio.h"
+#include "drivers/bus_i2c.h"
+#include "drivers/bus_i2c_soft.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define CORE_CLOCK_HZ 72000000
+#define HALF_BIT_CYCLES (CORE_CLOCK_HZ / 800000)
+#define SCL_LOW_MIN_US 1.3f                 // the fast mode minimums
+#define SCL_HIGH_MIN_US 0.6f
+#define SCL_PERIOD_MIN_US 2.5f
+#define CYCLES_PER_POLL 6                   // what one read of the cycle counter takes
+#define SCL_PIN Pin_10                      // I2CDEV_2, as on the NAZE
+#define SDA_PIN Pin_11
+#define MPU_ADDRESS 0x68
+#define MPU_ACCEL_XOUT_H 0x3B
+#define MPU_BURST_LENGTH 14
+#define STRETCH_FOREVER UINT32_MAX
+
+typedef enum {
+    SLAVE_IDLE,
+    SLAVE_ADDRESS,
+    SLAVE_REGISTER,
+    SLAVE_WRITE,
+    SLAVE_READ,
+    SLAVE_IGNORE                            // not addressed, or the master has stopped reading
+} slaveState_e;
+
+// a register file slave, the MPU6050 say, that optionally stretches the clock after every byte
+static struct {
+    uint8_t registers[256];
+    uint8_t pointer;
+    slaveState_e state;
+    uint8_t clocks;                         // rising SCL edges in this byte, the ninth is the ack
+    uint8_t shift;
+    bool masterAcked;
+    bool sdaLow;
+    bool sclLow;
+    uint32_t stretchCycles;
+    uint32_t stretchUntil;
+} slave;
+
+// what the master drives, what the bus carries and what was seen on it
+static struct {
+    bool masterScl, masterSda;
+    bool scl, sda;
+    int starts, stops, violations;
+    uint32_t lastRise, lastFall;
+    uint32_t minHigh, minLow, minPeriod;
+    uint32_t firstStart, lastStop;
+    uint32_t rises;
+    uint32_t byteRiseIntervals;             // sum of rise to rise times within bytes
+    uint32_t byteRiseCount;
+} bus;
+
+static uint32_t counterReads;
+
+static uint32_t now(void)
+{
+    return hostDWT.CYCCNT.value;
+}
+
+static void slaveLoadByte(void)
+{
+    slave.shift = slave.registers[slave.pointer++];
+    slave.sdaLow = !(slave.shift & 0x80);
+}
+
+static void slaveReceiving(void)
+{
+    // the ninth clock has been and gone, move on a byte
+    if (slave.clocks == 9) {
+        slave.sdaLow = false;
+        slave.clocks = 0;
+        switch (slave.state) {
+            case SLAVE_ADDRESS:
+                if (slave.shift & I2C_Direction_Receiver) {
+                    slave.state = SLAVE_READ;
+                    slaveLoadByte();
+                } else {
+                    slave.state = SLAVE_REGISTER;
+                }
+                break;
+            case SLAVE_REGISTER:
+                slave.pointer = slave.shift;
+                slave.state = SLAVE_WRITE;
+                break;
+            case SLAVE_WRITE:
+                slave.registers[slave.pointer++] = slave.shift;
+                break;
+            default:
+                break;
+        }
+        return;
+    }
+    // eight bits in, ack them
+    if (slave.clocks == 8) {
+        if (slave.state == SLAVE_ADDRESS && (slave.shift >> 1) != MPU_ADDRESS) {
+            slave.state = SLAVE_IGNORE;
+            return;
+        }
+        slave.sdaLow = true;
+    }
+}
+
+static void slaveSending(void)
+{
+    if (slave.clocks < 8) {
+        slave.sdaLow = !(slave.shift & (0x80 >> slave.clocks));
+    } else if (slave.clocks == 8) {
+        slave.sdaLow = false;
+    } else {
+        slave.clocks = 0;
+        if (slave.masterAcked) {
+            slaveLoadByte();
+        } else {
+            slave.state = SLAVE_IGNORE;
+        }
+    }
+}
+
+static void slaveSclRose(void)
+{
+    if (slave.state == SLAVE_IDLE || slave.state == SLAVE_IGNORE) {
+        return;
+    }
+    slave.clocks++;
+    if (slave.state == SLAVE_READ) {
+        if (slave.clocks == 9) {
+            slave.masterAcked = !bus.sda;
+        }
+    } else if (slave.clocks <= 8) {
+        slave.shift = slave.shift << 1 | (bus.sda ? 1 : 0);
+    }
+}
+
+static void slaveSclFell(void)
+{
+    if (slave.state == SLAVE_IDLE || slave.state == SLAVE_IGNORE) {
+        return;
+    }
+    if (slave.clocks == 9 && slave.stretchCycles) {
+        slave.sclLow = true;
+        slave.stretchUntil = now() + slave.stretchCycles;
+    }
+    if (slave.state == SLAVE_READ) {
+        slaveSending();
+    } else {
+        slaveReceiving();
+    }
+}
+
+static void busSclEdge(bool high)
+{
+    uint32_t time = now();
+
+    if (high) {
+        if (bus.lastFall && time - bus.lastFall < bus.minLow) {
+            bus.minLow = time - bus.lastFall;
+        }
+        // rises one bit apart are within a byte, a start or a stop between them makes the gap longer
+        if (bus.rises && time - bus.lastRise < 3 * HALF_BIT_CYCLES) {
+            bus.byteRiseIntervals += time - bus.lastRise;
+            bus.byteRiseCount++;
+        }
+        if (bus.rises && time - bus.lastRise < bus.minPeriod) {
+            bus.minPeriod = time - bus.lastRise;
+        }
+        bus.lastRise = time;
+        bus.rises++;
+        bus.scl = true;
+        slaveSclRose();
+    } else {
+        if (bus.lastRise && time - bus.lastRise < bus.minHigh) {
+            bus.minHigh = time - bus.lastRise;
+        }
+        bus.lastFall = time;
+        bus.scl = false;
+        slaveSclFell();
+    }
+}
+
+static void busSdaEdge(bool high)
+{
+    bus.sda = high;
+    if (!bus.scl) {
+        return;
+    }
+    // SDA moving with SCL high is a start or a stop
+    slave.clocks = 0;
+    slave.sdaLow = false;
+    if (high) {
+        bus.stops++;
+        bus.lastStop = now();
+        slave.state = SLAVE_IDLE;
+    } else {
+        if (!bus.starts) {
+            bus.firstStart = now();
+        }
+        bus.starts++;
+        slave.state = SLAVE_ADDRESS;
+        slave.shift = 0;
+    }
+}
+
+static void busResolve(void)
+{
+    for (int settle = 0; settle < 4; settle++) {
+        bool scl = bus.masterScl && !slave.sclLow;
+        bool sda = bus.masterSda && !slave.sdaLow;
+
+        if (scl == bus.scl && sda == bus.sda) {
+            break;
+        }
+        if (scl != bus.scl) {
+            if (scl && sda != bus.sda) {
+                // SDA has to be steady before SCL rises
+                bus.violations++;
+            }
+            if (!scl) {
+                busSclEdge(false);
+                continue;
+            }
+            if (sda != bus.sda) {
+                bus.sda = sda;
+            }
+            busSclEdge(true);
+            continue;
+        }
+        busSdaEdge(sda);
+    }
+
+    hostGPIOB.IDR = (bus.scl ? SCL_PIN : 0) | (bus.sda ? SDA_PIN : 0);
+}
+
+// runs on every read of the cycle counter
+static void busTick(void)
+{
+    uint32_t written = hostGPIOB.BSRR;
+
+    counterReads++;
+    hostDWT.CYCCNT.value += CYCLES_PER_POLL;
+
+    if (written) {
+        if (written & SCL_PIN) {
+            bus.masterScl = true;
+        }
+        if (written & ((uint32_t)SCL_PIN << 16)) {
+            bus.masterScl = false;
+        }
+        if (written & SDA_PIN) {
+            bus.masterSda = true;
+        }
+        if (written & ((uint32_t)SDA_PIN << 16)) {
+            bus.masterSda = false;
+        }
+        hostGPIOB.BSRR = 0;
+    }
+    if (slave.sclLow && slave.stretchCycles != STRETCH_FOREVER && (int32_t)(now() - slave.stretchUntil) >= 0) {
+        slave.sclLow = false;
+    }
+    busResolve();
+}
+
+// the last write of a transfer is not followed by a read of the cycle counter, so the bus catches up here
+static void settleBus(void)
+{
+    busTick();
+}
+
+static float cyclesToUs(uint32_t cycles)
+{
+    return cycles * 1e6f / CORE_CLOCK_HZ;
+}
+
+static void setupBus(uint32_t stretchCycles)
+{
+    memset(&slave, 0, sizeof(slave));
+    memset(&bus, 0, sizeof(bus));
+    for (int i = 0; i < 256; i++) {
+        slave.registers[i] = i * 37 + 11;
+    }
+    slave.stretchCycles = stretchCycles;
+    bus.masterScl = bus.masterSda = true;
+    bus.scl = bus.sda = true;
+    bus.minHigh = bus.minLow = bus.minPeriod = UINT32_MAX;
+
+    memset(&hostGPIOB, 0, sizeof(hostGPIOB));
+    hostGPIOB.IDR = SCL_PIN | SDA_PIN;
+    hostDWT.CYCCNT.value = 1000;
+    hostDWT.CYCCNT.onRead = busTick;
+    SystemCoreClock = CORE_CLOCK_HZ;
+
+    i2cInit(I2CDEV_2);
+}
+
+TEST(BusI2cSoftTest, ReadsRegisterBurst)
+{
+    // given
+    setupBus(0);
+    uint8_t buf[MPU_BURST_LENGTH];
+
+    // when
+    EXPECT_TRUE(i2cRead(MPU_ADDRESS, MPU_ACCEL_XOUT_H, MPU_BURST_LENGTH, buf));
+    settleBus();
+
+    // then
+    for (int i = 0; i < MPU_BURST_LENGTH; i++) {
+        EXPECT_EQ(slave.registers[MPU_ACCEL_XOUT_H + i], buf[i]);
+    }
+    EXPECT_EQ(2, bus.starts);
+    EXPECT_EQ(1, bus.stops);
+    EXPECT_EQ(0, bus.violations);
+    EXPECT_EQ(SLAVE_IDLE, slave.state);
+    EXPECT_TRUE(bus.scl && bus.sda);
+}
+
+TEST(BusI2cSoftTest, WritesRegisters)
+{
+    // given
+    setupBus(0);
+    uint8_t data[] = { 0x01, 0x02, 0x03 };
+
+    // when
+    EXPECT_TRUE(i2cWriteBuffer(MPU_ADDRESS, 0x19, sizeof(data), data));
+    settleBus();
+    EXPECT_TRUE(i2cWrite(MPU_ADDRESS, 0x6B, 0x80));
+    settleBus();
+
+    // then
+    EXPECT_EQ(0x01, slave.registers[0x19]);
+    EXPECT_EQ(0x02, slave.registers[0x1A]);
+    EXPECT_EQ(0x03, slave.registers[0x1B]);
+    EXPECT_EQ(0x80, slave.registers[0x6B]);
+    EXPECT_EQ(2, bus.starts);
+    EXPECT_EQ(2, bus.stops);
+    EXPECT_EQ(0, bus.violations);
+}
+
+TEST(BusI2cSoftTest, RunsAtBusClock)
+{
+    // given
+    setupBus(0);
+    uint8_t buf[MPU_BURST_LENGTH];
+
+    // when
+    EXPECT_TRUE(i2cRead(MPU_ADDRESS, MPU_ACCEL_XOUT_H, MPU_BURST_LENGTH, buf));
+    settleBus();
+
+    // then SCL keeps to the fast mode minimums and the clock is 400kHz, not much less
+    float clockHz = (float)CORE_CLOCK_HZ * bus.byteRiseCount / bus.byteRiseIntervals;
+    float transferUs = cyclesToUs(bus.lastStop - bus.firstStart);
+    printf("bus clock %.0fHz, SCL low %.2fus high %.2fus, %d byte read in %.1fus\n",
+        clockHz, cyclesToUs(bus.minLow), cyclesToUs(bus.minHigh), MPU_BURST_LENGTH, transferUs);
+    EXPECT_GE(cyclesToUs(bus.minLow), SCL_LOW_MIN_US);
+    EXPECT_GE(cyclesToUs(bus.minHigh), SCL_HIGH_MIN_US);
+    EXPECT_GE(cyclesToUs(bus.minPeriod), SCL_PERIOD_MIN_US);
+    EXPECT_LE(clockHz, 402000);
+    EXPECT_GE(clockHz, 390000);
+
+    // 17 bytes of 9 bits, a start, a repeated start and a stop
+    EXPECT_LT(transferUs, 395);
+}
+
+TEST(BusI2cSoftTest, WaitsForStretchedClock)
+{
+    // given a slave that holds SCL low for 20us after every byte
+    setupBus(20 * CORE_CLOCK_HZ / 1000000);
+    uint8_t buf[MPU_BURST_LENGTH];
+
+    // when
+    EXPECT_TRUE(i2cRead(MPU_ADDRESS, MPU_ACCEL_XOUT_H, MPU_BURST_LENGTH, buf));
+    settleBus();
+
+    // then nothing is lost and SCL still gets a whole half bit high once it is let go
+    for (int i = 0; i < MPU_BURST_LENGTH; i++) {
+        EXPECT_EQ(slave.registers[MPU_ACCEL_XOUT_H + i], buf[i]);
+    }
+    EXPECT_GE(cyclesToUs(bus.minHigh), SCL_HIGH_MIN_US);
+    EXPECT_GE(cyclesToUs(bus.minLow), SCL_LOW_MIN_US);
+    EXPECT_EQ(0, bus.violations);
+    EXPECT_GT((bus.lastStop - bus.firstStart) * 1e6f / CORE_CLOCK_HZ, 16 * 20);
+}
+
+TEST(BusI2cSoftTest, GivesUpOnStuckClock)
+{
+    // given a slave that never lets SCL go
+    setupBus(STRETCH_FOREVER);
+    uint8_t buf[MPU_BURST_LENGTH];
+    uint16_t errors = i2cGetErrorCounter();
+
+    // when
+    uint32_t started = now();
+    EXPECT_FALSE(i2cRead(MPU_ADDRESS, MPU_ACCEL_XOUT_H, MPU_BURST_LENGTH, buf));
+    settleBus();
+
+    // then it fails after the stretch timeout and lets go of the bus
+    float elapsedUs = (now() - started) * 1e6f / CORE_CLOCK_HZ;
+    EXPECT_GT(elapsedUs, 1000);
+    EXPECT_LT(elapsedUs, 1100);
+    EXPECT_EQ(errors + 1, i2cGetErrorCounter());
+    EXPECT_TRUE(bus.masterScl && bus.masterSda);
+}
+
+TEST(BusI2cSoftTest, NackedAddressFails)
+{
+    // given
+    setupBus(0);
+    uint8_t buf[MPU_BURST_LENGTH];
+    uint16_t errors = i2cGetErrorCounter();
+
+    // when nothing answers at the address
+    EXPECT_FALSE(i2cRead(MPU_ADDRESS + 1, MPU_ACCEL_XOUT_H, MPU_BURST_LENGTH, buf));
+    settleBus();
+
+    // then the transfer ends with a stop
+    EXPECT_EQ(errors + 1, i2cGetErrorCounter());
+    EXPECT_EQ(1, bus.starts);
+    EXPECT_EQ(1, bus.stops);
+    EXPECT_TRUE(bus.scl && bus.sda);
+
+    // and the next one works
+    EXPECT_TRUE(i2cRead(MPU_ADDRESS, MPU_ACCEL_XOUT_H, MPU_BURST_LENGTH, buf));
+    settleBus();
+    EXPECT_EQ(slave.registers[MPU_ACCEL_XOUT_H], buf[0]);
+}
+
+TEST(BusI2cSoftTest, NonBlockingRead)
+{
+    // given
+    setupBus(0);
+    uint8_t buf[MPU_BURST_LENGTH];
+    uint8_t other;
+
+    // when a timer interrupt services the read
+    EXPECT_TRUE(i2cSoftReadStart(MPU_ADDRESS, MPU_ACCEL_XOUT_H, MPU_BURST_LENGTH, buf));
+    EXPECT_FALSE(i2cSoftReadStart(MPU_ADDRESS, MPU_ACCEL_XOUT_H, MPU_BURST_LENGTH, buf));
+    EXPECT_FALSE(i2cRead(MPU_ADDRESS, 0, 1, &other));
+    settleBus();
+
+    uint32_t mostReads = 0;
+    int services = 0;
+    while (i2cSoftBusy() && services < 100000) {
+        uint32_t before = counterReads;
+        i2cSoftService();
+        services++;
+        if (counterReads - before > mostReads) {
+            mostReads = counterReads - before;
+        }
+        // the rest of the interrupt and the main loop between services
+        hostDWT.CYCCNT.value += HALF_BIT_CYCLES / 3;
+    }
+
+    // then no call waits and the result is the same as the blocking read
+    EXPECT_FALSE(i2cSoftBusy());
+    EXPECT_FALSE(i2cSoftFailed());
+    EXPECT_LE(mostReads, 3u);
+    for (int i = 0; i < MPU_BURST_LENGTH; i++) {
+        EXPECT_EQ(slave.registers[MPU_ACCEL_XOUT_H + i], buf[i]);
+    }
+    EXPECT_EQ(0, bus.violations);
+
+    // and the edges, late by up to a third of a half bit, keep to the minimums
+    EXPECT_GE(cyclesToUs(bus.minLow), SCL_LOW_MIN_US);
+    EXPECT_GE(cyclesToUs(bus.minHigh), SCL_HIGH_MIN_US);
+}
+
+// STUBS
+
+GPIO_TypeDef hostGPIOA, hostGPIOB;
+DWT_Type hostDWT;
+CoreDebug_Type hostCoreDebug;
+uint32_t SystemCoreClock;
+
+void gpioInit(GPIO_TypeDef *gpio, gpio_config_t *config) { UNUSED(gpio); UNUSED(config); }
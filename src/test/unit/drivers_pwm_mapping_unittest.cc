@@ -0,0 +1,201 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/gpio.h"
+#include "drivers/timer.h"
+#include "drivers/pwm_output.h"
+#include "drivers/pwm_rx.h"
+#include "drivers/pwm_mapping.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+pwmOutputConfiguration_t *pwmInit(drv_pwm_config_t *init);
+
+// what pwmInit() asked of the output driver, per servo index
+static const timerHardware_t *servoTimerHardware[MAX_PWM_SERVOS];
+static uint16_t servoRates[MAX_PWM_SERVOS];
+static int servoConfigCount;
+
+static drv_pwm_config_t pwmConfig;
+
+static void setupPwmConfig(bool airplane, bool usePPM)
+{
+    memset(&pwmConfig, 0, sizeof(pwmConfig));
+    pwmConfig.airplane = airplane;
+    pwmConfig.usePPM = usePPM;
+    pwmConfig.useParallelPWM = !usePPM;
+    pwmConfig.useServos = true;
+    pwmConfig.motorPwmRate = 400;
+    pwmConfig.servoPwmRate = 50;
+    pwmConfig.idlePulse = 1000;
+    pwmConfig.servoCenterPulse = 1500;
+
+    memset(servoTimerHardware, 0, sizeof(servoTimerHardware));
+    memset(servoRates, 0, sizeof(servoRates));
+    servoConfigCount = 0;
+}
+
+TEST(PwmMappingTest, ServosUseDefaultRate)
+{
+    // given
+    setupPwmConfig(true, true);
+
+    // when
+    pwmOutputConfiguration_t *configuration = pwmInit(&pwmConfig);
+
+    // then all eight airplane servos run at servo_pwm_rate
+    EXPECT_EQ(8, configuration->servoCount);
+    EXPECT_EQ(8, servoConfigCount);
+    for (int i = 0; i < 8; i++) {
+        EXPECT_EQ(50, servoRates[i]);
+    }
+}
+
+TEST(PwmMappingTest, ServoRatesFollowTheirTimer)
+{
+    // given digital servos on TIM3 and a mix of analog and digital servos on TIM4
+    setupPwmConfig(true, true);
+    uint16_t rates[MAX_PWM_SERVOS] = { 333, 0, 333, 333, 333, 333, 333, 333 };
+    memcpy(pwmConfig.servoPwmRates, rates, sizeof(rates));
+
+    // when
+    pwmOutputConfiguration_t *configuration = pwmInit(&pwmConfig);
+
+    // then servo 1 pulls the whole TIM4 group (servos 0..3, PWM11..14) down to 50Hz
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(&timerHardware[PWM11 + i], servoTimerHardware[i]);
+        EXPECT_EQ(50, servoRates[i]);
+    }
+    // and the TIM3 group (servos 4..7, PWM5..8) keeps its own rate
+    for (int i = 4; i < 8; i++) {
+        EXPECT_EQ(&timerHardware[PWM5 + i - 4], servoTimerHardware[i]);
+        EXPECT_EQ(333, servoRates[i]);
+    }
+    EXPECT_EQ(0, pwmCountTimerConflicts(configuration));
+}
+
+TEST(PwmMappingTest, MultirotorServosShareTimer)
+{
+    // given a tricopter tail servo on PWM9 with a faster rate than the unused second servo output
+    setupPwmConfig(false, true);
+    pwmConfig.servoPwmRates[0] = 333;
+
+    // when
+    pwmOutputConfiguration_t *configuration = pwmInit(&pwmConfig);
+
+    // then PWM9 and PWM10 are both on TIM1 and run at the lower rate
+    EXPECT_EQ(2, configuration->servoCount);
+    EXPECT_EQ(&timerHardware[PWM9], servoTimerHardware[0]);
+    EXPECT_EQ(&timerHardware[PWM10], servoTimerHardware[1]);
+    EXPECT_EQ(50, servoRates[0]);
+    EXPECT_EQ(50, servoRates[1]);
+
+    // unless the second one is asked for the same rate
+    setupPwmConfig(false, true);
+    pwmConfig.servoPwmRates[0] = 333;
+    pwmConfig.servoPwmRates[1] = 333;
+    pwmInit(&pwmConfig);
+    EXPECT_EQ(333, servoRates[0]);
+    EXPECT_EQ(333, servoRates[1]);
+}
+
+TEST(PwmMappingTest, StandardLayoutsHaveNoConflicts)
+{
+    for (int layout = 0; layout < 8; layout++) {
+        // given
+        setupPwmConfig(layout & 1, layout & 2);
+        pwmConfig.extraServos = layout & 4;
+        for (int i = 0; i < MAX_PWM_SERVOS; i++) {
+            pwmConfig.servoPwmRates[i] = (i % 3) ? 333 : 0;
+        }
+
+        // when
+        pwmOutputConfiguration_t *configuration = pwmInit(&pwmConfig);
+
+        // then
+        EXPECT_EQ(0, pwmCountTimerConflicts(configuration)) << "layout " << layout;
+        EXPECT_EQ(configuration->motorCount + configuration->servoCount, configuration->outputCount);
+    }
+}
+
+TEST(PwmMappingTest, DetectsTimerConflicts)
+{
+    // given a motor and a servo on TIM1
+    pwmOutputConfiguration_t configuration;
+    memset(&configuration, 0, sizeof(configuration));
+    configuration.outputCount = 4;
+    configuration.outputs[0] = (pwmOutputAllocation_t){ PWM9, PWM_OUTPUT_MOTOR, 400 };
+    configuration.outputs[1] = (pwmOutputAllocation_t){ PWM10, PWM_OUTPUT_SERVO, 50 };
+    configuration.outputs[2] = (pwmOutputAllocation_t){ PWM11, PWM_OUTPUT_MOTOR, 400 };
+    configuration.outputs[3] = (pwmOutputAllocation_t){ PWM5, PWM_OUTPUT_SERVO, 50 };
+
+    // then
+    EXPECT_EQ(1, pwmCountTimerConflicts(&configuration));
+
+    // when the servo moves to a timer of its own
+    configuration.outputs[1].timerIndex = PWM6;
+
+    // then
+    EXPECT_EQ(0, pwmCountTimerConflicts(&configuration));
+
+    // and outputs of different types at the same rate are fine
+    configuration.outputs[1] = (pwmOutputAllocation_t){ PWM12, PWM_OUTPUT_SERVO, 400 };
+    EXPECT_EQ(0, pwmCountTimerConflicts(&configuration));
+}
+
+// STUBS
+
+GPIO_TypeDef hostGPIOA, hostGPIOB;
+TIM_TypeDef hostTIM1, hostTIM2, hostTIM3, hostTIM4;
+uint32_t SystemCoreClock = 72000000;
+
+void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t TIM_IT, FunctionalState NewState) { UNUSED(TIMx); UNUSED(TIM_IT); UNUSED(NewState); }
+void TIM_TimeBaseStructInit(TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct) { UNUSED(TIM_TimeBaseInitStruct); }
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct) { UNUSED(TIMx); UNUSED(TIM_TimeBaseInitStruct); }
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState) { UNUSED(TIMx); UNUSED(NewState); }
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct) { UNUSED(NVIC_InitStruct); }
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState) { UNUSED(RCC_APB1Periph); UNUSED(NewState); }
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState) { UNUSED(RCC_APB2Periph); UNUSED(NewState); }
+
+void pwmBrushedMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, uint16_t motorPwmRate, uint16_t idlePulse, bool dithering)
+{
+    UNUSED(timerHardware); UNUSED(motorIndex); UNUSED(motorPwmRate); UNUSED(idlePulse); UNUSED(dithering);
+}
+
+void pwmBrushlessMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, uint16_t motorPwmRate, uint16_t idlePulse)
+{
+    UNUSED(timerHardware); UNUSED(motorIndex); UNUSED(motorPwmRate); UNUSED(idlePulse);
+}
+
+void pwmServoConfig(const timerHardware_t *timerHardware, uint8_t servoIndex, uint16_t servoPwmRate, uint16_t servoCenterPulse)
+{
+    UNUSED(servoCenterPulse);
+    servoTimerHardware[servoIndex] = timerHardware;
+    servoRates[servoIndex] = servoPwmRate;
+    servoConfigCount++;
+}
+
+void ppmInConfig(const timerHardware_t *timerHardwarePtr) { UNUSED(timerHardwarePtr); }
+void pwmInConfig(const timerHardware_t *timerHardwarePtr, uint8_t channel) { UNUSED(timerHardwarePtr); UNUSED(channel); }
@@ -0,0 +1,192 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/gpio.h"
+#include "drivers/timer.h"
+#include "drivers/pwm_mapping.h"
+#include "drivers/pwm_output.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define BRUSHED_TIMER_HZ 8000000
+#define AVERAGED_WRITES 256
+
+// motors 0 and 1 on TIM2 channels 1 and 2, as on the CJMCU
+static const timerHardware_t motorTimerHardware[] = {
+    { TIM2, GPIOA, Pin_0, TIM_Channel_1, TIM2_IRQn, 0, Mode_IPD },
+    { TIM2, GPIOA, Pin_1, TIM_Channel_2, TIM2_IRQn, 0, Mode_IPD }
+};
+
+static uint16_t configuredPeriod;
+
+// the driver hands out one of its output ports per call, and the tests between them use fewer than it has
+static uint16_t setupBrushedMotor(uint8_t index, uint16_t motorPwmRate, bool dithering)
+{
+    pwmBrushedMotorConfig(&motorTimerHardware[index], index, motorPwmRate, 0, dithering);
+    return configuredPeriod;
+}
+
+// the duty the command asks for, in timer counts
+static double exactDuty(uint16_t value, uint16_t period)
+{
+    return (value - 1000) * (double)period / 1000;
+}
+
+static double averageDuty(uint8_t index, uint16_t value, int writes)
+{
+    uint32_t sum = 0;
+
+    for (int i = 0; i < writes; i++) {
+        pwmWriteMotor(index, value);
+        sum += index ? hostTIM2.CCR2 : hostTIM2.CCR1;
+    }
+    return (double)sum / writes;
+}
+
+TEST(PwmOutputTest, BrushedMatchesDividingScale)
+{
+    static const uint16_t rates[] = { 1000, 8000, 16000, 24000, 32000 };
+
+    for (unsigned r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        // given
+        uint16_t period = setupBrushedMotor(0, rates[r], false);
+        EXPECT_EQ(BRUSHED_TIMER_HZ / rates[r], period);
+
+        // then every command lands on the count the multiply and divide gave, or the one below where the
+        // period does not divide evenly
+        for (uint16_t value = 1000; value <= 2000; value++) {
+            pwmWriteMotor(0, value);
+            uint16_t dividing = (value - 1000) * period / 1000;
+            EXPECT_LE(hostTIM2.CCR1, dividing) << "rate " << rates[r] << " value " << value;
+            EXPECT_GE(hostTIM2.CCR1 + 1, dividing) << "rate " << rates[r] << " value " << value;
+        }
+    }
+}
+
+TEST(PwmOutputTest, BrushedClampsCommand)
+{
+    // given
+    uint16_t period = setupBrushedMotor(0, 32000, false);
+
+    // then a command below 1000 stops the motor instead of wrapping round to full power
+    pwmWriteMotor(0, 900);
+    EXPECT_EQ(0, hostTIM2.CCR1);
+    pwmWriteMotor(0, 2100);
+    EXPECT_EQ(period, hostTIM2.CCR1);
+
+    // and so does it with dithering
+    setupBrushedMotor(0, 32000, true);
+    pwmWriteMotor(0, 0);
+    EXPECT_EQ(0, hostTIM2.CCR1);
+    pwmWriteMotor(0, 2100);
+    EXPECT_EQ(period, hostTIM2.CCR1);
+}
+
+TEST(PwmOutputTest, DitheringRecoversResolution)
+{
+    // given 333 counts for 1000 steps of command, on one motor without dithering and one with
+    uint16_t period = setupBrushedMotor(0, 24000, false);
+    ASSERT_EQ(333, period);
+    setupBrushedMotor(1, 24000, true);
+    double worstDithered = 0, worstPlain = 0;
+
+    for (uint16_t value = 1000; value <= 2000; value++) {
+        // when the command is held for a while
+        double plain = averageDuty(0, value, AVERAGED_WRITES);
+        double dithered = averageDuty(1, value, AVERAGED_WRITES);
+
+        worstDithered = fmax(worstDithered, fabs(dithered - exactDuty(value, period)));
+        worstPlain = fmax(worstPlain, fabs(plain - exactDuty(value, period)));
+    }
+
+    // then the average duty is within a small fraction of a count, where it was up to a whole count out.  The
+    // fraction carried over from the previous command is part of the dithered error
+    printf("worst average duty error over %d writes: %.4f counts dithered, %.4f plain\n", AVERAGED_WRITES, worstDithered, worstPlain);
+    EXPECT_LT(worstDithered, 1.0 / 64);
+    EXPECT_GE(worstPlain, 0.9);
+}
+
+TEST(PwmOutputTest, DitheringStaysWithinOneCount)
+{
+    // given
+    uint16_t period = setupBrushedMotor(0, 24000, true);
+
+    // when a command between two counts is held
+    uint16_t value = 1457;
+    uint16_t below = (uint16_t)exactDuty(value, period);
+
+    // then the output only ever moves between the counts either side of it
+    for (int i = 0; i < 100; i++) {
+        pwmWriteMotor(0, value);
+        EXPECT_GE(hostTIM2.CCR1, below);
+        EXPECT_LE(hostTIM2.CCR1, below + 1);
+    }
+}
+
+TEST(PwmOutputTest, DitheringTracksChangingCommand)
+{
+    // given
+    uint16_t period = setupBrushedMotor(0, 32000, true);
+
+    // when the command ramps slowly, one step every 16 writes as a 2kHz loop would at a gentle stick movement
+    double requested = 0, delivered = 0;
+    for (uint16_t value = 1100; value < 1900; value++) {
+        for (int i = 0; i < 16; i++) {
+            pwmWriteMotor(0, value);
+            requested += exactDuty(value, period);
+            delivered += hostTIM2.CCR1;
+        }
+    }
+
+    // then the error never builds up, the total delivered is within a count of the total requested
+    EXPECT_NEAR(requested, delivered, 1.0);
+}
+
+// STUBS
+
+GPIO_TypeDef hostGPIOA, hostGPIOB;
+TIM_TypeDef hostTIM1, hostTIM2, hostTIM3, hostTIM4;
+
+void configTimeBase(TIM_TypeDef *tim, uint16_t period, uint8_t mhz)
+{
+    UNUSED(tim);
+    EXPECT_EQ(BRUSHED_TIMER_HZ / 1000000, mhz);
+    configuredPeriod = period;
+}
+
+void gpioInit(GPIO_TypeDef *gpio, gpio_config_t *config) { UNUSED(gpio); UNUSED(config); }
+void TIM_OCStructInit(TIM_OCInitTypeDef *TIM_OCInitStruct) { memset(TIM_OCInitStruct, 0, sizeof(*TIM_OCInitStruct)); }
+void TIM_OC1Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct) { TIMx->CCR1 = TIM_OCInitStruct->TIM_Pulse; }
+void TIM_OC2Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct) { TIMx->CCR2 = TIM_OCInitStruct->TIM_Pulse; }
+void TIM_OC3Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct) { TIMx->CCR3 = TIM_OCInitStruct->TIM_Pulse; }
+void TIM_OC4Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct) { TIMx->CCR4 = TIM_OCInitStruct->TIM_Pulse; }
+void TIM_OC1PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload) { UNUSED(TIMx); UNUSED(TIM_OCPreload); }
+void TIM_OC2PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload) { UNUSED(TIMx); UNUSED(TIM_OCPreload); }
+void TIM_OC3PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload) { UNUSED(TIMx); UNUSED(TIM_OCPreload); }
+void TIM_OC4PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload) { UNUSED(TIMx); UNUSED(TIM_OCPreload); }
+void TIM_CtrlPWMOutputs(TIM_TypeDef *TIMx, FunctionalState NewState) { UNUSED(TIMx); UNUSED(NewState); }
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState) { UNUSED(TIMx); UNUSED(NewState); }
@@ -0,0 +1,165 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/gpio.h"
+#include "drivers/timer.h"
+#include "drivers/serial.h"
+#include "drivers/serial_softserial.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define TIMER_HARDWARE_COUNT 8
+
+void extractAndStoreRxByte(softSerial_t *softSerial);
+
+static volatile uint8_t rxBuffer[128];
+static volatile uint8_t txBuffer[128];
+
+static serialPort_t *openWithBuffers(uint16_t rxBufferSize, uint16_t txBufferSize)
+{
+    serialBuffers_t buffers;
+
+    memset((void *)rxBuffer, 0, sizeof(rxBuffer));
+    memset((void *)txBuffer, 0, sizeof(txBuffer));
+
+    buffers.rxBuffer = rxBuffer;
+    buffers.rxBufferSize = rxBufferSize;
+    buffers.txBuffer = txBuffer;
+    buffers.txBufferSize = txBufferSize;
+
+    return openSoftSerial(SOFTSERIAL1, NULL, 19200, SERIAL_NOT_INVERTED, &buffers);
+}
+
+static void receiveByte(serialPort_t *port, uint8_t c)
+{
+    softSerial_t *softSerial = (softSerial_t *)port;
+
+    // start bit low, the data and the stop bit high, as the rx edges leave them
+    softSerial->internalRxBuffer = (c << 1) | 1;
+    extractAndStoreRxByte(softSerial);
+}
+
+TEST(SoftSerialTest, BytesWaitingUseTheRxBufferSizeWhenTxIsSmaller)
+{
+    // given
+    serialPort_t *port = openWithBuffers(64, 16);
+
+    // when
+    for (int i = 0; i < 40; i++) {
+        receiveByte(port, i);
+    }
+
+    // then
+    EXPECT_EQ(40, softSerialTotalBytesWaiting(port));
+    EXPECT_EQ(15, softSerialTotalTxFree(port));
+
+    for (int i = 0; i < 40; i++) {
+        EXPECT_EQ(i, softSerialReadByte(port));
+    }
+    EXPECT_EQ(0, softSerialTotalBytesWaiting(port));
+}
+
+TEST(SoftSerialTest, BytesWaitingUseTheRxBufferSizeWhenTxIsLarger)
+{
+    // given
+    serialPort_t *port = openWithBuffers(16, 128);
+
+    // when
+    for (int i = 0; i < 12; i++) {
+        receiveByte(port, i);
+    }
+
+    // then
+    EXPECT_EQ(12, softSerialTotalBytesWaiting(port));
+    EXPECT_EQ(127, softSerialTotalTxFree(port));
+}
+
+TEST(SoftSerialTest, BytesWaitingCountAcrossTheRxWrap)
+{
+    // given
+    serialPort_t *port = openWithBuffers(16, 64);
+
+    for (int i = 0; i < 10; i++) {
+        receiveByte(port, i);
+    }
+    for (int i = 0; i < 10; i++) {
+        softSerialReadByte(port);
+    }
+
+    // when
+    for (int i = 0; i < 12; i++) {
+        receiveByte(port, 0xA0 + i);
+    }
+
+    // then
+    EXPECT_GT(port->rxBufferTail, port->rxBufferHead);
+    EXPECT_EQ(12, softSerialTotalBytesWaiting(port));
+    for (int i = 0; i < 12; i++) {
+        EXPECT_EQ(0xA0 + i, softSerialReadByte(port));
+    }
+}
+
+TEST(SoftSerialTest, TxFreeUsesTheTxBufferSize)
+{
+    // given
+    serialPort_t *port = openWithBuffers(64, 16);
+
+    // when
+    for (int i = 0; i < 5; i++) {
+        softSerialWriteByte(port, i);
+    }
+
+    // then
+    EXPECT_EQ(10, softSerialTotalTxFree(port));
+    EXPECT_EQ(0, softSerialTotalBytesWaiting(port));
+}
+
+// STUBS
+
+GPIO_TypeDef hostGPIOA, hostGPIOB;
+TIM_TypeDef hostTIM1, hostTIM2, hostTIM3, hostTIM4;
+uint32_t SystemCoreClock = 72000000;
+
+const timerHardware_t timerHardware[TIMER_HARDWARE_COUNT] = {
+    { TIM2, GPIOA, Pin_0, TIM_Channel_1, TIM2_IRQn, 0, Mode_IPD },
+    { TIM2, GPIOA, Pin_1, TIM_Channel_2, TIM2_IRQn, 0, Mode_IPD },
+    { TIM2, GPIOA, Pin_2, TIM_Channel_3, TIM2_IRQn, 0, Mode_IPD },
+    { TIM2, GPIOA, Pin_3, TIM_Channel_4, TIM2_IRQn, 0, Mode_IPD },
+    { TIM3, GPIOA, Pin_6, TIM_Channel_1, TIM3_IRQn, 0, Mode_IPD },
+    { TIM3, GPIOA, Pin_7, TIM_Channel_2, TIM3_IRQn, 0, Mode_IPD },
+    { TIM3, GPIOB, Pin_0, TIM_Channel_3, TIM3_IRQn, 0, Mode_IPD },
+    { TIM3, GPIOB, Pin_1, TIM_Channel_4, TIM3_IRQn, 0, Mode_IPD },
+};
+
+void delay(uint32_t ms) { UNUSED(ms); }
+void gpioInit(GPIO_TypeDef *gpio, gpio_config_t *config) { UNUSED(gpio); UNUSED(config); }
+void timerConfigure(const timerHardware_t *timerHardwarePtr, uint16_t period, uint8_t mhz) { UNUSED(timerHardwarePtr); UNUSED(period); UNUSED(mhz); }
+void configureTimerCaptureCompareInterrupt(const timerHardware_t *timerHardwarePtr, uint8_t reference, timerCCCallbackPtr *edgeCallback, timerCCCallbackPtr *overflowCallback)
+{
+    UNUSED(timerHardwarePtr); UNUSED(reference); UNUSED(edgeCallback); UNUSED(overflowCallback);
+}
+void TIM_ICStructInit(TIM_ICInitTypeDef *TIM_ICInitStruct) { memset(TIM_ICInitStruct, 0, sizeof(*TIM_ICInitStruct)); }
+void TIM_ICInit(TIM_TypeDef *TIMx, TIM_ICInitTypeDef *TIM_ICInitStruct) { UNUSED(TIMx); UNUSED(TIM_ICInitStruct); }
+void TIM_SetCounter(TIM_TypeDef *TIMx, uint16_t Counter) { UNUSED(TIMx); UNUSED(Counter); }
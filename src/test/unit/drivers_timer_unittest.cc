@@ -0,0 +1,274 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/gpio.h"
+#include "drivers/timer.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+void timerInit(void);
+void TIM2_IRQHandler(void);
+void TIM3_IRQHandler(void);
+
+#define TIMER_TEST_FLAGS (TIM_IT_Update | TIM_IT_CC1 | TIM_IT_CC2 | TIM_IT_CC3 | TIM_IT_CC4)
+#define MAX_TEST_EVENTS 16
+
+typedef enum {
+    EVENT_EDGE,
+    EVENT_OVERFLOW
+} testEventType_e;
+
+typedef struct testEvent_s {
+    testEventType_e type;
+    uint8_t reference;
+    captureCompare_t capture;
+} testEvent_t;
+
+static testEvent_t events[MAX_TEST_EVENTS];
+static int eventCount;
+
+// flags the next edge callback raises, as an edge arriving while the handler runs would
+static uint16_t raiseDuringCallback;
+
+static void recordEvent(testEventType_e type, uint8_t reference, captureCompare_t capture)
+{
+    if (eventCount < MAX_TEST_EVENTS) {
+        events[eventCount].type = type;
+        events[eventCount].reference = reference;
+        events[eventCount].capture = capture;
+    }
+    eventCount++;
+}
+
+static void edgeCallback(uint8_t reference, captureCompare_t capture)
+{
+    recordEvent(EVENT_EDGE, reference, capture);
+
+    TIM2->SR.raise(raiseDuringCallback);
+    raiseDuringCallback = 0;
+}
+
+static void overflowCallback(uint8_t reference, captureCompare_t capture)
+{
+    recordEvent(EVENT_OVERFLOW, reference, capture);
+}
+
+static void resetTimer(TIM_TypeDef *tim)
+{
+    tim->DIER = 0;
+    tim->SR = 0;
+    tim->ARR = 0;
+    tim->CCR1 = 0;
+    tim->CCR2 = 0;
+    tim->CCR3 = 0;
+    tim->CCR4 = 0;
+}
+
+static void setupTimers(void)
+{
+    resetTimer(TIM1);
+    resetTimer(TIM2);
+    resetTimer(TIM3);
+    resetTimer(TIM4);
+    memset(events, 0, sizeof(events));
+    eventCount = 0;
+    raiseDuringCallback = 0;
+
+    timerInit();
+}
+
+// timerHardware[0..3] are TIM2 channels 1 to 4 and [4..7] TIM3 channels 1 to 4
+static void configureTim2Channel(uint8_t channelIndex, timerCCCallbackPtr *edge, timerCCCallbackPtr *overflow)
+{
+    configureTimerCaptureCompareInterrupt(&timerHardware[channelIndex], 10 + channelIndex, edge, overflow);
+}
+
+static void expectEvent(int index, testEventType_e type, uint8_t reference, captureCompare_t capture)
+{
+    ASSERT_LT(index, eventCount);
+    EXPECT_EQ(type, events[index].type) << "event " << index;
+    EXPECT_EQ(reference, events[index].reference) << "event " << index;
+    EXPECT_EQ(capture, events[index].capture) << "event " << index;
+}
+
+TEST(TimerTest, DispatchesCaptureToChannelCallback)
+{
+    // given
+    setupTimers();
+    configureTim2Channel(2, edgeCallback, NULL);
+    TIM2->CCR3 = 1234;
+
+    // when
+    TIM2->SR.raise(TIM_IT_CC3);
+    TIM2_IRQHandler();
+
+    // then
+    EXPECT_EQ(1, eventCount);
+    expectEvent(0, EVENT_EDGE, 12, 1234);
+    EXPECT_EQ(0, TIM2->SR & TIMER_TEST_FLAGS);
+}
+
+TEST(TimerTest, DispatchesUpdateBeforeChannelsInOrder)
+{
+    // given
+    setupTimers();
+    configureTim2Channel(0, edgeCallback, overflowCallback);
+    configureTim2Channel(1, edgeCallback, NULL);
+    configureTim2Channel(2, edgeCallback, overflowCallback);
+    configureTim2Channel(3, edgeCallback, NULL);
+    TIM2->ARR = 0xFFFF;
+    TIM2->CCR1 = 100;
+    TIM2->CCR2 = 200;
+    TIM2->CCR3 = 300;
+    TIM2->CCR4 = 400;
+
+    // when every flag is pending at once
+    TIM2->SR.raise(TIM_IT_CC4 | TIM_IT_CC2 | TIM_IT_Update | TIM_IT_CC3 | TIM_IT_CC1);
+    TIM2_IRQHandler();
+
+    // then the overflows come first, then the edges from channel 1 up
+    EXPECT_EQ(6, eventCount);
+    expectEvent(0, EVENT_OVERFLOW, 10, 0xFFFF);
+    expectEvent(1, EVENT_OVERFLOW, 12, 0xFFFF);
+    expectEvent(2, EVENT_EDGE, 10, 100);
+    expectEvent(3, EVENT_EDGE, 11, 200);
+    expectEvent(4, EVENT_EDGE, 12, 300);
+    expectEvent(5, EVENT_EDGE, 13, 400);
+    EXPECT_EQ(0, TIM2->SR & TIMER_TEST_FLAGS);
+}
+
+TEST(TimerTest, IgnoresFlagsOfDisabledInterrupts)
+{
+    // given
+    setupTimers();
+    configureTim2Channel(0, edgeCallback, NULL);
+
+    // when a channel without its interrupt enabled has a flag, as output compare channels do
+    TIM2->SR.raise(TIM_IT_CC2 | TIM_IT_Update);
+    TIM2_IRQHandler();
+
+    // then it is neither dispatched nor cleared
+    EXPECT_EQ(0, eventCount);
+    EXPECT_EQ(TIM_IT_CC2 | TIM_IT_Update, TIM2->SR & TIMER_TEST_FLAGS);
+}
+
+TEST(TimerTest, KeepsFlagsRaisedDuringDispatch)
+{
+    // given
+    setupTimers();
+    configureTim2Channel(0, edgeCallback, NULL);
+    configureTim2Channel(1, edgeCallback, NULL);
+    TIM2->CCR1 = 100;
+    TIM2->CCR2 = 200;
+
+    // when both channels see another edge while the first is handled
+    raiseDuringCallback = TIM_IT_CC1 | TIM_IT_CC2;
+    TIM2->SR.raise(TIM_IT_CC1);
+    TIM2_IRQHandler();
+
+    // then only the edge pending on entry is dispatched and the new flags stay set
+    EXPECT_EQ(1, eventCount);
+    EXPECT_EQ(TIM_IT_CC1 | TIM_IT_CC2, TIM2->SR & TIMER_TEST_FLAGS);
+
+    // and the next interrupt handles them
+    TIM2->CCR1 = 150;
+    TIM2_IRQHandler();
+    EXPECT_EQ(3, eventCount);
+    expectEvent(1, EVENT_EDGE, 10, 150);
+    expectEvent(2, EVENT_EDGE, 11, 200);
+    EXPECT_EQ(0, TIM2->SR & TIMER_TEST_FLAGS);
+}
+
+TEST(TimerTest, ClearsChannelWithoutCallback)
+{
+    // given
+    setupTimers();
+    configureTimerInputCaptureCompareChannel(TIM2, TIM_Channel_4);
+
+    // when
+    TIM2->SR.raise(TIM_IT_CC4);
+    TIM2_IRQHandler();
+
+    // then
+    EXPECT_EQ(0, eventCount);
+    EXPECT_EQ(0, TIM2->SR & TIMER_TEST_FLAGS);
+}
+
+TEST(TimerTest, DispatchesEachTimerFromItsOwnTable)
+{
+    // given
+    setupTimers();
+    configureTim2Channel(0, edgeCallback, NULL);
+    configureTimerCaptureCompareInterrupt(&timerHardware[4], 20, edgeCallback, NULL);
+    TIM2->CCR1 = 100;
+    TIM3->CCR1 = 300;
+
+    // when
+    TIM3->SR.raise(TIM_IT_CC1);
+    TIM3_IRQHandler();
+
+    // then
+    EXPECT_EQ(1, eventCount);
+    expectEvent(0, EVENT_EDGE, 20, 300);
+}
+
+TEST(TimerTest, ReconfiguringWithoutOverflowRemovesIt)
+{
+    // given
+    setupTimers();
+    configureTim2Channel(0, edgeCallback, overflowCallback);
+    configureTim2Channel(1, edgeCallback, overflowCallback);
+
+    // when
+    configureTimerChannelCallbacks(TIM2, TIM_Channel_1, 10, edgeCallback, NULL);
+    TIM2->SR.raise(TIM_IT_Update);
+    TIM2_IRQHandler();
+
+    // then
+    EXPECT_EQ(1, eventCount);
+    expectEvent(0, EVENT_OVERFLOW, 11, 0);
+}
+
+// STUBS
+
+GPIO_TypeDef hostGPIOA, hostGPIOB;
+TIM_TypeDef hostTIM1, hostTIM2, hostTIM3, hostTIM4;
+uint32_t SystemCoreClock = 72000000;
+
+void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t TIM_IT, FunctionalState NewState)
+{
+    if (NewState == ENABLE) {
+        TIMx->DIER |= TIM_IT;
+    } else {
+        TIMx->DIER &= ~TIM_IT;
+    }
+}
+
+void TIM_TimeBaseStructInit(TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct) { UNUSED(TIM_TimeBaseInitStruct); }
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct) { UNUSED(TIMx); UNUSED(TIM_TimeBaseInitStruct); }
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState) { UNUSED(TIMx); UNUSED(NewState); }
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct) { UNUSED(NVIC_InitStruct); }
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState) { UNUSED(RCC_APB1Periph); UNUSED(NewState); }
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState) { UNUSED(RCC_APB2Periph); UNUSED(NewState); }
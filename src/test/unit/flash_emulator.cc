@@ -0,0 +1,275 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/system.h"
+#include "drivers/bus_spi.h"
+#include "drivers/serial.h"
+
+#include "mock_drivers.h"
+
+#include "flash_emulator.h"
+
+#define FLASH_EMULATOR_TOTAL_SIZE (FLASH_EMULATOR_MAX_SECTORS * FLASH_EMULATOR_SECTOR_SIZE)
+
+#define INSTRUCTION_RDID                0x9F
+#define INSTRUCTION_READ_BYTES          0x03
+#define INSTRUCTION_READ_STATUS_REG     0x05
+#define INSTRUCTION_WRITE_ENABLE        0x06
+#define INSTRUCTION_PAGE_PROGRAM        0x02
+#define INSTRUCTION_SECTOR_ERASE        0xD8
+#define INSTRUCTION_BULK_ERASE          0xC7
+
+#define STATUS_WRITE_IN_PROGRESS        0x01
+#define STATUS_WRITE_ENABLE_LATCH       0x02
+
+GPIO_TypeDef hostGPIOB;
+SPI_TypeDef hostSPI1, hostSPI2;
+
+flashEmulatorStats_t flashEmulatorStats;
+flashEmulatorTiming_t flashEmulatorTiming;
+uint8_t flashEmulatorMemory[FLASH_EMULATOR_TOTAL_SIZE];
+
+static uint32_t jedecId;
+static uint32_t busyUntil;
+static uint32_t busNanoseconds;
+static bool writeEnabled;
+
+// the command in progress while the chip is selected
+static bool selected;
+static bool ignored;
+static uint8_t command;
+static uint32_t byteIndex;
+static uint32_t address;
+static uint8_t programLatch[FLASH_EMULATOR_PAGE_SIZE];
+static bool programLatched[FLASH_EMULATOR_PAGE_SIZE];
+static bool pageWrapped;
+
+void flashEmulatorResetStats(void)
+{
+    memset(&flashEmulatorStats, 0, sizeof(flashEmulatorStats));
+}
+
+void flashEmulatorReset(uint32_t id)
+{
+    jedecId = id;
+    memset(flashEmulatorMemory, 0xFF, sizeof(flashEmulatorMemory));
+
+    flashEmulatorTiming.pageProgramUs = 640;
+    flashEmulatorTiming.sectorEraseUs = 600000;
+    flashEmulatorTiming.bulkEraseUs = 13000000;
+
+    busyUntil = micros();
+    busNanoseconds = 0;
+    writeEnabled = false;
+    selected = false;
+
+    flashEmulatorResetStats();
+}
+
+bool flashEmulatorIsBusy(void)
+{
+    return (int32_t)(micros() - busyUntil) < 0;
+}
+
+uint32_t flashEmulatorViolations(void)
+{
+    return flashEmulatorStats.commandsWhileBusy + flashEmulatorStats.writesWithoutEnable +
+        flashEmulatorStats.pageWraps + flashEmulatorStats.bitsNotSet;
+}
+
+static void setBusy(uint32_t duration)
+{
+    busyUntil = micros() + duration;
+    writeEnabled = false;
+}
+
+static uint8_t transferByte(uint8_t out)
+{
+    uint8_t in = 0xFF;
+
+    busNanoseconds += FLASH_EMULATOR_BYTE_NS;
+    mockAdvanceMicros(busNanoseconds / 1000);
+    busNanoseconds %= 1000;
+    flashEmulatorStats.busBytes++;
+
+    if (!selected || jedecId == FLASH_EMULATOR_JEDEC_ID_NONE) {
+        return in;
+    }
+
+    if (byteIndex == 0) {
+        command = out;
+        address = 0;
+        ignored = flashEmulatorIsBusy() && command != INSTRUCTION_READ_STATUS_REG;
+        if (ignored) {
+            flashEmulatorStats.commandsWhileBusy++;
+        }
+        if (command == INSTRUCTION_READ_STATUS_REG) {
+            flashEmulatorStats.statusReads++;
+        }
+        if (command == INSTRUCTION_PAGE_PROGRAM) {
+            memset(programLatched, 0, sizeof(programLatched));
+            pageWrapped = false;
+        }
+    } else if (!ignored) {
+        switch (command) {
+            case INSTRUCTION_RDID:
+                if (byteIndex <= 3) {
+                    in = jedecId >> (8 * (3 - byteIndex));
+                }
+                break;
+            case INSTRUCTION_READ_STATUS_REG:
+                in = (flashEmulatorIsBusy() ? STATUS_WRITE_IN_PROGRESS : 0) | (writeEnabled ? STATUS_WRITE_ENABLE_LATCH : 0);
+                break;
+            case INSTRUCTION_READ_BYTES:
+            case INSTRUCTION_PAGE_PROGRAM:
+            case INSTRUCTION_SECTOR_ERASE:
+                if (byteIndex <= 3) {
+                    address = (address << 8) | out;
+                } else if (command == INSTRUCTION_READ_BYTES) {
+                    in = flashEmulatorMemory[address % FLASH_EMULATOR_TOTAL_SIZE];
+                    address++;
+                } else if (command == INSTRUCTION_PAGE_PROGRAM) {
+                    uint32_t offset = (address + byteIndex - 4) % FLASH_EMULATOR_PAGE_SIZE;
+                    if (byteIndex - 4 >= FLASH_EMULATOR_PAGE_SIZE - address % FLASH_EMULATOR_PAGE_SIZE) {
+                        pageWrapped = true;
+                    }
+                    programLatch[offset] = out;
+                    programLatched[offset] = true;
+                }
+                break;
+        }
+    }
+
+    byteIndex++;
+    return in;
+}
+
+static void programPage(void)
+{
+    uint32_t pageStart = (address % FLASH_EMULATOR_TOTAL_SIZE) & ~(FLASH_EMULATOR_PAGE_SIZE - 1);
+
+    for (uint32_t i = 0; i < FLASH_EMULATOR_PAGE_SIZE; i++) {
+        if (!programLatched[i]) {
+            continue;
+        }
+        uint8_t *cell = &flashEmulatorMemory[pageStart + i];
+        if ((*cell & programLatch[i]) != programLatch[i]) {
+            flashEmulatorStats.bitsNotSet++;
+        }
+        *cell &= programLatch[i];
+    }
+    if (pageWrapped) {
+        flashEmulatorStats.pageWraps++;
+    }
+    flashEmulatorStats.pagePrograms++;
+    setBusy(flashEmulatorTiming.pageProgramUs);
+}
+
+static bool checkWriteEnabled(void)
+{
+    if (!writeEnabled) {
+        flashEmulatorStats.writesWithoutEnable++;
+    }
+    return writeEnabled;
+}
+
+// the chip acts on writes and erases when it is deselected
+static void deselect(void)
+{
+    selected = false;
+    if (ignored || byteIndex == 0 || jedecId == FLASH_EMULATOR_JEDEC_ID_NONE) {
+        return;
+    }
+
+    switch (command) {
+        case INSTRUCTION_WRITE_ENABLE:
+            writeEnabled = true;
+            break;
+        case INSTRUCTION_PAGE_PROGRAM:
+            if (byteIndex > 4 && checkWriteEnabled()) {
+                programPage();
+            }
+            break;
+        case INSTRUCTION_SECTOR_ERASE:
+            if (byteIndex >= 4 && checkWriteEnabled()) {
+                uint32_t sector = (address % FLASH_EMULATOR_TOTAL_SIZE) / FLASH_EMULATOR_SECTOR_SIZE;
+                memset(&flashEmulatorMemory[sector * FLASH_EMULATOR_SECTOR_SIZE], 0xFF, FLASH_EMULATOR_SECTOR_SIZE);
+                flashEmulatorStats.sectorErases[sector]++;
+                setBusy(flashEmulatorTiming.sectorEraseUs);
+            }
+            break;
+        case INSTRUCTION_BULK_ERASE:
+            if (checkWriteEnabled()) {
+                memset(flashEmulatorMemory, 0xFF, sizeof(flashEmulatorMemory));
+                flashEmulatorStats.bulkErases++;
+                setBusy(flashEmulatorTiming.bulkEraseUs);
+            }
+            break;
+    }
+}
+
+void GPIO_SetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    if (GPIOx == M25P16_CS_GPIO && (GPIO_Pin & M25P16_CS_PIN) && selected) {
+        deselect();
+    }
+}
+
+void GPIO_ResetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    if (GPIOx == M25P16_CS_GPIO && (GPIO_Pin & M25P16_CS_PIN)) {
+        selected = true;
+        byteIndex = 0;
+    }
+}
+
+bool spiInit(SPI_TypeDef *instance)
+{
+    return instance == M25P16_SPI_INSTANCE;
+}
+
+void spiSetDivisor(SPI_TypeDef *instance, uint16_t divisor)
+{
+    UNUSED(instance);
+    UNUSED(divisor);
+}
+
+uint8_t spiTransferByte(SPI_TypeDef *instance, uint8_t data)
+{
+    UNUSED(instance);
+    return transferByte(data);
+}
+
+bool spiTransfer(SPI_TypeDef *instance, uint8_t *out, uint8_t *in, int len)
+{
+    UNUSED(instance);
+    while (len--) {
+        uint8_t b = transferByte(in ? *(in++) : 0xFF);
+        if (out) {
+            *(out++) = b;
+        }
+    }
+    return true;
+}
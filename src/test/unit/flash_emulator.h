@@ -0,0 +1,62 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// An M25P16 class SPI flash behind spiTransferByte, spiTransfer and the chip select GPIO calls.  Programming
+// only clears bits and wraps within the page, erasing sets them again, and the chip stays busy for the
+// program and erase times.  Every byte on the bus advances the mock clock by the time it takes at 18MHz.
+// Commands the driver must not send, such as a program while busy or without a write enable, are counted.
+
+#define FLASH_EMULATOR_SECTOR_SIZE 65536
+#define FLASH_EMULATOR_PAGE_SIZE 256
+#define FLASH_EMULATOR_MAX_SECTORS 32
+#define FLASH_EMULATOR_BYTE_NS 444          // 8 bits at 18MHz
+
+#define FLASH_EMULATOR_JEDEC_ID_M25P16 0x202015
+#define FLASH_EMULATOR_JEDEC_ID_NONE 0xFFFFFF
+
+typedef struct flashEmulatorTiming_s {
+    uint32_t pageProgramUs;
+    uint32_t sectorEraseUs;
+    uint32_t bulkEraseUs;
+} flashEmulatorTiming_t;
+
+typedef struct flashEmulatorStats_s {
+    uint32_t busBytes;
+    uint32_t statusReads;
+    uint32_t pagePrograms;
+    uint32_t bulkErases;
+    uint32_t sectorErases[FLASH_EMULATOR_MAX_SECTORS];
+
+    uint32_t commandsWhileBusy;
+    uint32_t writesWithoutEnable;
+    uint32_t pageWraps;
+    uint32_t bitsNotSet;                    // 1 bits programmed over 0 bits, which stay 0
+} flashEmulatorStats_t;
+
+extern flashEmulatorStats_t flashEmulatorStats;
+extern flashEmulatorTiming_t flashEmulatorTiming;
+extern uint8_t flashEmulatorMemory[FLASH_EMULATOR_MAX_SECTORS * FLASH_EMULATOR_SECTOR_SIZE];
+
+// an erased chip of FLASH_EMULATOR_MAX_SECTORS sectors with the datasheet typical timing, the NONE id
+// leaves the bus floating as on a board without the chip
+void flashEmulatorReset(uint32_t jedecId);
+void flashEmulatorResetStats(void);
+
+bool flashEmulatorIsBusy(void);
+uint32_t flashEmulatorViolations(void);
@@ -0,0 +1,303 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "common/axis.h"
+
+#include "flight/flight.h"
+#include "flight/altitude_controller.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// A vertical plant: thrust proportional to the throttle above min throttle, first order motor lag and
+// linear drag.  The altitude estimate arrives at 40Hz with baro noise, the acceleration every cycle with
+// vibration noise
+// through the default 5Hz accZ filter.  The controller it replaced, the 40Hz BaroPID added to the throttle at engagement, runs
+// on the same plant for comparison.
+
+#define GRAVITY_CMSS 980.665f
+#define CYCLE_US 3500
+#define ESTIMATE_US 25000
+#define MIN_THROTTLE 1150
+#define MAX_THROTTLE 1850
+#define ACCELERATION_GAIN 100               // percent, the alt_hold_accel_gain default
+#define MOTOR_TIME_CONSTANT 0.03f
+#define DRAG 0.3f                           // cm/s/s per cm/s
+#define BARO_NOISE_CM 8
+#define VELOCITY_NOISE_CMS 5
+#define ACC_NOISE_CMSS 150                 // vibration, before the accz_lpf_cutoff filter
+#define ACC_LPF_TIME_CONSTANT (0.5f / (M_PI * 5.0f))
+
+typedef enum {
+    CASCADED,
+    LEGACY
+} controller_e;
+
+typedef struct plant_s {
+    uint16_t hoverThrottle;
+    float motor;                            // lagged throttle
+    float altitude;
+    float velocity;
+    float acceleration;
+} plant_t;
+
+typedef struct result_s {
+    float overshoot;
+    float riseTime;                         // seconds from 10% to 90% of the step
+    float steadyStateError;                 // mean absolute error over the last quarter
+    float worstSag;                         // furthest below the target
+    int maxThrottleStep;                    // largest change from one cycle to the next in the last quarter
+} result_t;
+
+static pidProfile_t pidProfile;
+static plant_t plant;
+static uint32_t noiseState;
+
+static float noise(float amplitude)
+{
+    noiseState = noiseState * 1103515245 + 12345;
+    return ((int32_t)((noiseState >> 8) & 0xFFFF) - 0x8000) * amplitude / 0x8000;
+}
+
+static void setupSimulation(uint16_t hoverThrottle, uint8_t hoverLearnTime)
+{
+    memset(&pidProfile, 0, sizeof(pidProfile));
+    pidProfile.P8[PIDALT] = 50;
+    pidProfile.P8[PIDVEL] = 120;
+    pidProfile.I8[PIDVEL] = 45;
+    pidProfile.D8[PIDVEL] = 1;
+
+    memset(&plant, 0, sizeof(plant));
+    plant.hoverThrottle = hoverThrottle;
+    plant.motor = hoverThrottle;
+    plant.altitude = 100;
+    noiseState = 1;
+
+    configureAltitudeController(&pidProfile, hoverLearnTime, ACCELERATION_GAIN, MIN_THROTTLE, MAX_THROTTLE);
+}
+
+static void stepPlant(uint16_t throttle)
+{
+    float dt = CYCLE_US * 1e-6f;
+
+    plant.motor += (throttle - plant.motor) * dt / (MOTOR_TIME_CONSTANT + dt);
+    plant.acceleration = GRAVITY_CMSS * (plant.motor - MIN_THROTTLE) / (plant.hoverThrottle - MIN_THROTTLE) - GRAVITY_CMSS - DRAG * plant.velocity;
+    plant.velocity += plant.acceleration * dt;
+    plant.altitude += plant.velocity * dt;
+}
+
+int constrain(int amt, int low, int high);
+
+static int32_t applyDeadbandForTest(int32_t value, int32_t deadband)
+{
+    if (abs(value) < deadband) {
+        return 0;
+    }
+    return value > 0 ? value - deadband : value + deadband;
+}
+
+// calculateBaroPid() and multirotorAltHold() as they were
+static int32_t legacyErrorVelocityI;
+
+static int32_t legacyBaroPid(int32_t altHold, int32_t estAlt, int32_t vel, int32_t accZ, int32_t accZOld)
+{
+    int32_t error = applyDeadbandForTest(constrain(altHold - estAlt, -500, 500), 10);
+    int32_t setVel = constrain(pidProfile.P8[PIDALT] * error / 128, -300, 300);
+    int32_t baroPid;
+
+    error = setVel - vel;
+    baroPid = constrain(pidProfile.P8[PIDVEL] * error / 32, -300, 300);
+    legacyErrorVelocityI += pidProfile.I8[PIDVEL] * error;
+    legacyErrorVelocityI = constrain(legacyErrorVelocityI, -(8192 * 200), 8192 * 200);
+    baroPid += legacyErrorVelocityI / 8192;
+    baroPid -= constrain(pidProfile.D8[PIDVEL] * (accZ + accZOld) / 512, -150, 150);
+
+    return baroPid;
+}
+
+static result_t simulate(controller_e controller, uint16_t engageThrottle, int32_t target, float seconds)
+{
+    result_t result = { 0, 0, 0, 0, 0 };
+    int cycles = seconds * 1000000 / CYCLE_US;
+    int lastQuarter = cycles - cycles / 4;
+    float start = plant.altitude;
+    float reached10 = -1, reached90 = -1;
+    uint16_t throttle = engageThrottle;
+    uint16_t lastThrottle = throttle;
+    int32_t baroPid = 0;
+    int32_t accZOld = 0;
+    uint32_t sinceEstimate = 0;
+    altitudeEstimate_t estimate;
+
+    estimate.altitude = lrintf(plant.altitude);
+    estimate.velocity = plant.velocity;
+    estimate.acceleration = 0;
+    legacyErrorVelocityI = 0;
+    altitudeControllerReset(&estimate, engageThrottle);
+    altitudeControllerHoldAltitude(target);
+
+    for (int i = 0; i < cycles; i++) {
+        float time = i * CYCLE_US * 1e-6f;
+
+        float dt = CYCLE_US * 1e-6f;
+        estimate.acceleration += (plant.acceleration + noise(ACC_NOISE_CMSS) - estimate.acceleration) * dt / (ACC_LPF_TIME_CONSTANT + dt);
+        sinceEstimate += CYCLE_US;
+        bool newEstimate = sinceEstimate >= ESTIMATE_US;
+        if (newEstimate) {
+            sinceEstimate -= ESTIMATE_US;
+            estimate.altitude = lrintf(plant.altitude + noise(BARO_NOISE_CM));
+            estimate.velocity = plant.velocity + noise(VELOCITY_NOISE_CMS);
+        }
+
+        if (controller == CASCADED) {
+            throttle = altitudeControllerUpdate(&estimate, CYCLE_US);
+        } else {
+            if (newEstimate) {
+                // accZ in acc units, 512 per g
+                int32_t accZ = lrintf(estimate.acceleration * 512 / GRAVITY_CMSS);
+                baroPid = legacyBaroPid(target, estimate.altitude, lrintf(estimate.velocity), accZ, accZOld);
+                accZOld = accZ;
+            }
+            throttle = constrain(engageThrottle + baroPid, MIN_THROTTLE, MAX_THROTTLE);
+        }
+
+        stepPlant(throttle);
+
+        float step = target - start;
+        if (step != 0) {
+            float progress = (plant.altitude - start) / step;
+            if (reached10 < 0 && progress >= 0.1f) {
+                reached10 = time;
+            }
+            if (reached90 < 0 && progress >= 0.9f) {
+                reached90 = time;
+            }
+            result.overshoot = std::max(result.overshoot, (plant.altitude - target) * (step > 0 ? 1 : -1));
+        }
+        result.worstSag = std::max(result.worstSag, target - plant.altitude);
+        if (i >= lastQuarter) {
+            result.steadyStateError += fabsf(plant.altitude - target) / (cycles - lastQuarter);
+            result.maxThrottleStep = std::max(result.maxThrottleStep, abs((int)throttle - (int)lastThrottle));
+        }
+        lastThrottle = throttle;
+    }
+    result.riseTime = (reached10 >= 0 && reached90 >= 0) ? reached90 - reached10 : seconds;
+
+    return result;
+}
+
+static void printResult(const char *name, result_t *result)
+{
+    printf("%-9s overshoot %5.1fcm  rise %5.2fs  steady state error %5.1fcm  sag %5.1fcm  throttle step %d\n",
+        name, result->overshoot, result->riseTime, result->steadyStateError, result->worstSag, result->maxThrottleStep);
+}
+
+TEST(AltitudeControllerTest, StepResponse)
+{
+    // given a hover throttle the pilot found exactly
+    setupSimulation(1500, 0);
+    result_t legacy = simulate(LEGACY, 1500, 200, 30);
+    setupSimulation(1500, 0);
+
+    // when asked to climb a metre
+    result_t cascaded = simulate(CASCADED, 1500, 200, 30);
+
+    // then
+    printResult("legacy", &legacy);
+    printResult("cascaded", &cascaded);
+    EXPECT_LT(cascaded.overshoot, 15);
+    EXPECT_LT(cascaded.riseTime, 8);
+    EXPECT_LT(cascaded.steadyStateError, 5);
+    EXPECT_LT(cascaded.steadyStateError, legacy.steadyStateError);
+}
+
+TEST(AltitudeControllerTest, HoldsWithWrongHoverThrottle)
+{
+    // given a craft that hovers at 1500 engaged with the stick at 1420
+    setupSimulation(1500, 0);
+    result_t legacy = simulate(LEGACY, 1420, 100, 30);
+    setupSimulation(1500, 0);
+
+    // when
+    result_t cascaded = simulate(CASCADED, 1420, 100, 30);
+
+    // then the acceleration loop catches the sag early and the velocity loop takes out the error
+    printResult("legacy", &legacy);
+    printResult("cascaded", &cascaded);
+    EXPECT_LT(cascaded.worstSag, legacy.worstSag);
+    EXPECT_LT(cascaded.steadyStateError, 5);
+}
+
+TEST(AltitudeControllerTest, LearnsHoverThrottle)
+{
+    // given
+    setupSimulation(1500, 5);
+
+    // when holding altitude from a wrong first guess
+    simulate(CASCADED, 1420, 100, 30);
+
+    // then the hover throttle converges on the real one
+    EXPECT_NEAR(1500, altitudeControllerGetHoverThrottle(), 10);
+
+    // and is kept when alt hold engages again with the stick elsewhere
+    result_t reengaged = simulate(CASCADED, 1350, 100, 10);
+    EXPECT_NEAR(1500, altitudeControllerGetHoverThrottle(), 10);
+    EXPECT_LT(reengaged.worstSag, 10);
+}
+
+TEST(AltitudeControllerTest, ThrottleDoesNotStepWithEstimates)
+{
+    // given
+    setupSimulation(1500, 0);
+    result_t legacy = simulate(LEGACY, 1500, 100, 10);
+    setupSimulation(1500, 0);
+
+    // when hovering
+    result_t cascaded = simulate(CASCADED, 1500, 100, 10);
+
+    // then the throttle moves in small steps every cycle rather than big ones at 40Hz
+    printResult("legacy", &legacy);
+    printResult("cascaded", &cascaded);
+    EXPECT_LT(cascaded.maxThrottleStep, legacy.maxThrottleStep);
+}
+
+TEST(AltitudeControllerTest, ClimbsAtCommandedRate)
+{
+    // given
+    setupSimulation(1500, 0);
+    altitudeEstimate_t estimate = { 100, 0, 0 };
+    altitudeControllerReset(&estimate, 1500);
+    altitudeControllerHoldVelocity(100);
+
+    // when
+    for (int i = 0; i < 5000000 / CYCLE_US; i++) {
+        estimate.altitude = lrintf(plant.altitude);
+        estimate.velocity = plant.velocity;
+        estimate.acceleration = plant.acceleration;
+        stepPlant(altitudeControllerUpdate(&estimate, CYCLE_US));
+    }
+
+    // then
+    EXPECT_NEAR(100, plant.velocity, 5);
+}
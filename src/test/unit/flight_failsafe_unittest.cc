@@ -0,0 +1,489 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/system.h"
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "rx/rx.h"
+#include "io/rc_controls.h"
+
+#include "config/config.h"
+#include "config/runtime_config.h"
+
+#include "flight/failsafe.h"
+
+#include "mock_drivers.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+failsafe_t *failsafeInit(rxConfig_t *intialRxConfig);
+void rxInit(rxConfig_t *rxConfig, failsafe_t *initialFailsafe);
+
+// The receiver code, the failsafe and the real serial decoders run as the main loop runs them, fed frames
+// at each receiver's own rate through the mock serial port.  PPM comes from a stand-in for the capture
+// driver.  When the link goes, the time from the end of the last valid frame to each stage is measured.
+
+#define LOOP_US 3500
+#define BYTE_TIME_115200_US 87
+#define BYTE_TIME_100000_US 120
+#define HOLD_THROTTLE 1600
+#define FAILSAFE_THROTTLE 1200
+#define FAILSAFE_DELAY 10                   // 1s
+#define FAILSAFE_OFF_DELAY 20               // 2s
+
+typedef enum {
+    RECEIVER_SBUS,
+    RECEIVER_SUMD,
+    RECEIVER_SPEKTRUM,
+    RECEIVER_PPM
+} receiver_e;
+
+typedef enum {
+    LINK_UP,
+    LINK_SILENT,                            // the receiver stops sending
+    LINK_FAILSAFE                           // the receiver sends frames saying it has lost the link
+} link_e;
+
+typedef struct receiverModel_s {
+    const char *name;
+    uint32_t features;
+    uint8_t serialrxProvider;
+    uint32_t frameInterval;
+} receiverModel_t;
+
+static const receiverModel_t receiverModels[] = {
+    { "SBUS", FEATURE_RX_SERIAL, SERIALRX_SBUS, 14000 },
+    { "SUMD", FEATURE_RX_SERIAL, SERIALRX_SUMD, 10000 },
+    { "Spektrum", FEATURE_RX_SERIAL, SERIALRX_SPEKTRUM1024, 22000 },
+    { "PPM", FEATURE_RX_PPM, 0, 22500 }
+};
+
+static uint32_t enabledFeatures;
+static rxConfig_t rxConfig;
+static failsafeConfig_t failsafeConfig;
+static failsafe_t *failsafe;
+
+static receiver_e receiver;
+static link_e linkState;
+static uint32_t loopUs;
+static uint32_t nextFrameAt;
+static uint32_t lastValidFrameAt;           // end of the last frame sent with the link up
+static uint32_t stageAt[FAILSAFE_STAGE_LANDED + 1];
+static uint32_t disarmCount;
+
+static uint16_t ppmChannels[8];
+static bool ppmFrame;
+
+static void setupFailsafe(receiver_e receiverToUse, uint32_t loopTime)
+{
+    const receiverModel_t *model = &receiverModels[receiverToUse];
+
+    mockDriversReset();
+    memset(&f, 0, sizeof(f));
+    disarmCount = 0;
+
+    receiver = receiverToUse;
+    linkState = LINK_UP;
+    loopUs = loopTime;
+    nextFrameAt = FAILSAFE_POWER_ON_DELAY_US;
+    lastValidFrameAt = 0;
+    memset(stageAt, 0, sizeof(stageAt));
+    ppmFrame = false;
+    for (int i = 0; i < 8; i++) {
+        ppmChannels[i] = 1500;
+    }
+    ppmChannels[THROTTLE] = HOLD_THROTTLE;
+
+    enabledFeatures = model->features | FEATURE_FAILSAFE;
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    parseRcChannels("AERT1234", &rxConfig);
+    rxConfig.serialrx_provider = model->serialrxProvider;
+    rxConfig.midrc = 1500;
+    rxConfig.mincheck = 1100;
+    rxConfig.maxcheck = 1900;
+
+    failsafeConfig.failsafe_delay = FAILSAFE_DELAY;
+    failsafeConfig.failsafe_off_delay = FAILSAFE_OFF_DELAY;
+    failsafeConfig.failsafe_throttle = FAILSAFE_THROTTLE;
+    failsafeConfig.failsafe_min_usec = 985;
+    failsafeConfig.failsafe_max_usec = 2115;
+
+    failsafe = failsafeInit(&rxConfig);
+    useFailsafeConfig(&failsafeConfig);
+    rxInit(&rxConfig, failsafe);
+    calculateRxChannels(0);                 // the 50Hz fallback from the start of this test
+}
+
+static void sendSbusFrame(void)
+{
+    uint8_t frame[25];
+
+    memset(frame, 0, sizeof(frame));
+    frame[0] = 0x0F;
+    for (int bit = 0; bit < 16 * 11; bit++) {
+        uint16_t value = ((bit / 11 == THROTTLE ? HOLD_THROTTLE : 1500) - 988) * 2;
+        if (value & (1 << (bit % 11))) {
+            frame[1 + bit / 8] |= 1 << (bit % 8);
+        }
+    }
+    frame[23] = linkState == LINK_FAILSAFE ? (1 << 3) : 0;
+    mockSerialReceive(frame, sizeof(frame), BYTE_TIME_100000_US);
+}
+
+static uint16_t sumdCrc(const uint8_t *data, uint8_t length)
+{
+    uint16_t crc = 0;
+
+    while (length--) {
+        crc ^= *data++ << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static void sendSumdFrame(void)
+{
+    uint8_t frame[3 + 8 * 2 + 2];
+    uint8_t length = 0;
+
+    frame[length++] = 0xA8;
+    frame[length++] = linkState == LINK_FAILSAFE ? 0x81 : 0x01;
+    frame[length++] = 8;
+    for (int i = 0; i < 8; i++) {
+        uint16_t value = (i == THROTTLE ? HOLD_THROTTLE : 1500) * 8;
+        frame[length++] = value >> 8;
+        frame[length++] = value & 0xFF;
+    }
+    uint16_t crc = sumdCrc(frame, length);
+    frame[length++] = crc >> 8;
+    frame[length++] = crc & 0xFF;
+    mockSerialReceive(frame, length, BYTE_TIME_115200_US);
+}
+
+static void sendSpektrumFrame(void)
+{
+    uint8_t frame[16];
+
+    frame[0] = 0;
+    frame[1] = 0x01;                        // DSM2 22ms 1024
+    for (int i = 0; i < 7; i++) {
+        uint16_t value = (i == THROTTLE ? HOLD_THROTTLE : 1500) - 988;
+        uint16_t word = (i << 10) | value;
+        frame[2 + i * 2] = word >> 8;
+        frame[3 + i * 2] = word & 0xFF;
+    }
+    mockSerialReceive(frame, sizeof(frame), BYTE_TIME_115200_US);
+}
+
+static void sendPpmFrame(void)
+{
+    // a receiver in failsafe cuts the throttle below the failsafe limits
+    ppmChannels[THROTTLE] = linkState == LINK_FAILSAFE ? 900 : HOLD_THROTTLE;
+    ppmFrame = true;
+}
+
+static void sendFrame(void)
+{
+    switch (receiver) {
+        case RECEIVER_SBUS:
+            sendSbusFrame();
+            break;
+        case RECEIVER_SUMD:
+            sendSumdFrame();
+            break;
+        case RECEIVER_SPEKTRUM:
+            sendSpektrumFrame();
+            break;
+        case RECEIVER_PPM:
+            sendPpmFrame();
+            break;
+    }
+    if (linkState == LINK_UP) {
+        lastValidFrameAt = micros();
+    }
+}
+
+// the receiver side and then the rx half of the main loop, every loopUs
+static void runFor(uint32_t duration)
+{
+    uint32_t end = micros() + duration;
+
+    while ((int32_t)(micros() - end) < 0) {
+        if (linkState != LINK_SILENT && (int32_t)(micros() - nextFrameAt) >= 0) {
+            nextFrameAt += receiverModels[receiver].frameInterval;
+            sendFrame();
+        }
+
+        uint32_t now = micros();
+        failsafeStage_e stage = failsafe->stage;
+
+        updateRx(now);
+        if (shouldProcessRx(now)) {
+            calculateRxChannels(now);
+            if (now > FAILSAFE_POWER_ON_DELAY_US && !failsafe->vTable->isEnabled()) {
+                failsafe->vTable->enable();
+            }
+            failsafe->vTable->updateState(now);
+        }
+        if (failsafe->stage != stage) {
+            stageAt[failsafe->stage] = now;
+        }
+
+        mockAdvanceMicros(loopUs);
+    }
+}
+
+static void armAndFly(void)
+{
+    runFor(FAILSAFE_POWER_ON_DELAY_US + 500000);
+    f.ARMED = 1;
+    runFor(500000);
+}
+
+static uint32_t measureSilentLinkLatency(receiver_e receiverToUse, uint32_t loopTime)
+{
+    setupFailsafe(receiverToUse, loopTime);
+    armAndFly();
+    EXPECT_EQ(FAILSAFE_STAGE_IDLE, failsafe->stage);
+    EXPECT_EQ(HOLD_THROTTLE, rcData[THROTTLE]);
+
+    linkState = LINK_SILENT;
+    runFor(500000);
+
+    EXPECT_EQ(FAILSAFE_STAGE_HOLD, failsafe->stage);
+    return stageAt[FAILSAFE_STAGE_HOLD] - lastValidFrameAt;
+}
+
+TEST(FailsafeTest, SignalLossLatencyPerProvider)
+{
+    for (int i = RECEIVER_SBUS; i <= RECEIVER_PPM; i++) {
+        // when the receiver stops sending
+        uint32_t latency = measureSilentLinkLatency((receiver_e)i, LOOP_US);
+
+        // then the loss is caught FAILSAFE_SIGNAL_LOSS_US after the last frame, to within a couple of loops and
+        // not a couple of frames
+        printf("%-9s frame %5uus  signal lost after %6uus\n", receiverModels[i].name, receiverModels[i].frameInterval, latency);
+        EXPECT_GE(latency, (uint32_t)FAILSAFE_SIGNAL_LOSS_US) << receiverModels[i].name;
+        EXPECT_LE(latency, (uint32_t)FAILSAFE_SIGNAL_LOSS_US + 2 * LOOP_US) << receiverModels[i].name;
+    }
+}
+
+TEST(FailsafeTest, LatencyDoesNotDependOnLoopRate)
+{
+    for (int i = RECEIVER_SBUS; i <= RECEIVER_PPM; i++) {
+        // when
+        uint32_t fast = measureSilentLinkLatency((receiver_e)i, 1000);
+        uint32_t slow = measureSilentLinkLatency((receiver_e)i, 8000);
+
+        // then
+        EXPECT_LE(fast, (uint32_t)FAILSAFE_SIGNAL_LOSS_US + 2 * 1000) << receiverModels[i].name;
+        EXPECT_LE(slow, (uint32_t)FAILSAFE_SIGNAL_LOSS_US + 2 * 8000) << receiverModels[i].name;
+    }
+}
+
+TEST(FailsafeTest, ReceiverIndicatedFailsafeLandsAtOnce)
+{
+    static const receiver_e receivers[] = { RECEIVER_SBUS, RECEIVER_SUMD };
+
+    for (unsigned i = 0; i < sizeof(receivers) / sizeof(receivers[0]); i++) {
+        // given
+        setupFailsafe(receivers[i], LOOP_US);
+        armAndFly();
+
+        // when the receiver flags its frames as failsafe
+        linkState = LINK_FAILSAFE;
+        uint32_t firstFlaggedFrameAt = nextFrameAt;
+        runFor(200000);
+
+        // then the guard time is skipped, within a frame and a loop of the flag
+        EXPECT_EQ(FAILSAFE_STAGE_LANDING, failsafe->stage) << receiverModels[receivers[i]].name;
+        uint32_t latency = stageAt[FAILSAFE_STAGE_LANDING] - firstFlaggedFrameAt;
+        printf("%-9s landing after the first flagged frame started %6uus\n", receiverModels[receivers[i]].name, latency);
+        EXPECT_LE(latency, receiverModels[receivers[i]].frameInterval + LOOP_US) << receiverModels[receivers[i]].name;
+    }
+}
+
+TEST(FailsafeTest, PpmFailsafePulsesAreALostSignal)
+{
+    // given
+    setupFailsafe(RECEIVER_PPM, LOOP_US);
+    armAndFly();
+
+    // when the receiver keeps sending frames with the throttle below failsafe_min_usec
+    linkState = LINK_FAILSAFE;
+    runFor(500000);
+
+    // then
+    EXPECT_EQ(FAILSAFE_STAGE_HOLD, failsafe->stage);
+    uint32_t latency = stageAt[FAILSAFE_STAGE_HOLD] - lastValidFrameAt;
+    EXPECT_GE(latency, (uint32_t)FAILSAFE_SIGNAL_LOSS_US);
+    EXPECT_LE(latency, (uint32_t)FAILSAFE_SIGNAL_LOSS_US + 2 * LOOP_US);
+
+    // and the throttle from before the loss is held, not the receiver's
+    EXPECT_EQ(HOLD_THROTTLE, rcData[THROTTLE]);
+}
+
+TEST(FailsafeTest, HoldsThenLandsThenDisarms)
+{
+    // given
+    setupFailsafe(RECEIVER_SBUS, LOOP_US);
+    armAndFly();
+
+    // when
+    linkState = LINK_SILENT;
+    runFor(500000);
+
+    // then stage one levels with the sticks centred and the throttle held
+    EXPECT_EQ(FAILSAFE_STAGE_HOLD, failsafe->stage);
+    EXPECT_TRUE(failsafe->vTable->shouldForceLevel());
+    EXPECT_FALSE(failsafe->vTable->shouldForceLanding(f.ARMED));
+    EXPECT_EQ(1500, rcData[ROLL]);
+    EXPECT_EQ(1500, rcData[PITCH]);
+    EXPECT_EQ(1500, rcData[YAW]);
+    EXPECT_EQ(HOLD_THROTTLE, rcData[THROTTLE]);
+    EXPECT_FALSE(f.PREVENT_ARMING);
+
+    // when
+    runFor(1000000);
+
+    // then stage two lands failsafe_delay after the last frame
+    EXPECT_EQ(FAILSAFE_STAGE_LANDING, failsafe->stage);
+    EXPECT_TRUE(failsafe->vTable->shouldForceLanding(f.ARMED));
+    EXPECT_EQ(FAILSAFE_THROTTLE, rcData[THROTTLE]);
+    EXPECT_TRUE(f.PREVENT_ARMING);
+    uint32_t landingAfter = stageAt[FAILSAFE_STAGE_LANDING] - lastValidFrameAt;
+    EXPECT_GE(landingAfter, FAILSAFE_DELAY * 100000u);
+    EXPECT_LE(landingAfter, FAILSAFE_DELAY * 100000u + 2 * LOOP_US);
+    EXPECT_EQ(1, failsafe->events);
+
+    // when
+    runFor(FAILSAFE_OFF_DELAY * 100000u);
+
+    // then the motors stop failsafe_off_delay into the landing
+    EXPECT_EQ(FAILSAFE_STAGE_LANDED, failsafe->stage);
+    EXPECT_TRUE(failsafe->vTable->shouldHaveCausedLandingByNow());
+    EXPECT_FALSE(f.ARMED);
+    EXPECT_GT(disarmCount, 0u);
+    uint32_t landedAfter = stageAt[FAILSAFE_STAGE_LANDED] - stageAt[FAILSAFE_STAGE_LANDING];
+    EXPECT_GE(landedAfter, FAILSAFE_OFF_DELAY * 100000u);
+    EXPECT_LE(landedAfter, FAILSAFE_OFF_DELAY * 100000u + LOOP_US);
+}
+
+TEST(FailsafeTest, SignalBackDuringHoldReturnsControl)
+{
+    // given
+    setupFailsafe(RECEIVER_SUMD, LOOP_US);
+    armAndFly();
+    linkState = LINK_SILENT;
+    runFor(300000);
+    ASSERT_EQ(FAILSAFE_STAGE_HOLD, failsafe->stage);
+
+    // when
+    linkState = LINK_UP;
+    nextFrameAt = micros();
+    runFor(LOOP_US * 2);
+
+    // then
+    EXPECT_TRUE(failsafe->vTable->isIdle());
+    EXPECT_FALSE(failsafe->vTable->shouldForceLevel());
+    EXPECT_FALSE(f.PREVENT_ARMING);
+    EXPECT_TRUE(f.ARMED);
+    EXPECT_EQ(0, failsafe->events);
+}
+
+TEST(FailsafeTest, NotEnabledUntilPowerOnDelay)
+{
+    // given a receiver that only starts sending after the power on delay
+    setupFailsafe(RECEIVER_SBUS, LOOP_US);
+    nextFrameAt = FAILSAFE_POWER_ON_DELAY_US + 50000;
+
+    // when
+    runFor(FAILSAFE_POWER_ON_DELAY_US);
+
+    // then nothing happens while it binds
+    EXPECT_TRUE(failsafe->vTable->isIdle());
+
+    // and the signal is only missed from the moment failsafe is enabled
+    runFor(FAILSAFE_SIGNAL_LOSS_US);
+    EXPECT_TRUE(failsafe->vTable->isIdle());
+}
+
+// STUBS
+
+int16_t debug[4];
+flags_t f;
+
+bool feature(uint32_t mask)
+{
+    return enabledFeatures & mask;
+}
+
+void featureClear(uint32_t mask)
+{
+    enabledFeatures &= ~mask;
+}
+
+void mwDisarm(void)
+{
+    disarmCount++;
+    f.ARMED = 0;
+}
+
+static uint16_t ppmReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
+{
+    UNUSED(rxRuntimeConfig);
+    return chan < 8 ? ppmChannels[chan] : 0;
+}
+
+void rxPwmInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
+{
+    rxRuntimeConfig->channelCount = MAX_SUPPORTED_RC_PPM_CHANNEL_COUNT;
+    *callback = ppmReadRawRC;
+}
+
+bool isPWMDataBeingReceived(void)
+{
+    return ppmFrame;
+}
+
+void resetPWMDataReceivedState(void)
+{
+    ppmFrame = false;
+}
+
+bool rxMspInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
+{
+    UNUSED(rxConfig);
+    UNUSED(rxRuntimeConfig);
+    UNUSED(callback);
+    return false;
+}
+
+bool rxMspFrameComplete(void)
+{
+    return false;
+}
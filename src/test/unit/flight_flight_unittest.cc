@@ -0,0 +1,312 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "common/axis.h"
+
+#include "drivers/accgyro.h"
+#include "sensors/sensors.h"
+#include "sensors/gyro.h"
+
+#include "rx/rx.h"
+#include "io/rc_controls.h"
+
+#include "flight/flight.h"
+#include "flight/navigation.h"
+
+#include "config/runtime_config.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+typedef void (*pidControllerFuncPtr)(pidProfile_t *pidProfile, controlRateConfig_t *controlRateConfig,
+        uint16_t max_angle_inclination, rollAndPitchTrims_t *angleTrim);
+extern pidControllerFuncPtr pid_controller;
+extern uint8_t dynP8[3], dynI8[3], dynD8[3];
+extern uint16_t cycleTime;
+
+#define PID_MULTIWII 0
+#define PID_REWRITE 1
+#define PID_BASEFLIGHT 2
+
+#define MAX_ANGLE_INCLINATION 500
+
+static pidProfile_t pidProfile;
+static controlRateConfig_t controlRateConfig;
+static rollAndPitchTrims_t angleTrim;
+
+static void runPid(void)
+{
+    pid_controller(&pidProfile, &controlRateConfig, MAX_ANGLE_INCLINATION, &angleTrim);
+}
+
+static void setupPid(int type)
+{
+    memset(&pidProfile, 0, sizeof(pidProfile));
+    pidProfile.P8[ROLL] = 40;
+    pidProfile.I8[ROLL] = 30;
+    pidProfile.D8[ROLL] = 23;
+    pidProfile.P8[PITCH] = 40;
+    pidProfile.I8[PITCH] = 30;
+    pidProfile.D8[PITCH] = 23;
+    pidProfile.P8[YAW] = 85;
+    pidProfile.I8[YAW] = 45;
+    pidProfile.P8[PIDLEVEL] = 90;
+    pidProfile.I8[PIDLEVEL] = 10;
+    pidProfile.D8[PIDLEVEL] = 100;
+    pidProfile.P_f[ROLL] = 2.5f;
+    pidProfile.I_f[ROLL] = 0.6f;
+    pidProfile.P_f[PITCH] = 2.5f;
+    pidProfile.I_f[PITCH] = 0.6f;
+    pidProfile.P_f[YAW] = 8.0f;
+    pidProfile.I_f[YAW] = 0.5f;
+    pidProfile.A_level = 5.0f;
+    pidProfile.H_level = 3.0f;
+
+    memset(&controlRateConfig, 0, sizeof(controlRateConfig));
+    resetRollAndPitchTrims(&angleTrim);
+    memset(dynP8, 0, sizeof(dynP8));
+    memset(dynI8, 0, sizeof(dynI8));
+    memset(dynD8, 0, sizeof(dynD8));
+
+    memset(&f, 0, sizeof(f));
+    memset(rcCommand, 0, sizeof(rcCommand));
+    memset(gyroData, 0, sizeof(gyroData));
+    memset(&inclination, 0, sizeof(inclination));
+    memset(GPS_angle, 0, sizeof(GPS_angle));
+    gyro.scale = 0.1f;
+    cycleTime = 3500;
+
+    setPIDController(type);
+
+    // the controllers keep their derivative history in statics, flush it with still inputs
+    for (int i = 0; i < 3; i++) {
+        runPid();
+    }
+    resetErrorGyro();
+    resetErrorAngle();
+}
+
+TEST(FlightPidTest, MultiWiiRateModeFollowsSticks)
+{
+    // given
+    setupPid(PID_MULTIWII);
+    rcCommand[ROLL] = 100;
+    rcCommand[PITCH] = -100;
+    rcCommand[YAW] = 50;
+
+    // when
+    runPid();
+
+    // then
+    EXPECT_EQ(100, axisPID[FD_ROLL]);
+    EXPECT_EQ(-100, axisPID[FD_PITCH]);
+    EXPECT_EQ(50, axisPID[FD_YAW]);
+}
+
+TEST(FlightPidTest, MultiWiiDampsGyroRate)
+{
+    // given
+    setupPid(PID_MULTIWII);
+    dynP8[FD_ROLL] = 40;
+    gyroData[FD_ROLL] = 400;
+
+    // when
+    runPid();
+
+    // then P opposes the rotation
+    EXPECT_EQ(-50, axisPID[FD_ROLL]);
+
+    // given
+    setupPid(PID_MULTIWII);
+    dynP8[FD_ROLL] = 40;
+    dynD8[FD_ROLL] = 32;
+    gyroData[FD_ROLL] = 400;
+
+    // when
+    runPid();
+
+    // then D adds to it while the rate changes
+    EXPECT_EQ(-150, axisPID[FD_ROLL]);
+}
+
+TEST(FlightPidTest, MultiWiiIntegratesAndResets)
+{
+    // given
+    setupPid(PID_MULTIWII);
+    rcCommand[ROLL] = 100;
+
+    // when
+    for (int i = 0; i < 10; i++) {
+        runPid();
+    }
+
+    // then
+    EXPECT_EQ(107, axisPID[FD_ROLL]);
+
+    // when
+    resetErrorGyro();
+    runPid();
+
+    // then
+    EXPECT_EQ(100, axisPID[FD_ROLL]);
+}
+
+TEST(FlightPidTest, MultiWiiYawIntegratorIsClearedOnLargeStick)
+{
+    // given
+    setupPid(PID_MULTIWII);
+    rcCommand[YAW] = 150;
+
+    // when
+    for (int i = 0; i < 10; i++) {
+        runPid();
+    }
+
+    // then
+    EXPECT_EQ(150, axisPID[FD_YAW]);
+}
+
+TEST(FlightPidTest, MultiWiiAngleModeLevelsToStickAngle)
+{
+    // given
+    setupPid(PID_MULTIWII);
+    f.ANGLE_MODE = 1;
+    rcCommand[ROLL] = 100;
+
+    // when
+    runPid();
+
+    // then
+    EXPECT_EQ(180, axisPID[FD_ROLL]);
+    EXPECT_EQ(0, axisPID[FD_PITCH]);
+
+    // given
+    setupPid(PID_MULTIWII);
+    f.ANGLE_MODE = 1;
+    rcCommand[ROLL] = 100;
+    inclination.values.rollDeciDegrees = 200;
+
+    // when
+    runPid();
+
+    // then the craft is already at the angle asked for
+    EXPECT_EQ(0, axisPID[FD_ROLL]);
+
+    // given
+    setupPid(PID_MULTIWII);
+    f.ANGLE_MODE = 1;
+    rcCommand[PITCH] = 500;
+
+    // when
+    runPid();
+
+    // then the angle is limited to max_angle_inclination, plus the first step of the level integrator
+    EXPECT_EQ(450 + 1, axisPID[FD_PITCH]);
+}
+
+TEST(FlightPidTest, RewriteRateMode)
+{
+    // given
+    setupPid(PID_REWRITE);
+    rcCommand[ROLL] = 100;
+
+    // when
+    runPid();
+
+    // then
+    EXPECT_EQ(123, axisPID[FD_ROLL]);
+    EXPECT_EQ(0, axisPID[FD_PITCH]);
+}
+
+TEST(FlightPidTest, RewriteIntegratorIsLimited)
+{
+    // given
+    setupPid(PID_REWRITE);
+    pidProfile.P8[ROLL] = 0;
+    pidProfile.D8[ROLL] = 0;
+    rcCommand[ROLL] = 500;
+
+    // when
+    for (int i = 0; i < 1000; i++) {
+        runPid();
+    }
+
+    // then
+    EXPECT_EQ(256, axisPID[FD_ROLL]);
+
+    // when
+    rcCommand[ROLL] = -500;
+    for (int i = 0; i < 2000; i++) {
+        runPid();
+    }
+
+    // then
+    EXPECT_EQ(-256, axisPID[FD_ROLL]);
+}
+
+TEST(FlightPidTest, BaseflightRateModeAndOutputLimit)
+{
+    // given
+    setupPid(PID_BASEFLIGHT);
+    rcCommand[ROLL] = 100;
+
+    // when
+    runPid();
+
+    // then
+    EXPECT_EQ(100, axisPID[FD_ROLL]);
+
+    // given
+    setupPid(PID_BASEFLIGHT);
+    controlRateConfig.rollPitchRate = 100;
+    rcCommand[ROLL] = 500;
+
+    // when
+    runPid();
+
+    // then
+    EXPECT_EQ(1000, axisPID[FD_ROLL]);
+}
+
+TEST(FlightPidTest, UnknownControllerFallsBackToMultiWii)
+{
+    // given
+    setupPid(PID_REWRITE);
+    setPIDController(99);
+    rcCommand[ROLL] = 100;
+
+    // when
+    runPid();
+
+    // then
+    EXPECT_EQ(100, axisPID[FD_ROLL]);
+}
+
+// STUBS
+
+int16_t gyroData[FLIGHT_DYNAMICS_INDEX_COUNT];
+int16_t GPS_angle[ANGLE_INDEX_COUNT];
+int16_t rcCommand[4];
+rollAndPitchInclination_t inclination;
+gyro_t gyro;
+uint16_t cycleTime;
+flags_t f;
@@ -88,6 +88,7 @@ flags_t f;
 gyro_t gyro;
 int16_t magADC[XYZ_AXIS_COUNT];
 int32_t BaroAlt;
+int32_t sonarAlt;
 int16_t debug[4];
 
 
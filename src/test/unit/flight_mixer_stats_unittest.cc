@@ -0,0 +1,191 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+
+#include "flight/mixer.h"
+#include "flight/mixer_stats.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define MIN_THROTTLE 1150
+#define MAX_THROTTLE 1850
+
+enum { ROLL_AXIS = 0, PITCH_AXIS, YAW_AXIS };
+
+static const motorMixer_t quadX[] = {
+    { 1.0f, -1.0f,  1.0f, -1.0f },          // REAR_R
+    { 1.0f, -1.0f, -1.0f,  1.0f },          // FRONT_R
+    { 1.0f,  1.0f,  1.0f,  1.0f },          // REAR_L
+    { 1.0f,  1.0f, -1.0f, -1.0f },          // FRONT_L
+};
+
+static int16_t requested[4];
+static int16_t output[4];
+
+// mixes the same way mixTable does, without yaw direction
+static void mix(int16_t throttle, int16_t roll, int16_t pitch, int16_t yaw)
+{
+    for (int i = 0; i < 4; i++) {
+        requested[i] = throttle + roll * quadX[i].roll + pitch * quadX[i].pitch + yaw * quadX[i].yaw;
+    }
+}
+
+// limits the same way mixTable does, shift down from the top then clip
+static void limit(void)
+{
+    int16_t maxMotor = requested[0];
+    for (int i = 1; i < 4; i++) {
+        if (requested[i] > maxMotor)
+            maxMotor = requested[i];
+    }
+    for (int i = 0; i < 4; i++) {
+        output[i] = requested[i];
+        if (maxMotor > MAX_THROTTLE)
+            output[i] -= maxMotor - MAX_THROTTLE;
+        if (output[i] < MIN_THROTTLE)
+            output[i] = MIN_THROTTLE;
+        if (output[i] > MAX_THROTTLE)
+            output[i] = MAX_THROTTLE;
+    }
+}
+
+static void update(void)
+{
+    limit();
+    mixerStatsUpdate(requested, output, MIN_THROTTLE, MAX_THROTTLE);
+}
+
+TEST(MixerStatsTest, NoClippingLosesNoAuthority)
+{
+    // given
+    mixerStatsInit(quadX, 4);
+
+    // when
+    mix(1500, 100, -50, 30);
+    update();
+
+    // then
+    const mixerStats_t *stats = getMixerStats();
+    EXPECT_EQ(1u, stats->cycles);
+    for (int axis = 0; axis < MIXER_STATS_AXIS_COUNT; axis++) {
+        EXPECT_EQ(0u, stats->authorityLostCycles[axis]);
+    }
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(0u, stats->upperLimitCycles[i]);
+        EXPECT_EQ(0u, stats->lowerLimitCycles[i]);
+    }
+}
+
+TEST(MixerStatsTest, ShiftFromTheTopLosesNoAuthority)
+{
+    // given
+    mixerStatsInit(quadX, 4);
+
+    // when
+    mix(1800, 100, 0, 0);
+    update();
+
+    // then
+    const mixerStats_t *stats = getMixerStats();
+    EXPECT_EQ(1u, stats->upperLimitCycles[2]);
+    EXPECT_EQ(1u, stats->upperLimitCycles[3]);
+    EXPECT_EQ(0u, stats->upperLimitCycles[0]);
+    for (int axis = 0; axis < MIXER_STATS_AXIS_COUNT; axis++) {
+        EXPECT_EQ(0u, stats->authorityLostCycles[axis]);
+    }
+}
+
+TEST(MixerStatsTest, ClippingAtTheBottomLosesAuthority)
+{
+    // given
+    mixerStatsInit(quadX, 4);
+
+    // when
+    mix(1200, 200, 0, 0);      // right motors asked for 1000, 150 below min_throttle
+    update();
+
+    // then
+    const mixerStats_t *stats = getMixerStats();
+    EXPECT_EQ(1u, stats->lowerLimitCycles[0]);
+    EXPECT_EQ(1u, stats->lowerLimitCycles[1]);
+    EXPECT_EQ(1u, stats->authorityLostCycles[ROLL_AXIS]);
+    EXPECT_EQ(0u, stats->authorityLostCycles[PITCH_AXIS]);
+    EXPECT_EQ(0u, stats->authorityLostCycles[YAW_AXIS]);
+
+    // 150 added to both right motors projects onto the roll column as 2 * 150 / 4
+    EXPECT_NEAR(75, mixerStatsAverageAuthorityLost(ROLL_AXIS), 1);
+}
+
+TEST(MixerStatsTest, HistogramTracksOutput)
+{
+    // given
+    mixerStatsInit(quadX, 4);
+
+    // when
+    for (int cycle = 0; cycle < 10; cycle++) {
+        mix(MIN_THROTTLE, 0, 0, 0);
+        update();
+    }
+    mix(MAX_THROTTLE, 0, 0, 0);
+    update();
+
+    // then
+    const mixerStats_t *stats = getMixerStats();
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(10, stats->histogram[i][0]);
+        EXPECT_EQ(1, stats->histogram[i][MIXER_STATS_HISTOGRAM_BINS - 1]);
+    }
+}
+
+TEST(MixerStatsTest, FullHistogramBinIsHalved)
+{
+    // given
+    mixerStatsInit(quadX, 4);
+    mix(MAX_THROTTLE, 0, 0, 0);
+    update();
+
+    // when
+    mix(MIN_THROTTLE, 0, 0, 0);
+    for (uint32_t cycle = 0; cycle <= UINT16_MAX; cycle++) {
+        update();
+    }
+
+    // then
+    const mixerStats_t *stats = getMixerStats();
+    EXPECT_EQ(UINT16_MAX / 2 + 1, stats->histogram[0][0]);
+    EXPECT_EQ(0, stats->histogram[0][MIXER_STATS_HISTOGRAM_BINS - 1]);
+}
+
+TEST(MixerStatsTest, ResetClearsEverything)
+{
+    // given
+    mixerStatsInit(quadX, 4);
+    mix(1200, 200, 0, 0);
+    update();
+
+    // when
+    mixerStatsReset();
+
+    // then
+    const mixerStats_t *stats = getMixerStats();
+    EXPECT_EQ(0u, stats->cycles);
+    EXPECT_EQ(0u, stats->lowerLimitCycles[0]);
+    EXPECT_EQ(0u, stats->authorityLostCycles[ROLL_AXIS]);
+    EXPECT_EQ(0, mixerStatsAverageAuthorityLost(ROLL_AXIS));
+    EXPECT_EQ(4, mixerStatsMotorCount());
+}
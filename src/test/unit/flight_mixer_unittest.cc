@@ -0,0 +1,389 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "common/axis.h"
+
+#include "drivers/gpio.h"
+#include "drivers/timer.h"
+#include "drivers/pwm_mapping.h"
+#include "drivers/serial.h"
+
+#include "rx/rx.h"
+#include "io/escservo.h"
+#include "io/gimbal.h"
+#include "io/rc_controls.h"
+
+#include "sensors/battery.h"
+
+#include "flight/flight.h"
+#include "flight/mixer.h"
+
+#include "config/runtime_config.h"
+#include "config/config.h"
+
+#include "mock_drivers.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+void mixerUseConfigs(servoParam_t *servoConfToUse, flight3DConfig_t *flight3DConfigToUse,
+        escAndServoConfig_t *escAndServoConfigToUse, mixerConfig_t *mixerConfigToUse,
+        airplaneConfig_t *airplaneConfigToUse, rxConfig_t *rxConfigToUse, gimbalConfig_t *gimbalConfigToUse);
+void mixerInit(MultiType mixerConfiguration, motorMixer_t *customMixers);
+void mixerUsePWMOutputConfiguration(pwmOutputConfiguration_t *pwmOutputConfiguration);
+void mixTable(void);
+void writeMotors(void);
+void writeServos(void);
+
+#define GOLDEN_MOTOR_COUNT 8
+#define GOLDEN_SERVO_COUNT 8
+
+static servoParam_t servoConf[MAX_SUPPORTED_SERVOS];
+static flight3DConfig_t flight3DConfig;
+static escAndServoConfig_t escAndServoConfig;
+static mixerConfig_t mixerConfig;
+static airplaneConfig_t airplaneConfig;
+static rxConfig_t rxConfig;
+static gimbalConfig_t gimbalConfig;
+static motorMixer_t customMixer[MAX_SUPPORTED_MOTORS];
+static pwmOutputConfiguration_t pwmOutputConfiguration;
+
+static uint32_t enabledFeatures;
+
+static void setupMixer(MultiType mixerConfiguration)
+{
+    static const int8_t servoRates[MAX_SUPPORTED_SERVOS] = { 30, 30, 100, 100, 100, 100, 100, 100 };
+
+    mockDriversReset();
+    memset(&f, 0, sizeof(f));
+    memset(rcOptions, 0, sizeof(rcOptions));
+    enabledFeatures = 0;
+
+    for (int i = 0; i < MAX_SUPPORTED_SERVOS; i++) {
+        servoConf[i].min = DEFAULT_SERVO_MIN;
+        servoConf[i].max = DEFAULT_SERVO_MAX;
+        servoConf[i].middle = DEFAULT_SERVO_MIDDLE;
+        servoConf[i].rate = servoRates[i];
+        servoConf[i].forwardFromChannel = CHANNEL_FORWARDING_DISABLED;
+    }
+    escAndServoConfig.minthrottle = 1150;
+    escAndServoConfig.maxthrottle = 1850;
+    escAndServoConfig.mincommand = 1000;
+    flight3DConfig.deadband3d_low = 1406;
+    flight3DConfig.deadband3d_high = 1514;
+    flight3DConfig.neutral3d = 1460;
+    mixerConfig.yaw_direction = 1;
+    mixerConfig.tri_unarmed_servo = 1;
+    mixerConfig.vbat_pid_compensation = 0;
+    vbatPidCompensation = 1.0f;
+    airplaneConfig.flaps_speed = 0;
+    rxConfig.midrc = 1500;
+    rxConfig.mincheck = 1100;
+    rxConfig.maxcheck = 1900;
+    gimbalConfig.gimbal_flags = 0;
+    pwmOutputConfiguration.servoCount = 0;
+
+    mixerUseConfigs(servoConf, &flight3DConfig, &escAndServoConfig, &mixerConfig, &airplaneConfig, &rxConfig, &gimbalConfig);
+    mixerInit(mixerConfiguration, customMixer);
+    mixerUsePWMOutputConfiguration(&pwmOutputConfiguration);
+}
+
+static void setInputs(int16_t throttle, int16_t roll, int16_t pitch, int16_t yaw)
+{
+    rcData[THROTTLE] = throttle;
+    rcCommand[THROTTLE] = throttle;
+    rcCommand[ROLL] = roll * 2;
+    rcCommand[PITCH] = pitch * 2;
+    rcCommand[YAW] = yaw * 2;
+    axisPID[ROLL] = roll;
+    axisPID[PITCH] = pitch;
+    axisPID[YAW] = yaw;
+}
+
+static void mixAndWrite(void)
+{
+    mixTable();
+    writeMotors();
+    writeServos();
+}
+
+typedef struct goldenOutput_s {
+    MultiType mixerConfiguration;
+    uint16_t motors[GOLDEN_MOTOR_COUNT];
+    uint16_t servos[GOLDEN_SERVO_COUNT];
+} goldenOutput_t;
+
+// Outputs of every mixer for throttle 1500, roll PID 50, pitch PID -30 and yaw PID 20, armed.  Recorded
+// from the mixer as it is, so any change in behaviour shows up here.
+static const goldenOutput_t goldenOutputs[] = {
+    { MULTITYPE_TRI,             { 1460, 1470, 1570,    0,    0,    0,    0,    0 }, { 1520,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_QUADP,           { 1490, 1430, 1530, 1550,    0,    0,    0,    0 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_QUADX,           { 1440, 1460, 1500, 1600,    0,    0,    0,    0 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_BI,              { 1550, 1450,    0,    0,    0,    0,    0,    0 }, { 1490, 1490,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_GIMBAL,          {    0,    0,    0,    0,    0,    0,    0,    0 }, { 1500, 1500,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_Y6,              { 1440, 1490, 1590, 1480, 1450, 1550,    0,    0 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_HEX6,            { 1421, 1491, 1508, 1578, 1510, 1490,    0,    0 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_FLYING_WING,     { 1500,    0,    0,    0,    0,    0,    0,    0 }, { 1520, 1520,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_Y4,              { 1490, 1480, 1450, 1580,    0,    0,    0,    0 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_HEX6X,           { 1429, 1480, 1519, 1570, 1470, 1530,    0,    0 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_OCTOX8,          { 1440, 1460, 1500, 1600, 1400, 1500, 1540, 1560 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_OCTOFLATP,       { 1536, 1465, 1423, 1494, 1550, 1470, 1490, 1570 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_OCTOFLATX,       { 1545, 1485, 1415, 1475, 1575, 1485, 1465, 1555 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_AIRPLANE,        { 1500,    0,    0,    0,    0,    0,    0,    0 }, { 1550, 1550, 1520, 1470,    0,    0,    0,    0 } },
+    { MULTITYPE_HELI_120_CCPM,   {    0,    0,    0,    0,    0,    0,    0,    0 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_HELI_90_DEG,     {    0,    0,    0,    0,    0,    0,    0,    0 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_VTAIL4,          { 1450, 1480, 1490, 1580,    0,    0,    0,    0 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_HEX6H,           { 1440, 1460, 1500, 1600, 1500, 1500,    0,    0 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_PPM_TO_SERVO,    {    0,    0,    0,    0,    0,    0,    0,    0 }, {    0,    0,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_DUALCOPTER,      { 1520, 1480,    0,    0,    0,    0,    0,    0 }, { 1470, 1550,    0,    0,    0,    0,    0,    0 } },
+    { MULTITYPE_SINGLECOPTER,    { 1500,    0,    0,    0,    0,    0,    0,    0 }, { 1490, 1490, 1570, 1570,    0,    0,    0,    0 } },
+};
+
+TEST(MixerTest, GoldenOutputForEveryMixer)
+{
+    for (unsigned m = 0; m < sizeof(goldenOutputs) / sizeof(goldenOutputs[0]); m++) {
+        const goldenOutput_t *golden = &goldenOutputs[m];
+
+        // given
+        setupMixer(golden->mixerConfiguration);
+        f.ARMED = 1;
+        setInputs(1500, 50, -30, 20);
+
+        // when
+        mixAndWrite();
+
+        // then
+        for (int i = 0; i < GOLDEN_MOTOR_COUNT; i++) {
+            EXPECT_EQ(golden->motors[i], mockMotorOutput[i]) << "mixer " << golden->mixerConfiguration << " motor " << i;
+        }
+        for (int i = 0; i < GOLDEN_SERVO_COUNT; i++) {
+            EXPECT_EQ(golden->servos[i], mockServoOutput[i]) << "mixer " << golden->mixerConfiguration << " servo " << i;
+        }
+    }
+}
+
+TEST(MixerTest, MotorsAreShiftedDownFromMaxThrottle)
+{
+    // given
+    setupMixer(MULTITYPE_QUADX);
+    f.ARMED = 1;
+    setInputs(1800, 100, 0, 0);
+
+    // when
+    mixAndWrite();
+
+    // then the left motors are at max_throttle and the difference to the right motors is kept
+    EXPECT_EQ(1850, mockMotorOutput[2]);
+    EXPECT_EQ(1850, mockMotorOutput[3]);
+    EXPECT_EQ(1650, mockMotorOutput[0]);
+    EXPECT_EQ(1650, mockMotorOutput[1]);
+}
+
+TEST(MixerTest, MotorsAreLimitedToMinThrottle)
+{
+    // given
+    setupMixer(MULTITYPE_QUADX);
+    f.ARMED = 1;
+    setInputs(1200, 100, 0, 0);
+
+    // when
+    mixAndWrite();
+
+    // then
+    EXPECT_EQ(1150, mockMotorOutput[0]);
+    EXPECT_EQ(1150, mockMotorOutput[1]);
+    EXPECT_EQ(1300, mockMotorOutput[2]);
+    EXPECT_EQ(1300, mockMotorOutput[3]);
+}
+
+TEST(MixerTest, LowThrottleIdlesOrStopsMotors)
+{
+    // given
+    setupMixer(MULTITYPE_QUADX);
+    f.ARMED = 1;
+    setInputs(1050, 100, 0, 0);
+
+    // when
+    mixAndWrite();
+
+    // then
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(1150, mockMotorOutput[i]);
+    }
+
+    // given
+    enabledFeatures = FEATURE_MOTOR_STOP;
+
+    // when
+    mixAndWrite();
+
+    // then
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(1000, mockMotorOutput[i]);
+    }
+}
+
+TEST(MixerTest, DisarmedMotorsGetMinCommand)
+{
+    // given
+    setupMixer(MULTITYPE_HEX6X);
+    setInputs(1500, 50, -30, 20);
+
+    // when
+    mixAndWrite();
+
+    // then
+    for (int i = 0; i < 6; i++) {
+        EXPECT_EQ(1000, mockMotorOutput[i]);
+    }
+    EXPECT_EQ(6u, mockMotorWriteCount);
+}
+
+TEST(MixerTest, YawIsLimitedOnQuads)
+{
+    // given
+    setupMixer(MULTITYPE_QUADX);
+    f.ARMED = 1;
+    setInputs(1500, 0, 0, 300);
+    rcCommand[YAW] = 0;
+
+    // when
+    mixAndWrite();
+
+    // then yaw PID is limited to 100 plus the yaw stick
+    EXPECT_EQ(100, axisPID[YAW]);
+    EXPECT_EQ(1600, mockMotorOutput[0]);
+    EXPECT_EQ(1400, mockMotorOutput[1]);
+}
+
+TEST(MixerTest, PidOutputIsScaledForBatterySag)
+{
+    // given a pack at 3.6V per cell that was 4.2V full
+    setupMixer(MULTITYPE_QUADX);
+    f.ARMED = 1;
+    setInputs(1500, 100, 0, 0);
+    vbatPidCompensation = 42.0f / 36;
+
+    // when
+    mixAndWrite();
+
+    // then nothing changes until it is turned on
+    EXPECT_EQ(1400, mockMotorOutput[0]);
+    EXPECT_EQ(1600, mockMotorOutput[2]);
+
+    // given
+    mixerConfig.vbat_pid_compensation = 1;
+
+    // when
+    mixAndWrite();
+
+    // then the correction is scaled and the throttle is not
+    EXPECT_EQ(1383, mockMotorOutput[0]);
+    EXPECT_EQ(1616, mockMotorOutput[2]);
+}
+
+TEST(MixerTest, ThreeDimensionalModeUsesDeadband)
+{
+    // given
+    setupMixer(MULTITYPE_QUADX);
+    enabledFeatures = FEATURE_3D;
+    mixerUsePWMOutputConfiguration(&pwmOutputConfiguration);
+    f.ARMED = 1;
+
+    // when reversed
+    setInputs(1300, 0, 0, 0);
+    mixAndWrite();
+
+    // then
+    EXPECT_EQ(1300, mockMotorOutput[0]);
+
+    // when just below the middle
+    setInputs(1450, 0, 0, 0);
+    mixAndWrite();
+
+    // then the output stays below the low deadband
+    EXPECT_EQ(1406, mockMotorOutput[0]);
+
+    // when just above the middle
+    setInputs(1505, 0, 0, 0);
+    mixAndWrite();
+
+    // then the output starts at the high deadband
+    EXPECT_EQ(1514, mockMotorOutput[0]);
+}
+
+TEST(MixerTest, TriServoOnlyMovesWhenArmedUnlessConfigured)
+{
+    // given
+    setupMixer(MULTITYPE_TRI);
+    mixerConfig.tri_unarmed_servo = 0;
+    setInputs(1500, 0, 0, 20);
+
+    // when
+    mixAndWrite();
+
+    // then
+    EXPECT_EQ(0, mockServoOutput[0]);
+
+    // given
+    f.ARMED = 1;
+
+    // when
+    mixAndWrite();
+
+    // then
+    EXPECT_EQ(1520, mockServoOutput[0]);
+}
+
+TEST(MixerTest, ServosAreForwardedFromRxChannels)
+{
+    // given
+    setupMixer(MULTITYPE_FLYING_WING);
+    rxRuntimeConfig.channelCount = 8;
+    servoConf[3].forwardFromChannel = AUX1;
+    rcData[AUX1] = 1700;
+    f.ARMED = 1;
+    setInputs(1500, 50, -30, 20);
+
+    // when
+    mixAndWrite();
+
+    // then the forwarded channel replaces the servo middle
+    EXPECT_EQ(1720, mockServoOutput[0]);
+    EXPECT_EQ(1520, mockServoOutput[1]);
+}
+
+// STUBS
+
+int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
+int16_t rcCommand[4];
+int16_t axisPID[3];
+rollAndPitchInclination_t inclination;
+rxRuntimeConfig_t rxRuntimeConfig;
+flags_t f;
+uint8_t rcOptions[CHECKBOX_ITEM_COUNT];
+float vbatPidCompensation = 1.0f;
+uint16_t cycleTime;
+
+bool feature(uint32_t mask)
+{
+    return enabledFeatures & mask;
+}
@@ -0,0 +1,195 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "flight/mixer.h"
+#include "flight/servo_output.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define CYCLE_US 3500
+
+static servoOutputConfig_t servoOutputConfig[MAX_SUPPORTED_SERVOS];
+
+static void setupServoOutput(uint16_t lowpassHz, uint8_t slewRate)
+{
+    memset(servoOutputConfig, 0, sizeof(servoOutputConfig));
+    servoOutputConfig[0].lowpass_hz = lowpassHz;
+    servoOutputConfig[0].slew_rate = slewRate;
+    servoOutputInit(servoOutputConfig);
+}
+
+// peak deviation from the centre over the last half of a sine at frequency hz, run for ten periods
+static int sineResponse(float hz, int amplitude, uint32_t dT)
+{
+    int periods = 10;
+    int cycles = periods * 1000000 / (hz * dT);
+    int peak = 0;
+
+    servoOutputFilter(0, 1500, dT);
+    for (int i = 0; i < cycles; i++) {
+        int16_t command = 1500 + lrintf(amplitude * sinf(2 * M_PI * hz * i * dT * 1e-6f));
+        int16_t output = servoOutputFilter(0, command, dT);
+        if (i >= cycles / 2) {
+            peak = std::max(peak, abs(output - 1500));
+        }
+    }
+    return peak;
+}
+
+TEST(ServoOutputTest, PassesThroughWhenDisabled)
+{
+    // given
+    setupServoOutput(0, 0);
+
+    // then
+    EXPECT_EQ(1500, servoOutputFilter(0, 1500, CYCLE_US));
+    EXPECT_EQ(2000, servoOutputFilter(0, 2000, CYCLE_US));
+    EXPECT_EQ(1000, servoOutputFilter(0, 1000, CYCLE_US));
+
+    // and the other outputs are left alone by the first one's settings
+    setupServoOutput(5, 1);
+    EXPECT_EQ(1500, servoOutputFilter(1, 1500, CYCLE_US));
+    EXPECT_EQ(2000, servoOutputFilter(1, 2000, CYCLE_US));
+}
+
+TEST(ServoOutputTest, LowpassStepResponse)
+{
+    // given a 10Hz low-pass settled at the centre
+    setupServoOutput(10, 0);
+    servoOutputFilter(0, 1500, CYCLE_US);
+
+    // when the command steps by 200us
+    float timeConstantUs = 1000000 / (2 * M_PI * 10);
+    int16_t output = 0;
+    int cycles = 0;
+    while (cycles * CYCLE_US < timeConstantUs) {
+        output = servoOutputFilter(0, 1700, CYCLE_US);
+        cycles++;
+    }
+
+    // then it is close to 63% of the way there after one time constant
+    EXPECT_NEAR(1500 + 200 * (1 - expf(-cycles * CYCLE_US / timeConstantUs)), output, 4);
+
+    // and there after five
+    while (cycles * CYCLE_US < 5 * timeConstantUs) {
+        output = servoOutputFilter(0, 1700, CYCLE_US);
+        cycles++;
+    }
+    EXPECT_GE(output, 1698);
+}
+
+TEST(ServoOutputTest, LowpassFrequencyResponse)
+{
+    // given
+    setupServoOutput(20, 0);
+
+    // then a sine well below the cutoff passes, one at the cutoff is 3dB down and one well above is mostly gone
+    EXPECT_NEAR(100, sineResponse(2, 100, CYCLE_US), 3);
+    EXPECT_NEAR(71, sineResponse(20, 100, CYCLE_US), 5);
+    EXPECT_LT(sineResponse(100, 100, CYCLE_US), 25);
+}
+
+TEST(ServoOutputTest, LowpassDoesNotDependOnLoopTime)
+{
+    // when the same step is filtered at two loop times
+    int16_t fast = 0, slow = 0;
+    setupServoOutput(10, 0);
+    servoOutputFilter(0, 1500, 1000);
+    for (int i = 0; i < 20; i++) {
+        fast = servoOutputFilter(0, 1700, 1000);
+    }
+    setupServoOutput(10, 0);
+    servoOutputFilter(0, 1500, 4000);
+    for (int i = 0; i < 5; i++) {
+        slow = servoOutputFilter(0, 1700, 4000);
+    }
+
+    // then it has got about as far after 20ms
+    EXPECT_NEAR(fast, slow, 6);
+}
+
+TEST(ServoOutputTest, SlewRateLimitsSteps)
+{
+    // given a limit of 5us per ms
+    setupServoOutput(0, 5);
+    servoOutputFilter(0, 1000, 2000);
+
+    // when the command jumps across the whole range
+    int16_t last = 1000;
+    int cycles = 0;
+    while (last < 2000 && cycles < 1000) {
+        int16_t output = servoOutputFilter(0, 2000, 2000);
+        EXPECT_LE(output - last, 10);
+        last = output;
+        cycles++;
+    }
+
+    // then it ramps over 200ms
+    EXPECT_EQ(2000, last);
+    EXPECT_EQ(100, cycles);
+
+    // and follows a small change at once
+    EXPECT_EQ(1995, servoOutputFilter(0, 1995, 2000));
+}
+
+TEST(ServoOutputTest, SmoothsJitter)
+{
+    // given
+    setupServoOutput(5, 20);
+    servoOutputFilter(0, 1500, CYCLE_US);
+
+    // when the command has +-20us of noise on it
+    uint32_t noiseState = 1;
+    int peak = 0, largestStep = 0;
+    int16_t last = 1500;
+    for (int i = 0; i < 1000; i++) {
+        noiseState = noiseState * 1103515245 + 12345;
+        int16_t command = 1500 + (int32_t)((noiseState >> 16) % 41) - 20;
+        int16_t output = servoOutputFilter(0, command, CYCLE_US);
+        if (i > 100) {
+            peak = std::max(peak, abs(output - 1500));
+            largestStep = std::max(largestStep, abs(output - last));
+        }
+        last = output;
+    }
+
+    // then the servo sees a fraction of it
+    EXPECT_LE(peak, 10);
+    EXPECT_LE(largestStep, 5);
+}
+
+TEST(ServoOutputTest, ResetTakesNextCommand)
+{
+    // given
+    setupServoOutput(5, 1);
+    servoOutputFilter(0, 1500, CYCLE_US);
+    EXPECT_LT(servoOutputFilter(0, 1900, CYCLE_US), 1510);
+
+    // when the output was stopped in between
+    servoOutputReset(0);
+
+    // then it starts from the new command
+    EXPECT_EQ(1900, servoOutputFilter(0, 1900, CYCLE_US));
+}
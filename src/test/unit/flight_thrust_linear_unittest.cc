@@ -0,0 +1,154 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <math.h>
+
+#include "flight/thrust_linear.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define MIN_THROTTLE 1150
+#define MAX_THROTTLE 1850
+
+static void setupThrustLinear(uint8_t thrustLinear)
+{
+    thrustLinearConfig_t thrustLinearConfig;
+    thrustLinearConfig.thrust_linear = thrustLinear;
+    thrustLinearInit(&thrustLinearConfig);
+}
+
+// the thrust model the table inverts, in PWM units
+static float thrustForCommand(int16_t command, uint8_t thrustLinear)
+{
+    float k = thrustLinear / 100.0f;
+    float x = (float)(command - MIN_THROTTLE) / (MAX_THROTTLE - MIN_THROTTLE);
+
+    return MIN_THROTTLE + ((1.0f - k) * x + k * x * x) * (MAX_THROTTLE - MIN_THROTTLE);
+}
+
+TEST(ThrustLinearTest, DisabledIsIdentity)
+{
+    // given
+    setupThrustLinear(0);
+
+    // then
+    EXPECT_FALSE(isThrustLinearisationEnabled());
+    for (int16_t thrust = MIN_THROTTLE; thrust <= MAX_THROTTLE; thrust++) {
+        EXPECT_EQ(thrust, thrustToMotorCommand(thrust, MIN_THROTTLE, MAX_THROTTLE));
+    }
+}
+
+TEST(ThrustLinearTest, EndsAreFixed)
+{
+    // given
+    setupThrustLinear(100);
+
+    // then
+    EXPECT_TRUE(isThrustLinearisationEnabled());
+    EXPECT_EQ(MIN_THROTTLE, thrustToMotorCommand(MIN_THROTTLE, MIN_THROTTLE, MAX_THROTTLE));
+    EXPECT_EQ(MAX_THROTTLE, thrustToMotorCommand(MAX_THROTTLE, MIN_THROTTLE, MAX_THROTTLE));
+
+    // and values outside the range are left to the mixer limits
+    EXPECT_EQ(1000, thrustToMotorCommand(1000, MIN_THROTTLE, MAX_THROTTLE));
+    EXPECT_EQ(2000, thrustToMotorCommand(2000, MIN_THROTTLE, MAX_THROTTLE));
+}
+
+TEST(ThrustLinearTest, CommandIsMonotonicInThrust)
+{
+    static const uint8_t settings[] = { 1, 25, 50, 75, 100 };
+
+    for (unsigned s = 0; s < sizeof(settings); s++) {
+        // given
+        setupThrustLinear(settings[s]);
+
+        // then
+        int16_t previous = thrustToMotorCommand(MIN_THROTTLE, MIN_THROTTLE, MAX_THROTTLE);
+        for (int16_t thrust = MIN_THROTTLE + 1; thrust <= MAX_THROTTLE; thrust++) {
+            int16_t command = thrustToMotorCommand(thrust, MIN_THROTTLE, MAX_THROTTLE);
+            EXPECT_GE(command, previous) << "thrust_linear " << (int)settings[s] << " thrust " << thrust;
+            EXPECT_GE(command, thrust) << "thrust_linear " << (int)settings[s] << " thrust " << thrust;
+            previous = command;
+        }
+    }
+}
+
+TEST(ThrustLinearTest, RoundTripErrorIsBounded)
+{
+    static const uint8_t settings[] = { 25, 50, 75, 100 };
+
+    for (unsigned s = 0; s < sizeof(settings); s++) {
+        // given
+        setupThrustLinear(settings[s]);
+
+        // then
+        for (int16_t thrust = MIN_THROTTLE; thrust <= MAX_THROTTLE; thrust++) {
+            int16_t command = thrustToMotorCommand(thrust, MIN_THROTTLE, MAX_THROTTLE);
+
+            // thrust the motor actually makes against what the mix asked for, interpolation error is largest
+            // in the first segment where the inverse curve bends the most
+            bool firstSegment = thrust < MIN_THROTTLE + (MAX_THROTTLE - MIN_THROTTLE) / THRUST_LINEAR_SEGMENTS;
+            float error = fabsf(thrustForCommand(command, settings[s]) - thrust);
+            EXPECT_LT(error, firstSegment ? 6.0f : 1.5f) << "thrust_linear " << (int)settings[s] << " thrust " << thrust;
+        }
+    }
+}
+
+TEST(ThrustLinearTest, AppliedToEveryMotor)
+{
+    // given
+    setupThrustLinear(100);
+    int16_t motors[4] = { MIN_THROTTLE, 1325, 1500, MAX_THROTTLE };
+
+    // when
+    applyThrustLinearisation(motors, 4, MIN_THROTTLE, MAX_THROTTLE);
+
+    // then
+    EXPECT_EQ(MIN_THROTTLE, motors[0]);
+    EXPECT_EQ(thrustToMotorCommand(1325, MIN_THROTTLE, MAX_THROTTLE), motors[1]);
+    EXPECT_EQ(thrustToMotorCommand(1500, MIN_THROTTLE, MAX_THROTTLE), motors[2]);
+    EXPECT_EQ(MAX_THROTTLE, motors[3]);
+
+    // half thrust needs sqrt(0.5) of the command range on a pure square law
+    EXPECT_NEAR(MIN_THROTTLE + 700 * 0.7071f, motors[2], 2);
+}
+
+TEST(ThrustLinearTest, CycleCost)
+{
+    // given
+    const int iterations = 1000000;
+    int16_t motors[4];
+    setupThrustLinear(60);
+
+    // when
+    clock_t start = clock();
+    for (int i = 0; i < iterations; i++) {
+        for (int m = 0; m < 4; m++) {
+            motors[m] = MIN_THROTTLE + ((i + m * 173) % (MAX_THROTTLE - MIN_THROTTLE));
+        }
+        applyThrustLinearisation(motors, 4, MIN_THROTTLE, MAX_THROTTLE);
+    }
+    clock_t elapsed = clock() - start;
+
+    // then
+    double nsPerMotor = (double)elapsed * 1e9 / CLOCKS_PER_SEC / iterations / 4;
+    printf("applyThrustLinearisation: %.1f ns/motor\n", nsPerMotor);
+    RecordProperty("applyThrustLinearisationNsPerMotor", (int)lrint(nsPerMotor));
+    EXPECT_GE(motors[0], MIN_THROTTLE);
+}
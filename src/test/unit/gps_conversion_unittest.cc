@@ -18,7 +18,7 @@
 #include <stdint.h>
 
 #include <limits.h>
-#include "io/gps_conversion.h"
+#include "flight/gps_conversion.h"
 
 #include "unittest_macros.h"
 #include "gtest/gtest.h"
@@ -0,0 +1,345 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/system.h"
+
+#include "rx/rx.h"
+#include "io/rc_controls.h"
+
+#include "config/config.h"
+#include "config/runtime_config.h"
+
+#include "flight/failsafe.h"
+
+#include "io/beeper.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+void beepcodeInit(failsafe_t *initialFailsafe);
+
+// The systick interrupt runs every millisecond, the main loop only every loopMs of them, and the beeper output
+// is recorded as the time of each change.  Tone and gap lengths are then read back from the changes.
+
+#define SLOW_LOOP_MS 37
+#define MAX_BEEPER_CHANGES 256
+
+static sysTickCallbackPtr sysTickCallback;
+static uint32_t now;
+static uint32_t enabledFeatures;
+static failsafeStage_e failsafeStage;
+static bool batteryWarning;
+
+static uint32_t beeperChangedAt[MAX_BEEPER_CHANGES];
+static bool beeperChangedTo[MAX_BEEPER_CHANGES];
+static int beeperChanges;
+
+static bool failsafeIsIdle(void)
+{
+    return failsafeStage == FAILSAFE_STAGE_IDLE;
+}
+
+static bool failsafeHasTimerElapsed(void)
+{
+    return failsafeStage >= FAILSAFE_STAGE_LANDING;
+}
+
+static bool failsafeShouldForceLanding(bool armed)
+{
+    return failsafeHasTimerElapsed() && armed;
+}
+
+static bool failsafeShouldHaveCausedLandingByNow(void)
+{
+    return failsafeStage == FAILSAFE_STAGE_LANDED;
+}
+
+static const failsafeVTable_t failsafeVTable = {
+    NULL,
+    failsafeShouldForceLanding,
+    failsafeHasTimerElapsed,
+    failsafeShouldHaveCausedLandingByNow,
+    NULL,
+    NULL,
+    failsafeIsIdle,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+static failsafe_t failsafe;
+
+static void setupBeeper(void)
+{
+    now = 0;
+    enabledFeatures = FEATURE_FAILSAFE;
+    failsafeStage = FAILSAFE_STAGE_IDLE;
+    batteryWarning = false;
+    memset(&f, 0, sizeof(f));
+    memset(rcOptions, 0, sizeof(rcOptions));
+    beeperChanges = 0;
+
+    failsafe.vTable = &failsafeVTable;
+    sysTickCallback = NULL;
+    beepcodeInit(&failsafe);
+    ASSERT_TRUE(sysTickCallback != NULL);
+}
+
+static void runFor(uint32_t duration, uint32_t loopMs)
+{
+    for (uint32_t end = now + duration; now < end; now++) {
+        if (now % loopMs == 0) {
+            beepcodeUpdateState(batteryWarning);
+        }
+        sysTickCallback();
+    }
+}
+
+// the length of each tone and gap from the change at index first on
+static void expectLengths(int first, const uint32_t *lengths, int count)
+{
+    ASSERT_GE(beeperChanges, first + count + 1);
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(i % 2 == 0, beeperChangedTo[first + i]) << "change " << first + i;
+        EXPECT_EQ(lengths[i], beeperChangedAt[first + i + 1] - beeperChangedAt[first + i]) << "change " << first + i;
+    }
+}
+
+TEST(BeeperTest, ConfirmationBeepsHaveExactLengths)
+{
+    // given
+    setupBeeper();
+
+    // when
+    queueConfirmationBeep(3);
+    runFor(2000, SLOW_LOOP_MS);
+
+    // then the first starts on the next tick
+    EXPECT_EQ(6, beeperChanges);
+    EXPECT_EQ(0u, beeperChangedAt[0]);
+    const uint32_t lengths[] = { 50, 200, 50, 200, 50 };
+    expectLengths(0, lengths, 5);
+}
+
+TEST(BeeperTest, BatteryPatternRepeatsExactlyUnderSlowLoop)
+{
+    // given
+    setupBeeper();
+    batteryWarning = true;
+
+    // when the main loop runs at a period that does not divide any tone
+    runFor(3 * 1050 + 1, SLOW_LOOP_MS);
+
+    // then
+    const uint32_t lengths[] = {
+        50, 200, 100, 200, 100, 400,
+        50, 200, 100, 200, 100, 400,
+        50, 200, 100, 200, 100, 400
+    };
+    expectLengths(0, lengths, 18);
+}
+
+TEST(BeeperTest, StalledLoopDoesNotStretchTones)
+{
+    // given
+    setupBeeper();
+    rcOptions[BOXBEEPERON] = 1;
+
+    // when the main loop is held up for a second at a time
+    runFor(2000, 1000);
+
+    // then
+    const uint32_t lengths[] = { 50, 200, 50, 200, 50, 200, 50, 200, 50, 200, 50, 200 };
+    expectLengths(0, lengths, 12);
+
+    // and it stops on the first loop after the switch goes off
+    rcOptions[BOXBEEPERON] = 0;
+    runFor(2000, 1000);
+    EXPECT_FALSE(beeperChangedTo[beeperChanges - 1]);
+    EXPECT_LE(beeperChangedAt[beeperChanges - 1], 2000u);
+}
+
+TEST(BeeperTest, HigherPriorityPreempts)
+{
+    // given the battery warning sounding
+    setupBeeper();
+    batteryWarning = true;
+    runFor(60, 1);
+    int preemptedAt = beeperChanges;
+
+    // when failsafe gives up on landing, during a gap
+    failsafeStage = FAILSAFE_STAGE_LANDED;
+    runFor(1200, 1);
+
+    // when the link is back
+    failsafeStage = FAILSAFE_STAGE_IDLE;
+    int resumedAt = beeperChanges;
+    runFor(1100, 1);
+
+    // then the find me signal started at once
+    EXPECT_EQ(60u, beeperChangedAt[preemptedAt]);
+    const uint32_t findMe[] = { 200, 400, 200, 400 };
+    expectLengths(preemptedAt, findMe, 4);
+
+    // and the battery warning starts over
+    EXPECT_EQ(1260u, beeperChangedAt[resumedAt]);
+    const uint32_t battery[] = { 50, 200, 100, 200, 100, 400 };
+    expectLengths(resumedAt, battery, 6);
+}
+
+TEST(BeeperTest, PreemptionDuringToneRestartsTheTone)
+{
+    // given
+    setupBeeper();
+    f.AUTOTUNE_MODE = 1;
+    runFor(20, 1);
+
+    // when
+    batteryWarning = true;
+    runFor(500, 1);
+
+    // then the tone carries on as the first of the battery warning
+    EXPECT_TRUE(beeperChangedTo[0]);
+    EXPECT_EQ(70u, beeperChangedAt[1]);
+}
+
+TEST(BeeperTest, LowerPriorityWaits)
+{
+    // given
+    setupBeeper();
+    f.ARMED = 1;
+    failsafeStage = FAILSAFE_STAGE_LANDING;
+    runFor(100, SLOW_LOOP_MS);
+
+    // when a calibration ends during the failsafe landing
+    queueConfirmationBeep(2);
+    runFor(1860, SLOW_LOOP_MS);
+
+    // then only the landing signal is heard
+    const uint32_t landing[] = { 50, 200, 100, 200, 200, 200, 50, 200, 100, 200, 200, 200 };
+    expectLengths(0, landing, 12);
+
+    // when the link is back
+    failsafeStage = FAILSAFE_STAGE_IDLE;
+    int resumedAt = beeperChanges;
+    runFor(1000, SLOW_LOOP_MS);
+
+    // then the confirmation plays in full and the beeper is silent after
+    const uint32_t confirmation[] = { 50, 200, 50 };
+    expectLengths(resumedAt, confirmation, 3);
+    EXPECT_EQ(resumedAt + 4, beeperChanges);
+}
+
+TEST(BeeperTest, FailsafeIgnoredWhenDisabled)
+{
+    // given
+    setupBeeper();
+    enabledFeatures = 0;
+    failsafeStage = FAILSAFE_STAGE_LANDED;
+
+    // when
+    runFor(1000, SLOW_LOOP_MS);
+
+    // then
+    EXPECT_EQ(0, beeperChanges);
+}
+
+TEST(BeeperTest, WarningSoundsAgainAfterItCleared)
+{
+    // given
+    setupBeeper();
+    rcOptions[BOXBEEPERON] = 1;
+    runFor(100, 1);
+    rcOptions[BOXBEEPERON] = 0;
+    runFor(1000, 1);
+    int clearedAt = beeperChanges;
+
+    // when
+    rcOptions[BOXBEEPERON] = 1;
+    runFor(300, 1);
+
+    // then
+    EXPECT_EQ(1100u, beeperChangedAt[clearedAt]);
+    const uint32_t lengths[] = { 50, 200 };
+    expectLengths(clearedAt, lengths, 2);
+}
+
+TEST(BeeperTest, PauseSilencesTheBeeperUntilResumed)
+{
+    // given the battery warning sounding, during a tone
+    setupBeeper();
+    batteryWarning = true;
+    runFor(20, 1);
+    ASSERT_EQ(1, beeperChanges);
+
+    // when blocking code beeps on its own
+    beeperPause();
+    runFor(500, 1);
+
+    // then the tone is cut and the interrupt leaves the beeper alone
+    EXPECT_EQ(2, beeperChanges);
+    EXPECT_FALSE(beeperChangedTo[1]);
+    EXPECT_EQ(20u, beeperChangedAt[1]);
+
+    // when
+    beeperResume();
+    int resumedAt = beeperChanges;
+    runFor(1100, 1);
+
+    // then the battery warning starts over
+    EXPECT_EQ(520u, beeperChangedAt[resumedAt]);
+    const uint32_t battery[] = { 50, 200, 100, 200, 100, 400 };
+    expectLengths(resumedAt, battery, 6);
+}
+
+// STUBS
+
+flags_t f;
+uint8_t rcOptions[CHECKBOX_ITEM_COUNT];
+
+bool feature(uint32_t mask)
+{
+    return enabledFeatures & mask;
+}
+
+bool sensors(uint32_t mask)
+{
+    UNUSED(mask);
+    return false;
+}
+
+void setSysTickCallback(sysTickCallbackPtr callback)
+{
+    sysTickCallback = callback;
+}
+
+void systemBeep(bool onoff)
+{
+    if (beeperChanges < MAX_BEEPER_CHANGES) {
+        beeperChangedAt[beeperChanges] = now;
+        beeperChangedTo[beeperChanges] = onoff;
+        beeperChanges++;
+    }
+}
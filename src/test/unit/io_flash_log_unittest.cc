@@ -0,0 +1,441 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/system.h"
+#include "drivers/serial.h"
+#include "drivers/flash_m25p16.h"
+#include "io/flash_log.h"
+
+#include "mock_drivers.h"
+#include "flash_emulator.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define SECTOR_DATA_SIZE (FLASH_EMULATOR_SECTOR_SIZE - FLASH_LOG_SECTOR_HEADER_SIZE)
+#define UPDATE_INTERVAL_US 50               // how often the main loop gets round to flashLogUpdate
+#define THROUGHPUT_RUN_US 1000000
+
+static uint8_t patternByte(uint32_t offset)
+{
+    // never 0xFF, the end of the log is found by looking for erased flash
+    return (offset * 7 + (offset >> 8)) % 0xFF;
+}
+
+static void writePattern(uint32_t offset, uint32_t length)
+{
+    uint8_t chunk[100];
+
+    while (length) {
+        uint16_t count = length < sizeof(chunk) ? length : sizeof(chunk);
+        for (uint16_t i = 0; i < count; i++) {
+            chunk[i] = patternByte(offset + i);
+        }
+        flashLogWrite(chunk, count);
+        offset += count;
+        length -= count;
+
+        // leave the log time to keep up, the way the main loop does
+        for (int i = 0; i < 4; i++) {
+            flashLogUpdate();
+            mockAdvanceMicros(200);
+        }
+    }
+}
+
+static void runUntilIdle(void)
+{
+    for (int i = 0; i < 1000000 && (flashEmulatorIsBusy() || (flashLogGetState() & FLASH_LOG_STATE_ERASING)); i++) {
+        flashLogUpdate();
+        mockAdvanceMicros(1000);
+    }
+    for (int i = 0; i < 4; i++) {
+        flashLogUpdate();
+        mockAdvanceMicros(1000);
+    }
+}
+
+static void flushAndWait(void)
+{
+    flashLogFlush();
+    runUntilIdle();
+}
+
+static void expectPattern(uint32_t offset, uint32_t length)
+{
+    uint8_t buffer[200];
+
+    while (length) {
+        uint16_t count = flashLogRead(offset, buffer, length < sizeof(buffer) ? length : sizeof(buffer));
+        ASSERT_GT(count, 0);
+        for (uint16_t i = 0; i < count; i++) {
+            ASSERT_EQ(patternByte(offset + i), buffer[i]) << "at offset " << offset + i;
+        }
+        offset += count;
+        length -= count;
+    }
+}
+
+static void setupFlash(void)
+{
+    mockDriversReset();
+    flashEmulatorReset(FLASH_EMULATOR_JEDEC_ID_M25P16);
+    EXPECT_TRUE(flashLogInit());
+}
+
+TEST(FlashLogTest, NoChipFound)
+{
+    // given
+    mockDriversReset();
+    flashEmulatorReset(FLASH_EMULATOR_JEDEC_ID_NONE);
+
+    // when
+    bool found = flashLogInit();
+    flashLogWrite((const uint8_t *)"data", 4);
+    flashLogUpdate();
+
+    // then
+    EXPECT_FALSE(found);
+    EXPECT_EQ(0, flashLogGetState());
+    EXPECT_EQ(0, flashLogTotalSize());
+    EXPECT_EQ(4, flashLogDroppedBytes());
+}
+
+TEST(FlashLogTest, EmptyChip)
+{
+    // when
+    setupFlash();
+
+    // then
+    EXPECT_EQ(FLASH_LOG_STATE_READY | FLASH_LOG_STATE_CHECKING, flashLogGetState());
+    EXPECT_EQ(FLASH_EMULATOR_MAX_SECTORS, flashLogSectorCount());
+    EXPECT_EQ((uint32_t)FLASH_EMULATOR_MAX_SECTORS * SECTOR_DATA_SIZE, flashLogTotalSize());
+    EXPECT_EQ(0, flashLogUsedSize());
+}
+
+TEST(FlashLogTest, StatusIsNotReadBeforeTheProgramIsDue)
+{
+    // given
+    setupFlash();
+    uint8_t page[M25P16_PAGE_SIZE];
+    memset(page, 0x55, sizeof(page));
+
+    // when
+    EXPECT_TRUE(m25p16PageProgram(0, page, sizeof(page)));
+    flashEmulatorResetStats();
+    for (int i = 0; i < 100; i++) {
+        EXPECT_FALSE(m25p16IsReady());
+    }
+
+    // then
+    EXPECT_EQ(0, flashEmulatorStats.statusReads);
+    EXPECT_EQ(0, flashEmulatorStats.busBytes);
+    EXPECT_FALSE(m25p16PageProgram(M25P16_PAGE_SIZE, page, sizeof(page)));
+
+    // and
+    mockAdvanceMicros(flashEmulatorTiming.pageProgramUs);
+    EXPECT_TRUE(m25p16IsReady());
+    EXPECT_EQ(1, flashEmulatorStats.statusReads);
+}
+
+TEST(FlashLogTest, WrittenDataReadsBack)
+{
+    // given
+    setupFlash();
+
+    // when
+    writePattern(0, 1000);
+    flushAndWait();
+
+    // then
+    EXPECT_EQ(1000, flashLogUsedSize());
+    expectPattern(0, 1000);
+    EXPECT_EQ(0, flashLogDroppedBytes());
+    EXPECT_EQ(0, flashEmulatorViolations());
+
+    // and the sector header is on the flash
+    EXPECT_EQ(FLASH_LOG_SECTOR_MAGIC & 0xFF, flashEmulatorMemory[0]);
+    EXPECT_EQ(FLASH_LOG_SECTOR_MAGIC >> 8, flashEmulatorMemory[1]);
+}
+
+TEST(FlashLogTest, LogContinuesAfterRestart)
+{
+    // given
+    setupFlash();
+    writePattern(0, 1000);
+    flushAndWait();
+
+    // when
+    EXPECT_TRUE(flashLogInit());
+
+    // then
+    EXPECT_EQ(1000, flashLogUsedSize());
+
+    // when
+    writePattern(1000, 500);
+    flushAndWait();
+
+    // then
+    EXPECT_EQ(1500, flashLogUsedSize());
+    expectPattern(0, 1500);
+    EXPECT_EQ(0, flashEmulatorViolations());
+}
+
+TEST(FlashLogTest, LogCrossesSectors)
+{
+    // given
+    setupFlash();
+    uint32_t length = 2 * SECTOR_DATA_SIZE + 1234;
+
+    // when
+    writePattern(0, length);
+    flashLogFlush();
+    runUntilIdle();
+    EXPECT_TRUE(flashLogInit());
+
+    // then
+    EXPECT_EQ(length, flashLogUsedSize());
+    expectPattern(0, length);
+    EXPECT_EQ(0, flashLogDroppedBytes());
+    EXPECT_EQ(0, flashEmulatorViolations());
+
+    // and each sector has the next sequence number
+    EXPECT_EQ(2, flashEmulatorMemory[2 * FLASH_EMULATOR_SECTOR_SIZE + 2]);
+}
+
+TEST(FlashLogTest, EraseTouchesOnlyWrittenSectorsAndMovesTheStart)
+{
+    // given
+    setupFlash();
+    writePattern(0, 2 * SECTOR_DATA_SIZE + 10);
+    flushAndWait();
+    flashEmulatorResetStats();
+
+    // when
+    flashLogEraseAll();
+    EXPECT_TRUE(flashLogGetState() & FLASH_LOG_STATE_ERASING);
+    runUntilIdle();
+
+    // then
+    for (int sector = 0; sector < FLASH_EMULATOR_MAX_SECTORS; sector++) {
+        EXPECT_EQ(sector < 3 ? 1u : 0u, flashEmulatorStats.sectorErases[sector]) << "sector " << sector;
+    }
+    EXPECT_EQ(0, flashEmulatorStats.bulkErases);
+    EXPECT_EQ(FLASH_LOG_STATE_READY, flashLogGetState());
+    EXPECT_EQ(0, flashLogUsedSize());
+
+    // and the next log starts after the old one, also after a restart
+    EXPECT_EQ(FLASH_LOG_SECTOR_MAGIC & 0xFF, flashEmulatorMemory[3 * FLASH_EMULATOR_SECTOR_SIZE]);
+    EXPECT_TRUE(flashLogInit());
+    EXPECT_EQ(0, flashLogUsedSize());
+
+    writePattern(0, 300);
+    flushAndWait();
+    expectPattern(0, 300);
+    EXPECT_EQ(patternByte(0), flashEmulatorMemory[3 * FLASH_EMULATOR_SECTOR_SIZE + FLASH_LOG_SECTOR_HEADER_SIZE]);
+    EXPECT_EQ(0, flashEmulatorViolations());
+}
+
+TEST(FlashLogTest, ChipWithoutErasedSectorsIsBulkErased)
+{
+    // given
+    mockDriversReset();
+    flashEmulatorReset(FLASH_EMULATOR_JEDEC_ID_M25P16);
+    memset(flashEmulatorMemory, 0x00, sizeof(flashEmulatorMemory));
+    EXPECT_TRUE(flashLogInit());
+
+    // when
+    flashLogWrite((const uint8_t *)"data", 4);
+
+    // then
+    EXPECT_TRUE(flashLogGetState() & FLASH_LOG_STATE_FULL);
+    EXPECT_EQ(4, flashLogDroppedBytes());
+
+    // when
+    flashLogEraseAll();
+    runUntilIdle();
+
+    // then
+    EXPECT_EQ(1, flashEmulatorStats.bulkErases);
+    EXPECT_EQ(FLASH_LOG_STATE_READY, flashLogGetState());
+    writePattern(0, 100);
+    flushAndWait();
+    expectPattern(0, 100);
+}
+
+TEST(FlashLogTest, SectorIsCheckedPageByPage)
+{
+    // given a chip with a byte written in the middle of the first sector and the last page of the second
+    mockDriversReset();
+    flashEmulatorReset(FLASH_EMULATOR_JEDEC_ID_M25P16);
+    flashEmulatorMemory[FLASH_EMULATOR_SECTOR_SIZE / 2 + 100] = 0x00;
+    flashEmulatorMemory[2 * FLASH_EMULATOR_SECTOR_SIZE - 1] = 0x00;
+    EXPECT_TRUE(flashLogInit());
+
+    // when
+    flashLogWrite((const uint8_t *)"data", 4);
+
+    // then the first sector is read in full by the scan
+    EXPECT_TRUE(flashLogGetState() & FLASH_LOG_STATE_FULL);
+
+    // when
+    flashEmulatorResetStats();
+    flashLogUpdate();
+
+    // then an update reads a page, and commands and addresses for the chunks
+    EXPECT_TRUE(flashLogGetState() & FLASH_LOG_STATE_CHECKING);
+    EXPECT_GE(flashEmulatorStats.busBytes, (uint32_t)FLASH_EMULATOR_PAGE_SIZE);
+    EXPECT_LT(flashEmulatorStats.busBytes, 2u * FLASH_EMULATOR_PAGE_SIZE);
+
+    // when the log is erased, which first finishes the check
+    flashEmulatorResetStats();
+    flashLogEraseAll();
+    runUntilIdle();
+
+    // then only the two sectors with data are erased
+    for (int sector = 0; sector < FLASH_EMULATOR_MAX_SECTORS; sector++) {
+        EXPECT_EQ(sector < 2 ? 1u : 0u, flashEmulatorStats.sectorErases[sector]) << "sector " << sector;
+    }
+    EXPECT_EQ(FLASH_LOG_STATE_READY, flashLogGetState());
+    EXPECT_EQ(0, flashEmulatorViolations());
+}
+
+TEST(FlashLogTest, FullLogDropsWrites)
+{
+    // given
+    setupFlash();
+    uint32_t total = flashLogTotalSize();
+
+    // when
+    writePattern(0, total + 1000);
+    flushAndWait();
+
+    // then
+    EXPECT_TRUE(flashLogGetState() & FLASH_LOG_STATE_FULL);
+    EXPECT_EQ(total, flashLogUsedSize());
+    EXPECT_EQ(1000, flashLogDroppedBytes());
+    expectPattern(total - 1000, 1000);
+    EXPECT_EQ(0, flashEmulatorViolations());
+
+    // when, wrapping round the end of the chip
+    flashLogEraseAll();
+    runUntilIdle();
+    writePattern(0, 1000);
+    flushAndWait();
+
+    // then
+    EXPECT_EQ(FLASH_LOG_STATE_READY, flashLogGetState());
+    expectPattern(0, 1000);
+    EXPECT_EQ(FLASH_LOG_SECTOR_MAGIC & 0xFF, flashEmulatorMemory[0]);
+}
+
+TEST(FlashLogTest, WritesDropWhileBothPagesWait)
+{
+    // given
+    setupFlash();
+    uint8_t data[3 * M25P16_PAGE_SIZE];
+    memset(data, 0x12, sizeof(data));
+
+    // when
+    flashLogWrite(data, sizeof(data));
+
+    // then the header and the data fill two pages, the rest is dropped
+    EXPECT_EQ(M25P16_PAGE_SIZE + FLASH_LOG_SECTOR_HEADER_SIZE, flashLogDroppedBytes());
+
+    // when
+    runUntilIdle();
+
+    // then
+    EXPECT_EQ(2 * M25P16_PAGE_SIZE - FLASH_LOG_SECTOR_HEADER_SIZE, flashLogUsedSize());
+    EXPECT_EQ(2, flashEmulatorStats.pagePrograms);
+}
+
+TEST(FlashLogTest, ReadsNothingWhileBusy)
+{
+    // given
+    setupFlash();
+    writePattern(0, 1000);
+    flashLogFlush();
+
+    // when
+    flashLogUpdate();
+    uint8_t buffer[16];
+
+    // then
+    EXPECT_TRUE(flashEmulatorIsBusy());
+    EXPECT_EQ(0, flashLogRead(0, buffer, sizeof(buffer)));
+    EXPECT_EQ(0, flashEmulatorStats.commandsWhileBusy);
+}
+
+// Writes bytesPerLoop once per looptime, with flashLogUpdate called in between, and returns the bytes dropped.
+static uint32_t runLogAtRate(uint32_t looptime, uint16_t bytesPerLoop)
+{
+    static uint8_t data[4096];
+
+    setupFlash();
+    uint32_t nextLoop = micros();
+    uint32_t end = micros() + THROUGHPUT_RUN_US;
+
+    while ((int32_t)(micros() - end) < 0) {
+        if ((int32_t)(micros() - nextLoop) >= 0) {
+            nextLoop += looptime;
+            flashLogWrite(data, bytesPerLoop);
+        }
+        flashLogUpdate();
+        mockAdvanceMicros(UPDATE_INTERVAL_US);
+    }
+
+    EXPECT_EQ(0, flashEmulatorViolations());
+    return flashLogDroppedBytes();
+}
+
+static uint32_t sustainedBytesPerLoop(uint32_t looptime)
+{
+    uint32_t best = 0;
+
+    for (uint16_t bytesPerLoop = 16; bytesPerLoop <= 2048; bytesPerLoop += 16) {
+        if (runLogAtRate(looptime, bytesPerLoop)) {
+            break;
+        }
+        best = bytesPerLoop;
+    }
+    return best;
+}
+
+TEST(FlashLogTest, SustainedWriteThroughput)
+{
+    static const uint32_t looptimes[] = { 1000, 2000, 3500 };
+
+    for (uint32_t i = 0; i < sizeof(looptimes) / sizeof(looptimes[0]); i++) {
+        uint32_t bytesPerLoop = sustainedBytesPerLoop(looptimes[i]);
+        uint32_t bytesPerSecond = bytesPerLoop * (1000000 / looptimes[i]);
+
+        printf("looptime %4uus: %4u bytes per loop, %3u KB/s without drops\n",
+            looptimes[i], bytesPerLoop, bytesPerSecond / 1024);
+
+        // two page buffers of headroom, and a page programmed in well under a millisecond
+        EXPECT_GE(bytesPerLoop, 200u);
+        EXPECT_GE(bytesPerSecond, 64u * 1024);
+    }
+}
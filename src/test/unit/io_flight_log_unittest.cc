@@ -0,0 +1,219 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "common/axis.h"
+
+#include "flight/flight.h"
+#include "flight/mixer.h"
+
+#include "rx/rx.h"
+
+#include "io/rc_controls.h"
+#include "io/flash_log.h"
+#include "io/flight_log.h"
+
+#include "config/runtime_config.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define LOGGED_BYTES_MAX (FLIGHT_LOG_RECORD_SIZE * 16)
+
+static uint8_t flashLogState;
+static uint8_t logged[LOGGED_BYTES_MAX];
+static uint16_t loggedLength;
+static uint8_t flushCount;
+
+static flightLogConfig_t flightLogConfig;
+
+static void resetFlightLog(uint8_t rate)
+{
+    memset(logged, 0, sizeof(logged));
+    loggedLength = 0;
+    flushCount = 0;
+    flashLogState = FLASH_LOG_STATE_READY;
+    memset(&f, 0, sizeof(f));
+
+    flightLogConfig.flight_log_rate = rate;
+    useFlightLogConfig(&flightLogConfig);
+
+    // let a flight of an earlier test end
+    flightLogUpdate(0);
+    loggedLength = 0;
+    flushCount = 0;
+}
+
+static int16_t logged16(uint16_t offset)
+{
+    return (int16_t)(logged[offset] | (logged[offset + 1] << 8));
+}
+
+TEST(FlightLogTest, NothingIsLoggedWhileDisarmed)
+{
+    // given
+    resetFlightLog(1);
+
+    // when
+    for (int i = 0; i < 10; i++) {
+        flightLogUpdate(i * 1000);
+    }
+
+    // then
+    EXPECT_EQ(0, loggedLength);
+    EXPECT_EQ(0, flushCount);
+}
+
+TEST(FlightLogTest, RecordHoldsTheLoopState)
+{
+    // given
+    resetFlightLog(1);
+    f.ARMED = 1;
+
+    rcCommand[ROLL] = -100;
+    rcCommand[PITCH] = 200;
+    rcCommand[YAW] = -300;
+    rcCommand[THROTTLE] = 1400;
+    gyroADC[X] = 11;
+    gyroADC[Y] = -22;
+    gyroADC[Z] = 33;
+    axisPID[ROLL] = -44;
+    axisPID[PITCH] = 55;
+    axisPID[YAW] = -66;
+    for (int i = 0; i < FLIGHT_LOG_MOTOR_COUNT; i++) {
+        motor[i] = 1100 + i;
+    }
+
+    // when
+    flightLogUpdate(0x12345678);
+
+    // then
+    ASSERT_EQ(FLIGHT_LOG_RECORD_SIZE, loggedLength);
+    EXPECT_EQ(FLIGHT_LOG_RECORD_MARKER, logged[0]);
+    EXPECT_EQ(FLIGHT_LOG_RECORD_SIZE, logged[1]);
+    EXPECT_EQ(0x78, logged[2]);
+    EXPECT_EQ(0x56, logged[3]);
+    EXPECT_EQ(0x34, logged[4]);
+    EXPECT_EQ(0x12, logged[5]);
+
+    EXPECT_EQ(-100, logged16(6));
+    EXPECT_EQ(200, logged16(8));
+    EXPECT_EQ(-300, logged16(10));
+    EXPECT_EQ(1400, logged16(12));
+    EXPECT_EQ(11, logged16(14));
+    EXPECT_EQ(-22, logged16(16));
+    EXPECT_EQ(33, logged16(18));
+    EXPECT_EQ(-44, logged16(20));
+    EXPECT_EQ(55, logged16(22));
+    EXPECT_EQ(-66, logged16(24));
+    for (int i = 0; i < FLIGHT_LOG_MOTOR_COUNT; i++) {
+        EXPECT_EQ(1100 + i, logged16(26 + i * 2));
+    }
+}
+
+TEST(FlightLogTest, RateLogsEveryNthLoop)
+{
+    // given
+    resetFlightLog(3);
+    f.ARMED = 1;
+
+    // when
+    for (int i = 0; i < 9; i++) {
+        flightLogUpdate(i * 1000);
+    }
+
+    // then
+    ASSERT_EQ(3 * FLIGHT_LOG_RECORD_SIZE, loggedLength);
+    EXPECT_EQ(0, logged[2]);
+    EXPECT_EQ((3000 & 0xFF), logged[FLIGHT_LOG_RECORD_SIZE + 2]);
+    EXPECT_EQ((6000 & 0xFF), logged[2 * FLIGHT_LOG_RECORD_SIZE + 2]);
+}
+
+TEST(FlightLogTest, DisarmingFlushesOnce)
+{
+    // given
+    resetFlightLog(1);
+    f.ARMED = 1;
+    flightLogUpdate(0);
+    flightLogUpdate(1000);
+
+    // when
+    f.ARMED = 0;
+    flightLogUpdate(2000);
+    flightLogUpdate(3000);
+
+    // then
+    EXPECT_EQ(2 * FLIGHT_LOG_RECORD_SIZE, loggedLength);
+    EXPECT_EQ(1, flushCount);
+}
+
+TEST(FlightLogTest, RateZeroLogsNothing)
+{
+    // given
+    resetFlightLog(0);
+    f.ARMED = 1;
+
+    // when
+    flightLogUpdate(0);
+
+    // then
+    EXPECT_EQ(0, loggedLength);
+}
+
+TEST(FlightLogTest, NothingIsLoggedWithoutTheFlash)
+{
+    // given
+    resetFlightLog(1);
+    flashLogState = 0;
+    f.ARMED = 1;
+
+    // when
+    flightLogUpdate(0);
+
+    // then
+    EXPECT_EQ(0, loggedLength);
+}
+
+// STUBS
+
+flags_t f;
+int16_t rcCommand[4];
+int16_t gyroADC[XYZ_AXIS_COUNT];
+int16_t axisPID[XYZ_AXIS_COUNT];
+int16_t motor[MAX_SUPPORTED_MOTORS];
+
+uint8_t flashLogGetState(void)
+{
+    return flashLogState;
+}
+
+void flashLogWrite(const uint8_t *data, uint16_t length)
+{
+    if (loggedLength + length <= LOGGED_BYTES_MAX) {
+        memcpy(&logged[loggedLength], data, length);
+        loggedLength += length;
+    }
+}
+
+void flashLogFlush(void)
+{
+    flushCount++;
+}
@@ -0,0 +1,526 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "common/axis.h"
+
+#include "rx/rx.h"
+#include "io/rc_controls.h"
+
+#include "flight/flight.h"
+
+#include "sensors/sensors.h"
+
+#include "config/runtime_config.h"
+#include "config/config.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define ARM_HOLD_MS 400
+#define COMMAND_HOLD_MS 400
+#define FRAME_US 20000                  // PWM and PPM receivers
+
+#define STICK_LOW 1000
+#define STICK_CENTER 1500
+#define STICK_HIGH 2000
+
+static uint32_t enabledFeatures;
+static uint32_t enabledSensors;
+static rxConfig_t rxConfig;
+static stickCommandConfig_t stickCommandConfig;
+static uint32_t currentTime;
+static uint32_t activate[CHECKBOX_ITEM_COUNT];
+
+static uint32_t armCount;
+static uint32_t disarmCount;
+static int8_t selectedProfile;
+static uint32_t gyroCalibrationCount;
+static uint32_t accCalibrationCount;
+static rollAndPitchTrims_t trimsDelta;
+
+static void setupRcControls(void)
+{
+    enabledFeatures = 0;
+    enabledSensors = 0;
+    memset(&f, 0, sizeof(f));
+    memset(rcOptions, 0, sizeof(rcOptions));
+    memset(activate, 0, sizeof(activate));
+
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    rxConfig.midrc = 1500;
+    rxConfig.mincheck = 1100;
+    rxConfig.maxcheck = 1900;
+    stickCommandConfig.arm_hold_time = ARM_HOLD_MS;
+    stickCommandConfig.command_hold_time = COMMAND_HOLD_MS;
+    currentTime += 10000000;            // well clear of the last test's sticks
+
+    armCount = 0;
+    disarmCount = 0;
+    selectedProfile = -1;
+    gyroCalibrationCount = 0;
+    accCalibrationCount = 0;
+    memset(&trimsDelta, 0, sizeof(trimsDelta));
+}
+
+static void setSticks(int16_t roll, int16_t pitch, int16_t yaw, int16_t throttle)
+{
+    rcData[ROLL] = roll;
+    rcData[PITCH] = pitch;
+    rcData[YAW] = yaw;
+    rcData[THROTTLE] = throttle;
+}
+
+// one RX frame
+static void processSticks(bool retardedArm)
+{
+    processRcStickPositions(&rxConfig, &stickCommandConfig, calculateThrottleStatus(&rxConfig, 0), activate, retardedArm, currentTime);
+}
+
+// holds the sticks for ms, a frame every FRAME_US, starting from centred sticks so the hold is timed from zero
+static void holdSticksWith(int16_t roll, int16_t pitch, int16_t yaw, int16_t throttle, uint32_t ms, bool retardedArm)
+{
+    setSticks(STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER);
+    processSticks(retardedArm);
+    currentTime += FRAME_US;
+
+    setSticks(roll, pitch, yaw, throttle);
+    uint32_t heldFrom = currentTime;
+    while (currentTime - heldFrom <= ms * 1000) {
+        processSticks(retardedArm);
+        currentTime += FRAME_US;
+    }
+}
+
+static void holdSticks(int16_t roll, int16_t pitch, int16_t yaw, int16_t throttle, uint32_t ms)
+{
+    holdSticksWith(roll, pitch, yaw, throttle, ms, false);
+}
+
+TEST(RcControlsTest, ThrottleStatus)
+{
+    // given
+    setupRcControls();
+
+    // when
+    rcData[THROTTLE] = 1099;
+
+    // then
+    EXPECT_EQ(THROTTLE_LOW, calculateThrottleStatus(&rxConfig, 50));
+
+    // when
+    rcData[THROTTLE] = 1100;
+
+    // then
+    EXPECT_EQ(THROTTLE_HIGH, calculateThrottleStatus(&rxConfig, 50));
+}
+
+TEST(RcControlsTest, ThrottleStatusIn3D)
+{
+    // given
+    setupRcControls();
+    enabledFeatures = FEATURE_3D;
+
+    // when
+    rcData[THROTTLE] = 1000;
+
+    // then low throttle is full reverse, not idle
+    EXPECT_EQ(THROTTLE_HIGH, calculateThrottleStatus(&rxConfig, 50));
+
+    // when
+    rcData[THROTTLE] = 1549;
+
+    // then the deadband around midrc is idle
+    EXPECT_EQ(THROTTLE_LOW, calculateThrottleStatus(&rxConfig, 50));
+
+    // when
+    rcData[THROTTLE] = 1550;
+
+    // then
+    EXPECT_EQ(THROTTLE_HIGH, calculateThrottleStatus(&rxConfig, 50));
+}
+
+TEST(RcControlsTest, SticksInApModePosition)
+{
+    // when
+    rcCommand[ROLL] = 19;
+    rcCommand[PITCH] = -19;
+
+    // then
+    EXPECT_TRUE(areSticksInApModePosition(20));
+
+    // when
+    rcCommand[PITCH] = -20;
+
+    // then
+    EXPECT_FALSE(areSticksInApModePosition(20));
+}
+
+TEST(RcControlsTest, ArmWithYawAfterDelay)
+{
+    // given
+    setupRcControls();
+
+    // when held one frame short
+    holdSticks(STICK_CENTER, STICK_CENTER, STICK_HIGH, STICK_LOW, ARM_HOLD_MS - FRAME_US / 1000);
+
+    // then
+    EXPECT_EQ(0u, armCount);
+
+    // when held long enough
+    processSticks(false);
+
+    // then
+    EXPECT_EQ(1u, armCount);
+
+    // when held longer
+    currentTime += 10 * ARM_HOLD_MS * 1000;
+    processSticks(false);
+
+    // then the command does not repeat
+    EXPECT_EQ(1u, armCount);
+}
+
+TEST(RcControlsTest, DisarmWithYawWhenArmed)
+{
+    // given
+    setupRcControls();
+    f.ARMED = 1;
+
+    // when
+    holdSticks(STICK_CENTER, STICK_CENTER, STICK_LOW, STICK_LOW, ARM_HOLD_MS);
+
+    // then
+    EXPECT_EQ(1u, disarmCount);
+    EXPECT_EQ(0u, gyroCalibrationCount);
+}
+
+TEST(RcControlsTest, HoldIsTimedFromWhenTheCommandBecomesAvailable)
+{
+    // given the arm sticks held while armed
+    setupRcControls();
+    f.ARMED = 1;
+    holdSticks(STICK_CENTER, STICK_CENTER, STICK_HIGH, STICK_LOW, 2 * ARM_HOLD_MS);
+
+    // when disarmed some other way, by failsafe or the configurator
+    f.ARMED = 0;
+    uint32_t disarmedAt = currentTime;
+    while (currentTime - disarmedAt < ARM_HOLD_MS * 1000) {
+        processSticks(false);
+        currentTime += FRAME_US;
+    }
+
+    // then it does not arm again until the sticks have been held for the arm hold time since
+    EXPECT_EQ(0u, armCount);
+
+    // when
+    processSticks(false);
+
+    // then
+    EXPECT_EQ(1u, armCount);
+}
+
+TEST(RcControlsTest, ArmAndDisarmWithRollOnlyWhenRetarded)
+{
+    // given
+    setupRcControls();
+
+    // when
+    holdSticks(STICK_HIGH, STICK_CENTER, STICK_CENTER, STICK_LOW, ARM_HOLD_MS);
+
+    // then
+    EXPECT_EQ(0u, armCount);
+
+    // when
+    holdSticksWith(STICK_HIGH, STICK_CENTER, STICK_CENTER, STICK_LOW, ARM_HOLD_MS, true);
+
+    // then
+    EXPECT_EQ(1u, armCount);
+
+    // given
+    f.ARMED = 1;
+
+    // when
+    holdSticksWith(STICK_LOW, STICK_CENTER, STICK_CENTER, STICK_LOW, ARM_HOLD_MS, true);
+
+    // then
+    EXPECT_EQ(1u, disarmCount);
+}
+
+TEST(RcControlsTest, ArmSwitch)
+{
+    // given
+    setupRcControls();
+    activate[BOXARM] = 1;
+    f.OK_TO_ARM = 1;
+    setSticks(STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_LOW);
+
+    // when the switch is on at high throttle
+    rcOptions[BOXARM] = 1;
+    processRcStickPositions(&rxConfig, &stickCommandConfig, THROTTLE_HIGH, activate, false, currentTime);
+
+    // then
+    EXPECT_EQ(0u, armCount);
+
+    // when at low throttle
+    processRcStickPositions(&rxConfig, &stickCommandConfig, THROTTLE_LOW, activate, false, currentTime);
+
+    // then
+    EXPECT_EQ(1u, armCount);
+
+    // when the switch is turned off while armed
+    f.ARMED = 1;
+    rcOptions[BOXARM] = 0;
+    processRcStickPositions(&rxConfig, &stickCommandConfig, THROTTLE_HIGH, activate, false, currentTime);
+
+    // then
+    EXPECT_EQ(1u, disarmCount);
+
+    // and yaw does not arm when the switch is configured
+    f.ARMED = 0;
+    holdSticks(STICK_CENTER, STICK_CENTER, STICK_HIGH, STICK_LOW, ARM_HOLD_MS);
+    EXPECT_EQ(1u, armCount);
+}
+
+TEST(RcControlsTest, ProfileSelection)
+{
+    typedef struct profileSticks_s {
+        int16_t roll;
+        int16_t pitch;
+        int8_t profile;
+    } profileSticks_t;
+
+    static const profileSticks_t profileSticks[] = {
+        { STICK_LOW, STICK_CENTER, 0 },
+        { STICK_CENTER, STICK_HIGH, 1 },
+        { STICK_HIGH, STICK_CENTER, 2 },
+    };
+
+    for (unsigned i = 0; i < sizeof(profileSticks) / sizeof(profileSticks[0]); i++) {
+        // given
+        setupRcControls();
+
+        // when
+        holdSticks(profileSticks[i].roll, profileSticks[i].pitch, STICK_LOW, STICK_LOW, COMMAND_HOLD_MS);
+
+        // then
+        EXPECT_EQ(profileSticks[i].profile, selectedProfile);
+        EXPECT_EQ(0u, armCount);
+    }
+}
+
+TEST(RcControlsTest, Calibrations)
+{
+    // given
+    setupRcControls();
+    enabledSensors = SENSOR_MAG;
+
+    // when
+    holdSticks(STICK_CENTER, STICK_LOW, STICK_LOW, STICK_LOW, COMMAND_HOLD_MS);
+
+    // then
+    EXPECT_EQ(1u, gyroCalibrationCount);
+
+    // when
+    holdSticks(STICK_CENTER, STICK_LOW, STICK_LOW, STICK_HIGH, COMMAND_HOLD_MS);
+
+    // then
+    EXPECT_EQ(1u, accCalibrationCount);
+
+    // when
+    holdSticks(STICK_CENTER, STICK_LOW, STICK_HIGH, STICK_HIGH, COMMAND_HOLD_MS);
+
+    // then
+    EXPECT_EQ(1, f.CALIBRATE_MAG);
+}
+
+TEST(RcControlsTest, AccelerometerTrimRepeats)
+{
+    // given
+    setupRcControls();
+
+    // when
+    holdSticks(STICK_CENTER, STICK_HIGH, STICK_CENTER, STICK_HIGH, COMMAND_HOLD_MS * 3);
+
+    // then the trim is applied again each time the delay runs out
+    EXPECT_EQ(3 * 2, trimsDelta.values.pitch);
+    EXPECT_EQ(0, trimsDelta.values.roll);
+
+    // when
+    holdSticks(STICK_LOW, STICK_CENTER, STICK_CENTER, STICK_HIGH, COMMAND_HOLD_MS);
+
+    // then
+    EXPECT_EQ(-2, trimsDelta.values.roll);
+}
+
+// A stick trace as the pilot moves the sticks, sampled at the RX frame rate from a random phase.  Returns
+// the ms from when the sticks reached the arming position to the arming, or -1 if it did not arm.
+typedef struct stickTracePoint_s {
+    uint32_t atMs;
+    int16_t yaw;
+    int16_t throttle;
+} stickTracePoint_t;
+
+static int32_t replayArmingTrace(const stickTracePoint_t *trace, int count, uint32_t framePeriodUs, uint32_t phaseUs)
+{
+    uint32_t startedAt = currentTime;
+    uint32_t armPositionAt = 0;
+    uint32_t endUs = (trace[count - 1].atMs + 2000) * 1000;
+
+    for (uint32_t us = phaseUs; us < endUs; us += framePeriodUs) {
+        int point = 0;
+        while (point + 1 < count && trace[point + 1].atMs * 1000 <= us) {
+            point++;
+        }
+        if (trace[point].yaw == STICK_HIGH && trace[point].throttle == STICK_LOW && (point == 0 || trace[point - 1].yaw != STICK_HIGH)) {
+            armPositionAt = trace[point].atMs * 1000;
+        }
+
+        setSticks(STICK_CENTER, STICK_CENTER, trace[point].yaw, trace[point].throttle);
+        currentTime = startedAt + us;
+        processSticks(false);
+
+        if (armCount) {
+            return (us - armPositionAt) / 1000;
+        }
+    }
+    return -1;
+}
+
+TEST(RcControlsTest, ArmingLatencyIndependentOfRxRate)
+{
+    static const stickTracePoint_t trace[] = {
+        { 0, STICK_CENTER, STICK_LOW },
+        { 300, STICK_HIGH, STICK_LOW },         // yaw right, let go of it too early
+        { 500, STICK_CENTER, STICK_LOW },
+        { 900, STICK_HIGH, STICK_LOW },         // and held
+    };
+    // SBUS fast and normal, Spektrum 2048 and 1024, PWM and PPM, a slow serial receiver
+    static const uint32_t framePeriods[] = { 7000, 14000, 11000, 22000, 20000, 45000 };
+    uint32_t noiseState = 1;
+
+    for (unsigned i = 0; i < sizeof(framePeriods) / sizeof(framePeriods[0]); i++) {
+        for (int run = 0; run < 10; run++) {
+            // given
+            setupRcControls();
+            noiseState = noiseState * 1103515245 + 12345;
+            uint32_t phase = (noiseState >> 8) % framePeriods[i];
+
+            // when
+            int32_t latency = replayArmingTrace(trace, sizeof(trace) / sizeof(trace[0]), framePeriods[i], phase);
+
+            // then the hold is the same at every frame rate, give or take when the frames sample the sticks
+            EXPECT_EQ(1u, armCount) << "frame period " << framePeriods[i];
+            EXPECT_GE(latency, ARM_HOLD_MS) << "frame period " << framePeriods[i];
+            EXPECT_LT((uint32_t)latency, ARM_HOLD_MS + 2 * framePeriods[i] / 1000) << "frame period " << framePeriods[i];
+        }
+    }
+}
+
+TEST(RcControlsTest, HoldTimesAreConfigurable)
+{
+    // given
+    setupRcControls();
+    stickCommandConfig.arm_hold_time = 1000;
+    stickCommandConfig.command_hold_time = 2000;
+
+    // when
+    holdSticks(STICK_CENTER, STICK_CENTER, STICK_HIGH, STICK_LOW, 980);
+
+    // then
+    EXPECT_EQ(0u, armCount);
+
+    // when
+    holdSticks(STICK_CENTER, STICK_CENTER, STICK_HIGH, STICK_LOW, 1000);
+
+    // then
+    EXPECT_EQ(1u, armCount);
+
+    // when the gyro calibration is held only as long as arming takes
+    holdSticks(STICK_CENTER, STICK_LOW, STICK_LOW, STICK_LOW, 1000);
+
+    // then
+    EXPECT_EQ(0u, gyroCalibrationCount);
+
+    // when
+    holdSticks(STICK_CENTER, STICK_LOW, STICK_LOW, STICK_LOW, 2000);
+
+    // then
+    EXPECT_EQ(1u, gyroCalibrationCount);
+}
+
+// STUBS
+
+int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
+uint8_t rcOptions[CHECKBOX_ITEM_COUNT];
+int16_t heading;
+flags_t f;
+
+bool feature(uint32_t mask)
+{
+    return enabledFeatures & mask;
+}
+
+bool sensors(uint32_t mask)
+{
+    return enabledSensors & mask;
+}
+
+void mwArm(void)
+{
+    armCount++;
+}
+
+void mwDisarm(void)
+{
+    disarmCount++;
+}
+
+void changeProfile(uint8_t profileIndex)
+{
+    selectedProfile = profileIndex;
+}
+
+void gyroSetCalibrationCycles(uint16_t calibrationCyclesRequired)
+{
+    UNUSED(calibrationCyclesRequired);
+    gyroCalibrationCount++;
+}
+
+void accSetCalibrationCycles(uint16_t calibrationCyclesRequired)
+{
+    UNUSED(calibrationCyclesRequired);
+    accCalibrationCount++;
+}
+
+void baroSetCalibrationCycles(uint16_t calibrationCyclesRequired)
+{
+    UNUSED(calibrationCyclesRequired);
+}
+
+void GPS_reset_home_position(void) {}
+void handleInflightCalibrationStickPosition(void) {}
+
+void applyAndSaveAccelerometerTrimsDelta(rollAndPitchTrims_t *rollAndPitchTrimsDelta)
+{
+    trimsDelta.values.roll += rollAndPitchTrimsDelta->values.roll;
+    trimsDelta.values.pitch += rollAndPitchTrimsDelta->values.pitch;
+}
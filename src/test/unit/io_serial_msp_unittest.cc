@@ -0,0 +1,238 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+#include "io/serial_msp.h"
+
+#include "config/runtime_config.h"
+
+#include "fuzz_stubs.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+void mspInit(serialConfig_t *serialConfig);
+
+#define FAKE_PORT_COUNT 2
+#define FAKE_PORT_BUFFER_SIZE 256
+
+#define MSP_IDENT 100
+#define REBOOT_CHARACTER 'R'
+
+typedef struct fakePort_s {
+    serialPort_t port;
+    bool opened;
+
+    uint8_t rx[FAKE_PORT_BUFFER_SIZE];
+    uint16_t rxHead;
+    uint16_t rxTail;
+
+    uint16_t txCount;
+} fakePort_t;
+
+static fakePort_t fakePorts[FAKE_PORT_COUNT];
+
+static serialPortFunction_t serialPortFunctions[FAKE_PORT_COUNT] = {
+    { SERIAL_PORT_USART1, &fakePorts[0].port, SCENARIO_MSP_CLI_TELEMETRY_GPS_PASTHROUGH, FUNCTION_NONE },
+    { SERIAL_PORT_USART2, &fakePorts[1].port, SCENARIO_MSP_ONLY, FUNCTION_NONE },
+};
+
+static uint8_t otherData[FAKE_PORT_BUFFER_SIZE];
+static uint8_t otherDataCount;
+
+static void openPorts(serialPortFunctionScenario_e secondPortScenario)
+{
+    memset(fakePorts, 0, sizeof(fakePorts));
+    otherDataCount = 0;
+
+    serialPortFunctions[1].scenario = secondPortScenario;
+
+    serialConfig_t *serialConfig = fuzzResetConfig();
+    serialConfig->reboot_character = REBOOT_CHARACTER;
+    mspInit(serialConfig);
+}
+
+static void receive(int portIndex, const uint8_t *data, uint8_t length)
+{
+    fakePort_t *fake = &fakePorts[portIndex];
+    while (length--) {
+        fake->rx[fake->rxHead++ % FAKE_PORT_BUFFER_SIZE] = *data++;
+    }
+}
+
+static void receiveCommand(int portIndex, uint8_t command)
+{
+    const uint8_t frame[] = { '$', 'M', '<', 0, command, command };
+    receive(portIndex, frame, sizeof(frame));
+}
+
+static const uint8_t rebootAndCli[] = { REBOOT_CHARACTER, '#' };
+
+TEST(SerialMspTest, SecondPortIgnoresRebootAndCliCharacters)
+{
+    // given
+    openPorts(SCENARIO_MSP_ONLY);
+
+    // when
+    receive(1, rebootAndCli, sizeof(rebootAndCli));
+    mspProcess();
+
+    // then
+    EXPECT_EQ(0, otherDataCount);
+    EXPECT_EQ(0, fakePorts[1].txCount);
+    EXPECT_EQ(fakePorts[1].rxHead, fakePorts[1].rxTail);
+}
+
+TEST(SerialMspTest, SecondPortStillAnswersMsp)
+{
+    // given
+    openPorts(SCENARIO_MSP_ONLY);
+
+    // when
+    receive(1, rebootAndCli, sizeof(rebootAndCli));
+    receiveCommand(1, MSP_IDENT);
+    mspProcess();
+
+    // then
+    EXPECT_EQ(0, otherDataCount);
+    EXPECT_GT(fakePorts[1].txCount, 0);
+    EXPECT_EQ(0, fakePorts[0].txCount);
+}
+
+TEST(SerialMspTest, PrimaryPortEvaluatesRebootAndCliCharacters)
+{
+    // given
+    openPorts(SCENARIO_MSP_ONLY);
+
+    // when
+    receive(0, rebootAndCli, sizeof(rebootAndCli));
+    mspProcess();
+
+    // then
+    EXPECT_EQ(2, otherDataCount);
+    EXPECT_EQ(REBOOT_CHARACTER, otherData[0]);
+    EXPECT_EQ('#', otherData[1]);
+}
+
+TEST(SerialMspTest, SecondPortThatAllowsTheCliEvaluatesRebootAndCliCharacters)
+{
+    // given
+    openPorts(SCENARIO_MSP_CLI_GPS_PASTHROUGH);
+
+    // when
+    receive(1, rebootAndCli, sizeof(rebootAndCli));
+    mspProcess();
+
+    // then
+    EXPECT_EQ(2, otherDataCount);
+    EXPECT_EQ(REBOOT_CHARACTER, otherData[0]);
+    EXPECT_EQ('#', otherData[1]);
+}
+
+TEST(SerialMspTest, NothingIsEvaluatedWhileArmed)
+{
+    // given
+    openPorts(SCENARIO_MSP_ONLY);
+    f.ARMED = 1;
+
+    // when
+    receive(0, rebootAndCli, sizeof(rebootAndCli));
+    mspProcess();
+
+    // then
+    EXPECT_EQ(0, otherDataCount);
+}
+
+// STUBS
+
+uint32_t micros(void) { return 0; }
+uint32_t millis(void) { return 0; }
+
+// MSP opens ports until none is left
+serialPort_t *openSerialPort(serialPortFunction_e function, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, serialInversion_e inversion)
+{
+    UNUSED(callback);
+    UNUSED(baudRate);
+    UNUSED(inversion);
+
+    if (function != FUNCTION_MSP) {
+        return NULL;
+    }
+
+    for (int i = 0; i < FAKE_PORT_COUNT; i++) {
+        fakePort_t *fake = &fakePorts[i];
+        if (!fake->opened) {
+            fake->opened = true;
+            fake->port.mode = mode;
+            return &fake->port;
+        }
+    }
+    return NULL;
+}
+
+bool isSerialPortFunctionAllowed(serialPort_t *port, serialPortFunction_e function)
+{
+    for (int i = 0; i < FAKE_PORT_COUNT; i++) {
+        if (serialPortFunctions[i].port == port) {
+            return serialPortFunctions[i].scenario & function;
+        }
+    }
+    return false;
+}
+
+void evaluateOtherData(uint8_t sr)
+{
+    otherData[otherDataCount++] = sr;
+}
+
+uint8_t serialTotalBytesWaiting(serialPort_t *instance)
+{
+    fakePort_t *fake = (fakePort_t *)instance;
+    return fake->rxHead - fake->rxTail;
+}
+
+uint8_t serialRead(serialPort_t *instance)
+{
+    fakePort_t *fake = (fakePort_t *)instance;
+    return fake->rx[fake->rxTail++ % FAKE_PORT_BUFFER_SIZE];
+}
+
+void serialWrite(serialPort_t *instance, uint8_t ch)
+{
+    UNUSED(ch);
+    ((fakePort_t *)instance)->txCount++;
+}
+
+int32_t GPS_coord[2];
+uint8_t GPS_numSat;
+uint8_t GPS_update;
+uint16_t GPS_altitude;
+uint16_t GPS_speed;
+uint16_t GPS_ground_course;
+uint8_t GPS_numCh;
+uint8_t GPS_svinfo_chn[16];
+uint8_t GPS_svinfo_svid[16];
+uint8_t GPS_svinfo_quality[16];
+uint8_t GPS_svinfo_cno[16];
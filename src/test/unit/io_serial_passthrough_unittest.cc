@@ -0,0 +1,393 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/serial.h"
+#include "io/serial_passthrough.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define FAKE_PORT_BUFFER_SIZE 1024
+
+// a port with the bytes it will return from serialRead and a transmitter with a settable amount of room
+typedef struct fakePort_s {
+    serialPort_t port;
+
+    uint8_t rx[FAKE_PORT_BUFFER_SIZE];
+    uint16_t rxHead;
+    uint16_t rxTail;
+
+    uint8_t tx[FAKE_PORT_BUFFER_SIZE];
+    uint16_t txCount;
+    uint8_t txFree;
+    uint16_t writeBufCalls;
+} fakePort_t;
+
+static uint32_t fakeMillis;
+
+static fakePort_t hostPort;
+static fakePort_t devicePort;
+
+static bool ended;
+static serialPassthroughEnd_e endReason;
+
+static uint8_t fakeTotalBytesWaiting(serialPort_t *instance)
+{
+    fakePort_t *fake = (fakePort_t *)instance;
+    uint16_t waiting = fake->rxHead - fake->rxTail;
+    return waiting > 255 ? 255 : waiting;
+}
+
+static uint8_t fakeTotalTxFree(serialPort_t *instance)
+{
+    return ((fakePort_t *)instance)->txFree;
+}
+
+static uint8_t fakeRead(serialPort_t *instance)
+{
+    fakePort_t *fake = (fakePort_t *)instance;
+    return fake->rx[fake->rxTail++];
+}
+
+static void fakeWrite(serialPort_t *instance, uint8_t ch)
+{
+    fakePort_t *fake = (fakePort_t *)instance;
+    fake->tx[fake->txCount++] = ch;
+    fake->txFree--;
+}
+
+static void fakeWriteBuf(serialPort_t *instance, const uint8_t *data, uint8_t count)
+{
+    fakePort_t *fake = (fakePort_t *)instance;
+    fake->writeBufCalls++;
+    while (count--) {
+        fakeWrite(instance, *(data++));
+    }
+}
+
+static const struct serialPortVTable fakeVTable[] = {
+    {
+        fakeWrite,
+        fakeTotalBytesWaiting,
+        fakeTotalTxFree,
+        fakeRead,
+        NULL,
+        NULL,
+        NULL,
+        fakeWriteBuf,
+    }
+};
+
+static void resetPort(fakePort_t *fake)
+{
+    memset(fake, 0, sizeof(*fake));
+    fake->port.vTable = fakeVTable;
+    fake->txFree = 255;
+}
+
+static void receive(fakePort_t *fake, const char *data)
+{
+    while (*data) {
+        fake->rx[fake->rxHead++] = *(data++);
+    }
+}
+
+static void receiveBytes(fakePort_t *fake, uint16_t count)
+{
+    while (count--) {
+        fake->rx[fake->rxHead++] = 'a' + count % 26;
+    }
+}
+
+static void passthroughEnded(serialPassthroughEnd_e reason)
+{
+    ended = true;
+    endReason = reason;
+}
+
+static void startPassthrough(uint32_t idleTimeoutMs)
+{
+    resetPort(&hostPort);
+    resetPort(&devicePort);
+    ended = false;
+    fakeMillis = 100000;
+
+    serialPassthroughStop();
+    EXPECT_TRUE(serialPassthroughStart(&hostPort.port, &devicePort.port, idleTimeoutMs, passthroughEnded));
+    ended = false;
+}
+
+// bytes received before it are forwarded by the first update, 1ms on
+static void runFor(uint32_t ms)
+{
+    for (uint32_t i = 0; i < ms; i++) {
+        fakeMillis++;
+        serialPassthroughUpdate();
+    }
+}
+
+TEST(SerialPassthroughTest, ForwardsBothWaysInBlocks)
+{
+    // given
+    startPassthrough(0);
+    receiveBytes(&hostPort, 100);
+    receiveBytes(&devicePort, 10);
+
+    // when
+    serialPassthroughUpdate();
+
+    // then
+    EXPECT_EQ(100, devicePort.txCount);
+    EXPECT_EQ(0, memcmp(hostPort.rx, devicePort.tx, 100));
+    EXPECT_EQ(4, devicePort.writeBufCalls);
+
+    EXPECT_EQ(10, hostPort.txCount);
+    EXPECT_EQ(0, memcmp(devicePort.rx, hostPort.tx, 10));
+    EXPECT_EQ(1, hostPort.writeBufCalls);
+
+    EXPECT_EQ(100, serialPassthroughGetStats()->hostToDevice);
+    EXPECT_EQ(10, serialPassthroughGetStats()->deviceToHost);
+    EXPECT_EQ(SERIAL_PASSTHROUGH_BLOCK_SIZE, serialPassthroughGetStats()->largestBlock);
+}
+
+TEST(SerialPassthroughTest, LeavesBytesThatDoNotFitWaiting)
+{
+    // given
+    startPassthrough(0);
+    receiveBytes(&hostPort, 100);
+    devicePort.txFree = 20;
+
+    // when
+    serialPassthroughUpdate();
+
+    // then
+    EXPECT_EQ(20, devicePort.txCount);
+    EXPECT_EQ(80, fakeTotalBytesWaiting(&hostPort.port));
+
+    // when
+    devicePort.txFree = 255;
+    serialPassthroughUpdate();
+
+    // then
+    EXPECT_EQ(100, devicePort.txCount);
+    EXPECT_EQ(0, memcmp(hostPort.rx, devicePort.tx, 100));
+}
+
+TEST(SerialPassthroughTest, OnlyTheBridgedPortsAreTaken)
+{
+    // given
+    fakePort_t otherPort;
+    resetPort(&otherPort);
+
+    // when
+    startPassthrough(0);
+
+    // then
+    EXPECT_TRUE(isSerialPortInPassthrough(&hostPort.port));
+    EXPECT_TRUE(isSerialPortInPassthrough(&devicePort.port));
+    EXPECT_FALSE(isSerialPortInPassthrough(&otherPort.port));
+
+    // when
+    serialPassthroughStop();
+
+    // then
+    EXPECT_FALSE(isSerialPortInPassthrough(&hostPort.port));
+    EXPECT_FALSE(isSerialPortInPassthrough(&devicePort.port));
+}
+
+TEST(SerialPassthroughTest, EscapeSequenceEndsAfterTheGuardTime)
+{
+    // given
+    startPassthrough(0);
+    receive(&hostPort, "data");
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS);
+
+    // when
+    receive(&hostPort, "+++");
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS);
+
+    // then
+    EXPECT_TRUE(isSerialPassthroughActive());
+
+    // when
+    runFor(1);
+
+    // then
+    EXPECT_FALSE(isSerialPassthroughActive());
+    EXPECT_TRUE(ended);
+    EXPECT_EQ(SERIAL_PASSTHROUGH_END_ESCAPED, endReason);
+
+    // and the escape was forwarded
+    EXPECT_EQ(0, memcmp("data+++", devicePort.tx, 7));
+}
+
+TEST(SerialPassthroughTest, EscapeSequenceNeedsSilenceBefore)
+{
+    // given
+    startPassthrough(0);
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS);
+    receive(&hostPort, "x");
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS / 2);
+
+    // when
+    receive(&hostPort, "+++");
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS * 2);
+
+    // then
+    EXPECT_TRUE(isSerialPassthroughActive());
+    EXPECT_FALSE(ended);
+}
+
+TEST(SerialPassthroughTest, EscapeSequenceNeedsSilenceAfter)
+{
+    // given
+    startPassthrough(0);
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS);
+
+    // when
+    receive(&hostPort, "+++");
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS / 2);
+    receive(&hostPort, "x");
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS * 2);
+
+    // then
+    EXPECT_TRUE(isSerialPassthroughActive());
+}
+
+TEST(SerialPassthroughTest, MoreThanThreeEscapeCharactersAreData)
+{
+    // given
+    startPassthrough(0);
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS);
+
+    // when
+    receive(&hostPort, "++++");
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS * 2);
+
+    // then
+    EXPECT_TRUE(isSerialPassthroughActive());
+}
+
+TEST(SerialPassthroughTest, EscapeSequenceSpreadOverUpdates)
+{
+    // given
+    startPassthrough(0);
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS);
+
+    // when
+    receive(&hostPort, "+");
+    runFor(10);
+    receive(&hostPort, "++");
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS + 1);
+
+    // then
+    EXPECT_FALSE(isSerialPassthroughActive());
+    EXPECT_EQ(SERIAL_PASSTHROUGH_END_ESCAPED, endReason);
+}
+
+TEST(SerialPassthroughTest, EscapeSequenceFromTheDeviceIsData)
+{
+    // given
+    startPassthrough(0);
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS);
+
+    // when
+    receive(&devicePort, "+++");
+    runFor(SERIAL_PASSTHROUGH_ESCAPE_GUARD_MS * 2);
+
+    // then
+    EXPECT_TRUE(isSerialPassthroughActive());
+    EXPECT_EQ(3, hostPort.txCount);
+}
+
+TEST(SerialPassthroughTest, TimesOutWithoutDataFromTheHost)
+{
+    // given
+    startPassthrough(5000);
+    runFor(4000);
+    receive(&hostPort, "x");
+    runFor(4000);
+
+    // when
+    receive(&devicePort, "y");
+    runFor(1000);
+
+    // then, data from the device does not keep it going
+    EXPECT_TRUE(isSerialPassthroughActive());
+
+    // when
+    runFor(1);
+
+    // then
+    EXPECT_FALSE(isSerialPassthroughActive());
+    EXPECT_EQ(SERIAL_PASSTHROUGH_END_TIMED_OUT, endReason);
+}
+
+TEST(SerialPassthroughTest, ZeroTimeoutNeverTimesOut)
+{
+    // given
+    startPassthrough(0);
+
+    // when
+    runFor(100000);
+
+    // then
+    EXPECT_TRUE(isSerialPassthroughActive());
+}
+
+TEST(SerialPassthroughTest, OnlyOnePassthroughAtATime)
+{
+    // given
+    startPassthrough(0);
+
+    // expect
+    EXPECT_FALSE(serialPassthroughStart(&devicePort.port, &hostPort.port, 0, NULL));
+}
+
+TEST(SerialPassthroughTest, StopEndsWithTheCallback)
+{
+    // given
+    startPassthrough(0);
+
+    // when
+    serialPassthroughStop();
+
+    // then
+    EXPECT_FALSE(isSerialPassthroughActive());
+    EXPECT_TRUE(ended);
+    EXPECT_EQ(SERIAL_PASSTHROUGH_END_STOPPED, endReason);
+
+    // and nothing is forwarded afterwards
+    receive(&hostPort, "x");
+    serialPassthroughUpdate();
+    EXPECT_EQ(0, devicePort.txCount);
+}
+
+// STUBS
+
+uint32_t millis(void)
+{
+    return fakeMillis;
+}
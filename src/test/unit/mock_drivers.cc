@@ -0,0 +1,160 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/system.h"
+#include "drivers/adc.h"
+#include "drivers/gpio.h"
+#include "drivers/timer.h"
+#include "drivers/pwm_output.h"
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "mock_drivers.h"
+
+uint16_t mockMotorOutput[MOCK_MOTOR_COUNT];
+uint16_t mockServoOutput[MOCK_SERVO_COUNT];
+uint32_t mockMotorWriteCount;
+
+serialReceiveCallbackPtr mockSerialRxCallback;
+uint32_t mockSerialBaudRate;
+uint8_t mockSerialTxBuffer[MOCK_SERIAL_BUFFER_SIZE];
+uint16_t mockSerialTxCount;
+
+static uint32_t mockMicros;
+static uint16_t mockAdc[MOCK_ADC_CHANNEL_COUNT];
+
+static uint8_t mockSerialRxBuffer[MOCK_SERIAL_BUFFER_SIZE];
+static uint16_t mockSerialRxHead;
+static uint16_t mockSerialRxTail;
+
+static serialPort_t mockSerialPort;
+
+void mockDriversReset(void)
+{
+    memset(mockMotorOutput, 0, sizeof(mockMotorOutput));
+    memset(mockServoOutput, 0, sizeof(mockServoOutput));
+    mockMotorWriteCount = 0;
+
+    mockSerialRxCallback = NULL;
+    mockSerialBaudRate = 0;
+    mockSerialTxCount = 0;
+    mockSerialRxHead = mockSerialRxTail = 0;
+
+    mockMicros = 0;
+    memset(mockAdc, 0, sizeof(mockAdc));
+}
+
+void mockSetMicros(uint32_t time)
+{
+    mockMicros = time;
+}
+
+void mockAdvanceMicros(uint32_t time)
+{
+    mockMicros += time;
+}
+
+void mockSetAdcChannel(uint8_t channel, uint16_t value)
+{
+    mockAdc[channel] = value;
+}
+
+void mockSerialQueueRx(const uint8_t *data, uint16_t length)
+{
+    while (length--) {
+        mockSerialRxBuffer[mockSerialRxHead] = *data++;
+        mockSerialRxHead = (mockSerialRxHead + 1) % MOCK_SERIAL_BUFFER_SIZE;
+    }
+}
+
+void mockSerialReceive(const uint8_t *data, uint16_t length, uint32_t delay)
+{
+    while (length--) {
+        mockAdvanceMicros(delay);
+        mockSerialRxCallback(*data++);
+    }
+}
+
+uint32_t micros(void)
+{
+    return mockMicros;
+}
+
+uint32_t millis(void)
+{
+    return mockMicros / 1000;
+}
+
+uint16_t adcGetChannel(uint8_t channel)
+{
+    return channel < MOCK_ADC_CHANNEL_COUNT ? mockAdc[channel] : 0;
+}
+
+void pwmWriteMotor(uint8_t index, uint16_t value)
+{
+    if (index < MOCK_MOTOR_COUNT) {
+        mockMotorOutput[index] = value;
+    }
+    mockMotorWriteCount++;
+}
+
+void pwmWriteServo(uint8_t index, uint16_t value)
+{
+    if (index < MOCK_SERVO_COUNT) {
+        mockServoOutput[index] = value;
+    }
+}
+
+serialPort_t *openSerialPort(serialPortFunction_e functionMask, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, serialInversion_e inversion)
+{
+    (void)functionMask;
+    (void)mode;
+    (void)inversion;
+
+    mockSerialRxCallback = callback;
+    mockSerialBaudRate = baudRate;
+    return &mockSerialPort;
+}
+
+uint8_t serialTotalBytesWaiting(serialPort_t *instance)
+{
+    (void)instance;
+    return (mockSerialRxHead - mockSerialRxTail + MOCK_SERIAL_BUFFER_SIZE) % MOCK_SERIAL_BUFFER_SIZE;
+}
+
+uint8_t serialRead(serialPort_t *instance)
+{
+    uint8_t ch;
+    (void)instance;
+
+    ch = mockSerialRxBuffer[mockSerialRxTail];
+    mockSerialRxTail = (mockSerialRxTail + 1) % MOCK_SERIAL_BUFFER_SIZE;
+    return ch;
+}
+
+void serialWrite(serialPort_t *instance, uint8_t ch)
+{
+    (void)instance;
+    if (mockSerialTxCount < MOCK_SERIAL_BUFFER_SIZE) {
+        mockSerialTxBuffer[mockSerialTxCount++] = ch;
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Host stand-ins for the drivers under the flight and receiver code: PWM outputs, the serial port, the
+// system clock and the ADC.  Tests set the inputs and read back what the code under test wrote.
+
+#define MOCK_MOTOR_COUNT 12
+#define MOCK_SERVO_COUNT 8
+#define MOCK_ADC_CHANNEL_COUNT 4
+#define MOCK_SERIAL_BUFFER_SIZE 256
+
+extern uint16_t mockMotorOutput[MOCK_MOTOR_COUNT];
+extern uint16_t mockServoOutput[MOCK_SERVO_COUNT];
+extern uint32_t mockMotorWriteCount;
+
+extern serialReceiveCallbackPtr mockSerialRxCallback;      // registered through openSerialPort
+extern uint32_t mockSerialBaudRate;
+extern uint8_t mockSerialTxBuffer[MOCK_SERIAL_BUFFER_SIZE];
+extern uint16_t mockSerialTxCount;
+
+void mockDriversReset(void);
+
+void mockSetMicros(uint32_t time);
+void mockAdvanceMicros(uint32_t time);
+
+void mockSetAdcChannel(uint8_t channel, uint16_t value);
+
+// bytes serialRead returns, in order
+void mockSerialQueueRx(const uint8_t *data, uint16_t length);
+// bytes passed to the callback openSerialPort registered, each delay us after the previous one
+void mockSerialReceive(const uint8_t *data, uint16_t length, uint32_t delay);
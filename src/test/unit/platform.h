@@ -18,3 +18,294 @@
 #pragma once
 
 #define BARO
+#define GPS
+#define SERIAL_PORT_COUNT 4
+#define TELEMETRY
+
+// Just enough of the STM32F10x peripheral library for driver code to build on the host.  Registers are
+// plain memory, the library calls are stubbed by the tests that use them.
+
+#define STM32F10X_MD
+
+typedef enum { DISABLE = 0, ENABLE = !DISABLE } FunctionalState;
+
+typedef struct {
+    volatile uint32_t CRL, CRH, IDR, ODR, BSRR, BRR, LCKR;
+} GPIO_TypeDef;
+
+#ifdef __cplusplus
+// A status register whose flags are cleared by writing 0 to them and left alone by writing 1, as the timer
+// SR flags are.  The hardware side raises them with raise().
+typedef struct hostStatusRegister_s {
+    volatile uint16_t value;
+
+    operator uint16_t() const { return value; }
+    hostStatusRegister_s &operator=(uint16_t written) { value &= written; return *this; }
+    void raise(uint16_t flags) { value |= flags; }
+} hostStatusRegister_t;
+#else
+typedef volatile uint16_t hostStatusRegister_t;
+#endif
+
+#ifdef __cplusplus
+// The DWT cycle counter.  Every read gives the hardware side the chance to run through onRead, which moves the
+// count on, as time passes while the firmware polls it.
+typedef struct hostCycleCounter_s {
+    volatile uint32_t value;
+    void (*onRead)(void);
+
+    operator uint32_t() { if (onRead) { onRead(); } return value; }
+} hostCycleCounter_t;
+#else
+typedef volatile uint32_t hostCycleCounter_t;
+#endif
+
+typedef struct {
+    volatile uint32_t CTRL;
+    hostCycleCounter_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DHCSR, DCRSR, DCRDR, DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    volatile uint16_t CR1, CR2, SMCR, DIER;
+    hostStatusRegister_t SR;
+    volatile uint16_t EGR, CCMR1, CCMR2, CCER, CNT, PSC, ARR, RCR, CCR1, CCR2, CCR3, CCR4, BDTR, DCR, DMAR;
+} TIM_TypeDef;
+
+typedef struct {
+    volatile uint16_t SR, DR, BRR, CR1, CR2, CR3, GTPR;
+} USART_TypeDef;
+
+typedef struct {
+    volatile uint32_t CCR, CNDTR, CPAR, CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct {
+    volatile uint16_t CR1, CR2, SR, DR, CRCPR, RXCRCR, TXCRCR, I2SCFGR, I2SPR;
+} SPI_TypeDef;
+
+typedef struct {
+    uint32_t USART_BaudRate;
+    uint16_t USART_WordLength;
+    uint16_t USART_StopBits;
+    uint16_t USART_Parity;
+    uint16_t USART_Mode;
+    uint16_t USART_HardwareFlowControl;
+} USART_InitTypeDef;
+
+typedef struct {
+    uint32_t DMA_PeripheralBaseAddr;
+    uint32_t DMA_MemoryBaseAddr;
+    uint32_t DMA_DIR;
+    uint32_t DMA_BufferSize;
+    uint32_t DMA_PeripheralInc;
+    uint32_t DMA_MemoryInc;
+    uint32_t DMA_PeripheralDataSize;
+    uint32_t DMA_MemoryDataSize;
+    uint32_t DMA_Mode;
+    uint32_t DMA_Priority;
+    uint32_t DMA_M2M;
+} DMA_InitTypeDef;
+
+#define USART_WordLength_8b             0x0000
+#define USART_StopBits_1                0x0000
+#define USART_StopBits_2                0x2000
+#define USART_Parity_No                 0x0000
+#define USART_Parity_Even               0x0400
+#define USART_Mode_Rx                   0x0004
+#define USART_Mode_Tx                   0x0008
+#define USART_HardwareFlowControl_None  0x0000
+#define USART_IT_RXNE                   0x0525
+#define USART_IT_TXE                    0x0727
+#define USART_DMAReq_Tx                 0x0080
+#define USART_DMAReq_Rx                 0x0040
+
+#define DMA_DIR_PeripheralDST           0x0010
+#define DMA_DIR_PeripheralSRC           0x0000
+#define DMA_PeripheralInc_Disable       0x0000
+#define DMA_MemoryInc_Enable            0x0080
+#define DMA_PeripheralDataSize_Byte     0x0000
+#define DMA_MemoryDataSize_Byte         0x0000
+#define DMA_Mode_Circular               0x0020
+#define DMA_Mode_Normal                 0x0000
+#define DMA_Priority_Medium             0x1000
+#define DMA_M2M_Disable                 0x0000
+#define DMA_IT_TC                       0x0002
+
+extern USART_TypeDef hostUSART1, hostUSART2, hostUSART3;
+#define USART1 (&hostUSART1)
+#define USART2 (&hostUSART2)
+#define USART3 (&hostUSART3)
+
+extern GPIO_TypeDef hostGPIOA, hostGPIOB;
+#define GPIOA (&hostGPIOA)
+#define GPIOB (&hostGPIOB)
+#define GPIO_Pin_12 ((uint16_t)0x1000)
+
+extern SPI_TypeDef hostSPI1, hostSPI2;
+#define SPI1 (&hostSPI1)
+#define SPI2 (&hostSPI2)
+
+// the SPI flash as it is wired on the NAZE, see unit/flash_emulator.h
+#define M25P16_CS_GPIO GPIOB
+#define M25P16_CS_PIN GPIO_Pin_12
+#define M25P16_SPI_INSTANCE SPI2
+
+void USART_Init(USART_TypeDef *USARTx, USART_InitTypeDef *USART_InitStruct);
+void USART_Cmd(USART_TypeDef *USARTx, FunctionalState NewState);
+void USART_ITConfig(USART_TypeDef *USARTx, uint16_t USART_IT, FunctionalState NewState);
+void USART_ClearITPendingBit(USART_TypeDef *USARTx, uint16_t USART_IT);
+void USART_DMACmd(USART_TypeDef *USARTx, uint16_t USART_DMAReq, FunctionalState NewState);
+void GPIO_SetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void GPIO_ResetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void DMA_StructInit(DMA_InitTypeDef *DMA_InitStruct);
+void DMA_DeInit(DMA_Channel_TypeDef *DMAy_Channelx);
+void DMA_Init(DMA_Channel_TypeDef *DMAy_Channelx, DMA_InitTypeDef *DMA_InitStruct);
+void DMA_Cmd(DMA_Channel_TypeDef *DMAy_Channelx, FunctionalState NewState);
+void DMA_ITConfig(DMA_Channel_TypeDef *DMAy_Channelx, uint32_t DMA_IT, FunctionalState NewState);
+void DMA_SetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx, uint16_t DataNumber);
+uint16_t DMA_GetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx);
+
+extern DWT_Type hostDWT;
+extern CoreDebug_Type hostCoreDebug;
+#define DWT (&hostDWT)
+#define CoreDebug (&hostCoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk          0x00000001
+#define CoreDebug_DEMCR_TRCENA_Msk      0x01000000
+
+#define I2C_Direction_Transmitter       0x00
+#define I2C_Direction_Receiver          0x01
+
+extern TIM_TypeDef hostTIM1, hostTIM2, hostTIM3, hostTIM4;
+#define TIM1 (&hostTIM1)
+#define TIM2 (&hostTIM2)
+#define TIM3 (&hostTIM3)
+#define TIM4 (&hostTIM4)
+
+#define TIM_Channel_1                   0x0000
+#define TIM_Channel_2                   0x0004
+#define TIM_Channel_3                   0x0008
+#define TIM_Channel_4                   0x000C
+#define TIM_IT_Update                   0x0001
+#define TIM_IT_CC1                      0x0002
+#define TIM_IT_CC2                      0x0004
+#define TIM_IT_CC3                      0x0008
+#define TIM_IT_CC4                      0x0010
+#define TIM_CounterMode_Up              0x0000
+
+typedef enum {
+    EXTI1_IRQn = 7,
+    EXTI9_5_IRQn = 23,
+    TIM1_CC_IRQn = 27,
+    TIM2_IRQn = 28,
+    TIM3_IRQn = 29,
+    TIM4_IRQn = 30
+} IRQn_Type;
+
+#define RCC_APB1Periph_TIM2             0x00000001
+#define RCC_APB1Periph_TIM3             0x00000002
+#define RCC_APB1Periph_TIM4             0x00000004
+#define RCC_APB2Periph_GPIOA            0x00000004
+#define RCC_APB2Periph_GPIOB            0x00000008
+#define RCC_APB2Periph_TIM1             0x00000800
+
+#define assert_param(expr) ((void)0)
+#define IS_TIM_CHANNEL(channel) ((channel) <= TIM_Channel_4)
+
+typedef struct {
+    uint16_t TIM_Prescaler;
+    uint16_t TIM_CounterMode;
+    uint16_t TIM_Period;
+    uint16_t TIM_ClockDivision;
+    uint8_t TIM_RepetitionCounter;
+} TIM_TimeBaseInitTypeDef;
+
+typedef struct {
+    uint16_t TIM_OCMode;
+    uint16_t TIM_OutputState;
+    uint16_t TIM_OutputNState;
+    uint16_t TIM_Pulse;
+    uint16_t TIM_OCPolarity;
+    uint16_t TIM_OCNPolarity;
+    uint16_t TIM_OCIdleState;
+    uint16_t TIM_OCNIdleState;
+} TIM_OCInitTypeDef;
+
+#define TIM_OCMode_PWM2                 0x0070
+#define TIM_OutputState_Enable          0x0001
+#define TIM_OutputNState_Disable        0x0000
+#define TIM_OCPolarity_Low              0x0002
+#define TIM_OCIdleState_Set             0x0100
+#define TIM_OCPreload_Enable            0x0008
+
+typedef struct {
+    uint16_t TIM_Channel;
+    uint16_t TIM_ICPolarity;
+    uint16_t TIM_ICSelection;
+    uint16_t TIM_ICPrescaler;
+    uint16_t TIM_ICFilter;
+} TIM_ICInitTypeDef;
+
+#define TIM_ICPolarity_Rising           0x0000
+#define TIM_ICPolarity_Falling          0x0002
+#define TIM_ICSelection_DirectTI        0x0001
+#define TIM_ICPSC_DIV1                  0x0000
+
+typedef struct {
+    uint8_t NVIC_IRQChannel;
+    uint8_t NVIC_IRQChannelPreemptionPriority;
+    uint8_t NVIC_IRQChannelSubPriority;
+    FunctionalState NVIC_IRQChannelCmd;
+} NVIC_InitTypeDef;
+
+#define EXTI_Line1                      0x00002
+#define EXTI_Line9                      0x00200
+#define GPIO_PortSourceGPIOB            0x01
+#define GPIO_PinSource1                 0x01
+#define GPIO_PinSource9                 0x09
+
+typedef enum { EXTI_Mode_Interrupt = 0x00, EXTI_Mode_Event = 0x04 } EXTIMode_TypeDef;
+typedef enum { EXTI_Trigger_Rising = 0x08, EXTI_Trigger_Falling = 0x0C, EXTI_Trigger_Rising_Falling = 0x10 } EXTITrigger_TypeDef;
+
+typedef struct {
+    uint32_t EXTI_Line;
+    EXTIMode_TypeDef EXTI_Mode;
+    EXTITrigger_TypeDef EXTI_Trigger;
+    FunctionalState EXTI_LineCmd;
+} EXTI_InitTypeDef;
+
+void EXTI_Init(EXTI_InitTypeDef *EXTI_InitStruct);
+void EXTI_ClearITPendingBit(uint32_t EXTI_Line);
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+
+void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t TIM_IT, FunctionalState NewState);
+void TIM_TimeBaseStructInit(TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct);
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct);
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState);
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct);
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState);
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState);
+void TIM_OCStructInit(TIM_OCInitTypeDef *TIM_OCInitStruct);
+void TIM_OC1Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct);
+void TIM_OC2Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct);
+void TIM_OC3Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct);
+void TIM_OC4Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct);
+void TIM_OC1PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload);
+void TIM_OC2PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload);
+void TIM_OC3PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload);
+void TIM_OC4PreloadConfig(TIM_TypeDef *TIMx, uint16_t TIM_OCPreload);
+void TIM_CtrlPWMOutputs(TIM_TypeDef *TIMx, FunctionalState NewState);
+void TIM_ICStructInit(TIM_ICInitTypeDef *TIM_ICInitStruct);
+void TIM_ICInit(TIM_TypeDef *TIMx, TIM_ICInitTypeDef *TIM_ICInitStruct);
+void TIM_SetCounter(TIM_TypeDef *TIMx, uint16_t Counter);
+
+// the unique device id and core clock are read by MSP_UID and the CLI status command
+extern uint32_t hostUniqueId[3];
+#define U_ID_0 (hostUniqueId[0])
+#define U_ID_1 (hostUniqueId[1])
+#define U_ID_2 (hostUniqueId[2])
+
+extern uint32_t SystemCoreClock;
@@ -0,0 +1,324 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/adc.h"
+#include "drivers/serial.h"
+
+#include "rx/rx.h"
+#include "rx/rssi.h"
+#include "io/rc_controls.h"
+
+#include "config/config.h"
+
+#include "mock_drivers.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// The receiver sends a frame every frameInterval, the main loop sees it on its first pass after and runs
+// updateRSSI() then, or at 50Hz while no frames arrive.  Link patterns have a character per frame: 'v' a valid
+// frame, 'l' a frame the receiver marks as lost and '.' a frame that never arrives.
+
+#define LOOP_US 3500
+#define FALLBACK_US 20000
+#define SBUS_FRAME_US 9000
+#define SBUS_FAST_FRAME_US 7000
+#define DSM2_FRAME_US 22000
+
+static uint32_t enabledFeatures;
+static rxConfig_t rxConfig;
+
+static uint32_t frameInterval;
+static uint32_t frameAt;                    // the next frame leaves the receiver
+static uint32_t loopAt;
+static uint32_t processedAt;
+
+static void setupRssi(uint32_t features, uint8_t rssiChannel, uint32_t interval)
+{
+    mockDriversReset();
+    enabledFeatures = features;
+
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    rxConfig.rssi_channel = rssiChannel;
+    for (int i = 0; i < MAX_SUPPORTED_RC_CHANNEL_COUNT; i++) {
+        rcData[i] = 1500;
+    }
+
+    frameInterval = interval;
+    frameAt = 1000;
+    loopAt = 0;
+    processedAt = 0;
+
+    rssiInit(&rxConfig);
+}
+
+static void idleLoop(void)
+{
+    if (loopAt - processedAt >= FALLBACK_US) {
+        updateRSSI(loopAt);
+        processedAt = loopAt;
+    }
+    loopAt += LOOP_US;
+}
+
+static void runLink(const char *pattern, int repeat)
+{
+    for (int i = 0; i < repeat; i++) {
+        for (const char *frame = pattern; *frame; frame++) {
+            while (loopAt < frameAt) {
+                idleLoop();
+            }
+            if (*frame != '.') {
+                if (*frame == 'v') {
+                    rssiFrameReceived(loopAt);
+                } else {
+                    rssiFramesLost(loopAt, 1);
+                }
+                updateRSSI(loopAt);
+                processedAt = loopAt;
+                loopAt += LOOP_US;
+            }
+            frameAt += frameInterval;
+        }
+    }
+}
+
+TEST(RssiTest, EveryFrameValid)
+{
+    // given
+    setupRssi(0, 0, SBUS_FRAME_US);
+
+    // when frames are seen up to a loop late
+    runLink("v", 200);
+
+    // then
+    EXPECT_EQ(100, getLinkQuality()->frameQuality);
+    EXPECT_EQ(100, getLinkQuality()->linkQuality);
+    EXPECT_EQ(0u, getLinkQuality()->lostFrames);
+    EXPECT_EQ(200u, getLinkQuality()->validFrames);
+    EXPECT_NEAR(SBUS_FRAME_US, getLinkQuality()->frameInterval, 500);
+    EXPECT_FALSE(isLinkQualityLow());
+
+    // and without an RSSI source the link quality stands in for it
+    EXPECT_EQ(0, getLinkQuality()->rssi);
+    EXPECT_EQ(1023, rssi);
+}
+
+TEST(RssiTest, LearnsSlowFrameRate)
+{
+    // given
+    setupRssi(0, 0, DSM2_FRAME_US);
+
+    // when
+    runLink("v", 100);
+
+    // then
+    EXPECT_EQ(100, getLinkQuality()->frameQuality);
+    EXPECT_NEAR(DSM2_FRAME_US, getLinkQuality()->frameInterval, 500);
+}
+
+TEST(RssiTest, LoopHalfTheFrameInterval)
+{
+    // given frames seen up to half their interval late
+    setupRssi(0, 0, SBUS_FAST_FRAME_US);
+
+    // when
+    runLink("v", 500);
+
+    // then
+    EXPECT_EQ(100, getLinkQuality()->frameQuality);
+    EXPECT_EQ(0u, getLinkQuality()->lostFrames);
+
+    // and a missing frame is still told apart
+    runLink(".vvv", 16);
+    EXPECT_EQ(75, getLinkQuality()->frameQuality);
+    EXPECT_EQ(16u, getLinkQuality()->lostFrames);
+}
+
+TEST(RssiTest, FramesMarkedLost)
+{
+    // given
+    setupRssi(0, 0, SBUS_FRAME_US);
+
+    // when every fourth frame repeats the last channels
+    runLink("vvvl", 64);
+
+    // then
+    EXPECT_EQ(75, getLinkQuality()->frameQuality);
+    EXPECT_EQ(64u, getLinkQuality()->lostFrames);
+    EXPECT_EQ(192u, getLinkQuality()->validFrames);
+}
+
+TEST(RssiTest, MissingFramesCountedFromGaps)
+{
+    // given
+    setupRssi(0, 0, SBUS_FRAME_US);
+    runLink("v", 10);
+
+    // when every other frame never arrives
+    runLink(".v", 64);
+
+    // then
+    EXPECT_EQ(50, getLinkQuality()->frameQuality);
+    EXPECT_EQ(64u, getLinkQuality()->lostFrames);
+    EXPECT_EQ(511, rssi);
+    EXPECT_FALSE(isLinkQualityLow());
+}
+
+TEST(RssiTest, BurstLossRecovers)
+{
+    // given
+    setupRssi(0, 0, SBUS_FRAME_US);
+    runLink("v", 100);
+
+    // when 16 frames in a row are missing
+    runLink(".", 16);
+    runLink("v", 1);
+
+    // then the gap is counted in frame intervals, give or take one over a long gap
+    EXPECT_NEAR(16, getLinkQuality()->lostFrames, 1);
+    EXPECT_NEAR(100 - 16 * 100 / LINK_QUALITY_WINDOW, getLinkQuality()->frameQuality, 2);
+
+    // when
+    runLink("v", LINK_QUALITY_WINDOW - 1);
+
+    // then the burst has left the window
+    EXPECT_EQ(100, getLinkQuality()->frameQuality);
+}
+
+TEST(RssiTest, SilenceDecaysToZero)
+{
+    // given
+    setupRssi(0, 0, SBUS_FRAME_US);
+    runLink("v", 100);
+
+    // when the receiver stops sending for half the window
+    while (loopAt < frameAt + LINK_QUALITY_WINDOW / 2 * SBUS_FRAME_US) {
+        idleLoop();
+    }
+
+    // then the quality falls without a frame to update it
+    EXPECT_NEAR(50, getLinkQuality()->frameQuality, 5);
+
+    // when
+    while (loopAt < frameAt + LINK_QUALITY_WINDOW * SBUS_FRAME_US + FALLBACK_US) {
+        idleLoop();
+    }
+
+    // then
+    EXPECT_EQ(0, getLinkQuality()->linkQuality);
+    EXPECT_TRUE(isLinkQualityLow());
+
+    // and a frame after a long silence takes its slot
+    frameAt = loopAt;
+    runLink("v", 1);
+    EXPECT_EQ(100 / LINK_QUALITY_WINDOW, getLinkQuality()->frameQuality);
+}
+
+TEST(RssiTest, RssiFromChannelIsSmoothed)
+{
+    // given
+    setupRssi(0, 5, SBUS_FRAME_US);
+    rcData[AUX1] = 1500;
+    runLink("v", 1);
+    EXPECT_EQ(511, rssi);
+
+    // when a single frame carries a spike
+    rcData[AUX1] = 2000;
+    runLink("v", 1);
+
+    // then it moves the RSSI an eighth of the way
+    EXPECT_NEAR(511 + (1023 - 511) / 8, rssi, 1);
+
+    // when the receiver reports full strength from now on
+    runLink("v", 60);
+
+    // then
+    EXPECT_EQ(1023, rssi);
+    EXPECT_EQ(100, getLinkQuality()->rssi);
+
+    // and out of range pulses are limited
+    rcData[AUX1] = 900;
+    runLink("v", 60);
+    EXPECT_EQ(0, rssi);
+}
+
+TEST(RssiTest, RssiFromAdcIsSmoothed)
+{
+    // given
+    setupRssi(FEATURE_RSSI_ADC, 0, SBUS_FRAME_US);
+    mockSetAdcChannel(ADC_RSSI, 0xFFF);
+
+    // when
+    runLink("v", 1);
+
+    // then the first sample is taken as it is
+    EXPECT_EQ(1023, rssi);
+
+    // when
+    mockSetAdcChannel(ADC_RSSI, 0x800);
+    runLink("v", 4);
+
+    // then
+    EXPECT_GT(rssi, 700);
+
+    // when
+    runLink("v", 60);
+
+    // then
+    EXPECT_NEAR(512, rssi, 2);
+    EXPECT_EQ(50, getLinkQuality()->rssi);
+}
+
+TEST(RssiTest, LinkQualityIsTheLowerOfRssiAndFrames)
+{
+    // given
+    setupRssi(0, 5, SBUS_FRAME_US);
+
+    // when the RSSI is low and every frame arrives
+    rcData[AUX1] = 1300;
+    runLink("v", 100);
+
+    // then
+    EXPECT_EQ(30, getLinkQuality()->linkQuality);
+    EXPECT_TRUE(isLinkQualityLow());
+
+    // when interference loses frames at a good RSSI
+    rcData[AUX1] = 2000;
+    runLink("vvvl", 64);
+
+    // then
+    EXPECT_EQ(75, getLinkQuality()->linkQuality);
+    EXPECT_EQ(100, getLinkQuality()->rssi);
+
+    // and the RSSI reported by MSP stays the RSSI
+    EXPECT_EQ(1023, rssi);
+}
+
+// STUBS
+
+int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
+
+bool feature(uint32_t mask)
+{
+    return enabledFeatures & mask;
+}
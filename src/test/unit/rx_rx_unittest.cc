@@ -0,0 +1,371 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/adc.h"
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "flight/failsafe.h"
+
+#include "rx/rx.h"
+#include "rx/rssi.h"
+#include "io/rc_controls.h"
+
+#include "config/config.h"
+
+#include "mock_drivers.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+void rxInit(rxConfig_t *rxConfig, failsafe_t *initialFailsafe);
+uint8_t calculateChannelRemapping(uint8_t *channelMap, uint8_t channelMapEntryCount, uint8_t channelToRemap);
+
+#define FAKE_CHANNEL_COUNT 8
+
+static uint32_t enabledFeatures;
+static rxConfig_t rxConfig;
+
+static uint16_t fakeChannels[FAKE_CHANNEL_COUNT];
+static bool fakeFrameComplete;
+
+static bool fakePwmFrame;
+
+static uint32_t failsafeValidDataCount;
+static uint32_t failsafeValidDataAt;
+static uint32_t failsafePulseChecks;
+static bool failsafeUpdateDue;
+
+static void failsafeOnValidDataReceived(uint32_t currentTime) { failsafeValidDataCount++; failsafeValidDataAt = currentTime; }
+static bool failsafeCheckPulse(uint16_t pulseDuration) { failsafePulseChecks++; return pulseDuration > 985 && pulseDuration < 2115; }
+static bool failsafeIsUpdateDue(uint32_t currentTime) { UNUSED(currentTime); return failsafeUpdateDue; }
+
+static const failsafeVTable_t failsafeVTable = {
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    failsafeOnValidDataReceived,
+    NULL,
+    NULL,
+    failsafeCheckPulse,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    failsafeIsUpdateDue
+};
+
+static failsafe_t failsafe = { &failsafeVTable, FAILSAFE_STAGE_IDLE, 0, 0, 0, 0, false, false, false };
+
+static uint16_t fakeReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
+{
+    UNUSED(rxRuntimeConfig);
+    return fakeChannels[chan];
+}
+
+static void setupRx(uint32_t features)
+{
+    mockDriversReset();
+    enabledFeatures = features;
+    fakeFrameComplete = false;
+    fakePwmFrame = false;
+    failsafeValidDataCount = 0;
+    failsafeValidDataAt = 0;
+    failsafePulseChecks = 0;
+    failsafeUpdateDue = false;
+
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    parseRcChannels("AETR1234", &rxConfig);
+    rxConfig.midrc = 1500;
+    rxConfig.mincheck = 1100;
+    rxConfig.maxcheck = 1900;
+
+    for (int i = 0; i < FAKE_CHANNEL_COUNT; i++) {
+        fakeChannels[i] = 1000 + i * 100;
+    }
+
+    rxRuntimeConfig.channelCount = 0;
+    rxInit(&rxConfig, &failsafe);
+}
+
+TEST(RxTest, ChannelRemapping)
+{
+    // given
+    uint8_t channelMap[] = { 3, 2, 1, 0 };
+
+    // then
+    EXPECT_EQ(3, calculateChannelRemapping(channelMap, sizeof(channelMap), 0));
+    EXPECT_EQ(0, calculateChannelRemapping(channelMap, sizeof(channelMap), 3));
+
+    // and channels past the map are not remapped
+    EXPECT_EQ(4, calculateChannelRemapping(channelMap, sizeof(channelMap), 4));
+    EXPECT_EQ(7, calculateChannelRemapping(channelMap, sizeof(channelMap), 7));
+}
+
+TEST(RxTest, ParseRcChannels)
+{
+    // given
+    rxConfig_t config;
+    memset(&config, 0, sizeof(config));
+
+    // when
+    parseRcChannels("TAER1234", &config);
+
+    // then
+    const uint8_t expected[] = { 1, 2, 3, 0, 4, 5, 6, 7 };
+    for (unsigned i = 0; i < sizeof(expected); i++) {
+        EXPECT_EQ(expected[i], config.rcmap[i]) << "channel " << i;
+    }
+}
+
+TEST(RxTest, InitCentresEveryChannel)
+{
+    // given
+    memset(rcData, 0, sizeof(rcData));
+
+    // when
+    setupRx(0);
+
+    // then
+    for (int i = 0; i < MAX_SUPPORTED_RC_CHANNEL_COUNT; i++) {
+        EXPECT_EQ(1500, rcData[i]);
+    }
+}
+
+TEST(RxTest, DataDrivenFrameUpdatesChannels)
+{
+    // given
+    setupRx(FEATURE_RX_MSP | FEATURE_FAILSAFE);
+    parseRcChannels("TAER1234", &rxConfig);
+    fakeChannels[5] = 500;          // out of range
+
+    calculateRxChannels(0);
+
+    // when no frame has arrived
+    updateRx(5000);
+
+    // then processing waits for the 50Hz fallback
+    EXPECT_FALSE(shouldProcessRx(10000));
+    EXPECT_EQ(0u, failsafeValidDataCount);
+
+    // when
+    fakeFrameComplete = true;
+    updateRx(10000);
+
+    // then the frame is reported to failsafe as it arrives
+    EXPECT_TRUE(shouldProcessRx(10000));
+    EXPECT_EQ(1u, failsafeValidDataCount);
+    EXPECT_EQ(10000u, failsafeValidDataAt);
+
+    // when
+    calculateRxChannels(10000);
+
+    // then channels are remapped, and pulses out of range are replaced by midrc
+    EXPECT_EQ(fakeChannels[1], rcData[ROLL]);
+    EXPECT_EQ(fakeChannels[2], rcData[PITCH]);
+    EXPECT_EQ(fakeChannels[3], rcData[YAW]);
+    EXPECT_EQ(fakeChannels[0], rcData[THROTTLE]);
+    EXPECT_EQ(fakeChannels[4], rcData[AUX1]);
+    EXPECT_EQ(1500, rcData[AUX2]);
+    EXPECT_EQ(fakeChannels[7], rcData[AUX4]);
+
+    // and the fallback runs 20ms later
+    EXPECT_FALSE(shouldProcessRx(29999));
+    EXPECT_TRUE(shouldProcessRx(30000));
+}
+
+TEST(RxTest, DataDrivenRxKeepsChannelsWithoutFrame)
+{
+    // given
+    setupRx(FEATURE_RX_MSP);
+    fakeFrameComplete = true;
+    updateRx(0);
+    calculateRxChannels(0);
+    fakeChannels[ROLL] = 1234;
+
+    // when
+    fakeFrameComplete = false;
+    updateRx(20000);
+    calculateRxChannels(20000);
+
+    // then
+    EXPECT_EQ(1000, rcData[ROLL]);
+}
+
+TEST(RxTest, PpmChannelsAreAveraged)
+{
+    // given
+    static const uint16_t samples[] = { 1000, 1100, 1200, 1300, 1400 };
+    static const uint16_t expected[] = { 1000, 1100, 1200, 1150, 1250 };
+    setupRx(FEATURE_RX_PPM);
+
+    for (unsigned i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        // when
+        fakeChannels[ROLL] = samples[i];
+        calculateRxChannels(i * 20000);
+
+        // then the first samples pass through until the average is filled
+        EXPECT_EQ(expected[i], rcData[ROLL]) << "sample " << i;
+    }
+}
+
+TEST(RxTest, FailsafeUpdateRunsBetweenFrames)
+{
+    // given
+    setupRx(FEATURE_RX_MSP | FEATURE_FAILSAFE);
+    calculateRxChannels(0);
+
+    // when a failsafe stage is reached before the next frame or the fallback
+    failsafeUpdateDue = true;
+
+    // then
+    EXPECT_TRUE(shouldProcessRx(5000));
+
+    // and without the failsafe feature it is not asked
+    enabledFeatures = FEATURE_RX_MSP;
+    EXPECT_FALSE(shouldProcessRx(5000));
+}
+
+TEST(RxTest, PwmFrameIsValidatedOnEveryChannel)
+{
+    // given
+    setupRx(FEATURE_RX_PARALLEL_PWM | FEATURE_FAILSAFE);
+    for (int i = 0; i < FAKE_CHANNEL_COUNT; i++) {
+        fakeChannels[i] = 1500;
+    }
+
+    // when no new pulses arrived
+    updateRx(1000);
+
+    // then
+    EXPECT_EQ(0u, failsafeValidDataCount);
+
+    // when every input had a pulse in range
+    fakePwmFrame = true;
+    updateRx(2000);
+
+    // then
+    EXPECT_EQ(1u, failsafeValidDataCount);
+    EXPECT_EQ(2000u, failsafeValidDataAt);
+    EXPECT_EQ(FAKE_CHANNEL_COUNT, failsafePulseChecks);
+    EXPECT_FALSE(fakePwmFrame);
+
+    // when an aux channel, not one of the first four, goes out of the failsafe limits
+    fakeChannels[AUX4] = 900;
+    fakePwmFrame = true;
+    updateRx(3000);
+
+    // then
+    EXPECT_EQ(1u, failsafeValidDataCount);
+
+    // and an input with nothing on it is not held against the rest
+    fakeChannels[AUX4] = 0;
+    fakePwmFrame = true;
+    updateRx(4000);
+    EXPECT_EQ(2u, failsafeValidDataCount);
+}
+
+TEST(RxTest, PwmFramesReachLinkQuality)
+{
+    // given
+    setupRx(FEATURE_RX_PARALLEL_PWM);
+    for (int i = 0; i < FAKE_CHANNEL_COUNT; i++) {
+        fakeChannels[i] = 1500;
+    }
+
+    // when every input had a pulse in range
+    for (int i = 0; i < 3; i++) {
+        fakePwmFrame = true;
+        updateRx(20000 * i);
+    }
+
+    // and one went out of the failsafe limits
+    fakeChannels[AUX4] = 900;
+    fakePwmFrame = true;
+    updateRx(60000);
+
+    // then the link quality counts both, without the failsafe feature
+    EXPECT_EQ(3u, getLinkQuality()->validFrames);
+    EXPECT_EQ(1u, getLinkQuality()->lostFrames);
+    EXPECT_EQ(75, getLinkQuality()->frameQuality);
+    EXPECT_EQ(0u, failsafeValidDataCount);
+}
+
+TEST(RxTest, DataDrivenFramesReachLinkQuality)
+{
+    // given
+    setupRx(FEATURE_RX_MSP);
+
+    // when
+    fakeFrameComplete = true;
+    updateRx(10000);
+    fakeFrameComplete = false;
+    updateRx(15000);
+
+    // then only the frame is counted
+    EXPECT_EQ(1u, getLinkQuality()->validFrames);
+    EXPECT_EQ(0u, getLinkQuality()->lostFrames);
+}
+
+// STUBS
+
+int16_t debug[4];
+
+bool feature(uint32_t mask)
+{
+    return enabledFeatures & mask;
+}
+
+void featureClear(uint32_t mask)
+{
+    enabledFeatures &= ~mask;
+}
+
+void rxPwmInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
+{
+    rxRuntimeConfig->channelCount = FAKE_CHANNEL_COUNT;
+    *callback = fakeReadRawRC;
+}
+
+bool rxMspInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
+{
+    UNUSED(rxConfig);
+    rxRuntimeConfig->channelCount = FAKE_CHANNEL_COUNT;
+    *callback = fakeReadRawRC;
+    return true;
+}
+
+bool rxMspFrameComplete(void)
+{
+    return fakeFrameComplete;
+}
+
+bool isPWMDataBeingReceived(void)
+{
+    return fakePwmFrame;
+}
+
+void resetPWMDataReceivedState(void)
+{
+    fakePwmFrame = false;
+}
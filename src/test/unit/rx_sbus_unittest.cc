@@ -0,0 +1,183 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "rx/rx.h"
+#include "rx/sbus.h"
+
+#include "mock_drivers.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+bool sbusInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *runtimeConfig, rcReadRawDataPtr *callback);
+
+#define SBUS_FRAME_SIZE 25
+#define SBUS_CHANNEL_COUNT 16
+#define SBUS_FLAG_FRAME_LOST (1 << 2)
+#define SBUS_FLAG_FAILSAFE (1 << 3)
+#define SBUS_BYTE_TIME_US 120           // 12 bits at 100000 baud
+
+static rxConfig_t rxConfig;
+static rxRuntimeConfig_t runtimeConfig;
+static rcReadRawDataPtr readRawRC;
+
+static void setupSbus(void)
+{
+    mockDriversReset();
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    rxConfig.midrc = 1500;
+    readRawRC = NULL;
+
+    EXPECT_TRUE(sbusInit(&rxConfig, &runtimeConfig, &readRawRC));
+}
+
+// packs 16 channels of 11 bits, lsb first, as the receiver sends them
+static void buildFrame(uint8_t *frame, const uint16_t *channels, uint8_t flags)
+{
+    memset(frame, 0, SBUS_FRAME_SIZE);
+    frame[0] = 0x0F;
+
+    for (int bit = 0; bit < SBUS_CHANNEL_COUNT * 11; bit++) {
+        if (channels[bit / 11] & (1 << (bit % 11))) {
+            frame[1 + bit / 8] |= 1 << (bit % 8);
+        }
+    }
+    frame[23] = flags;
+    frame[24] = 0x00;
+}
+
+static void receiveFrame(const uint16_t *channels, uint8_t flags)
+{
+    uint8_t frame[SBUS_FRAME_SIZE];
+
+    buildFrame(frame, channels, flags);
+    mockAdvanceMicros(7000);
+    mockSerialReceive(frame, sizeof(frame), SBUS_BYTE_TIME_US);
+}
+
+static const uint16_t testChannels[SBUS_CHANNEL_COUNT] = {
+    172, 992, 1811, 1024, 0, 2047, 300, 400, 500, 600, 700, 800, 900, 1000, 1100, 1200
+};
+
+TEST(SbusTest, InitCentresChannels)
+{
+    // when
+    setupSbus();
+
+    // then
+    EXPECT_EQ(100000u, mockSerialBaudRate);
+    EXPECT_TRUE(mockSerialRxCallback != NULL);
+    EXPECT_EQ(12, runtimeConfig.channelCount);
+    for (int i = 0; i < runtimeConfig.channelCount; i++) {
+        EXPECT_EQ(1500, readRawRC(&runtimeConfig, i));
+    }
+    EXPECT_FALSE(sbusFrameComplete());
+}
+
+TEST(SbusTest, DecodesFrame)
+{
+    // given
+    setupSbus();
+
+    // when
+    receiveFrame(testChannels, 0);
+
+    // then
+    EXPECT_TRUE(sbusFrameComplete());
+    for (int i = 0; i < runtimeConfig.channelCount; i++) {
+        EXPECT_EQ(testChannels[i] / 2 + 988, readRawRC(&runtimeConfig, i)) << "channel " << i;
+    }
+
+    // and the frame is only reported once
+    EXPECT_FALSE(sbusFrameComplete());
+}
+
+TEST(SbusTest, FailsafeFlagDropsFrame)
+{
+    // given
+    setupSbus();
+
+    // when
+    receiveFrame(testChannels, SBUS_FLAG_FAILSAFE);
+
+    // then the channels keep their previous values
+    EXPECT_FALSE(sbusFrameComplete());
+    EXPECT_EQ(1500, readRawRC(&runtimeConfig, 0));
+
+    // and failsafe is reported until a frame without the flag
+    EXPECT_TRUE(sbusFailsafeIndicated());
+    receiveFrame(testChannels, 0);
+    EXPECT_TRUE(sbusFrameComplete());
+    EXPECT_FALSE(sbusFailsafeIndicated());
+}
+
+TEST(SbusTest, LostFrameIsNotValid)
+{
+    // given
+    setupSbus();
+
+    // when the receiver repeats the last channels because it missed a packet
+    receiveFrame(testChannels, SBUS_FLAG_FRAME_LOST);
+
+    // then the frame does not count as a sign of the link, nor as its loss
+    EXPECT_FALSE(sbusFrameComplete());
+    EXPECT_FALSE(sbusFailsafeIndicated());
+    EXPECT_EQ(1500, readRawRC(&runtimeConfig, 0));
+}
+
+TEST(SbusTest, ResynchronisesAfterGap)
+{
+    // given
+    uint8_t frame[SBUS_FRAME_SIZE];
+    setupSbus();
+    buildFrame(frame, testChannels, 0);
+
+    // when a partial frame is followed by a complete one
+    mockAdvanceMicros(7000);
+    mockSerialReceive(frame, 10, SBUS_BYTE_TIME_US);
+    receiveFrame(testChannels, 0);
+
+    // then
+    EXPECT_TRUE(sbusFrameComplete());
+    EXPECT_EQ(testChannels[2] / 2 + 988, readRawRC(&runtimeConfig, 2));
+}
+
+TEST(SbusTest, IgnoresBytesBeforeSync)
+{
+    // given
+    static const uint8_t noise[] = { 0x00, 0xFF, 0x55 };
+    uint8_t frame[SBUS_FRAME_SIZE];
+    setupSbus();
+    buildFrame(frame, testChannels, 0);
+
+    // when the frame follows the noise without a gap
+    mockAdvanceMicros(7000);
+    mockSerialReceive(noise, sizeof(noise), SBUS_BYTE_TIME_US);
+    mockSerialReceive(frame, sizeof(frame), SBUS_BYTE_TIME_US);
+
+    // then
+    EXPECT_TRUE(sbusFrameComplete());
+    EXPECT_EQ(testChannels[0] / 2 + 988, readRawRC(&runtimeConfig, 0));
+}
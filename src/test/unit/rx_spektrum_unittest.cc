@@ -0,0 +1,379 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "rx/rx.h"
+#include "rx/spektrum.h"
+
+#include "mock_drivers.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+bool spektrumInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback);
+
+#define SPEK_FRAME_SIZE 16
+#define SPEK_CHANNELS_PER_FRAME 7
+#define SPEK_BYTE_TIME_US 87            // 10 bits at 115200 baud
+#define SPEK_FRAME_INTERVAL_US 11000
+#define SPEK_SYSTEM_DSMX_11MS 0xB2
+
+// DSMX 11ms 2048 frames from a satellite, twelve channels in two halves a cycle and the fade counter going
+// up once
+static const uint8_t dsmxCapture[][SPEK_FRAME_SIZE] = {
+    { 0x03, 0xB2, 0x04, 0x00, 0x0C, 0x06, 0x13, 0xFA, 0x19, 0x54, 0x24, 0x00, 0x2E, 0xA4, 0x31, 0x56 },
+    { 0x03, 0xB2, 0xBC, 0x00, 0xC4, 0x00, 0xCC, 0x00, 0xD4, 0x00, 0xDC, 0x00, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0x03, 0xB2, 0x04, 0x04, 0x0C, 0x0A, 0x13, 0xFE, 0x19, 0x58, 0x24, 0x00, 0x2E, 0xA4, 0x31, 0x56 },
+    { 0x03, 0xB2, 0xBC, 0x01, 0xC4, 0x01, 0xCC, 0x01, 0xD4, 0x01, 0xDC, 0x01, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0x04, 0xB2, 0x04, 0x08, 0x0C, 0x0E, 0x14, 0x02, 0x19, 0x5C, 0x24, 0x00, 0x2E, 0xA4, 0x31, 0x56 },
+    { 0x04, 0xB2, 0xBC, 0x02, 0xC4, 0x02, 0xCC, 0x02, 0xD4, 0x02, 0xDC, 0x02, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0x04, 0xB2, 0x04, 0x0C, 0x0C, 0x12, 0x14, 0x06, 0x19, 0x60, 0x24, 0x00, 0x2E, 0xA4, 0x31, 0x56 },
+    { 0x04, 0xB2, 0xBC, 0x03, 0xC4, 0x03, 0xCC, 0x03, 0xD4, 0x03, 0xDC, 0x03, 0xFF, 0xFF, 0xFF, 0xFF },
+};
+
+#define DSMX_CAPTURE_FRAMES (sizeof(dsmxCapture) / sizeof(dsmxCapture[0]))
+
+static rxConfig_t rxConfig;
+static rxRuntimeConfig_t runtimeConfig;
+static rcReadRawDataPtr readRawRC;
+
+static void setupSpektrum(SerialRXType provider)
+{
+    mockDriversReset();
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    rxConfig.serialrx_provider = provider;
+    readRawRC = NULL;
+
+    EXPECT_TRUE(spektrumInit(&rxConfig, &runtimeConfig, &readRawRC));
+}
+
+// two header bytes then seven channel words of channel id and value
+static void buildFrame(uint8_t *frame, uint8_t shift, const uint8_t *ids, const uint16_t *values)
+{
+    frame[0] = 0x00;            // fades
+    frame[1] = 0x12;            // system
+    for (int i = 0; i < SPEK_CHANNELS_PER_FRAME; i++) {
+        uint16_t word = (ids[i] << (8 + shift)) | values[i];
+        frame[2 + i * 2] = word >> 8;
+        frame[3 + i * 2] = word & 0xFF;
+    }
+}
+
+static void receiveBytes(const uint8_t *data, uint8_t length)
+{
+    mockAdvanceMicros(SPEK_FRAME_INTERVAL_US);
+    mockSerialReceive(data, length, SPEK_BYTE_TIME_US);
+}
+
+static void receiveCapture(uint8_t first, uint8_t count)
+{
+    for (uint8_t i = first; i < first + count; i++) {
+        receiveBytes(dsmxCapture[i % DSMX_CAPTURE_FRAMES], SPEK_FRAME_SIZE);
+    }
+}
+
+static void receiveFrame(uint8_t shift, const uint8_t *ids, const uint16_t *values)
+{
+    uint8_t frame[SPEK_FRAME_SIZE];
+
+    buildFrame(frame, shift, ids, values);
+    mockAdvanceMicros(SPEK_FRAME_INTERVAL_US);
+    mockSerialReceive(frame, sizeof(frame), SPEK_BYTE_TIME_US);
+}
+
+TEST(SpektrumTest, Init)
+{
+    // when
+    setupSpektrum(SERIALRX_SPEKTRUM2048);
+
+    // then
+    EXPECT_EQ(115200u, mockSerialBaudRate);
+    EXPECT_TRUE(mockSerialRxCallback != NULL);
+    EXPECT_EQ(12, runtimeConfig.channelCount);
+
+    // when
+    setupSpektrum(SERIALRX_SPEKTRUM1024);
+
+    // then
+    EXPECT_EQ(7, runtimeConfig.channelCount);
+}
+
+TEST(SpektrumTest, Decodes1024Frame)
+{
+    // given
+    static const uint8_t ids[] = { 0, 1, 2, 3, 4, 5, 6 };
+    static const uint16_t values[] = { 12, 512, 1012, 300, 700, 900, 100 };
+    setupSpektrum(SERIALRX_SPEKTRUM1024);
+
+    // when
+    receiveFrame(2, ids, values);
+
+    // then
+    EXPECT_TRUE(spektrumFrameComplete());
+    for (int i = 0; i < SPEK_CHANNELS_PER_FRAME; i++) {
+        EXPECT_EQ(988 + values[i], readRawRC(&runtimeConfig, ids[i])) << "channel " << i;
+    }
+    EXPECT_FALSE(spektrumFrameComplete());
+}
+
+TEST(SpektrumTest, Decodes2048FramesInTwoHalves)
+{
+    // given
+    static const uint8_t firstIds[] = { 0, 1, 2, 3, 4, 5, 6 };
+    static const uint16_t firstValues[] = { 24, 1024, 2024, 600, 1400, 1800, 200 };
+    static const uint8_t secondIds[] = { 7, 8, 9, 10, 11, 1, 2 };
+    static const uint16_t secondValues[] = { 100, 200, 300, 400, 500, 1024, 2024 };
+    setupSpektrum(SERIALRX_SPEKTRUM2048);
+
+    // when
+    receiveFrame(3, firstIds, firstValues);
+    readRawRC(&runtimeConfig, 0);
+    receiveFrame(3, secondIds, secondValues);
+
+    // then
+    EXPECT_EQ(988 + 24 / 2, readRawRC(&runtimeConfig, 0));
+    EXPECT_EQ(988 + 1024 / 2, readRawRC(&runtimeConfig, 1));
+    EXPECT_EQ(988 + 2024 / 2, readRawRC(&runtimeConfig, 2));
+    EXPECT_EQ(988 + 200 / 2, readRawRC(&runtimeConfig, 6));
+    EXPECT_EQ(988 + 100 / 2, readRawRC(&runtimeConfig, 7));
+    EXPECT_EQ(988 + 500 / 2, readRawRC(&runtimeConfig, 11));
+
+    // and channels past the channel count read as zero
+    EXPECT_EQ(0, readRawRC(&runtimeConfig, 12));
+}
+
+TEST(SpektrumTest, ResynchronisesAfterGap)
+{
+    // given
+    static const uint8_t ids[] = { 0, 1, 2, 3, 4, 5, 6 };
+    static const uint16_t values[] = { 100, 200, 300, 400, 500, 600, 700 };
+    uint8_t frame[SPEK_FRAME_SIZE];
+    setupSpektrum(SERIALRX_SPEKTRUM1024);
+    buildFrame(frame, 2, ids, values);
+
+    // when a partial frame is followed by a complete one
+    mockAdvanceMicros(SPEK_FRAME_INTERVAL_US);
+    mockSerialReceive(frame + 5, 6, SPEK_BYTE_TIME_US);
+    receiveFrame(2, ids, values);
+
+    // then
+    EXPECT_TRUE(spektrumFrameComplete());
+    EXPECT_EQ(988 + 300, readRawRC(&runtimeConfig, 2));
+}
+
+TEST(SpektrumTest, DecodesCapturedDsmxStream)
+{
+    // given
+    setupSpektrum(SERIALRX_SPEKTRUM2048);
+
+    // when
+    receiveCapture(0, DSMX_CAPTURE_FRAMES);
+
+    // then
+    EXPECT_TRUE(spektrumFrameComplete());
+    EXPECT_EQ(988 + (1024 + 12) / 2, readRawRC(&runtimeConfig, 0));
+    EXPECT_EQ(988 + (340 + 12) / 2, readRawRC(&runtimeConfig, 3));
+    EXPECT_EQ(988 + 1700 / 2, readRawRC(&runtimeConfig, 5));
+    EXPECT_EQ(988 + (1024 + 3) / 2, readRawRC(&runtimeConfig, 7));
+    EXPECT_EQ(988 + (1024 + 3) / 2, readRawRC(&runtimeConfig, 11));
+
+    const spektrumStats_t *stats = spektrumGetStats();
+    EXPECT_EQ(DSMX_CAPTURE_FRAMES, stats->frames);
+    EXPECT_EQ(DSMX_CAPTURE_FRAMES / 2, stats->cycles);
+    EXPECT_EQ(0u, stats->badFrames);
+    EXPECT_EQ(0u, stats->syncLosses);
+    EXPECT_EQ(1u, stats->fades);
+    EXPECT_EQ(SPEK_SYSTEM_DSMX_11MS, stats->system);
+}
+
+TEST(SpektrumTest, PublishesBothHalvesOfACycleTogether)
+{
+    // given
+    setupSpektrum(SERIALRX_SPEKTRUM2048);
+    receiveCapture(0, 2);
+    readRawRC(&runtimeConfig, 0);
+
+    // when the first half of the next cycle arrives
+    receiveCapture(2, 1);
+
+    // then nothing changes
+    EXPECT_FALSE(spektrumFrameComplete());
+    EXPECT_EQ(988 + 1024 / 2, readRawRC(&runtimeConfig, 0));
+
+    // when the second half arrives
+    receiveCapture(3, 1);
+
+    // then both halves are there
+    EXPECT_TRUE(spektrumFrameComplete());
+    EXPECT_EQ(988 + (1024 + 4) / 2, readRawRC(&runtimeConfig, 0));
+    EXPECT_EQ(988 + (1024 + 1) / 2, readRawRC(&runtimeConfig, 7));
+}
+
+TEST(SpektrumTest, PublishesAHalfWhoseOtherHalfWasLost)
+{
+    // given
+    setupSpektrum(SERIALRX_SPEKTRUM2048);
+    receiveCapture(0, 4);
+    readRawRC(&runtimeConfig, 0);
+
+    // when the second half of a cycle is lost
+    receiveCapture(4, 1);
+    mockAdvanceMicros(SPEK_FRAME_INTERVAL_US);
+    receiveCapture(6, 2);
+
+    // then the next cycle brings out what there was of it
+    EXPECT_TRUE(spektrumFrameComplete());
+    EXPECT_EQ(988 + (1024 + 12) / 2, readRawRC(&runtimeConfig, 0));
+    EXPECT_EQ(988 + (1024 + 3) / 2, readRawRC(&runtimeConfig, 7));
+    EXPECT_EQ(0u, spektrumGetStats()->badFrames);
+}
+
+TEST(SpektrumTest, DropsAFrameWithMissingBytes)
+{
+    // given
+    setupSpektrum(SERIALRX_SPEKTRUM2048);
+    receiveCapture(0, 2);
+    readRawRC(&runtimeConfig, 0);
+
+    // when two bytes of a frame are lost
+    uint8_t damaged[SPEK_FRAME_SIZE];
+    memcpy(damaged, dsmxCapture[2], SPEK_FRAME_SIZE);
+    memmove(damaged + 4, damaged + 6, SPEK_FRAME_SIZE - 6);
+    receiveBytes(damaged, SPEK_FRAME_SIZE - 2);
+    receiveCapture(3, 1);
+
+    // then neither it nor the frame it ran into is used
+    EXPECT_FALSE(spektrumFrameComplete());
+    EXPECT_EQ(988 + 1024 / 2, readRawRC(&runtimeConfig, 0));
+    EXPECT_EQ(1u, spektrumGetStats()->syncLosses);
+    EXPECT_GE(spektrumGetStats()->badFrames, 1u);
+
+    // when the stream goes on
+    receiveCapture(4, 4);
+
+    // then it is back in sync
+    EXPECT_TRUE(spektrumFrameComplete());
+    EXPECT_EQ(988 + (1024 + 12) / 2, readRawRC(&runtimeConfig, 0));
+    EXPECT_EQ(1u, spektrumGetStats()->syncLosses);
+}
+
+TEST(SpektrumTest, DropsSyncOnExtraBytes)
+{
+    // given
+    setupSpektrum(SERIALRX_SPEKTRUM2048);
+    receiveCapture(0, 2);
+    readRawRC(&runtimeConfig, 0);
+
+    // when noise adds a byte between frames, and the next frame follows on from it
+    uint8_t noisy[SPEK_FRAME_SIZE + 1] = { 0x55 };
+    memcpy(noisy + 1, dsmxCapture[2], SPEK_FRAME_SIZE);
+    mockAdvanceMicros(SPEK_FRAME_INTERVAL_US - 500);
+    mockSerialReceive(noisy, sizeof(noisy), SPEK_BYTE_TIME_US);
+    receiveCapture(3, 1);
+
+    // then that frame is not trusted
+    EXPECT_EQ(1u, spektrumGetStats()->syncLosses);
+    EXPECT_FALSE(spektrumFrameComplete());
+    EXPECT_EQ(988 + 1024 / 2, readRawRC(&runtimeConfig, 0));
+
+    // when
+    receiveCapture(4, 4);
+
+    // then
+    EXPECT_EQ(988 + (1024 + 12) / 2, readRawRC(&runtimeConfig, 0));
+}
+
+TEST(SpektrumTest, RejectsCorruptHeaders)
+{
+    // given
+    setupSpektrum(SERIALRX_SPEKTRUM2048);
+    receiveCapture(0, 2);
+    readRawRC(&runtimeConfig, 0);
+
+    // when the system byte changes
+    uint8_t corrupt[SPEK_FRAME_SIZE];
+    memcpy(corrupt, dsmxCapture[2], SPEK_FRAME_SIZE);
+    corrupt[1] = 0x12;
+    receiveBytes(corrupt, SPEK_FRAME_SIZE);
+
+    // then
+    EXPECT_EQ(1u, spektrumGetStats()->badFrames);
+
+    // when the fade counter goes backwards
+    setupSpektrum(SERIALRX_SPEKTRUM2048);
+    receiveCapture(4, 2);
+    readRawRC(&runtimeConfig, 0);
+    memcpy(corrupt, dsmxCapture[2], SPEK_FRAME_SIZE);
+    corrupt[0] = 0x01;
+    receiveBytes(corrupt, SPEK_FRAME_SIZE);
+
+    // then
+    EXPECT_EQ(1u, spektrumGetStats()->badFrames);
+    EXPECT_FALSE(spektrumFrameComplete());
+}
+
+TEST(SpektrumTest, RejectsBadChannelWordsIn1024Mode)
+{
+    // given
+    static const uint8_t ids[] = { 0, 1, 2, 3, 4, 5, 6 };
+    static const uint16_t values[] = { 100, 200, 300, 400, 500, 600, 700 };
+    uint8_t frame[SPEK_FRAME_SIZE];
+    setupSpektrum(SERIALRX_SPEKTRUM1024);
+    buildFrame(frame, 2, ids, values);
+
+    // when bits above the channel id are set
+    frame[6] |= 0x80;
+    receiveBytes(frame, SPEK_FRAME_SIZE);
+
+    // then
+    EXPECT_FALSE(spektrumFrameComplete());
+    EXPECT_EQ(1u, spektrumGetStats()->badFrames);
+}
+
+TEST(SpektrumTest, ReportsFrameRateAndFades)
+{
+    // given
+    setupSpektrum(SERIALRX_SPEKTRUM2048);
+
+    // when two seconds of frames arrive with a fade every tenth frame
+    uint8_t frame[SPEK_FRAME_SIZE];
+    for (int i = 0; i < 2000000 / SPEK_FRAME_INTERVAL_US; i++) {
+        memcpy(frame, dsmxCapture[i % 2], SPEK_FRAME_SIZE);
+        frame[0] = i / 10;
+        mockAdvanceMicros(SPEK_FRAME_INTERVAL_US - SPEK_FRAME_SIZE * SPEK_BYTE_TIME_US);
+        mockSerialReceive(frame, SPEK_FRAME_SIZE, SPEK_BYTE_TIME_US);
+    }
+
+    // then
+    const spektrumStats_t *stats = spektrumGetStats();
+    EXPECT_NEAR(1000000 / SPEK_FRAME_INTERVAL_US, stats->frameRate, 1);
+    EXPECT_NEAR(1000000 / SPEK_FRAME_INTERVAL_US / 10, stats->fadesPerSecond, 1);
+    EXPECT_EQ(0u, stats->badFrames);
+
+    // when the satellite goes quiet
+    mockAdvanceMicros(2000000);
+
+    // then
+    EXPECT_EQ(0, spektrumGetStats()->frameRate);
+}
@@ -0,0 +1,331 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "rx/rx.h"
+#include "rx/sumd.h"
+
+#include "mock_drivers.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+bool sumdInit(rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback);
+
+#define SUMD_SYNCBYTE 0xA8
+#define SUMD_STATUS_LIVE 0x01
+#define SUMD_STATUS_FAILSAFE 0x81
+#define SUMD_MAX_FRAME_SIZE (32 * 2 + 5)
+#define SUMD_BYTE_TIME_US 87            // 10 bits at 115200 baud
+
+static rxConfig_t rxConfig;
+static rxRuntimeConfig_t runtimeConfig;
+static rcReadRawDataPtr readRawRC;
+
+static void setupSumd(void)
+{
+    mockDriversReset();
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    readRawRC = NULL;
+
+    EXPECT_TRUE(sumdInit(&rxConfig, &runtimeConfig, &readRawRC));
+}
+
+// CRC-16/XMODEM over everything before the crc, as Graupner specifies it
+static uint16_t sumdCrc(const uint8_t *data, uint8_t length)
+{
+    uint16_t crc = 0;
+
+    while (length--) {
+        crc ^= *data++ << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// channel values are in 1/8 us
+static uint8_t buildFrame(uint8_t *frame, uint8_t status, const uint16_t *channels, uint8_t channelCount)
+{
+    uint8_t length = 0;
+    uint16_t crc;
+
+    frame[length++] = SUMD_SYNCBYTE;
+    frame[length++] = status;
+    frame[length++] = channelCount;
+    for (int i = 0; i < channelCount; i++) {
+        frame[length++] = channels[i] >> 8;
+        frame[length++] = channels[i] & 0xFF;
+    }
+    crc = sumdCrc(frame, length);
+    frame[length++] = crc >> 8;
+    frame[length++] = crc & 0xFF;
+
+    return length;
+}
+
+static void receiveFrame(uint8_t status, const uint16_t *channels, uint8_t channelCount)
+{
+    uint8_t frame[SUMD_MAX_FRAME_SIZE];
+    uint8_t length = buildFrame(frame, status, channels, channelCount);
+
+    mockAdvanceMicros(10000);
+    mockSerialReceive(frame, length, SUMD_BYTE_TIME_US);
+}
+
+static const uint16_t testChannels[] = {
+    1100 * 8, 1500 * 8, 1900 * 8, 1000 * 8, 2000 * 8, 1234 * 8, 1750 * 8, 1250 * 8
+};
+
+#define TEST_CHANNEL_COUNT (sizeof(testChannels) / sizeof(testChannels[0]))
+
+// Frames byte for byte as an 8 channel Graupner receiver sends them, the first with the transmitter in
+// range and the second with the receiver in failsafe sending its hold positions.
+static const uint8_t liveFrame[] = {
+    0xA8, 0x01, 0x08, 0x25, 0x80, 0x2E, 0xE0, 0x38, 0x40, 0x1F, 0x40, 0x3E,
+    0x80, 0x2E, 0xE0, 0x22, 0x60, 0x3B, 0x60, 0x02, 0x23
+};
+
+static const uint8_t failsafeFrame[] = {
+    0xA8, 0x81, 0x08, 0x2E, 0xE0, 0x2E, 0xE0, 0x1F, 0x40, 0x2E, 0xE0, 0x1F,
+    0x40, 0x2E, 0xE0, 0x2E, 0xE0, 0x2E, 0xE0, 0x44, 0x5A
+};
+
+static const uint16_t liveFrameChannels[] = { 1200, 1500, 1800, 1000, 2000, 1500, 1100, 1900 };
+
+static void receiveBytes(const uint8_t *data, uint8_t length)
+{
+    mockAdvanceMicros(10000);
+    mockSerialReceive(data, length, SUMD_BYTE_TIME_US);
+}
+
+TEST(SumdTest, Init)
+{
+    // when
+    setupSumd();
+
+    // then
+    EXPECT_EQ(115200u, mockSerialBaudRate);
+    EXPECT_TRUE(mockSerialRxCallback != NULL);
+    EXPECT_EQ(MAX_SUPPORTED_RC_CHANNEL_COUNT, runtimeConfig.channelCount);
+    EXPECT_FALSE(sumdFrameComplete());
+}
+
+TEST(SumdTest, DecodesFrame)
+{
+    // given
+    setupSumd();
+
+    // when
+    receiveFrame(SUMD_STATUS_LIVE, testChannels, TEST_CHANNEL_COUNT);
+
+    // then
+    EXPECT_TRUE(sumdFrameComplete());
+    for (unsigned i = 0; i < TEST_CHANNEL_COUNT; i++) {
+        EXPECT_EQ(testChannels[i] / 8, readRawRC(&runtimeConfig, i)) << "channel " << i;
+    }
+
+    // and the frame is only reported once
+    EXPECT_FALSE(sumdFrameComplete());
+}
+
+TEST(SumdTest, DecodesSixteenChannels)
+{
+    // given
+    uint16_t channels[16];
+    for (int i = 0; i < 16; i++) {
+        channels[i] = (1000 + i * 50) * 8;
+    }
+    setupSumd();
+
+    // when
+    receiveFrame(SUMD_STATUS_LIVE, channels, 16);
+
+    // then
+    EXPECT_TRUE(sumdFrameComplete());
+    EXPECT_EQ(1000, readRawRC(&runtimeConfig, 0));
+    EXPECT_EQ(1750, readRawRC(&runtimeConfig, 15));
+}
+
+TEST(SumdTest, FailsafeFrameIsDropped)
+{
+    // given
+    setupSumd();
+    receiveFrame(SUMD_STATUS_LIVE, testChannels, TEST_CHANNEL_COUNT);
+    EXPECT_TRUE(sumdFrameComplete());
+
+    // when
+    uint16_t holdChannels[TEST_CHANNEL_COUNT];
+    for (unsigned i = 0; i < TEST_CHANNEL_COUNT; i++) {
+        holdChannels[i] = 1500 * 8;
+    }
+    receiveFrame(SUMD_STATUS_FAILSAFE, holdChannels, TEST_CHANNEL_COUNT);
+
+    // then the last good channels are kept
+    EXPECT_FALSE(sumdFrameComplete());
+    EXPECT_EQ(1100, readRawRC(&runtimeConfig, 0));
+
+    // and failsafe is reported
+    EXPECT_TRUE(sumdFailsafeIndicated());
+}
+
+TEST(SumdTest, ResynchronisesAfterGap)
+{
+    // given
+    uint8_t frame[SUMD_MAX_FRAME_SIZE];
+    buildFrame(frame, SUMD_STATUS_LIVE, testChannels, TEST_CHANNEL_COUNT);
+    setupSumd();
+
+    // when a partial frame is followed by a complete one
+    mockAdvanceMicros(10000);
+    mockSerialReceive(frame, 7, SUMD_BYTE_TIME_US);
+    receiveFrame(SUMD_STATUS_LIVE, testChannels, TEST_CHANNEL_COUNT);
+
+    // then
+    EXPECT_TRUE(sumdFrameComplete());
+    EXPECT_EQ(1900, readRawRC(&runtimeConfig, 2));
+}
+
+TEST(SumdTest, FrameCrcMatchesReference)
+{
+    // then the fixtures carry the crc the bitwise reference calculates
+    EXPECT_EQ((liveFrame[19] << 8) | liveFrame[20], sumdCrc(liveFrame, sizeof(liveFrame) - 2));
+    EXPECT_EQ((failsafeFrame[19] << 8) | failsafeFrame[20], sumdCrc(failsafeFrame, sizeof(failsafeFrame) - 2));
+}
+
+TEST(SumdTest, DecodesReceiverFrame)
+{
+    // given
+    setupSumd();
+
+    // when
+    receiveBytes(liveFrame, sizeof(liveFrame));
+
+    // then
+    EXPECT_TRUE(sumdFrameComplete());
+    EXPECT_FALSE(sumdFailsafeIndicated());
+    for (unsigned i = 0; i < sizeof(liveFrameChannels) / sizeof(liveFrameChannels[0]); i++) {
+        EXPECT_EQ(liveFrameChannels[i], readRawRC(&runtimeConfig, i)) << "channel " << i;
+    }
+}
+
+TEST(SumdTest, DropsFramesWithBadCrc)
+{
+    // given
+    setupSumd();
+    receiveBytes(liveFrame, sizeof(liveFrame));
+    EXPECT_TRUE(sumdFrameComplete());
+
+    uint8_t corrupted[sizeof(liveFrame)];
+
+    for (unsigned i = 1; i < sizeof(liveFrame); i++) {
+        // when any byte after the sync byte has a flipped bit
+        memcpy(corrupted, liveFrame, sizeof(liveFrame));
+        corrupted[i] ^= 1 << (i % 8);
+        receiveBytes(corrupted, sizeof(corrupted));
+
+        // then the frame is dropped
+        EXPECT_FALSE(sumdFrameComplete()) << "byte " << i;
+        EXPECT_EQ(1200, readRawRC(&runtimeConfig, 0)) << "byte " << i;
+    }
+
+    // and a good frame is decoded after them
+    receiveBytes(liveFrame, sizeof(liveFrame));
+    EXPECT_TRUE(sumdFrameComplete());
+}
+
+TEST(SumdTest, DropsFailsafeFrameWithBadCrc)
+{
+    // given
+    uint8_t corrupted[sizeof(failsafeFrame)];
+    memcpy(corrupted, failsafeFrame, sizeof(failsafeFrame));
+    corrupted[sizeof(corrupted) - 1] ^= 0x01;
+    setupSumd();
+
+    // when
+    receiveBytes(corrupted, sizeof(corrupted));
+
+    // then
+    EXPECT_FALSE(sumdFrameComplete());
+    EXPECT_FALSE(sumdFailsafeIndicated());
+}
+
+TEST(SumdTest, LiveFrameEndsFailsafe)
+{
+    // given
+    setupSumd();
+    receiveBytes(failsafeFrame, sizeof(failsafeFrame));
+    EXPECT_FALSE(sumdFrameComplete());
+    EXPECT_TRUE(sumdFailsafeIndicated());
+
+    // when
+    receiveBytes(liveFrame, sizeof(liveFrame));
+
+    // then
+    EXPECT_TRUE(sumdFrameComplete());
+    EXPECT_FALSE(sumdFailsafeIndicated());
+}
+
+TEST(SumdTest, DecodesThirtyTwoChannelFrame)
+{
+    // given
+    uint16_t channels[32];
+    for (int i = 0; i < 32; i++) {
+        channels[i] = (1000 + i * 30) * 8;
+    }
+    setupSumd();
+
+    // when
+    receiveFrame(SUMD_STATUS_LIVE, channels, 32);
+
+    // then the channels rx can use are decoded
+    EXPECT_TRUE(sumdFrameComplete());
+    for (int i = 0; i < MAX_SUPPORTED_RC_CHANNEL_COUNT; i++) {
+        EXPECT_EQ(1000 + i * 30, readRawRC(&runtimeConfig, i)) << "channel " << i;
+    }
+}
+
+TEST(SumdTest, IgnoresInvalidChannelCount)
+{
+    // given
+    uint8_t frame[SUMD_MAX_FRAME_SIZE];
+    buildFrame(frame, SUMD_STATUS_LIVE, testChannels, TEST_CHANNEL_COUNT);
+    setupSumd();
+
+    // when the channel counts are out of range
+    const uint8_t badCounts[] = { 0, 1, 33, 0xFF };
+    for (unsigned i = 0; i < sizeof(badCounts); i++) {
+        frame[2] = badCounts[i];
+        receiveBytes(frame, 3 + TEST_CHANNEL_COUNT * 2 + 2);
+
+        // then
+        EXPECT_FALSE(sumdFrameComplete()) << "count " << (int)badCounts[i];
+    }
+
+    // and a good frame is decoded after them
+    receiveFrame(SUMD_STATUS_LIVE, testChannels, TEST_CHANNEL_COUNT);
+    EXPECT_TRUE(sumdFrameComplete());
+    EXPECT_EQ(1100, readRawRC(&runtimeConfig, 0));
+}
@@ -0,0 +1,295 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <limits.h>
+
+#include "common/axis.h"
+#include "sensors/gyro_redundancy.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define VOTE_THRESHOLD 100
+#define FAULT_CYCLES 5
+
+static gyroRedundancyConfig_t testConfig = { 1, VOTE_THRESHOLD, FAULT_CYCLES };
+static int16_t samples[GYRO_SOURCE_COUNT][XYZ_AXIS_COUNT];
+static int16_t output[XYZ_AXIS_COUNT];
+
+static void setupVoter(void)
+{
+    useGyroRedundancyConfig(&testConfig);
+    gyroRedundancyInit(GYRO_SOURCE_COUNT, 1.0f);
+}
+
+// slow sine-ish motion plus a little noise that differs between the two gyros
+static void generateSamples(int cycle)
+{
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        int16_t motion = ((cycle * (axis + 1)) % 200) - 100;
+        samples[GYRO_SOURCE_PRIMARY][axis] = motion + (cycle % 3);
+        samples[GYRO_SOURCE_SECONDARY][axis] = motion - (cycle % 5);
+    }
+}
+
+static void expectOutputNear(int16_t *expected, int tolerance)
+{
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        EXPECT_LE(abs(output[axis] - expected[axis]), tolerance);
+    }
+}
+
+TEST(GyroRedundancyTest, HealthyGyrosAreAveraged)
+{
+    // given
+    setupVoter();
+    samples[GYRO_SOURCE_PRIMARY][X] = 100;
+    samples[GYRO_SOURCE_PRIMARY][Y] = -50;
+    samples[GYRO_SOURCE_PRIMARY][Z] = 10;
+    samples[GYRO_SOURCE_SECONDARY][X] = 110;
+    samples[GYRO_SOURCE_SECONDARY][Y] = -40;
+    samples[GYRO_SOURCE_SECONDARY][Z] = 0;
+
+    // when
+    gyroRedundancyUpdate(samples, output);
+
+    // then
+    EXPECT_EQ(105, output[X]);
+    EXPECT_EQ(-45, output[Y]);
+    EXPECT_EQ(5, output[Z]);
+    EXPECT_EQ(2, gyroRedundancyHealthySourceCount());
+}
+
+TEST(GyroRedundancyTest, SecondaryIsRescaledToPrimaryUnits)
+{
+    // given
+    useGyroRedundancyConfig(&testConfig);
+    gyroRedundancyInit(GYRO_SOURCE_COUNT, 2.0f);
+    samples[GYRO_SOURCE_PRIMARY][X] = 200;
+    samples[GYRO_SOURCE_SECONDARY][X] = 100;
+
+    // when
+    gyroRedundancyUpdate(samples, output);
+
+    // then
+    EXPECT_EQ(200, output[X]);
+}
+
+TEST(GyroRedundancyTest, SingleGyroPassesThrough)
+{
+    // given
+    useGyroRedundancyConfig(&testConfig);
+    gyroRedundancyInit(1, 1.0f);
+    samples[GYRO_SOURCE_PRIMARY][X] = INT16_MAX;
+    samples[GYRO_SOURCE_PRIMARY][Y] = 0;
+    samples[GYRO_SOURCE_PRIMARY][Z] = 0;
+
+    // when
+    for (int cycle = 0; cycle < GYRO_STUCK_CYCLES * 2; cycle++) {
+        gyroRedundancyUpdate(samples, output);
+    }
+
+    // then
+    EXPECT_EQ(INT16_MAX, output[X]);
+    EXPECT_EQ(1, gyroRedundancyHealthySourceCount());
+}
+
+TEST(GyroRedundancyTest, OutOfRangeGyroIsDroppedInTheSameCycle)
+{
+    // given
+    setupVoter();
+    for (int cycle = 0; cycle < 50; cycle++) {
+        generateSamples(cycle);
+        gyroRedundancyUpdate(samples, output);
+    }
+
+    // when
+    generateSamples(50);
+    samples[GYRO_SOURCE_PRIMARY][Y] = INT16_MIN;
+    gyroRedundancyUpdate(samples, output);
+
+    // then
+    expectOutputNear(samples[GYRO_SOURCE_SECONDARY], 0);
+    EXPECT_EQ(GYRO_FAULT_OUT_OF_RANGE, gyroRedundancySourceState(GYRO_SOURCE_PRIMARY)->faults);
+    EXPECT_EQ(0, gyroRedundancySourceState(GYRO_SOURCE_PRIMARY)->isolatedBy);
+
+    // when
+    for (int cycle = 51; cycle < 51 + FAULT_CYCLES; cycle++) {
+        generateSamples(cycle);
+        samples[GYRO_SOURCE_PRIMARY][Y] = INT16_MIN;
+        gyroRedundancyUpdate(samples, output);
+        expectOutputNear(samples[GYRO_SOURCE_SECONDARY], 0);
+    }
+
+    // then
+    EXPECT_EQ(GYRO_FAULT_OUT_OF_RANGE, gyroRedundancySourceState(GYRO_SOURCE_PRIMARY)->isolatedBy);
+    EXPECT_EQ(1, gyroRedundancyHealthySourceCount());
+
+    // and the isolation is latched even when the primary recovers
+    generateSamples(100);
+    gyroRedundancyUpdate(samples, output);
+    expectOutputNear(samples[GYRO_SOURCE_SECONDARY], 0);
+}
+
+TEST(GyroRedundancyTest, BriefSaturationOfBothGyrosDoesNotIsolate)
+{
+    // given
+    setupVoter();
+    for (int cycle = 0; cycle < 50; cycle++) {
+        generateSamples(cycle);
+        gyroRedundancyUpdate(samples, output);
+    }
+
+    // when a flip goes beyond the range of both, the primary saturating first and the secondary just short of it
+    for (int cycle = 50; cycle < 50 + FAULT_CYCLES * 3; cycle++) {
+        generateSamples(cycle);
+        samples[GYRO_SOURCE_PRIMARY][Z] = INT16_MAX;
+        samples[GYRO_SOURCE_SECONDARY][Z] = cycle < 50 + FAULT_CYCLES * 2 ? 31000 : INT16_MAX;
+        gyroRedundancyUpdate(samples, output);
+    }
+    for (int cycle = 65; cycle < 70; cycle++) {
+        generateSamples(cycle);
+        gyroRedundancyUpdate(samples, output);
+    }
+
+    // then
+    EXPECT_EQ(2, gyroRedundancyHealthySourceCount());
+    EXPECT_EQ(0, gyroRedundancySourceState(GYRO_SOURCE_PRIMARY)->faultyCycles);
+    EXPECT_EQ(0, gyroRedundancySourceState(GYRO_SOURCE_SECONDARY)->faultyCycles);
+    EXPECT_EQ((samples[GYRO_SOURCE_PRIMARY][Z] + samples[GYRO_SOURCE_SECONDARY][Z]) / 2, output[Z]);
+}
+
+TEST(GyroRedundancyTest, SaturationIsAFaultWhenTheOtherGyroIsWellInRange)
+{
+    // given
+    gyroRedundancyConfig_t tolerantConfig = { 1, 10000, FAULT_CYCLES };    // so the vote can't catch it first
+    useGyroRedundancyConfig(&tolerantConfig);
+    gyroRedundancyInit(GYRO_SOURCE_COUNT, 1.0f);
+
+    // when
+    for (int cycle = 0; cycle < FAULT_CYCLES; cycle++) {
+        generateSamples(cycle);
+        samples[GYRO_SOURCE_PRIMARY][Z] = INT16_MAX;
+        samples[GYRO_SOURCE_SECONDARY][Z] = 25000;
+        gyroRedundancyUpdate(samples, output);
+    }
+
+    // then
+    EXPECT_EQ(GYRO_FAULT_OUT_OF_RANGE, gyroRedundancySourceState(GYRO_SOURCE_PRIMARY)->isolatedBy);
+}
+
+TEST(GyroRedundancyTest, StuckGyroIsIsolated)
+{
+    // given
+    gyroRedundancyConfig_t tolerantConfig = { 1, 10000, FAULT_CYCLES };    // so the vote can't catch it first
+    useGyroRedundancyConfig(&tolerantConfig);
+    gyroRedundancyInit(GYRO_SOURCE_COUNT, 1.0f);
+    int16_t frozen[XYZ_AXIS_COUNT] = { 12, 34, 56 };
+
+    // when
+    for (int cycle = 0; cycle < GYRO_STUCK_CYCLES + 10; cycle++) {
+        generateSamples(cycle);
+        samples[GYRO_SOURCE_SECONDARY][X] = frozen[X];
+        samples[GYRO_SOURCE_SECONDARY][Y] = frozen[Y];
+        samples[GYRO_SOURCE_SECONDARY][Z] = frozen[Z];
+        gyroRedundancyUpdate(samples, output);
+    }
+
+    // then
+    EXPECT_TRUE(gyroRedundancySourceState(GYRO_SOURCE_SECONDARY)->isolatedBy & GYRO_FAULT_STUCK);
+    EXPECT_EQ(0, gyroRedundancySourceState(GYRO_SOURCE_PRIMARY)->isolatedBy);
+    expectOutputNear(samples[GYRO_SOURCE_PRIMARY], 0);
+}
+
+TEST(GyroRedundancyTest, DisagreeingGyroIsDroppedWithoutOutputStep)
+{
+    // given
+    setupVoter();
+    for (int cycle = 0; cycle < 50; cycle++) {
+        generateSamples(cycle);
+        gyroRedundancyUpdate(samples, output);
+    }
+
+    // when
+    for (int cycle = 50; cycle < 50 + FAULT_CYCLES; cycle++) {
+        int16_t previousOutput[XYZ_AXIS_COUNT] = { output[X], output[Y], output[Z] };
+
+        generateSamples(cycle);
+        samples[GYRO_SOURCE_SECONDARY][Z] += 2000;
+        gyroRedundancyUpdate(samples, output);
+
+        // then output follows the good gyro immediately and never jumps towards the bad one
+        expectOutputNear(samples[GYRO_SOURCE_PRIMARY], 0);
+        expectOutputNear(previousOutput, 20);
+        EXPECT_EQ(GYRO_FAULT_DISAGREEMENT, gyroRedundancySourceState(GYRO_SOURCE_SECONDARY)->faults);
+    }
+
+    // then
+    EXPECT_EQ(GYRO_FAULT_DISAGREEMENT, gyroRedundancySourceState(GYRO_SOURCE_SECONDARY)->isolatedBy);
+    EXPECT_EQ(0, gyroRedundancySourceState(GYRO_SOURCE_PRIMARY)->isolatedBy);
+}
+
+TEST(GyroRedundancyTest, ShortDisagreementDoesNotIsolate)
+{
+    // given
+    setupVoter();
+    for (int cycle = 0; cycle < 50; cycle++) {
+        generateSamples(cycle);
+        gyroRedundancyUpdate(samples, output);
+    }
+
+    // when
+    for (int cycle = 50; cycle < 50 + FAULT_CYCLES - 1; cycle++) {
+        generateSamples(cycle);
+        samples[GYRO_SOURCE_PRIMARY][X] -= 1000;
+        gyroRedundancyUpdate(samples, output);
+        expectOutputNear(samples[GYRO_SOURCE_SECONDARY], 0);
+    }
+    generateSamples(60);
+    gyroRedundancyUpdate(samples, output);
+
+    // then
+    EXPECT_EQ(2, gyroRedundancyHealthySourceCount());
+    EXPECT_EQ(0, gyroRedundancySourceState(GYRO_SOURCE_PRIMARY)->faultyCycles);
+}
+
+TEST(GyroRedundancyTest, LastGyroIsNeverIsolated)
+{
+    // given
+    setupVoter();
+    for (int cycle = 0; cycle < GYRO_STUCK_CYCLES + 10; cycle++) {
+        generateSamples(cycle);
+        samples[GYRO_SOURCE_SECONDARY][X] = 0;
+        samples[GYRO_SOURCE_SECONDARY][Y] = 0;
+        samples[GYRO_SOURCE_SECONDARY][Z] = 0;
+        gyroRedundancyUpdate(samples, output);
+    }
+    EXPECT_EQ(1, gyroRedundancyHealthySourceCount());
+
+    // when
+    for (int cycle = 0; cycle < FAULT_CYCLES * 2; cycle++) {
+        generateSamples(cycle);
+        samples[GYRO_SOURCE_PRIMARY][X] = INT16_MAX;
+        gyroRedundancyUpdate(samples, output);
+    }
+
+    // then
+    EXPECT_EQ(0, gyroRedundancySourceState(GYRO_SOURCE_PRIMARY)->isolatedBy);
+    EXPECT_EQ(INT16_MAX, output[X]);
+}
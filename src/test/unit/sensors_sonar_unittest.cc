@@ -0,0 +1,323 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "build_config.h"
+
+#include "drivers/system.h"
+#include "drivers/gpio.h"
+#include "drivers/serial.h"
+#include "drivers/sonar_hcsr04.h"
+
+#include "sensors/sensors.h"
+#include "sensors/sonar.h"
+
+#include "mock_drivers.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+void EXTI1_IRQHandler(void);
+
+#define TRIGGER_PIN Pin_0                   // sonar_rc78
+#define ECHO_PIN Pin_1
+#define STEP_US 50                          // how often the main loop calls Sonar_update()
+#define ECHO_DELAY_US 450                   // the 8 cycle 40kHz burst before the echo line goes high
+#define US_PER_CM 59
+#define NO_ECHO -1
+#define MAX_ECHOES 32
+#define MAX_PINGS 64
+
+// distances the synthetic sensor echoes, one per ping and the last one repeated
+static int32_t echoes[MAX_ECHOES];
+static int echoCount;
+static int echoIndex;
+static int jitterCm;                        // +- noise on every echo
+
+static uint32_t echoRiseAt;
+static uint32_t echoFallAt;
+static bool echoPending;
+
+static uint32_t pingTimes[MAX_PINGS];
+static int pingCount;
+static uint32_t triggerHighAt;
+static uint32_t shortestTriggerUs;
+
+static uint32_t noiseState;
+
+static int32_t noise(void)
+{
+    if (jitterCm == 0) {
+        return 0;
+    }
+    noiseState = noiseState * 1103515245 + 12345;
+    return (int32_t)((noiseState >> 16) % (2 * jitterCm + 1)) - jitterCm;
+}
+
+static void setupSonar(void)
+{
+    mockDriversReset();
+    mockSetMicros(1000000);
+    memset(&hostGPIOB, 0, sizeof(hostGPIOB));
+
+    echoCount = 0;
+    echoIndex = 0;
+    jitterCm = 0;
+    echoPending = false;
+    pingCount = 0;
+    shortestTriggerUs = UINT32_MAX;
+    noiseState = 1;
+
+    Sonar_init();
+}
+
+static void queueEchoes(const int32_t *distances, int count)
+{
+    memcpy(echoes, distances, count * sizeof(*distances));
+    echoCount = count;
+    echoIndex = 0;
+}
+
+static void onPing(uint32_t now)
+{
+    if (pingCount < MAX_PINGS) {
+        pingTimes[pingCount] = now;
+    }
+    pingCount++;
+
+    int32_t distance = echoes[echoIndex < echoCount ? echoIndex : echoCount - 1];
+    echoIndex++;
+    if (distance == NO_ECHO) {
+        return;
+    }
+    echoRiseAt = now + ECHO_DELAY_US;
+    echoFallAt = echoRiseAt + (distance + noise()) * US_PER_CM;
+    echoPending = true;
+}
+
+static void echoEdge(bool high)
+{
+    if (high) {
+        hostGPIOB.IDR |= ECHO_PIN;
+    } else {
+        hostGPIOB.IDR &= ~ECHO_PIN;
+    }
+    EXTI1_IRQHandler();
+}
+
+// runs the main loop and the sensor side by side for duration us
+static void runFor(uint32_t duration)
+{
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += STEP_US) {
+        uint32_t now = micros();
+
+        if (echoPending && !(hostGPIOB.IDR & ECHO_PIN) && (int32_t)(now - echoRiseAt) >= 0) {
+            echoEdge(true);
+        }
+        if (echoPending && (hostGPIOB.IDR & ECHO_PIN) && (int32_t)(now - echoFallAt) >= 0) {
+            echoPending = false;
+            echoEdge(false);
+        }
+
+        hostGPIOB.BSRR = 0;
+        hostGPIOB.BRR = 0;
+        Sonar_update();
+        if (hostGPIOB.BSRR & TRIGGER_PIN) {
+            triggerHighAt = now;
+        }
+        if (hostGPIOB.BRR & TRIGGER_PIN) {
+            if (now - triggerHighAt < shortestTriggerUs) {
+                shortestTriggerUs = now - triggerHighAt;
+            }
+            onPing(now);
+        }
+
+        mockAdvanceMicros(STEP_US);
+    }
+}
+
+TEST(SonarTest, TriggerPulseDoesNotBlock)
+{
+    // given
+    setupSonar();
+
+    // when the first update raises the trigger
+    hostGPIOB.BSRR = 0;
+    Sonar_update();
+    EXPECT_EQ(TRIGGER_PIN, hostGPIOB.BSRR);
+    uint32_t raisedAt = micros();
+
+    // then it returns at once and the next update within 10us leaves it high
+    mockAdvanceMicros(5);
+    hostGPIOB.BRR = 0;
+    Sonar_update();
+    EXPECT_EQ(raisedAt + 5, micros());
+    EXPECT_EQ(0, hostGPIOB.BRR);
+
+    // and the first one after that drops it
+    mockAdvanceMicros(6);
+    Sonar_update();
+    EXPECT_EQ(TRIGGER_PIN, hostGPIOB.BRR);
+}
+
+TEST(SonarTest, MeasuresSteadyDistance)
+{
+    // given
+    setupSonar();
+    int32_t distance = 120;
+    queueEchoes(&distance, 1);
+
+    // when
+    runFor(300000);
+
+    // then
+    EXPECT_EQ(120, sonarGetDistance(micros()));
+    EXPECT_GE(shortestTriggerUs, 11u);
+}
+
+TEST(SonarTest, MedianRejectsSpikesAndDropouts)
+{
+    // given a noisy surface with a stray far echo and a missed one among the pings
+    setupSonar();
+    static const int32_t distances[] = { 100, 101, 99, 100, 280, 100, NO_ECHO, 101, 99, 350, 100, 100 };
+    queueEchoes(distances, sizeof(distances) / sizeof(distances[0]));
+    jitterCm = 1;
+
+    // when every ping is followed by an update of the estimate
+    int32_t lowest = INT32_MAX, highest = INT32_MIN;
+    int lastPing = 0;
+    while (echoIndex < echoCount) {
+        runFor(STEP_US);
+        if (pingCount != lastPing && pingCount > 3) {
+            int32_t estimate = sonarGetDistance(micros());
+            if (estimate < lowest) {
+                lowest = estimate;
+            }
+            if (estimate > highest) {
+                highest = estimate;
+            }
+        }
+        lastPing = pingCount;
+    }
+
+    // then none of the outliers shows
+    EXPECT_GE(lowest, 97);
+    EXPECT_LE(highest, 103);
+}
+
+TEST(SonarTest, PingsAgainOnceEchoIsBack)
+{
+    // given
+    setupSonar();
+    int32_t distance = 50;
+    queueEchoes(&distance, 1);
+
+    // when
+    runFor(1000000);
+
+    // then it pings at the minimum interval, not every 60ms
+    EXPECT_GE(pingCount, 32);
+    for (int i = 1; i < pingCount && i < MAX_PINGS; i++) {
+        EXPECT_GE(pingTimes[i] - pingTimes[i - 1], 30000u);
+        EXPECT_LE(pingTimes[i] - pingTimes[i - 1], 30000u + 2 * STEP_US);
+    }
+}
+
+TEST(SonarTest, LongEchoDelaysNextPing)
+{
+    // given nothing in range, where the sensor holds the echo high for longer than the ping interval
+    setupSonar();
+    int32_t distance = 600;
+    queueEchoes(&distance, 1);
+
+    // when
+    runFor(500000);
+
+    // then the next ping waits for the echo and follows right after
+    ASSERT_GE(pingCount, 3);
+    uint32_t echoUs = ECHO_DELAY_US + 600 * US_PER_CM;
+    for (int i = 1; i < pingCount && i < MAX_PINGS; i++) {
+        EXPECT_GE(pingTimes[i] - pingTimes[i - 1], echoUs);
+        EXPECT_LE(pingTimes[i] - pingTimes[i - 1], echoUs + 3 * STEP_US);
+    }
+    EXPECT_EQ(-1, sonarGetDistance(micros()));
+}
+
+TEST(SonarTest, MissingEchoTimesOut)
+{
+    // given a sensor that never answers
+    setupSonar();
+    int32_t distance = NO_ECHO;
+    queueEchoes(&distance, 1);
+
+    // when
+    runFor(500000);
+
+    // then it keeps pinging every timeout and reports out of range
+    EXPECT_GE(pingCount, 8);
+    EXPECT_EQ(-1, sonarGetDistance(micros()));
+}
+
+TEST(SonarTest, StaleDistanceIsNotUsed)
+{
+    // given
+    setupSonar();
+    int32_t distance = 80;
+    queueEchoes(&distance, 1);
+    runFor(300000);
+    uint32_t now = micros();
+    ASSERT_EQ(80, sonarGetDistance(now));
+    EXPECT_LT(sonarGetSampleAge(now), 40000u);
+
+    // then a reading older than the altitude estimate can use is dropped
+    EXPECT_EQ(80, sonarGetDistance(now + 50000));
+    EXPECT_EQ(-1, sonarGetDistance(now + 200000));
+}
+
+TEST(SonarTest, TiltCorrectionDoesNotCompound)
+{
+    // given
+    setupSonar();
+    int32_t distance = 200;
+    queueEchoes(&distance, 1);
+    runFor(300000);
+
+    // when the altitude is worked out again and again from the same reading
+    int32_t altitude = 0;
+    for (int i = 0; i < 10; i++) {
+        altitude = sonarCalculateAltitude(sonarGetDistance(micros()), 225);
+    }
+
+    // then it is corrected once, 200 * (900 - 225) / 900
+    EXPECT_EQ(150, altitude);
+    EXPECT_EQ(-1, sonarCalculateAltitude(sonarGetDistance(micros()), 300));
+}
+
+// STUBS
+
+GPIO_TypeDef hostGPIOA, hostGPIOB;
+
+void sensorsSet(uint32_t mask) { UNUSED(mask); }
+void gpioInit(GPIO_TypeDef *gpio, gpio_config_t *config) { UNUSED(gpio); UNUSED(config); }
+void gpioExtiLineConfig(uint8_t portsrc, uint8_t pinsrc) { UNUSED(portsrc); UNUSED(pinsrc); }
+void EXTI_Init(EXTI_InitTypeDef *EXTI_InitStruct) { UNUSED(EXTI_InitStruct); }
+void EXTI_ClearITPendingBit(uint32_t EXTI_Line) { UNUSED(EXTI_Line); }
+void NVIC_EnableIRQ(IRQn_Type IRQn) { UNUSED(IRQn); }
@@ -0,0 +1,193 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+
+#include <math.h>
+
+#include "common/axis.h"
+#include "sensors/vibration.h"
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define TEST_ACC_1G 4096
+#define TEST_ACC_FULL_SCALE_G 8
+#define TEST_LOOPRATE_HZ 1000
+
+static vibrationConfig_t testConfig = { 0 };
+static int16_t sample[XYZ_AXIS_COUNT];
+
+static void setupMonitor(void)
+{
+    testConfig.acc_vibration_warning = 0;
+    useVibrationConfig(&testConfig);
+    vibrationInit(TEST_ACC_1G, TEST_ACC_FULL_SCALE_G);
+}
+
+// feeds a sinusoid of the given amplitude and frequency on top of a constant offset, on every axis
+static void feedSinusoid(vibrationSensor_e sensor, int16_t offset, int16_t amplitude, float frequencyHz, int cycles)
+{
+    for (int cycle = 0; cycle < cycles; cycle++) {
+        float phase = 2 * M_PI * frequencyHz * cycle / TEST_LOOPRATE_HZ;
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            sample[axis] = offset + lrintf(amplitude * sinf(phase + axis));
+        }
+        vibrationUpdate(sensor, sample);
+    }
+}
+
+TEST(VibrationTest, ConstantSignalHasNoVibration)
+{
+    // given
+    setupMonitor();
+
+    // when
+    feedSinusoid(VIBRATION_SENSOR_ACC, TEST_ACC_1G, 0, 0, 1000);
+
+    // then
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        EXPECT_EQ(0, vibrationRms(VIBRATION_SENSOR_ACC, axis));
+        EXPECT_EQ(0, vibrationPeak(VIBRATION_SENSOR_ACC, axis));
+    }
+    EXPECT_EQ(0, vibrationClipCount(VIBRATION_SENSOR_ACC));
+}
+
+TEST(VibrationTest, SinusoidRmsAndPeak)
+{
+    // given
+    setupMonitor();
+    feedSinusoid(VIBRATION_SENSOR_ACC, TEST_ACC_1G, 1000, 150, 100);
+    vibrationReset();   // drop the high pass settling transient
+
+    // when
+    feedSinusoid(VIBRATION_SENSOR_ACC, TEST_ACC_1G, 1000, 150, 2000);
+
+    // then
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        EXPECT_NEAR(1000 / sqrtf(2), vibrationRms(VIBRATION_SENSOR_ACC, axis), 1000 * 0.1f);
+        EXPECT_NEAR(1000, vibrationPeak(VIBRATION_SENSOR_ACC, axis), 1000 * 0.15f);
+    }
+    EXPECT_EQ(0, vibrationClipCount(VIBRATION_SENSOR_ACC));
+}
+
+TEST(VibrationTest, SlowMotionIsFilteredOut)
+{
+    // given
+    setupMonitor();
+
+    // when
+    feedSinusoid(VIBRATION_SENSOR_GYRO, 0, 1000, 0.5f, 4000);
+
+    // then
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        EXPECT_LT(vibrationRms(VIBRATION_SENSOR_GYRO, axis), 1000 * 0.05f);
+    }
+}
+
+TEST(VibrationTest, ClippedSamplesAreCounted)
+{
+    // given
+    setupMonitor();
+
+    // when
+    feedSinusoid(VIBRATION_SENSOR_ACC, 0, INT16_MAX, 100, 100);
+    feedSinusoid(VIBRATION_SENSOR_GYRO, 0, 1000, 100, 100);
+
+    // then
+    EXPECT_GT(vibrationClipCount(VIBRATION_SENSOR_ACC), 0u);
+    EXPECT_LT(vibrationClipCount(VIBRATION_SENSOR_ACC), 100u);
+    EXPECT_EQ(0, vibrationClipCount(VIBRATION_SENSOR_GYRO));
+}
+
+TEST(VibrationTest, ClippingFollowsTheAccRange)
+{
+    // given a +/-4G sensor at its rails, which an 8G limit never sees
+    setupMonitor();
+    feedSinusoid(VIBRATION_SENSOR_ACC, 0, TEST_ACC_1G * 4 - 1, 100, 100);
+    EXPECT_EQ(0, vibrationClipCount(VIBRATION_SENSOR_ACC));
+
+    // when
+    vibrationInit(TEST_ACC_1G, 4);
+    feedSinusoid(VIBRATION_SENSOR_ACC, 0, TEST_ACC_1G * 4 - 1, 100, 100);
+
+    // then
+    EXPECT_GT(vibrationClipCount(VIBRATION_SENSOR_ACC), 0u);
+    EXPECT_TRUE(isVibrationWarningActive());
+}
+
+TEST(VibrationTest, ResetClearsStatistics)
+{
+    // given
+    setupMonitor();
+    feedSinusoid(VIBRATION_SENSOR_GYRO, 0, INT16_MAX, 100, 100);
+
+    // when
+    vibrationReset();
+
+    // then
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        EXPECT_EQ(0, vibrationRms(VIBRATION_SENSOR_GYRO, axis));
+        EXPECT_EQ(0, vibrationPeak(VIBRATION_SENSOR_GYRO, axis));
+    }
+    EXPECT_EQ(0, vibrationClipCount(VIBRATION_SENSOR_GYRO));
+    EXPECT_FALSE(isVibrationWarningActive());
+}
+
+TEST(VibrationTest, ClippingWarningTimesOut)
+{
+    // given
+    setupMonitor();
+    EXPECT_FALSE(isVibrationWarningActive());
+
+    // when
+    sample[X] = INT16_MIN;
+    vibrationUpdate(VIBRATION_SENSOR_GYRO, sample);
+
+    // then
+    EXPECT_TRUE(isVibrationWarningActive());
+
+    // when
+    feedSinusoid(VIBRATION_SENSOR_GYRO, 0, 0, 0, VIBRATION_CLIP_WARNING_CYCLES - 1);
+
+    // then
+    EXPECT_TRUE(isVibrationWarningActive());
+
+    // when
+    feedSinusoid(VIBRATION_SENSOR_GYRO, 0, 0, 0, 1);
+
+    // then
+    EXPECT_FALSE(isVibrationWarningActive());
+}
+
+TEST(VibrationTest, AccRmsWarning)
+{
+    // given
+    setupMonitor();
+    testConfig.acc_vibration_warning = 50;     // 0.5G
+
+    // when
+    feedSinusoid(VIBRATION_SENSOR_ACC, TEST_ACC_1G, TEST_ACC_1G / 4, 150, 1000);
+
+    // then
+    EXPECT_FALSE(isVibrationWarningActive());
+
+    // when
+    feedSinusoid(VIBRATION_SENSOR_ACC, TEST_ACC_1G, TEST_ACC_1G, 150, 1000);
+
+    // then
+    EXPECT_TRUE(isVibrationWarningActive());
+}
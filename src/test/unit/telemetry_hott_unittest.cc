@@ -41,7 +41,7 @@
 #include "telemetry/telemetry.h"
 #include "telemetry/hott.h"
 
-#include "io/gps_conversion.h"
+#include "flight/gps_conversion.h"
 
 
 #include "unittest_macros.h"
@@ -0,0 +1,389 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "msp.h"
+
+#define READ_CHUNK_SIZE 256
+
+enum {
+    STATE_IDLE,
+    STATE_HEADER_START,
+    STATE_HEADER_M,
+    STATE_HEADER_DIRECTION,
+    STATE_HEADER_SIZE,
+    STATE_HEADER_COMMAND
+};
+
+uint64_t mspMicros(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+size_t mspEncodeRequest(uint8_t *buffer, uint8_t command, const uint8_t *payload, uint8_t size)
+{
+    size_t length = 0;
+    uint8_t checksum = size ^ command;
+
+    buffer[length++] = '$';
+    buffer[length++] = 'M';
+    buffer[length++] = '<';
+    buffer[length++] = size;
+    buffer[length++] = command;
+    for (uint8_t i = 0; i < size; i++) {
+        buffer[length++] = payload[i];
+        checksum ^= payload[i];
+    }
+    buffer[length++] = checksum;
+
+    return length;
+}
+
+void mspDecoderReset(mspDecoder_t *decoder)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->state = STATE_IDLE;
+}
+
+mspDecodeResult_e mspDecode(mspDecoder_t *decoder, uint8_t c)
+{
+    mspFrame_t *frame = &decoder->frame;
+
+    switch (decoder->state) {
+        case STATE_IDLE:
+            if (c == '$') {
+                decoder->state = STATE_HEADER_START;
+            } else {
+                decoder->discardedBytes++;
+            }
+            break;
+        case STATE_HEADER_START:
+            decoder->state = (c == 'M') ? STATE_HEADER_M : STATE_IDLE;
+            break;
+        case STATE_HEADER_M:
+            if (c == '>' || c == '!') {
+                frame->error = (c == '!');
+                decoder->state = STATE_HEADER_DIRECTION;
+            } else {
+                decoder->state = STATE_IDLE;
+            }
+            break;
+        case STATE_HEADER_DIRECTION:
+            frame->size = c;
+            decoder->checksum = c;
+            decoder->offset = 0;
+            decoder->state = STATE_HEADER_SIZE;
+            break;
+        case STATE_HEADER_SIZE:
+            frame->command = c;
+            decoder->checksum ^= c;
+            decoder->state = STATE_HEADER_COMMAND;
+            break;
+        case STATE_HEADER_COMMAND:
+            if (decoder->offset < frame->size) {
+                frame->payload[decoder->offset++] = c;
+                decoder->checksum ^= c;
+                break;
+            }
+            decoder->state = STATE_IDLE;
+            return (decoder->checksum == c) ? MSP_DECODE_FRAME : MSP_DECODE_CHECKSUM_ERROR;
+    }
+    return MSP_DECODE_PENDING;
+}
+
+static speed_t baudRateToSpeed(uint32_t baudRate)
+{
+    switch (baudRate) {
+        case 9600:
+            return B9600;
+        case 19200:
+            return B19200;
+        case 38400:
+            return B38400;
+        case 57600:
+            return B57600;
+        case 230400:
+            return B230400;
+        case 460800:
+            return B460800;
+        case 921600:
+            return B921600;
+        default:
+            return B115200;
+    }
+}
+
+int mspOpenPort(const char *path, uint32_t baudRate)
+{
+    struct termios options;
+
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (tcgetattr(fd, &options) == 0) {
+        cfmakeraw(&options);
+        options.c_cflag |= CLOCAL | CREAD;
+        options.c_cflag &= ~CRTSCTS;
+        options.c_cc[VMIN] = 0;
+        options.c_cc[VTIME] = 0;
+        cfsetispeed(&options, baudRateToSpeed(baudRate));
+        cfsetospeed(&options, baudRateToSpeed(baudRate));
+        if (tcsetattr(fd, TCSANOW, &options) != 0) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+        tcflush(fd, TCIOFLUSH);
+    }
+
+    return fd;
+}
+
+static mspCommandStats_t *findStats(mspClient_t *client, uint8_t command)
+{
+    for (uint8_t i = 0; i < client->statsCount; i++) {
+        if (client->stats[i].command == command) {
+            return &client->stats[i];
+        }
+    }
+    return NULL;
+}
+
+bool mspClientInit(mspClient_t *client, int fd, uint32_t timeout, const uint8_t *commands, uint8_t commandCount)
+{
+    memset(client, 0, sizeof(*client));
+    client->fd = fd;
+    client->timeout = timeout;
+    mspDecoderReset(&client->decoder);
+
+    client->stats = calloc(commandCount ? commandCount : 1, sizeof(mspCommandStats_t));
+    if (!client->stats) {
+        return false;
+    }
+    for (uint8_t i = 0; i < commandCount; i++) {
+        if (!findStats(client, commands[i])) {
+            client->stats[client->statsCount++].command = commands[i];
+        }
+    }
+    return true;
+}
+
+void mspClientFree(mspClient_t *client)
+{
+    for (uint8_t i = 0; i < client->statsCount; i++) {
+        free(client->stats[i].latency.samples);
+    }
+    free(client->stats);
+    client->stats = NULL;
+    client->statsCount = 0;
+}
+
+static void addLatencySample(mspLatencyStats_t *latency, uint32_t sample)
+{
+    if (latency->count == latency->capacity) {
+        uint32_t capacity = latency->capacity ? latency->capacity * 2 : 1024;
+        uint32_t *samples = realloc(latency->samples, capacity * sizeof(uint32_t));
+        if (!samples) {
+            return;
+        }
+        latency->samples = samples;
+        latency->capacity = capacity;
+    }
+    latency->samples[latency->count++] = sample;
+}
+
+static mspPendingRequest_t *pendingAt(mspClient_t *client, uint8_t index)
+{
+    return &client->pending[(client->pendingHead + index) % MSP_MAX_PENDING];
+}
+
+static void popPending(mspClient_t *client)
+{
+    client->pendingHead = (client->pendingHead + 1) % MSP_MAX_PENDING;
+    client->pendingCount--;
+}
+
+bool mspClientSend(mspClient_t *client, uint8_t command, const uint8_t *payload, uint8_t size)
+{
+    uint8_t buffer[MSP_MAX_FRAME_SIZE];
+    size_t length = mspEncodeRequest(buffer, command, payload, size);
+    size_t written = 0;
+
+    if (client->pendingCount == MSP_MAX_PENDING) {
+        return false;
+    }
+
+    while (written < length) {
+        ssize_t result = write(client->fd, buffer + written, length - written);
+        if (result < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                return false;
+            }
+            struct pollfd pollFd = { client->fd, POLLOUT, 0 };
+            poll(&pollFd, 1, 10);
+            continue;
+        }
+        written += result;
+    }
+
+    mspPendingRequest_t *request = pendingAt(client, client->pendingCount);
+    request->command = command;
+    request->sentAt = mspMicros();
+    client->pendingCount++;
+
+    mspCommandStats_t *stats = findStats(client, command);
+    if (stats) {
+        stats->sent++;
+    }
+    return true;
+}
+
+// the answer belongs to the oldest request for its command, the requests before that went unanswered
+static int matchFrame(mspClient_t *client, const mspFrame_t *frame, uint64_t now)
+{
+    uint8_t index;
+    int completed = 0;
+
+    for (index = 0; index < client->pendingCount; index++) {
+        if (pendingAt(client, index)->command == frame->command) {
+            break;
+        }
+    }
+    if (index == client->pendingCount) {
+        client->unexpectedFrames++;
+        return 0;
+    }
+
+    while (index--) {
+        mspCommandStats_t *stats = findStats(client, pendingAt(client, 0)->command);
+        if (stats) {
+            stats->lost++;
+        }
+        popPending(client);
+        completed++;
+    }
+
+    mspCommandStats_t *stats = findStats(client, frame->command);
+    if (stats) {
+        if (frame->error) {
+            stats->errorFrames++;
+        } else {
+            stats->answered++;
+            addLatencySample(&stats->latency, (uint32_t)(now - pendingAt(client, 0)->sentAt));
+        }
+    }
+    popPending(client);
+    return completed + 1;
+}
+
+static int expirePending(mspClient_t *client, uint64_t now)
+{
+    int completed = 0;
+
+    while (client->pendingCount && now - pendingAt(client, 0)->sentAt > client->timeout) {
+        mspCommandStats_t *stats = findStats(client, pendingAt(client, 0)->command);
+        if (stats) {
+            stats->timeouts++;
+        }
+        popPending(client);
+        completed++;
+    }
+    return completed;
+}
+
+int mspClientPoll(mspClient_t *client, uint32_t wait)
+{
+    uint8_t buffer[READ_CHUNK_SIZE];
+    struct pollfd pollFd = { client->fd, POLLIN, 0 };
+    int completed = 0;
+
+    int ready = poll(&pollFd, 1, (wait + 999) / 1000);
+    if (ready < 0 && errno != EINTR) {
+        return -1;
+    }
+
+    while (ready > 0) {
+        ssize_t length = read(client->fd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                break;
+            }
+            return -1;
+        }
+        if (length == 0) {
+            break;
+        }
+
+        uint64_t now = mspMicros();
+        for (ssize_t i = 0; i < length; i++) {
+            switch (mspDecode(&client->decoder, buffer[i])) {
+                case MSP_DECODE_FRAME:
+                    completed += matchFrame(client, &client->decoder.frame, now);
+                    break;
+                case MSP_DECODE_CHECKSUM_ERROR:
+                    client->checksumErrors++;
+                    break;
+                case MSP_DECODE_PENDING:
+                    break;
+            }
+        }
+    }
+
+    return completed + expirePending(client, mspMicros());
+}
+
+uint8_t mspClientPendingCount(const mspClient_t *client)
+{
+    return client->pendingCount;
+}
+
+static int compareSamples(const void *a, const void *b)
+{
+    uint32_t sampleA = *(const uint32_t *)a;
+    uint32_t sampleB = *(const uint32_t *)b;
+    return (sampleA > sampleB) - (sampleA < sampleB);
+}
+
+uint32_t mspLatencyPercentile(mspLatencyStats_t *latency, uint8_t percentile)
+{
+    if (!latency->count) {
+        return 0;
+    }
+    qsort(latency->samples, latency->count, sizeof(uint32_t), compareSamples);
+
+    uint32_t rank = ((uint64_t)latency->count * percentile + 99) / 100;
+    return latency->samples[rank ? rank - 1 : 0];
+}
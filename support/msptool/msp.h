@@ -0,0 +1,134 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Host side of the MultiWii Serial Protocol as the firmware speaks it in io/serial_msp.c.
+//
+// A request is '$', 'M', '<', the payload size, the command, the payload and a checksum, the xor of the
+// size, command and payload.  The board answers in the same framing with '>' in place of '<', or with '!'
+// when it does not know the command.  Commands are answered one at a time in the order they arrived and
+// carry no sequence number, so a client that sends several requests before the first answer matches the
+// answers to the requests in order.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MSP_MAX_PAYLOAD_SIZE 255
+#define MSP_MAX_FRAME_SIZE (3 + 1 + 1 + MSP_MAX_PAYLOAD_SIZE + 1)
+#define MSP_MAX_PENDING 64                      // requests in flight
+
+#define MSP_IDENT                100
+#define MSP_STATUS               101
+#define MSP_RAW_IMU              102
+#define MSP_SERVO                103
+#define MSP_MOTOR                104
+#define MSP_RC                   105
+#define MSP_RAW_GPS              106
+#define MSP_ATTITUDE             108
+#define MSP_ALTITUDE             109
+#define MSP_ANALOG               110
+
+typedef struct mspFrame_s {
+    uint8_t command;
+    uint8_t size;
+    bool error;                                 // '$M!', the board did not know the command
+    uint8_t payload[MSP_MAX_PAYLOAD_SIZE];
+} mspFrame_t;
+
+typedef enum {
+    MSP_DECODE_PENDING = 0,                     // more bytes needed
+    MSP_DECODE_FRAME,                           // a complete frame with a good checksum
+    MSP_DECODE_CHECKSUM_ERROR                   // a complete frame with a bad checksum, dropped
+} mspDecodeResult_e;
+
+typedef struct mspDecoder_s {
+    uint8_t state;
+    uint8_t offset;
+    uint8_t checksum;
+    uint32_t discardedBytes;                    // bytes outside of any frame
+    mspFrame_t frame;
+} mspDecoder_t;
+
+// Writes a request into buffer, which must hold MSP_MAX_FRAME_SIZE bytes, and returns its length.
+size_t mspEncodeRequest(uint8_t *buffer, uint8_t command, const uint8_t *payload, uint8_t size);
+
+void mspDecoderReset(mspDecoder_t *decoder);
+// Feeds one received byte, the frame is in decoder->frame when MSP_DECODE_FRAME is returned.
+mspDecodeResult_e mspDecode(mspDecoder_t *decoder, uint8_t c);
+
+typedef struct mspLatencyStats_s {
+    uint32_t *samples;                          // round trip times in us
+    uint32_t count;
+    uint32_t capacity;
+} mspLatencyStats_t;
+
+typedef struct mspCommandStats_s {
+    uint8_t command;
+    uint32_t sent;
+    uint32_t answered;
+    uint32_t errorFrames;
+    uint32_t timeouts;                          // no answer within the timeout
+    uint32_t lost;                              // skipped over by the answer to a later request
+    mspLatencyStats_t latency;
+} mspCommandStats_t;
+
+typedef struct mspPendingRequest_s {
+    uint8_t command;
+    uint64_t sentAt;                            // us
+} mspPendingRequest_t;
+
+typedef struct mspClient_s {
+    int fd;
+    uint32_t timeout;                           // us
+    mspDecoder_t decoder;
+
+    mspPendingRequest_t pending[MSP_MAX_PENDING];
+    uint8_t pendingHead;
+    uint8_t pendingCount;
+
+    uint32_t checksumErrors;
+    uint32_t unexpectedFrames;                  // answers to no request in flight
+
+    mspCommandStats_t *stats;
+    uint8_t statsCount;
+} mspClient_t;
+
+// Opens a tty or pty at the baud rate in raw mode, returns -1 and sets errno on failure.
+int mspOpenPort(const char *path, uint32_t baudRate);
+
+// The client keeps stats for the commands in the list, once for each, others are sent and matched but not
+// counted.
+bool mspClientInit(mspClient_t *client, int fd, uint32_t timeout, const uint8_t *commands, uint8_t commandCount);
+void mspClientFree(mspClient_t *client);
+
+// Sends a request without waiting for the answer.  Returns false when MSP_MAX_PENDING are in flight or the
+// write failed.
+bool mspClientSend(mspClient_t *client, uint8_t command, const uint8_t *payload, uint8_t size);
+
+// Reads what has arrived, waiting up to wait us for the first byte, matches the answers to the requests in
+// flight and expires those past the timeout.  Returns the number of requests that completed, answered or
+// not, or -1 when reading failed.
+int mspClientPoll(mspClient_t *client, uint32_t wait);
+
+uint8_t mspClientPendingCount(const mspClient_t *client);
+
+// Sorts the samples and returns the one at the percentile, nearest rank, 0 without samples.
+uint32_t mspLatencyPercentile(mspLatencyStats_t *latency, uint8_t percentile);
+
+uint64_t mspMicros(void);
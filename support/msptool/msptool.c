@@ -0,0 +1,228 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures how quickly a board answers MSP requests over a serial port, or a pty for the host build.
+//
+//   msptool [-b baud] [-c commands] [-n count] [-d seconds] [-w window] [-t timeout ms] port
+//
+// Requests for the commands are sent round robin with up to window of them in flight, until count have been
+// sent or the time is up.  The tool then prints, per command, the answers, the p50, p99 and max round trip
+// times, and the messages per second achieved, and exits with 2 when any answer was corrupt or missing.
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "msp.h"
+
+#define DEFAULT_BAUD_RATE 115200
+#define DEFAULT_COMMANDS "status,raw_imu,motor,rc"
+#define DEFAULT_COUNT 1000
+#define DEFAULT_WINDOW 1
+#define DEFAULT_TIMEOUT_MS 500
+#define MAX_COMMANDS 16
+#define POLL_WAIT_US 1000
+
+typedef struct commandName_s {
+    const char *name;
+    uint8_t command;
+} commandName_t;
+
+static const commandName_t commandNames[] = {
+    { "ident", MSP_IDENT },
+    { "status", MSP_STATUS },
+    { "raw_imu", MSP_RAW_IMU },
+    { "servo", MSP_SERVO },
+    { "motor", MSP_MOTOR },
+    { "rc", MSP_RC },
+    { "raw_gps", MSP_RAW_GPS },
+    { "attitude", MSP_ATTITUDE },
+    { "altitude", MSP_ALTITUDE },
+    { "analog", MSP_ANALOG },
+};
+
+#define COMMAND_NAME_COUNT (sizeof(commandNames) / sizeof(commandNames[0]))
+
+static const char *commandName(uint8_t command)
+{
+    static char number[4];
+
+    for (unsigned i = 0; i < COMMAND_NAME_COUNT; i++) {
+        if (commandNames[i].command == command) {
+            return commandNames[i].name;
+        }
+    }
+    snprintf(number, sizeof(number), "%u", command);
+    return number;
+}
+
+// a comma separated list of names or command numbers
+static int parseCommands(char *list, uint8_t *commands)
+{
+    int count = 0;
+
+    for (char *token = strtok(list, ","); token; token = strtok(NULL, ",")) {
+        char *end;
+        long number = strtol(token, &end, 0);
+        int command = -1;
+
+        if (*end == '\0' && number >= 0 && number <= 255) {
+            command = number;
+        }
+        for (unsigned i = 0; i < COMMAND_NAME_COUNT && command < 0; i++) {
+            if (strcmp(token, commandNames[i].name) == 0) {
+                command = commandNames[i].command;
+            }
+        }
+        if (command < 0 || count == MAX_COMMANDS) {
+            fprintf(stderr, "unknown command or too many commands: %s\n", token);
+            return -1;
+        }
+        commands[count++] = command;
+    }
+    return count;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+        "usage: %s [-b baud] [-c commands] [-n count] [-d seconds] [-w window] [-t timeout ms] port\n"
+        "  -b  baud rate, default %d\n"
+        "  -c  comma separated command names or numbers, default %s\n"
+        "  -n  requests to send, default %d\n"
+        "  -d  stop sending after this many seconds instead\n"
+        "  -w  requests in flight at once, 1 to %d, default %d\n"
+        "  -t  time to wait for an answer, default %d\n",
+        name, DEFAULT_BAUD_RATE, DEFAULT_COMMANDS, DEFAULT_COUNT, MSP_MAX_PENDING, DEFAULT_WINDOW, DEFAULT_TIMEOUT_MS);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t baudRate = DEFAULT_BAUD_RATE;
+    char commandList[256] = DEFAULT_COMMANDS;
+    uint32_t count = DEFAULT_COUNT;
+    double duration = 0;
+    uint32_t window = DEFAULT_WINDOW;
+    uint32_t timeoutMs = DEFAULT_TIMEOUT_MS;
+    int option;
+
+    while ((option = getopt(argc, argv, "b:c:n:d:w:t:h")) != -1) {
+        switch (option) {
+            case 'b':
+                baudRate = strtoul(optarg, NULL, 10);
+                break;
+            case 'c':
+                snprintf(commandList, sizeof(commandList), "%s", optarg);
+                break;
+            case 'n':
+                count = strtoul(optarg, NULL, 10);
+                break;
+            case 'd':
+                duration = atof(optarg);
+                count = UINT32_MAX;
+                break;
+            case 'w':
+                window = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                timeoutMs = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1 || window < 1 || window > MSP_MAX_PENDING || count == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    uint8_t commands[MAX_COMMANDS];
+    int commandCount = parseCommands(commandList, commands);
+    if (commandCount <= 0) {
+        return 1;
+    }
+
+    int fd = mspOpenPort(argv[optind], baudRate);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open %s: %s\n", argv[optind], strerror(errno));
+        return 1;
+    }
+
+    mspClient_t client;
+    if (!mspClientInit(&client, fd, timeoutMs * 1000, commands, commandCount)) {
+        fprintf(stderr, "out of memory\n");
+        close(fd);
+        return 1;
+    }
+
+    uint32_t sent = 0;
+    uint64_t start = mspMicros();
+    uint64_t stopSendingAt = start + (uint64_t)(duration * 1e6);
+
+    while (sent < count && (duration == 0 || mspMicros() < stopSendingAt)) {
+        while (mspClientPendingCount(&client) < window && sent < count) {
+            if (!mspClientSend(&client, commands[sent % commandCount], NULL, 0)) {
+                fprintf(stderr, "write to %s failed: %s\n", argv[optind], strerror(errno));
+                mspClientFree(&client);
+                close(fd);
+                return 1;
+            }
+            sent++;
+        }
+        if (mspClientPoll(&client, POLL_WAIT_US) < 0) {
+            fprintf(stderr, "read from %s failed: %s\n", argv[optind], strerror(errno));
+            mspClientFree(&client);
+            close(fd);
+            return 1;
+        }
+    }
+    while (mspClientPendingCount(&client)) {
+        if (mspClientPoll(&client, POLL_WAIT_US) < 0) {
+            break;
+        }
+    }
+    double elapsed = (mspMicros() - start) / 1e6;
+
+    uint32_t answered = 0;
+    uint32_t failed = client.checksumErrors + client.unexpectedFrames;
+
+    printf("%-10s %8s %8s %6s %8s %6s %8s %8s %8s\n", "command", "sent", "answered", "lost", "timeouts", "errors",
+        "p50 us", "p99 us", "max us");
+    for (uint8_t i = 0; i < client.statsCount; i++) {
+        mspCommandStats_t *stats = &client.stats[i];
+        printf("%-10s %8u %8u %6u %8u %6u %8u %8u %8u\n", commandName(stats->command), stats->sent, stats->answered,
+            stats->lost, stats->timeouts, stats->errorFrames,
+            mspLatencyPercentile(&stats->latency, 50),
+            mspLatencyPercentile(&stats->latency, 99),
+            mspLatencyPercentile(&stats->latency, 100));
+        answered += stats->answered;
+        failed += stats->lost + stats->timeouts + stats->errorFrames;
+    }
+    printf("%u answered in %.2f s, %.1f msgs/s with %u in flight, %u checksum errors, %u unexpected answers\n",
+        answered, elapsed, answered / elapsed, window, client.checksumErrors, client.unexpectedFrames);
+
+    mspClientFree(&client);
+    close(fd);
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,134 @@
+#!/usr/bin/awk -f
+#
+# This file is part of Cleanflight.
+#
+# Cleanflight is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Cleanflight is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Static RAM per module from a GNU ld map file, largest first, followed by the totals against the RAM
+# region of the linker script.  Run by 'make ramreport', or by hand:
+#
+#   awk -f support/ramreport.awk obj/cleanflight_NAZE.map
+#
+# Input sections are counted by the output section they end up in, .data and .bss.  The heap and stack
+# reservation has no input sections and is only counted in the totals.
+
+function hex(s,    i, n)
+{
+    n = 0
+    s = tolower(s)
+    sub(/^0x/, "", s)
+    for (i = 1; i <= length(s); i++) {
+        n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+    }
+    return n
+}
+
+function isHex(s)
+{
+    return s ~ /^0x[0-9a-fA-F]+$/
+}
+
+function moduleName(file)
+{
+    if (file ~ /\.a\(/) {
+        sub(/^.*\//, "", file)      # library member, keep the archive name
+    } else {
+        sub(/^.*obj\/main\/[^\/]*\//, "", file)
+        sub(/\.o$/, "", file)
+    }
+    return file
+}
+
+function addInputSection(size, file)
+{
+    if (size == 0 || (outputSection != ".data" && outputSection != ".bss")) {
+        return
+    }
+    if (file == "") {
+        file = "(fill)"
+    }
+    module = moduleName(file)
+    modules[module] = 1
+    if (outputSection == ".data") {
+        data[module] += size
+    } else {
+        bss[module] += size
+    }
+}
+
+/^Memory Configuration/ { inMemoryConfiguration = 1; next }
+/^Linker script and memory map/ { inMemoryConfiguration = 0; inMemoryMap = 1; next }
+
+inMemoryConfiguration && $1 == "RAM" && isHex($3) {
+    ramLength = hex($3)
+    next
+}
+
+!inMemoryMap { next }
+
+# output sections start in the first column, a long name puts the address and size on the next line
+/^\.[A-Za-z_]/ {
+    outputSection = $1
+    pendingInputSection = 0
+    if (isHex($3)) {
+        outputSize[outputSection] = hex($3)
+    } else {
+        pendingOutputSection = 1
+    }
+    next
+}
+
+pendingOutputSection {
+    pendingOutputSection = 0
+    if (isHex($1) && isHex($2)) {
+        outputSize[outputSection] = hex($2)
+    }
+    next
+}
+
+# input sections are indented, again a long name wraps
+/^ [^ *]/ || /^ \*fill\*/ {
+    if (isHex($2) && isHex($3)) {
+        addInputSection(hex($3), $4)
+        pendingInputSection = 0
+    } else if (NF == 1) {
+        pendingInputSection = 1
+    }
+    next
+}
+
+pendingInputSection {
+    pendingInputSection = 0
+    if (isHex($1) && isHex($2)) {
+        addInputSection(hex($2), $3)
+    }
+    next
+}
+
+END {
+    printf("%-40s %8s %8s %8s\n", "module", "data", "bss", "total")
+    sortCommand = "sort -k4 -n -r"
+    for (module in modules) {
+        printf("%-40s %8d %8d %8d\n", module, data[module], bss[module], data[module] + bss[module]) | sortCommand
+    }
+    close(sortCommand)
+
+    used = outputSize[".data"] + outputSize[".bss"]
+    reserved = outputSize["._user_heap_stack"]
+    printf("\ndata %d, bss %d, heap and stack %d bytes", outputSize[".data"], outputSize[".bss"], reserved)
+    if (ramLength) {
+        printf(", %d of %d bytes of RAM free", ramLength - used - reserved, ramLength)
+    }
+    printf("\n")
+}